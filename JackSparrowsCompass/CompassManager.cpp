@@ -57,7 +57,7 @@ float const accCalibrationMatrix[3][3] =
 {-0.052, -0.006, 1.02}
 };
 
-float accBias[3] =
+float const accBias[3] =
 {
 -8.465,
 -6.363,
@@ -65,6 +65,13 @@ float accBias[3] =
 };
 
 
+// CompassSample derived values already computed
+const uint8_t SAMPLE_RAW_HEADING    = 0x01;
+const uint8_t SAMPLE_CALIB_HEADING  = 0x02;
+const uint8_t SAMPLE_ATTITUDE       = 0x04;     // pitch, roll and tilt angle
+const uint8_t SAMPLE_TILT_HEADING   = 0x08;
+
+
 /*-----------------------------------*
  * PRIVATE MACROS
  *-----------------------------------*/
@@ -79,9 +86,89 @@ float accBias[3] =
  * PRIVATE FUNCTION PROTOTYPES
  *-----------------------------------*/
 
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+/**
+ * @name headingDegrees
+ * @brief headingDegrees: heading of a horizontal vector
+ * @param [in] double x: x component
+ * @param [in] double y: y component
+ * @retval heading 0 to 360 deg [float]
+ */
+static float headingDegrees(double x, double y)
+{
+    float heading = (float)atan2(y, x) * 180 / PI;
+    if (heading < 0) {
+        heading = 360 + heading;
+    }
+    return heading;
+}
+
 /**********************************
  * CONSTRUCTOR & DESTRUCTOR METHODS
 ***********************************/
+/**
+ * @name CompassSample
+ * @brief CompassSample: empty sample, every heading 0 and level
+ */
+CompassSample::CompassSample()
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        rawMag[i]       = 0;
+        calibMag[i]     = 0;
+        magFiltered[i]  = 0;
+        accFiltered[i]  = 0;
+    }
+    offsetCompass   = 0;
+    headingMethod   = heading_method_t::VECTOR;
+    timestamp       = 0;
+
+    computed            = SAMPLE_RAW_HEADING | SAMPLE_CALIB_HEADING | SAMPLE_ATTITUDE | SAMPLE_TILT_HEADING;
+    rawHeading          = 0;
+    calibHeading        = 0;
+    tiltCalibHeading    = 0;
+    pitch               = 0;
+    roll                = 0;
+    tiltAngle           = 0;
+}
+
+/**
+ * @name CompassSample
+ * @brief CompassSample: snapshot of one sensor reading
+ * @param [in] const float rawMag[3]: raw magnetometer values
+ * @param [in] const float calibMag[3]: calibrated magnetometer values
+ * @param [in] const float magFiltered[3]: calibrated, normalized and low-pass filtered magnetometer values
+ * @param [in] const float accFiltered[3]: calibrated, normalized and low-pass filtered accelerometer values
+ * @param [in] float offsetCompass: compass offset deg, added to every heading
+ * @param [in] heading_method_t headingMethod: tilt compensated heading computation
+ * @param [in] uint32_t timestamp: millis() of the reading
+ */
+CompassSample::CompassSample(const float rawMag[3], const float calibMag[3], const float magFiltered[3],
+                             const float accFiltered[3], float offsetCompass, heading_method_t headingMethod,
+                             uint32_t timestamp)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        this->rawMag[i]         = rawMag[i];
+        this->calibMag[i]       = calibMag[i];
+        this->magFiltered[i]    = magFiltered[i];
+        this->accFiltered[i]    = accFiltered[i];
+    }
+    this->offsetCompass = offsetCompass;
+    this->headingMethod = headingMethod;
+    this->timestamp     = timestamp;
+
+    computed            = 0;
+    rawHeading          = 0;
+    calibHeading        = 0;
+    tiltCalibHeading    = 0;
+    pitch               = 0;
+    roll                = 0;
+    tiltAngle           = 0;
+}
+
 /**
  * @name CompassManager
  * @brief CompassManager: constructor
@@ -93,13 +180,6 @@ CompassManager::CompassManager()
 
     alpha = DEFAULT_ALPHA_VALUE;
 
-    rawHeading          = 0;
-    calibHeading        = 0;
-    tiltCalibHeading    = 0;
-
-    pitch   = 0;
-    roll    = 0;
-
     MxCalibNormFiltered = 0;
     MyCalibNormFiltered = 0;
     MzCalibNormFiltered = 0;
@@ -109,6 +189,11 @@ CompassManager::CompassManager()
 
     offsetCompass = 0;
 
+    headingMethod = heading_method_t::VECTOR;
+
+    setMagCalibration(magCalibrationMatrix, magBias);
+    setAccCalibration(accCalibrationMatrix, accBias);
+
     delay(500);
 }
 
@@ -117,9 +202,8 @@ CompassManager::CompassManager()
  * @brief CompassManager: get raw compass heading 
  * @param [in] float alpha: filter parameter 
  */
-CompassManager::CompassManager(float alpha)
+CompassManager::CompassManager(float alpha) : CompassManager()
 {
-    CompassManager();
     this->alpha = alpha;
 }
 
@@ -128,56 +212,186 @@ CompassManager::~CompassManager()
     // delete *lsm;
 }
 
+/*******************
+ * PUBLIC METHODS
+*******************/
 /**
  * @name getRawHeading
- * @brief getCalibratedHeading: get raw compass heading 
+ * @brief getRawHeading: raw compass heading of this sample
  * @retval compass heading value 0 to 360 deg [int]
  */
-int CompassManager::getRawHeading()
+int CompassSample::getRawHeading() const
 {
-    computeHeading();
+    if (!(computed & SAMPLE_RAW_HEADING))
+    {
+        //  Calculating heading with raw measurements not tilt compensated
+        rawHeading = headingDegrees(rawMag[0], rawMag[1]);
+        computed |= SAMPLE_RAW_HEADING;
+    }
     return (int)(rawHeading + offsetCompass)%360;
 }
 
 /**
  * @name getCalibratedHeading
- * @brief getCalibratedHeading: get calibrated compass heading tilt or not tilt compensated
+ * @brief getCalibratedHeading: calibrated compass heading of this sample, tilt or not tilt compensated
  * @param [in] bool tiltCompensated: set return heading tilt or not tilt compensated with acelerometer
  * @retval compass heading value 0 to 360 deg [int]
  */
-int CompassManager::getCalibratedHeading(bool tiltCompensated = true)
+int CompassSample::getCalibratedHeading(bool tiltCompensated) const
 {
-    computeHeading();
     if(tiltCompensated)
     {
+        computeTiltHeading();
         return (int)(tiltCalibHeading + offsetCompass)%360;
     }
-    else
+
+    if (!(computed & SAMPLE_CALIB_HEADING))
     {
-        return (int)(calibHeading + offsetCompass)%360;
+        //  Calculating heading with calibrated measurements not tilt compensated
+        calibHeading = headingDegrees(calibMag[0], calibMag[1]);
+        computed |= SAMPLE_CALIB_HEADING;
     }
+    return (int)(calibHeading + offsetCompass)%360;
 }
 
+/**
+ * @name getHeadingAngle
+ * @brief getHeadingAngle: calibrated compass heading of this sample as binary angle, no rounding to the degree
+ * @param [in] bool tiltCompensated: set return heading tilt or not tilt compensated with acelerometer
+ * @retval Bam16 heading
+ */
+Bam16 CompassSample::getHeadingAngle(bool tiltCompensated) const
+{
+    if(tiltCompensated)
+    {
+        computeTiltHeading();
+        return Bam16::fromDegrees(tiltCalibHeading + offsetCompass);
+    }
 
+    getCalibratedHeading(false);
+    return Bam16::fromDegrees(calibHeading + offsetCompass);
+}
 
 /**
  * @name getPitch
- * @brief getPitch: get pitch
+ * @brief getPitch: pitch of this sample
+ * @retval float Pitch deg
+ */
+float CompassSample::getPitch() const
+{
+    computeAttitude();
+    return pitch * 180 / PI;
+}
+
+/**
+ * @name getRoll
+ * @brief getRoll: roll of this sample
+ * @retval float Roll deg
+ */
+float CompassSample::getRoll() const
+{
+    computeAttitude();
+    return roll * 180 / PI;
+}
+
+/**
+ * @name getTiltAngle
+ * @brief getTiltAngle: tilt angle of this sample
+ * @retval float tilt angle deg
+ */
+float CompassSample::getTiltAngle() const
+{
+    computeAttitude();
+    return tiltAngle;
+}
+
+/**
+ * @name sample
+ * @brief sample: read the sensor once, run calibration and filters and keep the snapshot
+ * @retval const CompassSample &: the new snapshot, valid until the next sample()
+ */
+const CompassSample &CompassManager::sample()
+{
+    lsm.read();
+
+    float rawMagnetometerValues[3];
+    float calibMagnetometerValues[3];
+    getRawValuesMag(rawMagnetometerValues);
+    magTransform.apply(rawMagnetometerValues, calibMagnetometerValues);
+
+    float rawAccelerometerValues[3];
+    float calibAcceleronemeterValues[3];
+    getRawValuesAcc(rawAccelerometerValues);
+    accTransform.apply(rawAccelerometerValues, calibAcceleronemeterValues);
+
+    float norm_m = sqrt(sq(calibMagnetometerValues[0]) + sq(calibMagnetometerValues[1]) + sq(calibMagnetometerValues[2])); //original code did not appear to normalize, and this seems to help
+    float MxCalibratedNormalized = calibMagnetometerValues[0] / norm_m;
+    float MyCalibratedNormalized = calibMagnetometerValues[1] / norm_m;
+    float MzCalibratedNormalized = calibMagnetometerValues[2] / norm_m;
+
+    float norm_a = sqrt(sq(calibAcceleronemeterValues[0]) + sq(calibAcceleronemeterValues[1]) + sq(calibAcceleronemeterValues[2])); //original code did not appear to normalize, and this seems to help
+    float AxCalibratedNormalized = calibAcceleronemeterValues[0] / norm_a;
+    float AyCalibratedNormalized = calibAcceleronemeterValues[1] / norm_a;
+    float AzCalibratedNormalized = calibAcceleronemeterValues[2] / norm_a;
+
+    // Low-Pass filter magnetometer
+    MxCalibNormFiltered = MxCalibratedNormalized * alpha + (MxCalibNormFiltered * (1.0 - alpha));
+    MyCalibNormFiltered = MyCalibratedNormalized * alpha + (MyCalibNormFiltered * (1.0 - alpha));
+    MzCalibNormFiltered = MzCalibratedNormalized * alpha + (MzCalibNormFiltered * (1.0 - alpha));
+
+    // Low-Pass filter accelerometer
+    AxCalibNormFiltered = AxCalibratedNormalized * alpha + (AxCalibNormFiltered * (1.0 - alpha));
+    AyCalibNormFiltered = AyCalibratedNormalized * alpha + (AyCalibNormFiltered * (1.0 - alpha));
+    AzCalibNormFiltered = AzCalibratedNormalized * alpha + (AzCalibNormFiltered * (1.0 - alpha));
+
+    const float magFiltered[3] = {MxCalibNormFiltered, MyCalibNormFiltered, MzCalibNormFiltered};
+    const float accFiltered[3] = {AxCalibNormFiltered, AyCalibNormFiltered, AzCalibNormFiltered};
+    lastSample = CompassSample(rawMagnetometerValues, calibMagnetometerValues, magFiltered, accFiltered,
+                               offsetCompass, headingMethod, millis());
+    return lastSample;
+}
+
+/**
+ * @name getRawHeading
+ * @brief getCalibratedHeading: get raw compass heading 
+ * @note takes a new sample, use sample() to query more values of the same reading
+ * @retval compass heading value 0 to 360 deg [int]
+ */
+int CompassManager::getRawHeading()
+{
+    return sample().getRawHeading();
+}
+
+/**
+ * @name getCalibratedHeading
+ * @brief getCalibratedHeading: get calibrated compass heading tilt or not tilt compensated
+ * @note takes a new sample, use sample() to query more values of the same reading
+ * @param [in] bool tiltCompensated: set return heading tilt or not tilt compensated with acelerometer
+ * @retval compass heading value 0 to 360 deg [int]
+ */
+int CompassManager::getCalibratedHeading(bool tiltCompensated = true)
+{
+    return sample().getCalibratedHeading(tiltCompensated);
+}
+
+/**
+ * @name getPitch
+ * @brief getPitch: get pitch of the last sample
  * @retval float Pitch deg [0-360]
  */
 float CompassManager::getPitch()
 {
-    return pitch * 180 / PI;
+    return lastSample.getPitch();
 }
 
 /**
  * @name getRoll
- * @brief getRoll: get roll
+ * @brief getRoll: get roll of the last sample
  * @retval float Roll deg [0-360]
  */
 float CompassManager::getRoll()
 {
-    return roll * 180 / PI;
+    return lastSample.getRoll();
 }
 
 /**
@@ -190,6 +404,41 @@ void CompassManager::setOffsetCompass(float offset)
     this->offsetCompass = offset;
 }
 
+/**
+ * @name setMagCalibration
+ * @brief setMagCalibration: replace the magnetometer calibration, calibrated = matrix * (raw - bias)
+ * @param [in] float const calibrationMatrix[3][3]: soft-iron matrix
+ * @param [in] float const biasArray[3]: hard-iron bias, raw units
+ * @retval None
+ */
+void CompassManager::setMagCalibration(float const calibrationMatrix[3][3], float const biasArray[3])
+{
+    magTransform.set(calibrationMatrix, biasArray);
+}
+
+/**
+ * @name setAccCalibration
+ * @brief setAccCalibration: replace the accelerometer calibration, calibrated = matrix * (raw - bias)
+ * @param [in] float const calibrationMatrix[3][3]: misalignment and scale matrix
+ * @param [in] float const biasArray[3]: bias, raw units
+ * @retval None
+ */
+void CompassManager::setAccCalibration(float const calibrationMatrix[3][3], float const biasArray[3])
+{
+    accTransform.set(calibrationMatrix, biasArray);
+}
+
+/**
+ * @name setHeadingMethod
+ * @brief setHeadingMethod: select the tilt compensated heading computation of the next samples
+ * @param [in] heading_method_t method: VECTOR (default) or EULER
+ * @retval None
+ */
+void CompassManager::setHeadingMethod(heading_method_t method)
+{
+    headingMethod = method;
+}
+
 
 /*******************
  * PUBLIC VARIABLES
@@ -227,107 +476,45 @@ void CompassManager::getRawValuesAcc(float *rawAccelerometerValues)
 }
 
 /**
- * @name transformationMag
- * @brief transformationMag: get raw calibrated magnetometer using clib tranformation 
- * @param [in] float rawMagnetometerValues[3]: size 3 array for Mx, My, Mz value
- * @param [out] float calibMagnetometerValues[3]: size 3 array for MxCalib, MyCalib, MzCalib value
+ * @name computeAttitude
+ * @brief computeAttitude: compute and cache pitch, roll and tilt angle
+ * @param None
  * @retval None
  */
-void CompassManager::calibrationTransform(float const calibrationMatrix[3][3], 
-                                          float const biasArray[3], 
-                                          float rawMeasurementValues[3], 
-                                          float *calibratedValues)
+void CompassSample::computeAttitude() const
 {
-    // Computing
-    for (int i = 0; i < 3; ++i) rawMeasurementValues[i] = rawMeasurementValues[i] - biasArray[i];
-    
-    float result[3] = {0, 0, 0};
-    
-    for (int i = 0; i < 3; ++i)
-    {
-        for (int j = 0; j < 3; ++j)
-        {
-            result[i] += calibrationMatrix[i][j] * rawMeasurementValues[j];
-        }
-    }
-    for (int i = 0; i < 3; ++i)
-    {
-        calibratedValues[i] = result[i];
-    }
+    if (computed & SAMPLE_ATTITUDE) return;
 
-}
+    // Calculating this->pitch and this->roll angles following Application Note
+    this->pitch = (double) asin((double) - accFiltered[0]);
+    this->roll = (double) asin((double) accFiltered[1] / cos((double) this->pitch));
+
+    //Calculating Tilt angle in degrees
+    this->tiltAngle = (float)atan2((float)fabs(accFiltered[2]), (float)accFiltered[0]) * 180 / PI;
 
+    computed |= SAMPLE_ATTITUDE;
+}
 
 /**
- * @name computeHeading
- * @brief computeHeading: compute and store the three kind of heading 
+ * @name computeTiltHeading
+ * @brief computeTiltHeading: compute and cache the tilt compensated heading
  * @param None
  * @retval None
  */
-void CompassManager::computeHeading()
+void CompassSample::computeTiltHeading() const
 {
-    lsm.read();
-
-    float rawMagnetometerValues[3];
-    float calibMagnetometerValues[3];
-    getRawValuesMag(rawMagnetometerValues);
-    calibrationTransform(magCalibrationMatrix, magBias, rawMagnetometerValues, calibMagnetometerValues);
-
-    float rawAccelerometerValues[3];
-    float calibAcceleronemeterValues[3];
-    getRawValuesMag(rawAccelerometerValues);
-    calibrationTransform(accCalibrationMatrix, accBias, rawAccelerometerValues, calibAcceleronemeterValues);
-
-    float norm_m = sqrt(sq(calibMagnetometerValues[0]) + sq(calibMagnetometerValues[1]) + sq(calibMagnetometerValues[2])); //original code did not appear to normalize, and this seems to help
-    float MxCalibratedNormalized = calibMagnetometerValues[0] / norm_m;
-    float MyCalibratedNormalized = calibMagnetometerValues[1] / norm_m;
-    float MzCalibratedNormalized = calibMagnetometerValues[2] / norm_m;
+    if (computed & SAMPLE_TILT_HEADING) return;
 
-    float norm_a = sqrt(sq(calibAcceleronemeterValues[0]) + sq(calibAcceleronemeterValues[1]) + sq(calibAcceleronemeterValues[2])); //original code did not appear to normalize, and this seems to help
-    float AxCalibratedNormalized = calibAcceleronemeterValues[0] / norm_a;
-    float AyCalibratedNormalized = calibAcceleronemeterValues[1] / norm_a;
-    float AzCalibratedNormalized = calibAcceleronemeterValues[2] / norm_a;
-
-    // Low-Pass filter magnetometer
-    MxCalibNormFiltered = MxCalibratedNormalized * alpha + (MxCalibNormFiltered * (1.0 - alpha));
-    MyCalibNormFiltered = MyCalibratedNormalized * alpha + (MyCalibNormFiltered * (1.0 - alpha));
-    MzCalibNormFiltered = MzCalibratedNormalized * alpha + (MzCalibNormFiltered * (1.0 - alpha));
-
-    // Low-Pass filter accelerometer
-    AxCalibNormFiltered = AxCalibratedNormalized * alpha + (AxCalibNormFiltered * (1.0 - alpha));
-    AyCalibNormFiltered = AyCalibratedNormalized * alpha + (AyCalibNormFiltered * (1.0 - alpha));
-    AzCalibNormFiltered = AzCalibratedNormalized * alpha + (AzCalibNormFiltered * (1.0 - alpha));
-
-    // Calculating this->pitch and this->roll angles following Application Note
-    this->pitch = (double) asin((double) - AxCalibNormFiltered);
-    this->roll = (double) asin((double) AyCalibNormFiltered / cos((double) this->pitch));
-
-    //  Calculating heading with raw measurements not tilt compensated
-    this->rawHeading = (float)atan2(rawMagnetometerValues[1], rawMagnetometerValues[0]) * 180 / PI;
-
-    // this->rawHeading += offsetCompass;
-    if (this->rawHeading < 0) {
-        this->rawHeading = 360 + this->rawHeading;
+    if (headingMethod == heading_method_t::EULER)
+    {
+        this->tiltCalibHeading = headingFromEuler(accFiltered, magFiltered);
     }
-
-    //  Calculating heading with calibrated measurements not tilt compensated
-    this->calibHeading = (float)atan2(calibMagnetometerValues[1], calibMagnetometerValues[0]) * 180 / PI;
-    // this->calibHeading += offsetCompass;
-    if (this->calibHeading < 0) {
-        this->calibHeading = 360 + this->calibHeading;
+    else
+    {
+        this->tiltCalibHeading = headingFromVectors(accFiltered, magFiltered);
     }
 
-    //  Calculating tilt compensated heading
-    double Xh = MxCalibNormFiltered * cos((double)this->pitch) + MzCalibNormFiltered * sin((double)this->pitch);
-    double Yh = MxCalibNormFiltered * sin((double)this->roll) * sin((double)this->pitch) + MyCalibNormFiltered * cos((double)this->roll) - MzCalibNormFiltered * sin((float)this->roll) * cos((float)this->pitch);
-    this->tiltCalibHeading = (atan2(Yh, Xh)) * 180 / PI;
-
-    // this->calibHeading += offsetCompass;
-    if (this->tiltCalibHeading < 0) {
-        this->tiltCalibHeading = 360 + this->tiltCalibHeading;
-    }
-    //Calculating Tilt angle in degrees
-    this->tiltAngle = (float)atan2((float)fabs(AzCalibNormFiltered), (float)AxCalibNormFiltered) * 180 / PI;
+    computed |= SAMPLE_TILT_HEADING;
 }
 
 /****************************************************************************
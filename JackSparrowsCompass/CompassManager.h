@@ -13,6 +13,13 @@
  * 
  * @note actually accelerometer and magnetometer calibration (matrix and bias) parameters are hardcoded 
  * 
+ * @note sample() reads the sensor once and returns a CompassSample: heading, pitch and roll are
+ * computed from it on first request and cached, so querying all of them costs a single bus read
+ * 
+ * @note the tilt compensated heading uses by default the cross products of gravity and field
+ * (heading_method_t::VECTOR, see HeadingMath.h), heading_method_t::EULER selects the original
+ * pitch/roll formula
+ * 
  * @note This class is tested with 2 MCUs:
  *          - Arduno UNO
  *          - NodeMCU 1.0 (ESP-12E)
@@ -33,6 +40,9 @@
 #include "Wire.h"
 #include <Adafruit_Sensor.h>
 #include <Adafruit_LSM303.h>
+#include <CalibrationTransform.h>
+#include <HeadingMath.h>
+#include <BinaryAngle.h>
 
 /*-----------------------------------*
  * PUBLIC DEFINES
@@ -47,7 +57,116 @@ const float DEFAULT_ALPHA_VALUE = 0.25;
 /*-----------------------------------*
  * PUBLIC TYPEDEFS
  *-----------------------------------*/
-/* None */
+class CompassSample
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name CompassSample
+     * @brief CompassSample: empty sample, every heading 0 and level
+     */
+    CompassSample();
+
+    /**
+     * @name CompassSample
+     * @brief CompassSample: snapshot of one sensor reading
+     * @param [in] const float rawMag[3]: raw magnetometer values
+     * @param [in] const float calibMag[3]: calibrated magnetometer values
+     * @param [in] const float magFiltered[3]: calibrated, normalized and low-pass filtered magnetometer values
+     * @param [in] const float accFiltered[3]: calibrated, normalized and low-pass filtered accelerometer values
+     * @param [in] float offsetCompass: compass offset deg, added to every heading
+     * @param [in] heading_method_t headingMethod: tilt compensated heading computation
+     * @param [in] uint32_t timestamp: millis() of the reading
+     */
+    CompassSample(const float rawMag[3], const float calibMag[3], const float magFiltered[3],
+                  const float accFiltered[3], float offsetCompass, heading_method_t headingMethod,
+                  uint32_t timestamp);
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name getRawHeading
+     * @brief getRawHeading: raw compass heading of this sample
+     * @retval compass heading value 0 to 360 deg [int]
+     */
+    int getRawHeading() const;
+
+    /**
+     * @name getCalibratedHeading
+     * @brief getCalibratedHeading: calibrated compass heading of this sample, tilt or not tilt compensated
+     * @param [in] bool tiltCompensated: set return heading tilt or not tilt compensated with acelerometer
+     * @retval compass heading value 0 to 360 deg [int]
+     */
+    int getCalibratedHeading(bool tiltCompensated = true) const;
+
+    /**
+     * @name getHeadingAngle
+     * @brief getHeadingAngle: calibrated compass heading of this sample as binary angle, no rounding to the degree
+     * @param [in] bool tiltCompensated: set return heading tilt or not tilt compensated with acelerometer
+     * @retval Bam16 heading
+     */
+    Bam16 getHeadingAngle(bool tiltCompensated = true) const;
+
+    /**
+     * @name getPitch
+     * @brief getPitch: pitch of this sample
+     * @retval float Pitch deg
+     */
+    float getPitch() const;
+
+    /**
+     * @name getRoll
+     * @brief getRoll: roll of this sample
+     * @retval float Roll deg
+     */
+    float getRoll() const;
+
+    /**
+     * @name getTiltAngle
+     * @brief getTiltAngle: tilt angle of this sample
+     * @retval float tilt angle deg
+     */
+    float getTiltAngle() const;
+
+    /**
+     * @name getTimestamp
+     * @brief getTimestamp: time of the reading
+     * @retval uint32_t millis() of the reading
+     */
+    uint32_t getTimestamp() const { return timestamp; }
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void computeAttitude() const;
+    void computeTiltHeading() const;
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    // Reading
+    float rawMag[3];
+    float calibMag[3];
+    float magFiltered[3];
+    float accFiltered[3];
+    float offsetCompass;
+    heading_method_t headingMethod;
+    uint32_t timestamp;
+
+    // Derived values, computed on first request
+    mutable uint8_t computed;
+    mutable float rawHeading;
+    mutable float calibHeading;
+    mutable float tiltCalibHeading;
+    mutable float pitch;
+    mutable float roll;
+    mutable float tiltAngle;
+
+}; /* CompassSample */
 
 /*-----------------------------------*
  * PUBLIC VARIABLE DECLARATIONS
@@ -81,9 +200,24 @@ public:
     /*******************
      * PUBLIC METHODS
     *******************/
+    /**
+     * @name sample
+     * @brief sample: read the sensor once, run calibration and filters and keep the snapshot
+     * @retval const CompassSample &: the new snapshot, valid until the next sample()
+     */
+    const CompassSample &sample();
+
+    /**
+     * @name getLastSample
+     * @brief getLastSample: snapshot of the last sample(), no bus access
+     * @retval const CompassSample &
+     */
+    const CompassSample &getLastSample() const { return lastSample; }
+
     /**
      * @name getRawHeading
      * @brief getCalibratedHeading: get raw compass heading 
+     * @note takes a new sample, use sample() to query more values of the same reading
      * @retval compass heading value 0 to 360 deg [int]
      */
     int getRawHeading();
@@ -91,6 +225,7 @@ public:
     /**
      * @name getCalibratedHeading
      * @brief getCalibratedHeading: get calibrated compass heading tilt or not tilt compensated
+     * @note takes a new sample, use sample() to query more values of the same reading
      * @param [in] bool tiltCompensated: set return heading tilt or not tilt compensated with acelerometer
      * @retval compass heading value 0 to 360 deg [int]
      */
@@ -99,14 +234,14 @@ public:
 
     /**
      * @name getPitch
-     * @brief getPitch: get pitch
+     * @brief getPitch: get pitch of the last sample
      * @retval float Pitch deg [0-360]
      */
     float getPitch();
 
     /**
      * @name getRoll
-     * @brief getRoll: get roll
+     * @brief getRoll: get roll of the last sample
      * @retval float Roll deg [0-360]
      */
     float getRoll();
@@ -119,6 +254,32 @@ public:
      */
     void setOffsetCompass(float offset);
 
+    /**
+     * @name setMagCalibration
+     * @brief setMagCalibration: replace the magnetometer calibration, calibrated = matrix * (raw - bias)
+     * @param [in] float const calibrationMatrix[3][3]: soft-iron matrix
+     * @param [in] float const biasArray[3]: hard-iron bias, raw units
+     * @retval None
+     */
+    void setMagCalibration(float const calibrationMatrix[3][3], float const biasArray[3]);
+
+    /**
+     * @name setAccCalibration
+     * @brief setAccCalibration: replace the accelerometer calibration, calibrated = matrix * (raw - bias)
+     * @param [in] float const calibrationMatrix[3][3]: misalignment and scale matrix
+     * @param [in] float const biasArray[3]: bias, raw units
+     * @retval None
+     */
+    void setAccCalibration(float const calibrationMatrix[3][3], float const biasArray[3]);
+
+    /**
+     * @name setHeadingMethod
+     * @brief setHeadingMethod: select the tilt compensated heading computation of the next samples
+     * @param [in] heading_method_t method: VECTOR (default) or EULER
+     * @retval None
+     */
+    void setHeadingMethod(heading_method_t method);
+
     /*******************
      * PUBLIC VARIABLES
     *******************/
@@ -144,47 +305,22 @@ private:
      * @retval None
      */
     void getRawValuesAcc(float *rawAccelerometerValues);
-    
-    /**
-     * @name calibrationTransform
-     * @brief calibrationTransform: get calibrate raw meauserments with proper calibration matrix and bias array
-     * @param [in] float calibrationMatrix[3][3]: calibration parameters
-     * @param [in] float biasArray[3]: bias array
-     * @param [in] float rawMeasurementValues[3]: raw measurement
-     * @param [out] float calibMagnetometerValues[3]: calibrated measurement value
-     * @retval None
-     */
-    void calibrationTransform(  float const calibrationMatrix[3][3], 
-                                float const biasArray[3], 
-                                float rawMeasurementValues[3], 
-                                float *calibratedValues);
-
 
-    /**
-     * @name computeHeading
-     * @brief computeHeading: compute and store the three kind of heading 
-     * @param None
-     * @retval None
-     */
-    void computeHeading();
 
     /*******************
      * PRIVATE VARIABLES
     *******************/
     Adafruit_LSM303 lsm;
 
+    // Calibrations folded in one affine transform, rebuilt only by the setters
+    CalibrationTransform magTransform;
+    CalibrationTransform accTransform;
+
     // Filter value
     float alpha;
 
-    // All headings values
-    int rawHeading;
-    int calibHeading;
-    int tiltCalibHeading;
-    
-    float tiltAngle;
-
-    float roll;
-    float pitch;
+    // Last reading, headings and angles are computed on request
+    CompassSample lastSample;
 
     float MxCalibNormFiltered;
     float MyCalibNormFiltered;
@@ -195,6 +331,8 @@ private:
 
     float offsetCompass; //degrees
 
+    heading_method_t headingMethod;
+
 
 
 
@@ -121,6 +121,7 @@ bool GPSManager::update()
 			
 		}
 	}
+	return false;
 }
 
 double GPSManager::getLatitude()
@@ -132,16 +133,49 @@ double GPSManager::getLongitude()
 	return this->gpsLongitude;
 }
 
+/**
+ * @name hasLocation
+ * @brief hasLocation: a fix has been received, or simulation mode
+ * @retval bool
+*/
+bool GPSManager::hasLocation()
+{
+	return simulationMode or gps.location.isValid();
+}
+
+/**
+ * @name getDecimalYear
+ * @brief getDecimalYear: date of the GPS as a decimal year, for the magnetic model
+ * @param [out] float &year: e.g. 2021.5
+ * @retval bool: false until the GPS has sent a date
+*/
+bool GPSManager::getDecimalYear(float &year)
+{
+	// the module sends 2000-00-00 before it knows the date
+	if(not gps.date.isValid() or gps.date.year() < 2020)
+	{
+		return false;
+	}
+	const uint16_t DAYS_BEFORE_MONTH[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+	uint8_t month = gps.date.month();
+	if(month < 1 or month > 12)
+	{
+		return false;
+	}
+	year = gps.date.year() + (DAYS_BEFORE_MONTH[month - 1] + gps.date.day() - 1) / 365.25;
+	return true;
+}
+
 
 /**
  * @name getTargetDistanceHeading
  * @brief getTargetDistanceHeading:  compute the heading to the targrt position
- * @param [in] const int currentHeading: set current heading
- * @param [out] int targetHeading: return target heading
+ * @param [in] const Bam16 currentHeading: set current heading
+ * @param [out] Bam16 targetHeading: return target heading, relative to the current heading
  * @param [out] double distanceTarget: target distance
  * @retval bool: return true if GPS is avaliable false otherwise
  */
-bool GPSManager::getTargetDistanceHeading(const int currentHeading, int &targetHeading, double &distanceTarget)
+bool GPSManager::getTargetDistanceHeading(const Bam16 currentHeading, Bam16 &targetHeading, double &distanceTarget)
 {
 	// Serial.println("GET");
 
@@ -149,15 +183,9 @@ bool GPSManager::getTargetDistanceHeading(const int currentHeading, int &targetH
 	
 	distanceTarget = gps.distanceBetween(gpsLatitude, gpsLongitude, targetLatitude, targetLongitude);
 	directionTarget = gps.courseTo(gpsLatitude, gpsLongitude, targetLatitude, targetLongitude);
-	targetHeading = 0;  // sweep
-
-	if( currentHeading > directionTarget ) 
-		targetHeading = -(currentHeading - directionTarget); // These two are equal. -(a-b) = -a+b
-	else
-		targetHeading = directionTarget - currentHeading;
 
-	if( targetHeading < 0 ) 
-		targetHeading += 360;	
+	// bearing - heading, the wrap around 360 is the natural overflow
+	targetHeading = Bam16::fromDegrees(directionTarget) - currentHeading;
 	return ret;
 }
 
@@ -21,6 +21,7 @@
  *-----------------------------------*/
 #include <TinyGPS++.h>
 #include <SoftwareSerial.h>
+#include <BinaryAngle.h>
 
 /*-----------------------------------*
  * PUBLIC DEFINES
@@ -90,12 +91,12 @@ public:
     /**
      * @name getTargetDistanceHeading
      * @brief getTargetDistanceHeading:  compute the heading to the targrt position
-     * @param [in] int currentHeading: current heading from compass 
-     * @param [out] int targetHeading: heding to target
+     * @param [in] Bam16 currentHeading: current heading from compass 
+     * @param [out] Bam16 targetHeading: heding to target, relative to the current heading
      * @param [out] double distanceTarget: distance to target
      * @retval bool: return true if GPS is avaliable false otherwise
     */
-    bool getTargetDistanceHeading(const int currentHeading, int &targetHeading, double &distanceTarget);
+    bool getTargetDistanceHeading(const Bam16 currentHeading, Bam16 &targetHeading, double &distanceTarget);
 
 
 
@@ -110,6 +111,21 @@ public:
     double getLatitude();
     double getLongitude();
 
+    /**
+     * @name hasLocation
+     * @brief hasLocation: a fix has been received, or simulation mode
+     * @retval bool
+    */
+    bool hasLocation();
+
+    /**
+     * @name getDecimalYear
+     * @brief getDecimalYear: date of the GPS as a decimal year, for the magnetic model
+     * @param [out] float &year: e.g. 2021.5
+     * @retval bool: false until the GPS has sent a date
+    */
+    bool getDecimalYear(float &year);
+
 
 
 
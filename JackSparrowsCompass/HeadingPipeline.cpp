@@ -0,0 +1,493 @@
+/**
+ * @file HeadingPipeline.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief This class is for the heading of the compass from the MPU9250 library of hideakitai: the filter of the
+ *        library, the gyro in between and the corrections around it, one update() per loop
+ *
+ */
+
+#include "HeadingPipeline.h"
+#include <HeadingMath.h>
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name HeadingPipeline
+ * @brief HeadingPipeline: constructor, no heading yet
+ * @param [in] MPU9250 mpu: sensor and filter, set up by the sketch
+ * @param [in] const DeviationCurve deviation: deviation left by the calibration, loaded by the sketch
+ */
+HeadingPipeline::HeadingPipeline(MPU9250 &mpu, const DeviationCurve &deviation) : smoother(DEFAULT_SMOOTHER_WINDOW)
+{
+    this->mpu = &mpu;
+    this->deviation = &deviation;
+    for(int i = 0; i < 3; i++)
+    {
+        magOffset[i] = 0;
+        magScale[i] = 1;
+        gyroBootBias[i] = 0;
+        accelBootBias[i] = 0;
+        gyroTemperatureBias[i] = 0;
+        magTemperatureBias[i] = 0;
+        magTemperatureTurn[i] = 0;
+        vertical[i] = 0;
+    }
+    vertical[2] = 1;
+    calibrationTemperature = 0;
+    compassHeading = 0;
+    headingPeriodUs = 10000;
+    timestamp = 0;
+    headingSampleUs = 0;
+    lastFusionMs = 0;
+    lastTemperatureMs = 0;
+    lastTemperatureSaveMs = 0;
+    lastResumeSaveMs = 0;
+    resumed = false;
+    headingStarted = false;
+    filterSettled = false;
+    resumeBlending = false;
+    temperatureRebased = false;
+    temperatureLearned = false;
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name loadResume
+ * @brief loadResume: state before a watchdog or soft reset from the RTC memory, garbage after a power cycle
+ * @retval bool resumed, begin() will not calibrate
+ */
+bool HeadingPipeline::loadResume()
+{
+    resumed = loadResumeState(resumeState) and (resumeState.flags & RESUME_FLAG_HEADING);
+    return resumed;
+}
+
+/**
+ * @name isResumed
+ * @brief isResumed: the state before a reset was found by loadResume
+ * @retval bool
+ */
+bool HeadingPipeline::isResumed()
+{
+    return resumed;
+}
+
+/**
+ * @name begin
+ * @brief begin: after mpu.setup, the gyro and accelerometer calibration (with the hull still) or the one before
+ *               the reset, the magnetometer calibration and the filter in warm start
+ * @param [in] const float magOffset: hard iron, setMagBias units
+ * @param [in] const float magScale: soft iron scale
+ * @retval None
+ */
+void HeadingPipeline::begin(const float magOffset[3], const float magScale[3])
+{
+    if(resumed)
+    {
+        // the calibration before the reset, the hull may be moving now
+        for(int i = 0; i < 3; i++)
+        {
+            gyroBootBias[i] = resumeState.gyroOffset[i];
+            accelBootBias[i] = resumeState.accelOffset[i];
+        }
+        mpu->setAccBias(accelBootBias[0], accelBootBias[1], accelBootBias[2]);
+        mpu->setGyroBias(gyroBootBias[0], gyroBootBias[1], gyroBootBias[2]);
+        motion.setGyroBias(resumeState.gyroBias);
+        calibrationTemperature = resumeState.calibrationTemperature;
+    }
+    else
+    {
+        mpu->calibrateAccelGyro();
+        gyroBootBias[0] = mpu->getGyroBiasX();
+        gyroBootBias[1] = mpu->getGyroBiasY();
+        gyroBootBias[2] = mpu->getGyroBiasZ();
+        accelBootBias[0] = mpu->getAccBiasX();
+        accelBootBias[1] = mpu->getAccBiasY();
+        accelBootBias[2] = mpu->getAccBiasZ();
+    }
+    for(int i = 0; i < 3; i++)
+    {
+        this->magOffset[i] = magOffset[i];
+        this->magScale[i] = magScale[i];
+    }
+    mpu->setMagBias(magOffset[0], magOffset[1], magOffset[2]);
+    mpu->setMagScale(magScale[0], magScale[1], magScale[2]);
+    mpu->selectFilter(QuatFilterSel::MAHONYEM);
+    mpu->setFilterIterations(FILTER_WARM_ITERATIONS);
+}
+
+/**
+ * @name update
+ * @brief update: one step of the heading, call it every loop; the filter runs at a low rate while stationary
+ * @param [in] const float servoBias: mG, bias of the servo at the needle angle, in the calibration of the library
+ * @param [in] float servoWeight: weight of the magnetometer with the servo, 0 to 1
+ * @param [in] bool servoBusy: the autotune or the sweep drives the needle: filter at full rate and no
+ *                             magnetometer temperature window
+ * @retval bool true on a new sample
+ */
+bool HeadingPipeline::update(const float servoBias[3], float servoWeight, bool servoBusy)
+{
+    // servo and temperature bias in the calibration of the library
+    mpu->setMagBias(magOffset[0] + (servoBias[0] + magTemperatureBias[0]) / (magScale[0] * MAG_BIAS_UNIT),
+                    magOffset[1] + (servoBias[1] + magTemperatureBias[1]) / (magScale[1] * MAG_BIAS_UNIT),
+                    magOffset[2] + (servoBias[2] + magTemperatureBias[2]) / (magScale[2] * MAG_BIAS_UNIT));
+
+    if(motion.isStationary() and not servoBusy and (millis() - lastFusionMs < STATIONARY_FUSION_PERIOD_MS))
+    {
+        return false;
+    }
+    bool newSample = mpu->update(micros() - timestamp);
+    lastFusionMs = millis();
+    timestamp = micros();
+    if(not newSample)
+    {
+        return false;
+    }
+
+    uint32_t sampleUs = micros();
+    float dt = 0;
+    if(headingSampleUs != 0)
+    {
+        dt = (sampleUs - headingSampleUs) * 1e-6;
+        headingPeriodUs += 0.05 * ((float)(sampleUs - headingSampleUs) - headingPeriodUs);
+    }
+    headingSampleUs = sampleUs;
+
+    // gyro bias learned while stationary, the hull does not turn
+    float gyroBias[3];
+    motion.getGyroBias(gyroBias);
+    float gyro[3] = {mpu->getGyroX(), mpu->getGyroY(), mpu->getGyroZ()};
+    motion.update(gyro, dt);
+
+    float acc[3] = {mpu->getAccX(), mpu->getAccY(), mpu->getAccZ()};
+    updateVertical(gyro, gyroBias, acc, dt);
+
+    // magnetometer axes to the accelerometer ones: x and y swapped, z down
+    float magImu[3] = {mpu->getMagY(), mpu->getMagX(), -mpu->getMagZ()};
+    magDisturbance.update(magImu, vertical, sqrt(acc[0] * acc[0] + acc[1] * acc[1] + acc[2] * acc[2]), dt);
+
+    compensateTemperature(gyro, gyroBias, dt, servoBusy);
+    fuseHeading(gyro, gyroBias, acc, magImu, dt, servoWeight);
+
+    if(millis() - lastResumeSaveMs >= RESUME_SAVE_PERIOD_MS)
+    {
+        saveResume();
+        lastResumeSaveMs = millis();
+    }
+    return true;
+}
+
+/**
+ * @name setLocation
+ * @brief setLocation: place and date of the declination, cached per cell of a few km
+ * @param [in] float latitude: deg
+ * @param [in] float longitude: deg
+ * @param [in] float year: decimal year
+ * @param [in] bool here: the compass is there (GPS fix): its dip checks the field learned at power-on
+ * @retval None
+ */
+void HeadingPipeline::setLocation(float latitude, float longitude, float year, bool here)
+{
+    if(magneticModel.update(latitude, longitude, year) and not magneticModel.isCurrent())
+    {
+        Serial.println("Date out of the life of the World Magnetic Model, declination of its nearest end");
+    }
+    if(here)
+    {
+        magDisturbance.setExpectedDip(magneticModel.getInclination());
+    }
+}
+
+/**
+ * @name getHeading
+ * @brief getHeading: smoothed heading to true north
+ * @retval Bam16
+ */
+Bam16 HeadingPipeline::getHeading()
+{
+    return Bam16::fromDegrees(smoother.getHeading() + magneticModel.getDeclination());
+}
+
+/**
+ * @name getHeadingRate
+ * @brief getHeadingRate: turn rate of the hull from the gyro, without its bias
+ * @retval float deg/s, clockwise
+ */
+float HeadingPipeline::getHeadingRate()
+{
+    float gyroBias[3];
+    motion.getGyroBias(gyroBias);
+    return GYRO_Z_TO_HEADING_RATE * (mpu->getGyroZ() - gyroBias[2]);
+}
+
+/**
+ * @name getLatencyUs
+ * @brief getLatencyUs: age of the smoothed heading, from the sample to now, smoothing included
+ * @retval unsigned long us
+ */
+unsigned long HeadingPipeline::getLatencyUs()
+{
+    return (micros() - headingSampleUs) + (unsigned long)(smoother.getLag() * headingPeriodUs);
+}
+
+/**
+ * @name getStability
+ * @brief getStability: circular variance of the last headings
+ * @retval float 0 (steady) to 1
+ */
+float HeadingPipeline::getStability()
+{
+    return smoother.getCircularVariance();
+}
+
+/**
+ * @name isStationary
+ * @brief isStationary: the hull does not turn, from the gyro
+ * @retval bool
+ */
+bool HeadingPipeline::isStationary()
+{
+    return motion.isStationary();
+}
+
+/**
+ * @name isMagDisturbed
+ * @brief isMagDisturbed: the norm or dip of the field moved away, the heading coasts on the gyro
+ * @retval bool
+ */
+bool HeadingPipeline::isMagDisturbed()
+{
+    return magDisturbance.isDisturbed();
+}
+
+/**
+ * @name getGyroTemperature
+ * @brief getGyroTemperature: gyro bias versus temperature, deg/s, to load before begin() and to save
+ * @retval TemperatureBiasTable &
+ */
+TemperatureBiasTable &HeadingPipeline::getGyroTemperature()
+{
+    return gyroTemperature;
+}
+
+/**
+ * @name getMagTemperature
+ * @brief getMagTemperature: magnetometer bias versus temperature, mG, to load before begin() and to save
+ * @retval TemperatureBiasTable &
+ */
+TemperatureBiasTable &HeadingPipeline::getMagTemperature()
+{
+    return magTemperature;
+}
+
+/**
+ * @name takeTemperatureSave
+ * @brief takeTemperatureSave: the tables learned since the last save and TEMP_BIAS_SAVE_PERIOD_MS passed;
+ *                             true once, the caller saves them
+ * @retval bool
+ */
+bool HeadingPipeline::takeTemperatureSave()
+{
+    if(not temperatureLearned or (millis() - lastTemperatureSaveMs < TEMP_BIAS_SAVE_PERIOD_MS))
+    {
+        return false;
+    }
+    lastTemperatureSaveMs = millis();
+    temperatureLearned = false;
+    return true;
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name updateVertical
+ * @brief updateVertical: vertical turned with the gyro, a fixed vector in a turning frame, then pulled towards
+ *                        the accelerometer; the first sample takes the accelerometer
+ * @param [in] const float gyro: deg/s
+ * @param [in] const float gyroBias: deg/s, learned while stationary
+ * @param [in] const float acc: g
+ * @param [in] float dt: s since the last sample
+ * @retval None
+ */
+void HeadingPipeline::updateVertical(const float gyro[3], const float gyroBias[3], const float acc[3], float dt)
+{
+    float rate[3];
+    for(int i = 0; i < 3; i++)
+    {
+        rate[i] = (gyro[i] - gyroBias[i]) * DEG_TO_RAD;
+    }
+    float turned[3] = {vertical[0] - (rate[1] * vertical[2] - rate[2] * vertical[1]) * dt,
+                       vertical[1] - (rate[2] * vertical[0] - rate[0] * vertical[2]) * dt,
+                       vertical[2] - (rate[0] * vertical[1] - rate[1] * vertical[0]) * dt};
+    float pull = headingStarted ? 1 - exp(-dt / VERTICAL_TIME) : 1;
+    float norm = 0;
+    for(int i = 0; i < 3; i++)
+    {
+        turned[i] += pull * (acc[i] - turned[i]);
+        norm += turned[i] * turned[i];
+    }
+    norm = sqrt(norm);
+    if(norm > 0)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            vertical[i] = turned[i] / norm;
+        }
+    }
+}
+
+/**
+ * @name compensateTemperature
+ * @brief compensateTemperature: learn the bias versus temperature and give it to the library. The library took
+ *                               away the table bias it was given: put back, the samples are the gyro less the
+ *                               calibration at boot and the calibrated field, the ones mpu9250_lib learns from
+ * @param [in] const float gyro: deg/s, from the library
+ * @param [in] const float gyroBias: deg/s, learned while stationary
+ * @param [in] float dt: s since the last sample
+ * @param [in] bool servoBusy: the needle is driven, no magnetometer window
+ * @retval None
+ */
+void HeadingPipeline::compensateTemperature(const float gyro[3], const float gyroBias[3], float dt, bool servoBusy)
+{
+    float temperature = mpu->getTemperature();
+    if(not temperatureRebased)
+    {
+        if(not resumed)
+        {
+            calibrationTemperature = temperature;
+        }
+        gyroTemperature.rebase(calibrationTemperature);
+        temperatureRebased = true;
+    }
+
+    // gyro: stationary it reads its own bias
+    if(motion.isStationary())
+    {
+        float gyroUncompensated[3];
+        for(int i = 0; i < 3; i++)
+        {
+            gyroUncompensated[i] = gyro[i] + gyroTemperatureBias[i];
+        }
+        gyroTemperature.learn(temperature, gyroUncompensated, dt);
+        temperatureLearned = true;
+    }
+
+    // magnetometer: only its change is seen, over a window while still; a hull swinging slowly at anchor is still
+    // for the motion detector, so the window ends after TEMPERATURE_MAG_TURN_LIMIT on the gyro
+    float turn = 0;
+    for(int i = 0; i < 3; i++)
+    {
+        magTemperatureTurn[i] += (gyro[i] - gyroBias[i]) * dt;
+        turn += magTemperatureTurn[i] * magTemperatureTurn[i];
+    }
+    if(motion.isStationary() and not magDisturbance.isDisturbed() and not servoBusy and
+       sqrt(turn) < TEMPERATURE_MAG_TURN_LIMIT)
+    {
+        float magUncompensated[3] = {mpu->getMagX() + magTemperatureBias[0],
+                                     mpu->getMagY() + magTemperatureBias[1],
+                                     mpu->getMagZ() + magTemperatureBias[2]};
+        magTemperature.learnChange(temperature, magUncompensated, dt);
+    }
+    else
+    {
+        magTemperature.restartChange();
+        for(int i = 0; i < 3; i++)
+        {
+            magTemperatureTurn[i] = 0;
+        }
+    }
+
+    // the offset registers are written at a low rate, the temperature changes slowly
+    if(millis() - lastTemperatureMs >= TEMPERATURE_PERIOD_MS)
+    {
+        lastTemperatureMs = millis();
+        gyroTemperature.getBias(temperature, gyroTemperatureBias);
+        magTemperature.getBias(temperature, magTemperatureBias);
+        mpu->setGyroBias(gyroBootBias[0] + gyroTemperatureBias[0] / GYRO_BIAS_UNIT,
+                         gyroBootBias[1] + gyroTemperatureBias[1] / GYRO_BIAS_UNIT,
+                         gyroBootBias[2] + gyroTemperatureBias[2] / GYRO_BIAS_UNIT);
+    }
+}
+
+/**
+ * @name fuseHeading
+ * @brief fuseHeading: heading turned with the gyro and pulled towards the magnetometer; TRIAD, or the heading
+ *                     before the reset, until the library agrees with TRIAD
+ * @param [in] const float gyro: deg/s
+ * @param [in] const float gyroBias: deg/s, learned while stationary
+ * @param [in] const float acc: g
+ * @param [in] const float magImu: mG, accelerometer axes
+ * @param [in] float dt: s since the last sample
+ * @param [in] float servoWeight: weight of the magnetometer with the servo
+ * @retval None
+ */
+void HeadingPipeline::fuseHeading(const float gyro[3], const float gyroBias[3], const float acc[3], const float magImu[3],
+                                  float dt, float servoWeight)
+{
+    float triadHeading = deviation->correct(headingFromVectors(acc, magImu));
+    float filterHeading = deviation->correct(mpu->getHeading());
+    if(not headingStarted)
+    {
+        compassHeading = resumed ? resumeState.heading : triadHeading;
+        resumeBlending = resumed;
+        headingStarted = true;
+    }
+    if(not filterSettled and
+       (fabs((Bam16::fromDegrees(filterHeading) - Bam16::fromDegrees(triadHeading)).toSignedDegrees()) < FILTER_SETTLE_TOLERANCE or
+        millis() >= FILTER_SETTLE_LIMIT_MS))
+    {
+        filterSettled = true;
+        mpu->setFilterIterations(1);
+    }
+    float magHeading = filterSettled ? filterHeading : triadHeading;
+
+    // a resumed heading is not thrown away for the first TRIAD: the magnetometer pulls it in slowly, until the
+    // library has settled on it
+    float magWeight = servoWeight * magDisturbance.getWeight();
+    if(resumeBlending)
+    {
+        if(filterSettled and
+           fabs((Bam16::fromDegrees(filterHeading) - Bam16::fromDegrees(compassHeading)).toSignedDegrees()) < FILTER_SETTLE_TOLERANCE)
+        {
+            resumeBlending = false;
+        }
+        else
+        {
+            magWeight *= 1 - exp(-dt / RESUME_BLEND_TIME);
+        }
+    }
+
+    // while the needle moves the heading goes on with the gyro, the compass comes back as the motor settles
+    compassHeading += GYRO_Z_TO_HEADING_RATE * (gyro[2] - gyroBias[2]) * dt;
+    compassHeading += magWeight * (Bam16::fromDegrees(magHeading) - Bam16::fromDegrees(compassHeading)).toSignedDegrees();
+    compassHeading = Bam16::fromDegrees(compassHeading).toDegrees();
+    smoother.update(compassHeading);
+}
+
+/**
+ * @name saveResume
+ * @brief saveResume: heading, biases and calibration to the RTC memory, it costs no flash; the attitude is of the
+ *                    filter of the library, which starts again from TRIAD: no RESUME_FLAG_ATTITUDE
+ * @retval None
+ */
+void HeadingPipeline::saveResume()
+{
+    resumeState.flags = RESUME_FLAG_HEADING;
+    for(int i = 0; i < 3; i++)
+    {
+        resumeState.gyroOffset[i] = gyroBootBias[i];
+        resumeState.accelOffset[i] = accelBootBias[i];
+    }
+    motion.getGyroBias(resumeState.gyroBias);
+    resumeState.calibrationTemperature = calibrationTemperature;
+    resumeState.heading = compassHeading;
+    saveResumeState(resumeState);
+}
+
+/****************************************************************************
+ ****************************************************************************/
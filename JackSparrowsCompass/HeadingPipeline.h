@@ -0,0 +1,268 @@
+/**
+ * @file HeadingPipeline.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief This class is for the heading of the compass from the MPU9250 library of hideakitai: the filter of the
+ *        library, the gyro in between and the corrections around it, one update() per loop
+ *
+ * On a new sample of the library:
+ *      - motion: moving or stationary from the gyro (MotionDetector), the gyro bias learned while stationary;
+ *        stationary the filter runs every STATIONARY_FUSION_PERIOD_MS, the heading does not change in a harbour.
+ *        The wake-on-motion of the MPU9250 is not used: the library clears INT_STATUS itself
+ *      - vertical: turned with the gyro, pulled towards the accelerometer over VERTICAL_TIME, the waves would tilt
+ *        the accelerometer alone by several degrees; the norm and dip of the field against it feed the
+ *        MagDisturbanceDetector, the dip only while the accelerometer feels 1 g, the heading coasts on the gyro
+ *        while the field is disturbed
+ *      - temperature: gyro and magnetometer bias versus the die temperature (TemperatureBiasTable), given to the
+ *        library with its own biases every TEMPERATURE_PERIOD_MS. Both tables learn from the samples without the
+ *        table bias, the gyro less the calibration at boot and the calibrated field, as mpu9250_lib does: the gyro
+ *        one while stationary, taken to zero at the temperature of the calibration, the magnetometer one from the
+ *        change of the field in a window ended by TEMPERATURE_MAG_TURN_LIMIT on the gyro
+ *      - warm start: the first heading from gravity and field alone (TRIAD), the filter of the library starts from
+ *        level and north and would swing the needle for seconds. It runs FILTER_WARM_ITERATIONS per sample until it
+ *        agrees with TRIAD, then takes over
+ *      - heading: turned with the gyro, pulled towards the filter by the weight of the servo and of the disturbance,
+ *        then smoothed (HeadingSmoother)
+ *      - resume: heading, biases and calibration kept in the RTC memory every RESUME_SAVE_PERIOD_MS. After a watchdog
+ *        or soft reset the MPU9250 kept its power and the hull need not be still: no calibration, the resumed heading
+ *        is kept and the magnetometer pulls it in over RESUME_BLEND_TIME until the library agrees with it
+ *
+ * The declination of the World Magnetic Model turns the heading to true north, as the GPS bearing.
+ *
+ */
+
+#ifndef HEADING_PIPELINE_H
+#define HEADING_PIPELINE_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <Arduino.h>
+#include <MPU9250.h>
+#include <BinaryAngle.h>
+#include <HeadingSmoother.h>
+#include <DeviationCurve.h>
+#include <MotionDetector.h>
+#include <MagneticModel.h>
+#include <MagDisturbanceDetector.h>
+#include <TemperatureBiasTable.h>
+#include <ResumeState.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const float GYRO_Z_TO_HEADING_RATE          = -1.0f;        // heading turns clockwise, the gyro z axis points up
+const float MAG_BIAS_UNIT                   = 4.0f;         // mG of one unit of setMagBias: kept at 16 bit, the magnetometer runs at 14
+const float GYRO_BIAS_UNIT                  = 1.0f / 131.0f; // deg/s of one unit of setGyroBias, kept at 250 dps
+const float VERTICAL_TIME                   = 2.0f;         // s, time constant of the accelerometer on the vertical
+const unsigned long TEMP_BIAS_SAVE_PERIOD_MS = 1800000;     // 30 min, the flash wears
+const int FILTER_WARM_ITERATIONS            = 10;           // filter iterations per sample until it agrees with TRIAD
+const float FILTER_SETTLE_TOLERANCE         = 3.0f;         // deg between the library and TRIAD to take over
+const unsigned long FILTER_SETTLE_LIMIT_MS  = 10000;        // the library takes over after this anyway
+const float RESUME_BLEND_TIME               = 5.0f;         // s, time constant of the magnetometer on a resumed heading
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+class HeadingPipeline
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name HeadingPipeline
+     * @brief HeadingPipeline: constructor, no heading yet
+     * @param [in] MPU9250 mpu: sensor and filter, set up by the sketch
+     * @param [in] const DeviationCurve deviation: deviation left by the calibration, loaded by the sketch
+     */
+    HeadingPipeline(MPU9250 &mpu, const DeviationCurve &deviation);
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name loadResume
+     * @brief loadResume: state before a watchdog or soft reset from the RTC memory, garbage after a power cycle
+     * @retval bool resumed, begin() will not calibrate
+     */
+    bool loadResume();
+
+    /**
+     * @name isResumed
+     * @brief isResumed: the state before a reset was found by loadResume
+     * @retval bool
+     */
+    bool isResumed();
+
+    /**
+     * @name begin
+     * @brief begin: after mpu.setup, the gyro and accelerometer calibration (with the hull still) or the one before
+     *               the reset, the magnetometer calibration and the filter in warm start
+     * @param [in] const float magOffset: hard iron, setMagBias units
+     * @param [in] const float magScale: soft iron scale
+     * @retval None
+     */
+    void begin(const float magOffset[3], const float magScale[3]);
+
+    /**
+     * @name update
+     * @brief update: one step of the heading, call it every loop; the filter runs at a low rate while stationary
+     * @param [in] const float servoBias: mG, bias of the servo at the needle angle, in the calibration of the library
+     * @param [in] float servoWeight: weight of the magnetometer with the servo, 0 to 1
+     * @param [in] bool servoBusy: the autotune or the sweep drives the needle: filter at full rate and no
+     *                             magnetometer temperature window
+     * @retval bool true on a new sample
+     */
+    bool update(const float servoBias[3], float servoWeight, bool servoBusy);
+
+    /**
+     * @name setLocation
+     * @brief setLocation: place and date of the declination, cached per cell of a few km
+     * @param [in] float latitude: deg
+     * @param [in] float longitude: deg
+     * @param [in] float year: decimal year
+     * @param [in] bool here: the compass is there (GPS fix): its dip checks the field learned at power-on
+     * @retval None
+     */
+    void setLocation(float latitude, float longitude, float year, bool here);
+
+    /**
+     * @name getHeading
+     * @brief getHeading: smoothed heading to true north
+     * @retval Bam16
+     */
+    Bam16 getHeading();
+
+    /**
+     * @name getHeadingRate
+     * @brief getHeadingRate: turn rate of the hull from the gyro, without its bias
+     * @retval float deg/s, clockwise
+     */
+    float getHeadingRate();
+
+    /**
+     * @name getLatencyUs
+     * @brief getLatencyUs: age of the smoothed heading, from the sample to now, smoothing included
+     * @retval unsigned long us
+     */
+    unsigned long getLatencyUs();
+
+    /**
+     * @name getStability
+     * @brief getStability: circular variance of the last headings
+     * @retval float 0 (steady) to 1
+     */
+    float getStability();
+
+    /**
+     * @name isStationary
+     * @brief isStationary: the hull does not turn, from the gyro
+     * @retval bool
+     */
+    bool isStationary();
+
+    /**
+     * @name isMagDisturbed
+     * @brief isMagDisturbed: the norm or dip of the field moved away, the heading coasts on the gyro
+     * @retval bool
+     */
+    bool isMagDisturbed();
+
+    /**
+     * @name getGyroTemperature
+     * @brief getGyroTemperature: gyro bias versus temperature, deg/s, to load before begin() and to save
+     * @retval TemperatureBiasTable &
+     */
+    TemperatureBiasTable &getGyroTemperature();
+
+    /**
+     * @name getMagTemperature
+     * @brief getMagTemperature: magnetometer bias versus temperature, mG, to load before begin() and to save
+     * @retval TemperatureBiasTable &
+     */
+    TemperatureBiasTable &getMagTemperature();
+
+    /**
+     * @name takeTemperatureSave
+     * @brief takeTemperatureSave: the tables learned since the last save and TEMP_BIAS_SAVE_PERIOD_MS passed;
+     *                             true once, the caller saves them
+     * @retval bool
+     */
+    bool takeTemperatureSave();
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void updateVertical(const float gyro[3], const float gyroBias[3], const float acc[3], float dt);
+    void compensateTemperature(const float gyro[3], const float gyroBias[3], float dt, bool servoBusy);
+    void fuseHeading(const float gyro[3], const float gyroBias[3], const float acc[3], const float magImu[3],
+                     float dt, float servoWeight);
+    void saveResume();
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    MPU9250 *mpu;
+    const DeviationCurve *deviation;
+
+    MotionDetector motion;
+    MagneticModel magneticModel;
+    MagDisturbanceDetector magDisturbance;
+    HeadingSmoother smoother;
+    TemperatureBiasTable gyroTemperature;
+    TemperatureBiasTable magTemperature;
+    ResumeState resumeState;
+
+    float magOffset[3];                 // setMagBias units, calibration
+    float magScale[3];
+    float gyroBootBias[3];              // setGyroBias units, found by calibrateAccelGyro
+    float accelBootBias[3];             // setAccBias units, found by calibrateAccelGyro
+    float gyroTemperatureBias[3];       // deg/s, in the library now
+    float magTemperatureBias[3];        // mG, in the library now
+    float magTemperatureTurn[3];        // deg turned in the magnetometer window
+    float calibrationTemperature;       // degC of the calibration, the zero of the gyro table
+    float vertical[3];                  // up, accelerometer frame
+    float compassHeading;               // deg, magnetic
+    float headingPeriodUs;              // mean time between two samples
+
+    uint32_t timestamp;                 // micros of the last filter update, integration of the library
+    uint32_t headingSampleUs;           // micros of the last sample
+    unsigned long lastFusionMs;
+    unsigned long lastTemperatureMs;
+    unsigned long lastTemperatureSaveMs;
+    unsigned long lastResumeSaveMs;
+
+    bool resumed;                       // resumeState read from the RTC memory at boot
+    bool headingStarted;                // compassHeading set by the first sample
+    bool filterSettled;                 // the heading of the library agrees with TRIAD
+    bool resumeBlending;                // the resumed heading is not yet the one of the library
+    bool temperatureRebased;            // gyro table taken to the temperature of the calibration
+    bool temperatureLearned;            // the tables changed since the last save
+
+};
+
+
+#endif /* HEADING_PIPELINE_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -1,14 +1,28 @@
 // #include "CompassManager.h"
 #include "MPU9250.h"
 #include "ServoManager.h"
+#include "ServoAutotune.h"
+#include "ServoMagSweep.h"
 #include "GPSManager.h"
 #include "Server.h"
 #include "SystemManager.h"
+#include "HeadingPipeline.h"
+#include <BinaryAngle.h>
+#include <ServoMagModel.h>
+#include <DeviationCurve.h>
+#include <Ticker.h>
 
 // CompassManager cm;
 MPU9250 mpu;
 
 ServoManager sm;
+ServoAutotune autotune;
+ServoMagSweep magSweep;
+ServoMagModel servoMag;
+DeviationCurve deviation;
+// gyro, filter of the library, magnetometer corrections, warm start and resume: one update per loop
+HeadingPipeline headingPipeline(mpu, deviation);
+Ticker servoTicker;
 GPSManager gpsm;
 SystemManager *systemManager;
 //casa
@@ -38,7 +52,7 @@ double lat_target = 43.025567;
 double lon_target = 12.438006;
 
 
-int previousTargetHeading = 0;
+Bam16 previousTargetHeading;
 
 // const float Mag_x_offset = 366.695;
 // const float Mag_y_offset = 376.02;
@@ -79,20 +93,14 @@ int previousTargetHeading = 0;
 // Mag_y_scale = 1.0988564,
 // Mag_z_scale = 0.8257466;
 
-float
-Mag_x_offset = 208.03,
-Mag_y_offset = -108.94,
-Mag_z_offset = -611.47,
-Mag_x_scale = 1.2461473,
-Mag_y_scale = 1.1814733,
-Mag_z_scale = 0.74012357;
+// Mag_*_offset and Mag_*_scale of the unit, the same header as compass_servo: its deviation curve is what this
+// calibration leaves
+#include <compass_mag_calibration.h>
 
+// Declination of the World Magnetic Model: before the first fix it is taken at the target, before the GPS date
+// at the build
+const float BUILD_YEAR = atoi(__DATE__ + 7) + 0.5;
 
-int32_t timestamp = 0;
-
-const int size_sample_filter = 30;
-int heading_filter[size_sample_filter];
-int sample_counter = 0;
 void setup()
 {
 	systemManager = new SystemManager();
@@ -100,6 +108,9 @@ void setup()
 	Wire.setClock(400000);
 	Serial.begin(115200);
 
+	// state before a watchdog or soft reset, garbage after a power cycle
+	headingPipeline.loadResume();
+
 	// Init Server and get coordinates from eeprom
 	Serial.println("Init Server and EEPROM");
 	init_server(systemManager);
@@ -111,6 +122,24 @@ void setup()
 		Serial.println("Init Servo");
 		sm = ServoManager(0, 270);
 
+		// PID gains found by the last autotune, if any
+		float kp, ki, kd;
+		if(load_servo_gains(kp, ki, kd))
+		{
+			servo_gains_t gains = {kp, ki, kd};
+			sm.setGains(gains);
+		}
+		// magnetometer bias of the servo learned by the last sweep, if any
+		load_servo_mag(servoMag);
+		// deviation left by the calibration, measured by the swing of compass_servo, if any
+		load_deviation(deviation);
+		// bias versus temperature learned on the previous days, if any
+		load_temperature_bias(headingPipeline.getGyroTemperature(), "/temp_gyro.txt");
+		load_temperature_bias(headingPipeline.getMagTemperature(), "/temp_mag.txt");
+
+		// servo PID and setpoints at a fixed rate, whatever the loop is doing
+		servoTicker.attach_ms(SERVO_SETPOINT_PERIOD_MS, [] () { sm.step(); });
+
 		if(sm.getStatus())
 		{
 			systemManager->update_servo_status(servo_status_t::OK);
@@ -147,12 +176,19 @@ void setup()
 
 			if(status_compass)
 			{
-				Serial.println("Calibrating Compass...");
-				systemManager->update_compass_status(compass_status_t::CALIBRATING);
-				mpu.calibrateAccelGyro();
-				mpu.setMagBias(Mag_x_offset, Mag_y_offset, Mag_z_offset);
-				mpu.setMagScale(Mag_x_scale, Mag_y_scale, Mag_z_scale);
-				mpu.selectFilter(QuatFilterSel::MAHONYEM);
+				if(headingPipeline.isResumed())
+				{
+					// the calibration before the reset, the hull may be moving now
+					Serial.println("Compass resumed after a reset");
+				}
+				else
+				{
+					Serial.println("Calibrating Compass...");
+					systemManager->update_compass_status(compass_status_t::CALIBRATING);
+				}
+				const float magOffset[3] = {Mag_x_offset, Mag_y_offset, Mag_z_offset};
+				const float magScale[3] = {Mag_x_scale, Mag_y_scale, Mag_z_scale};
+				headingPipeline.begin(magOffset, magScale);
 				
 				Serial.println("End calibration Compass");
 				systemManager->update_compass_status(compass_status_t::OK);
@@ -183,11 +219,6 @@ void setup()
 	{
 		Serial.println("ERROR ON SERVER SETUP");
 	}
-	// for(int i = 0; i < size_sample_filter; i++)
-	// {
-	// 	heading_filter[i] = 0;
-	// }
-
 	delay(500);
 }
 
@@ -195,40 +226,101 @@ void loop()
 {
 	if(systemManager->get_system_status() != system_status_t::FAIL)
 	{
-		// Get heading from quaternion compensation compass
-		int heading;
-		int start = millis();
-		if(mpu.update(micros()-timestamp))
+		// bias of the servo at the needle angle, in the calibration of the library; none while it is learned
+		float servoBias[3] = {0, 0, 0};
+		if(not magSweep.isRunning())
+		{
+			servoMag.getBias(sm.getNeedleAngle(), servoBias);
+		}
+		bool newSample = headingPipeline.update(servoBias, sm.getMagWeight(), autotune.isRunning() or magSweep.isRunning());
+		if(newSample)
 		{
-			heading = (int) mpu.getHeading();
-//			heading_filter[sample_counter] = heading;
-//			sample_counter ++;
-//			int sum = 0;
-//			for(int i = 0; i < sample_counter; i++)
-//			{
-//				sum += heading_filter[i];
-//			}
-//			
-//			heading = sum/sample_counter;
-//			sample_counter = sample_counter%size_sample_filter;
+			systemManager->update_mag_disturbance(headingPipeline.isMagDisturbed());
 		}
 
-		int targetHeading = 0;
-		double distanceTarget = 0;
+		float year;
+		if(not gpsm.getDecimalYear(year))
+		{
+			year = BUILD_YEAR;
+		}
+		if(gpsm.hasLocation())
+		{
+			headingPipeline.setLocation(gpsm.getLatitude(), gpsm.getLongitude(), year, true);
+		}
+		else
+		{
+			headingPipeline.setLocation(lat_target, lon_target, year, false);
+		}
+		Bam16 heading = headingPipeline.getHeading();
 
-		timestamp = micros(); // is for integration handling on quaternion compensation compass
+		Bam16 targetHeading;
+		double distanceTarget = 0;
 
 		// Get Lat and Lon from Server Manager
+		double lat_previous = lat_target;
+		double lon_previous = lon_target;
 		get_coordinates(lat_target, lon_target);
+		bool targetMoved = (lat_target != lat_previous) or (lon_target != lon_previous);
 		gpsm.setTarget(lat_target, lon_target);
 
 		bool ret_gps = gpsm.getTargetDistanceHeading(heading, targetHeading, distanceTarget);
 
 		systemManager->update_gps_status(gps_status_t::OK);
 
-		int difference = abs(targetHeading - previousTargetHeading);
+		// shortest rotation, 359 -> 1 is 2 deg
+		float difference = fabs((targetHeading - previousTargetHeading).toSignedDegrees());
+
+		// the needle turns against the hull at once, the target is as old as the smoothed heading
+		float headingRate = headingPipeline.getHeadingRate();
+		sm.setFeedForward(-headingRate, headingPipeline.getLatencyUs());
 
-		if((targetHeading != previousTargetHeading) and (difference >= 5) and distanceTarget < 10000)
+		// the autotune and the sweep drive the servo for some seconds, the needle follows the target afterwards
+		if(get_autotune_request() and not autotune.isRunning() and not magSweep.isRunning())
+		{
+			autotune.start(sm);
+			set_autotune_status("running");
+		}
+		if(get_mag_sweep_request() and not autotune.isRunning() and not magSweep.isRunning())
+		{
+			magSweep.start(sm);
+			set_mag_sweep_status("running");
+		}
+		if(autotune.isRunning())
+		{
+			if(not autotune.update(sm))
+			{
+				if(autotune.getState() == autotune_state_t::DONE)
+				{
+					servo_gains_t gains = autotune.getGains();
+					save_servo_gains(gains.kp, gains.ki, gains.kd);
+					set_autotune_status("ok;" + String(gains.kp, 2) + ";" + String(gains.ki, 3) + ";" + String(gains.kd, 2));
+				}
+				else
+				{
+					set_autotune_status("fail");
+				}
+			}
+		}
+		else if(magSweep.isRunning())
+		{
+			float mag[3] = {mpu.getMagX(), mpu.getMagY(), mpu.getMagZ()};
+			if(not magSweep.update(sm, newSample ? mag : NULL, headingRate))
+			{
+				if(magSweep.getState() == mag_sweep_state_t::DONE)
+				{
+					servoMag = magSweep.getModel();
+					save_servo_mag(servoMag);
+					set_mag_sweep_status("ok;" + String(servoMag.getMaxBias(), 1));
+				}
+				else
+				{
+					set_mag_sweep_status("fail");
+				}
+			}
+		}
+		// stationary the target only moves with the GPS noise: the needle holds unless a new target is set
+		else if((targetHeading != previousTargetHeading) and (difference >= 5) and distanceTarget < 10000 and
+				(not headingPipeline.isStationary() or targetMoved))
 		{
 			// Serial.print("H: ");Serial.print(heading);
 			// Serial.print(", TH: ");Serial.print(targetHeading);
@@ -239,13 +331,25 @@ void loop()
 			
 			previousTargetHeading = targetHeading;
 		}
-		set_actualpose(heading, distanceTarget);
+		// back toward neutral when the needle has been still for a while, not to twist the wiring
+		sm.unwind();
+		set_actualpose(heading.toIntDegrees(), distanceTarget);
+		set_heading_stability(headingPipeline.getStability());
+		servo_tick_stats_t tickStats = sm.getTickStats();
+		set_servo_timing(tickStats.ticks, tickStats.late, tickStats.maxPeriodUs, tickStats.maxStepUs);
 
 
 		if(not ret_gps)
 		{
 			systemManager->update_gps_status(gps_status_t::OFFLINE);
 		}
+
+		// the flash wears, the tables are saved at a low rate and only after learning
+		if(headingPipeline.takeTemperatureSave())
+		{
+			save_temperature_bias(headingPipeline.getGyroTemperature(), "/temp_gyro.txt");
+			save_temperature_bias(headingPipeline.getMagTemperature(), "/temp_mag.txt");
+		}
 		
 		delay(10);
 	}
@@ -17,6 +17,9 @@
 #include <FS.h>
 #include "index_html.h"
 #include "SystemManager.h"
+#include <ServoMagModel.h>
+#include <DeviationCurve.h>
+#include <TemperatureBiasTable.h>
 
 
 /*-----------------------------------*
@@ -53,6 +56,16 @@ const char* PARAM_INPUT_2 = "lon";
 double lat,lon;
 
 int heading, distance;
+float heading_variance = -1;     // circular variance of the smoothed heading, -1 unknown
+
+bool autotune_requested = false;    // set by /autotune, taken by the loop
+String autotune_status = "idle";    // served on /autotune_status
+
+bool mag_sweep_requested = false;   // set by /mag_sweep, taken by the loop
+String mag_sweep_status = "idle";   // served on /mag_sweep_status
+
+unsigned long servo_ticks = 0, servo_late_ticks = 0;                // servo tick timing, served on /servo_timing
+unsigned long servo_max_period_us = 0, servo_max_step_us = 0;
 
 bool is_connected = false;
 
@@ -63,6 +76,19 @@ void notFound(AsyncWebServerRequest *request);
 void print_config();
 bool init_fs(double &lat, double &lon);
 void save_data(double lat, double lon);
+void set_heading_stability(float variance);
+bool load_servo_gains(float &kp, float &ki, float &kd);
+void save_servo_gains(float kp, float ki, float kd);
+bool get_autotune_request();
+void set_autotune_status(const String &status);
+bool load_servo_mag(ServoMagModel &model);
+void save_servo_mag(const ServoMagModel &model);
+bool get_mag_sweep_request();
+void set_mag_sweep_status(const String &status);
+bool load_deviation(DeviationCurve &curve);
+bool load_temperature_bias(TemperatureBiasTable &table, const char *path);
+void save_temperature_bias(const TemperatureBiasTable &table, const char *path);
+void set_servo_timing(unsigned long ticks, unsigned long late, unsigned long maxPeriodUs, unsigned long maxStepUs);
 
 /*******************
  * CONSTRUCTOR & DESTRUCTOR METHODS
@@ -127,7 +153,8 @@ void init_server(SystemManager *SysMan)
                 request->send(200, "text/plain", "calibrating");
                 break;
             case compass_status_t::OK:
-                request->send(200, "text/plain", "ok");
+                // working, but on the gyro alone while the field is disturbed
+                request->send(200, "text/plain", SysMan->is_mag_disturbed() ? "disturbed" : "ok");
                 break;
             case compass_status_t::FAIL:
                 request->send(200, "text/plain", "err");
@@ -214,6 +241,50 @@ void init_server(SystemManager *SysMan)
 		request->send(200, "text/plain", heading_s + ";" + distance_s);
 	});
 
+    server.on("/stability", HTTP_GET, [] (AsyncWebServerRequest *request) 
+	{
+        String variance_s = "-";
+        if(heading_variance >= 0)
+        {
+            variance_s = String(heading_variance, 4);
+        }
+		request->send(200, "text/plain", variance_s);
+	});
+
+    server.on("/servo_timing", HTTP_GET, [] (AsyncWebServerRequest *request) 
+	{
+        // ticks;late ticks;max period us;max step us
+        String timing_s = String(servo_ticks) + ";" + String(servo_late_ticks) + ";" +
+                          String(servo_max_period_us) + ";" + String(servo_max_step_us);
+		request->send(200, "text/plain", timing_s);
+	});
+
+    server.on("/autotune", HTTP_GET, [] (AsyncWebServerRequest *request) 
+	{
+        // the tuning moves the needle for some seconds, it is run by the loop
+        autotune_requested = true;
+        autotune_status = "requested";
+		request->send(200, "text/plain", autotune_status);
+	});
+
+    server.on("/autotune_status", HTTP_GET, [] (AsyncWebServerRequest *request) 
+	{
+		request->send(200, "text/plain", autotune_status);
+	});
+
+    server.on("/mag_sweep", HTTP_GET, [] (AsyncWebServerRequest *request) 
+	{
+        // the sweep turns the needle back and forth for about a minute, it is run by the loop
+        mag_sweep_requested = true;
+        mag_sweep_status = "requested";
+		request->send(200, "text/plain", mag_sweep_status);
+	});
+
+    server.on("/mag_sweep_status", HTTP_GET, [] (AsyncWebServerRequest *request) 
+	{
+		request->send(200, "text/plain", mag_sweep_status);
+	});
+
     
 
     server.onNotFound(notFound);
@@ -335,6 +406,290 @@ void save_data(double lat, double lon)
     SPIFFS.end();
 }
 
+/**
+ * @name load_servo_gains
+ * @brief load_servo_gains: PID gains of the servo saved by the autotune
+ * @param [out] float kp: proportional gain
+ * @param [out] float ki: integral gain
+ * @param [out] float kd: derivative gain
+ * @retval bool gains found
+ */
+bool load_servo_gains(float &kp, float &ki, float &kd)
+{
+    bool success = SPIFFS.begin();
+    if (!success)
+    {
+        return false;
+    }
+    bool found = false;
+    if (SPIFFS.exists("/servo_gains.txt"))
+    {
+        File gainsFile = SPIFFS.open("/servo_gains.txt", "r");
+        if (gainsFile)
+        {
+            kp = gainsFile.readStringUntil('\n').toFloat();
+            ki = gainsFile.readStringUntil('\n').toFloat();
+            kd = gainsFile.readStringUntil('\n').toFloat();
+            gainsFile.close();
+            found = kp > 0;
+        }
+    }
+    SPIFFS.end();
+    return found;
+}
+
+/**
+ * @name save_servo_gains
+ * @brief save_servo_gains: save the PID gains of the servo found by the autotune
+ * @param [in] float kp: proportional gain
+ * @param [in] float ki: integral gain
+ * @param [in] float kd: derivative gain
+ */
+void save_servo_gains(float kp, float ki, float kd)
+{
+    bool success = SPIFFS.begin();
+    if (!success)
+    {
+        return;
+    }
+    File gainsFile = SPIFFS.open("/servo_gains.txt", "w");
+    if (gainsFile)
+    {
+        gainsFile.println(kp, 4);
+        gainsFile.println(ki, 5);
+        gainsFile.println(kd, 4);
+        gainsFile.close();
+    }
+    SPIFFS.end();
+}
+
+/**
+ * @name get_autotune_request
+ * @brief get_autotune_request: autotune asked from the web page, the request is taken
+ * @retval bool
+ */
+bool get_autotune_request()
+{
+    bool requested = autotune_requested;
+    autotune_requested = false;
+    return requested;
+}
+
+/**
+ * @name set_autotune_status
+ * @brief set_autotune_status: status served on /autotune_status
+ * @param [in] String status: running, ok;kp;ki;kd or fail
+ */
+void set_autotune_status(const String &status)
+{
+    autotune_status = status;
+}
+
+/**
+ * @name load_servo_mag
+ * @brief load_servo_mag: magnetometer bias of the servo saved by the sweep, one line per value, bin by bin
+ * @param [out] ServoMagModel model: table loaded, unchanged if not found
+ * @retval bool table found
+ */
+bool load_servo_mag(ServoMagModel &model)
+{
+    bool success = SPIFFS.begin();
+    if (!success)
+    {
+        return false;
+    }
+    bool found = false;
+    if (SPIFFS.exists("/servo_mag.txt"))
+    {
+        File magFile = SPIFFS.open("/servo_mag.txt", "r");
+        if (magFile)
+        {
+            float table[SERVO_MAG_BINS][3];
+            found = true;
+            for (int k = 0; k < SERVO_MAG_BINS and found; ++k)
+            {
+                for (int i = 0; i < 3 and found; ++i)
+                {
+                    found = magFile.available() > 0;
+                    table[k][i] = magFile.readStringUntil('\n').toFloat();
+                }
+            }
+            magFile.close();
+            if (found)
+            {
+                model.setTable(table);
+            }
+        }
+    }
+    SPIFFS.end();
+    return found;
+}
+
+/**
+ * @name save_servo_mag
+ * @brief save_servo_mag: save the magnetometer bias of the servo learned by the sweep
+ * @param [in] ServoMagModel model: table to save
+ */
+void save_servo_mag(const ServoMagModel &model)
+{
+    bool success = SPIFFS.begin();
+    if (!success)
+    {
+        return;
+    }
+    File magFile = SPIFFS.open("/servo_mag.txt", "w");
+    if (magFile)
+    {
+        float table[SERVO_MAG_BINS][3];
+        model.getTable(table);
+        for (int k = 0; k < SERVO_MAG_BINS; ++k)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                magFile.println(table[k][i], 2);
+            }
+        }
+        magFile.close();
+    }
+    SPIFFS.end();
+}
+
+/**
+ * @name load_deviation
+ * @brief load_deviation: deviation curve saved by the swing of compass_servo, one line per coefficient, A to E
+ * @param [out] DeviationCurve curve: curve loaded, unchanged if not found
+ * @retval bool curve found
+ */
+bool load_deviation(DeviationCurve &curve)
+{
+    bool success = SPIFFS.begin();
+    if (!success)
+    {
+        return false;
+    }
+    bool found = false;
+    if (SPIFFS.exists("/deviation.txt"))
+    {
+        File deviationFile = SPIFFS.open("/deviation.txt", "r");
+        if (deviationFile)
+        {
+            float coefficients[DEVIATION_COEFFICIENTS];
+            found = true;
+            for (int i = 0; i < DEVIATION_COEFFICIENTS and found; ++i)
+            {
+                found = deviationFile.available() > 0;
+                coefficients[i] = deviationFile.readStringUntil('\n').toFloat();
+            }
+            deviationFile.close();
+            if (found)
+            {
+                curve.setCoefficients(coefficients);
+            }
+        }
+    }
+    SPIFFS.end();
+    return found;
+}
+
+/**
+ * @name load_temperature_bias
+ * @brief load_temperature_bias: bias versus temperature learned while stationary, one line per value, node by node,
+ *                               the weight then x, y, z
+ * @param [out] TemperatureBiasTable table: table loaded, unchanged if not found
+ * @param [in] const char path: file, e.g. /temp_gyro.txt
+ * @retval bool table found
+ */
+bool load_temperature_bias(TemperatureBiasTable &table, const char *path)
+{
+    bool success = SPIFFS.begin();
+    if (!success)
+    {
+        return false;
+    }
+    bool found = false;
+    if (SPIFFS.exists(path))
+    {
+        File biasFile = SPIFFS.open(path, "r");
+        if (biasFile)
+        {
+            float bias[TEMP_BIAS_NODES][3];
+            float weight[TEMP_BIAS_NODES];
+            found = true;
+            for (int k = 0; k < TEMP_BIAS_NODES and found; ++k)
+            {
+                found = biasFile.available() > 0;
+                weight[k] = biasFile.readStringUntil('\n').toFloat();
+                for (int i = 0; i < 3 and found; ++i)
+                {
+                    found = biasFile.available() > 0;
+                    bias[k][i] = biasFile.readStringUntil('\n').toFloat();
+                }
+            }
+            biasFile.close();
+            if (found)
+            {
+                table.setTable(bias, weight);
+            }
+        }
+    }
+    SPIFFS.end();
+    return found;
+}
+
+/**
+ * @name save_temperature_bias
+ * @brief save_temperature_bias: save the bias versus temperature learned while stationary
+ * @param [in] TemperatureBiasTable table: table to save
+ * @param [in] const char path: file, e.g. /temp_gyro.txt
+ */
+void save_temperature_bias(const TemperatureBiasTable &table, const char *path)
+{
+    bool success = SPIFFS.begin();
+    if (!success)
+    {
+        return;
+    }
+    File biasFile = SPIFFS.open(path, "w");
+    if (biasFile)
+    {
+        float bias[TEMP_BIAS_NODES][3];
+        float weight[TEMP_BIAS_NODES];
+        table.getTable(bias, weight);
+        for (int k = 0; k < TEMP_BIAS_NODES; ++k)
+        {
+            biasFile.println(weight[k], 1);
+            for (int i = 0; i < 3; ++i)
+            {
+                biasFile.println(bias[k][i], 4);
+            }
+        }
+        biasFile.close();
+    }
+    SPIFFS.end();
+}
+
+/**
+ * @name get_mag_sweep_request
+ * @brief get_mag_sweep_request: sweep of the servo bias asked from the web page, the request is taken
+ * @retval bool
+ */
+bool get_mag_sweep_request()
+{
+    bool requested = mag_sweep_requested;
+    mag_sweep_requested = false;
+    return requested;
+}
+
+/**
+ * @name set_mag_sweep_status
+ * @brief set_mag_sweep_status: status served on /mag_sweep_status
+ * @param [in] String status: running, ok;largest bias mG or fail
+ */
+void set_mag_sweep_status(const String &status)
+{
+    mag_sweep_status = status;
+}
+
 /**
  * @name notFound
  * @brief notFound: page 404
@@ -351,6 +706,32 @@ void set_actualpose(int h, int d)
     distance = d;
 }
 
+/**
+ * @name set_heading_stability
+ * @brief set_heading_stability: circular variance of the heading served on /stability
+ * @param [in] float variance: 0 steady to 1 spread all around
+ */
+void set_heading_stability(float variance)
+{
+    heading_variance = variance;
+}
+
+/**
+ * @name set_servo_timing
+ * @brief set_servo_timing: timing of the servo ticks served on /servo_timing
+ * @param [in] unsigned long ticks: ticks run
+ * @param [in] unsigned long late: ticks later than SERVO_TICK_LATE_US
+ * @param [in] unsigned long maxPeriodUs: longest time between two ticks
+ * @param [in] unsigned long maxStepUs: longest tick
+ */
+void set_servo_timing(unsigned long ticks, unsigned long late, unsigned long maxPeriodUs, unsigned long maxStepUs)
+{
+    servo_ticks = ticks;
+    servo_late_ticks = late;
+    servo_max_period_us = maxPeriodUs;
+    servo_max_step_us = maxStepUs;
+}
+
 
 
     
@@ -0,0 +1,331 @@
+/**
+ * @file ServoAutotune.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief This class is for tuning the PID of the feedback servo on the unit, by relay feedback
+ *
+ */
+
+#include "ServoAutotune.h"
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const int   RELAY_AMPLITUDE         = 80;       // us from the stop pulse, above the dead band
+const float RELAY_GAIN              = 1000.0f;  // saturates the PID within one feedback step: a relay
+const float RELAY_HYSTERESIS        = 1.0f;     // deg, center crossings counted outside it
+const float RELAY_START             = 10.0f;    // deg, the center is off the start angle: the cycle starts
+const int   RELAY_CYCLES_SKIPPED    = 2;        // transient of the limit cycle
+const int   RELAY_CYCLES            = 4;        // cycles averaged
+const unsigned long RELAY_TIMEOUT_MS = 15000;
+
+const float VALIDATE_STEP           = 90.0f;    // deg, a quarter turn, moves of the needle are up to half a turn
+const float VALIDATE_BAND           = 2.0f;     // deg, settled inside
+const float VALIDATE_MAX_OVERSHOOT  = 3.0f;     // deg, oscillation above
+const unsigned long VALIDATE_HOLD_MS    = 300;  // settled once inside the band for this long
+const unsigned long VALIDATE_TIMEOUT_MS = 2500;
+
+// Kp / Ku, Ti / Tu, Td / Tu: Tyreus-Luyben first, then slower integrals; the dead band of the servo
+// needs a long Ti, with the Ziegler-Nichols ones (Ti = Tu / 2) the needle rings around the target,
+// and the integral only has to pull the last degrees the proportional leaves in the dead band
+const float CANDIDATES[AUTOTUNE_CANDIDATES][3] =
+{
+    {0.31f, 2.2f, 0.16f},
+    {0.30f, 8.0f, 0.33f},
+    {0.30f, 32.0f, 0.45f},
+    {0.25f, 32.0f, 0.45f},
+    {0.20f, 32.0f, 0.6f},
+    {0.15f, 32.0f, 0.3f}
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+static float wrap180(float angle)
+{
+    angle = fmod(angle + 180.0f, 360.0f);
+    if(angle < 0.0f) angle += 360.0f;
+    return angle - 180.0f;
+}
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name ServoAutotune
+ * @brief ServoAutotune: constructor, idle
+ */
+ServoAutotune::ServoAutotune()
+{
+    state = autotune_state_t::IDLE;
+    ultimateGain = 0.0f;
+    ultimatePeriod = 0.0f;
+    bestGains.kp = 0.0f;
+    bestGains.ki = 0.0f;
+    bestGains.kd = 0.0f;
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name start
+ * @brief start: start the tuning near the current needle angle; the servo must not be streaming a move
+ * @param [in] ServoManager sm: servo to tune
+ * @retval None
+ */
+void ServoAutotune::start(ServoManager &sm)
+{
+    previousGains = sm.getGains();
+    center = sm.getFeedbackAngle() + RELAY_START;
+
+    servo_gains_t relay = {RELAY_GAIN, 0.0f, 0.0f};
+    sm.setGains(relay, RELAY_AMPLITUDE);
+
+    side = -1;
+    cycles = 0;
+    lastCrossUpMs = 0;
+    cycleMax = -180.0f;
+    cycleMin = 180.0f;
+    sumPeriod = 0.0f;
+    sumAmplitude = 0.0f;
+    ultimateGain = 0.0f;
+    ultimatePeriod = 0.0f;
+    // the relay is the PID itself, switched on the tick as the tuned PID will be
+    sm.rotateDirect(center);
+
+    phaseStartMs = millis();
+    state = autotune_state_t::RELAY;
+}
+
+/**
+ * @name update
+ * @brief update: one step of the tuning, call it every loop; the servo tick drives the servo meanwhile
+ * @param [in] ServoManager sm: servo to tune
+ * @retval bool true while the tuning is running
+ */
+bool ServoAutotune::update(ServoManager &sm)
+{
+    if(not isRunning())
+    {
+        return false;
+    }
+
+    const unsigned long now = millis();
+    const float angle = wrap180(sm.getFeedbackAngle() - center);
+    if(state == autotune_state_t::RELAY)
+    {
+        updateRelay(sm, angle, now);
+    }
+    else
+    {
+        updateValidate(sm, angle, now);
+    }
+    return isRunning();
+}
+
+bool ServoAutotune::isRunning()
+{
+    return state == autotune_state_t::RELAY or state == autotune_state_t::VALIDATE;
+}
+
+autotune_state_t ServoAutotune::getState()
+{
+    return state;
+}
+
+servo_gains_t ServoAutotune::getGains()
+{
+    return bestGains;
+}
+
+float ServoAutotune::getUltimateGain()
+{
+    return ultimateGain;
+}
+
+float ServoAutotune::getUltimatePeriod()
+{
+    return ultimatePeriod;
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name updateRelay
+ * @brief updateRelay: measure the limit cycle of the relay around the center, one cycle between upward crossings
+ * @param [in] ServoManager sm: servo to tune
+ * @param [in] float angle: needle deg from the center
+ * @param [in] unsigned long now: ms
+ * @retval None
+ */
+void ServoAutotune::updateRelay(ServoManager &sm, float angle, unsigned long now)
+{
+    if(now - phaseStartMs > RELAY_TIMEOUT_MS)
+    {
+        // no limit cycle: servo not moving or feedback missing
+        found = false;
+        finish(sm);
+        return;
+    }
+
+    if(angle > cycleMax) cycleMax = angle;
+    if(angle < cycleMin) cycleMin = angle;
+
+    if(side > 0 and angle < -RELAY_HYSTERESIS)
+    {
+        side = -1;
+    }
+    else if(side < 0 and angle > RELAY_HYSTERESIS)
+    {
+        side = 1;
+
+        // one cycle from an upward crossing to the next
+        if(lastCrossUpMs != 0)
+        {
+            cycles++;
+            if(cycles > RELAY_CYCLES_SKIPPED)
+            {
+                sumPeriod += (now - lastCrossUpMs) * 0.001f;
+                sumAmplitude += (cycleMax - cycleMin) * 0.5f;
+            }
+        }
+        lastCrossUpMs = now;
+        cycleMax = angle;
+        cycleMin = angle;
+    }
+
+    if(cycles < RELAY_CYCLES_SKIPPED + RELAY_CYCLES)
+    {
+        return;
+    }
+
+    const float amplitude = sumAmplitude / RELAY_CYCLES;
+    ultimatePeriod = sumPeriod / RELAY_CYCLES;
+    ultimateGain = 4.0f * RELAY_AMPLITUDE / (PI * (amplitude > 0.1f ? amplitude : 0.1f));
+
+    candidate = 0;
+    found = false;
+    state = autotune_state_t::VALIDATE;
+    startCandidate(sm, now);
+}
+
+/**
+ * @name updateValidate
+ * @brief updateValidate: follow the step of the candidate, go to the next step or candidate
+ * @param [in] ServoManager sm: servo to tune
+ * @param [in] float angle: needle deg from the center
+ * @param [in] unsigned long now: ms
+ * @retval None
+ */
+void ServoAutotune::updateValidate(ServoManager &sm, float angle, unsigned long now)
+{
+    const float error = angle - stepTarget;
+    bool failed = error * stepDirection > VALIDATE_MAX_OVERSHOOT or now - stepStartMs > VALIDATE_TIMEOUT_MS;
+
+    if(fabs(error) > VALIDATE_BAND)
+    {
+        lastOutsideMs = now;
+    }
+    else if(not failed and now - lastOutsideMs >= VALIDATE_HOLD_MS)
+    {
+        // settled: next step, or the candidate is done
+        candidateSettleMs += lastOutsideMs - stepStartMs;
+        if(step == 0)
+        {
+            step = 1;
+            startStep(sm, now);
+            return;
+        }
+        if(not found or candidateSettleMs < bestSettleMs)
+        {
+            found = true;
+            bestSettleMs = candidateSettleMs;
+            bestGains = sm.getGains();
+        }
+        failed = true;          // not a failure, the candidate is over
+    }
+
+    if(not failed)
+    {
+        return;
+    }
+
+    candidate++;
+    if(candidate < AUTOTUNE_CANDIDATES)
+    {
+        startCandidate(sm, now);
+    }
+    else
+    {
+        finish(sm);
+    }
+}
+
+/**
+ * @name startCandidate
+ * @brief startCandidate: rebuild the PID with the current candidate gains, back to the center, first step
+ * @param [in] ServoManager sm: servo to tune
+ * @param [in] unsigned long now: ms
+ * @retval None
+ */
+void ServoAutotune::startCandidate(ServoManager &sm, unsigned long now)
+{
+    const float T = SERVO_CONTROL_PERIOD_MS * 0.001f;
+    const float kp = CANDIDATES[candidate][0] * ultimateGain;
+    const float Ti = CANDIDATES[candidate][1] * ultimatePeriod;
+    const float Td = CANDIDATES[candidate][2] * ultimatePeriod;
+
+    servo_gains_t gains;
+    gains.kp = kp;
+    gains.ki = kp * T / Ti;
+    gains.kd = kp * Td / T;
+    sm.setGains(gains);
+
+    // the relay leaves the needle off the center: the out step starts from there, as a real move
+    step = 0;
+    candidateSettleMs = 0;
+    startStep(sm, now);
+}
+
+/**
+ * @name startStep
+ * @brief startStep: command the out step (center + VALIDATE_STEP) or the back step (center)
+ * @param [in] ServoManager sm: servo to tune
+ * @param [in] unsigned long now: ms
+ * @retval None
+ */
+void ServoAutotune::startStep(ServoManager &sm, unsigned long now)
+{
+    const float from = wrap180(sm.getFeedbackAngle() - center);
+    stepTarget = (step == 0) ? VALIDATE_STEP : 0.0f;
+    stepDirection = (stepTarget >= from) ? 1.0f : -1.0f;
+    stepStartMs = now;
+    lastOutsideMs = now;
+    sm.rotateDirect(center + stepTarget);
+}
+
+/**
+ * @name finish
+ * @brief finish: keep the best gains or restore the previous ones, back to the profile setpoint
+ * @param [in] ServoManager sm: servo tuned
+ * @retval None
+ */
+void ServoAutotune::finish(ServoManager &sm)
+{
+    if(found)
+    {
+        sm.setGains(bestGains);
+        state = autotune_state_t::DONE;
+    }
+    else
+    {
+        sm.setGains(previousGains);
+        state = autotune_state_t::FAIL;
+    }
+    sm.holdPosition();
+}
+
+/****************************************************************************
+ ****************************************************************************/
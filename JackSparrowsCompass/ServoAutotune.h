@@ -0,0 +1,173 @@
+/**
+ * @file ServoAutotune.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief This class is for tuning the PID of the feedback servo on the unit, by relay feedback
+ *
+ * The tuning runs in the loop, one update() per iteration, in two phases:
+ *      - RELAY: the PID is rebuilt as a relay (high gain, output limited to +-RELAY_AMPLITUDE us) on a
+ *        center near the start angle; it switches on the servo tick, as the tuned PID will, and the
+ *        needle settles in a limit cycle whose period Tu and amplitude a give the ultimate gain
+ *        Ku = 4 RELAY_AMPLITUDE / (pi a)
+ *      - VALIDATE: candidate gains from Ku and Tu (Tyreus-Luyben, then variants with a slower integral
+ *        for the dead band of the servo) are tried on a step out and back; the candidate with the
+ *        shortest settle time that does not overshoot nor ring wins
+ * If no candidate passes the previous gains are restored.
+ * The gains are per control period, as FeedbackServo takes them: ki = Kp T / Ti, kd = Kp Td / T.
+ *
+ */
+
+#ifndef SERVO_AUTOTUNE_H
+#define SERVO_AUTOTUNE_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "ServoManager.h"
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const int AUTOTUNE_CANDIDATES = 6;
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+enum class autotune_state_t
+{
+    IDLE,
+    RELAY,          // measuring the limit cycle
+    VALIDATE,       // trying the candidate gains
+    DONE,           // new gains in use
+    FAIL            // previous gains restored
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+class ServoAutotune
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name ServoAutotune
+     * @brief ServoAutotune: constructor, idle
+     */
+    ServoAutotune();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name start
+     * @brief start: start the tuning near the current needle angle; the servo must not be streaming a move
+     * @param [in] ServoManager sm: servo to tune
+     * @retval None
+     */
+    void start(ServoManager &sm);
+
+    /**
+     * @name update
+     * @brief update: one step of the tuning, call it every loop; the servo tick drives the servo meanwhile
+     * @param [in] ServoManager sm: servo to tune
+     * @retval bool true while the tuning is running
+     */
+    bool update(ServoManager &sm);
+
+    /**
+     * @name isRunning
+     * @brief isRunning: tuning in progress
+     * @retval bool
+     */
+    bool isRunning();
+
+    /**
+     * @name getState
+     * @brief getState: state of the tuning
+     * @retval autotune_state_t
+     */
+    autotune_state_t getState();
+
+    /**
+     * @name getGains
+     * @brief getGains: gains found, valid in DONE
+     * @retval servo_gains_t
+     */
+    servo_gains_t getGains();
+
+    /**
+     * @name getUltimateGain
+     * @brief getUltimateGain: Ku measured by the relay, us/deg, 0 if not measured
+     * @retval float
+     */
+    float getUltimateGain();
+
+    /**
+     * @name getUltimatePeriod
+     * @brief getUltimatePeriod: Tu measured by the relay, s, 0 if not measured
+     * @retval float
+     */
+    float getUltimatePeriod();
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void updateRelay(ServoManager &sm, float angle, unsigned long now);
+    void updateValidate(ServoManager &sm, float angle, unsigned long now);
+    void startCandidate(ServoManager &sm, unsigned long now);
+    void startStep(ServoManager &sm, unsigned long now);
+    void finish(ServoManager &sm);
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    autotune_state_t state;
+    servo_gains_t previousGains;
+    bool found;                     // a candidate passed
+    servo_gains_t bestGains;
+    unsigned long bestSettleMs;
+    unsigned long phaseStartMs;
+
+    float center;                   // servo frame deg, relay center and validation start
+
+    // ----- Relay
+    int side;                       // +1 above the center, -1 below
+    int cycles;
+    unsigned long lastCrossUpMs;
+    float cycleMax, cycleMin;       // deg from center, in the current cycle
+    float sumPeriod, sumAmplitude;
+    float ultimateGain;             // us/deg
+    float ultimatePeriod;           // s
+
+    // ----- Validation
+    int candidate;
+    int step;                       // 0 out, 1 back
+    float stepTarget;               // deg from center
+    float stepDirection;
+    unsigned long stepStartMs;
+    unsigned long lastOutsideMs;
+    unsigned long candidateSettleMs;
+
+};
+
+
+#endif /* SERVO_AUTOTUNE_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,192 @@
+/**
+ * @file ServoMagSweep.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief This class is for learning the magnetometer bias caused by the servo, by a sweep of the needle
+ *
+ */
+
+#include "ServoMagSweep.h"
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const int   SWEEP_HALF_TURN         = SERVO_MAG_BINS / 2;   // stops in half a turn
+const int   SWEEP_STOPS             = 2 * SERVO_MAG_BINS;   // last stop index, back at the start
+const float SWEEP_BAND              = 4.0f;     // deg, stop reached inside, the samples go to the bin of the stop
+const float SWEEP_STILL             = 0.5f;     // deg, largest move of the needle in a loop to be still
+const float SWEEP_MAX_HULL_RATE     = 3.0f;     // deg/s, the field turns in the sensor frame above it
+const unsigned long SWEEP_SETTLE_MS     = 300;  // inside the band for this long before sampling
+const unsigned long SWEEP_SAMPLE_MS     = 400;
+const unsigned long SWEEP_MOVE_TIMEOUT_MS = 3000;
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+static float wrap180(float angle)
+{
+    angle = fmod(angle + 180.0f, 360.0f);
+    if(angle < 0.0f) angle += 360.0f;
+    return angle - 180.0f;
+}
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name ServoMagSweep
+ * @brief ServoMagSweep: constructor, idle
+ */
+ServoMagSweep::ServoMagSweep()
+{
+    state = mag_sweep_state_t::IDLE;
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name start
+ * @brief start: start the sweep from the current needle angle; the servo must not be streaming a move
+ * @param [in] ServoManager sm: servo to sweep
+ * @retval None
+ */
+void ServoMagSweep::start(ServoManager &sm)
+{
+    model.reset();
+    // the stops on the centres of the bins
+    center = floor(sm.getNeedleAngle() / SERVO_MAG_BIN_WIDTH + 0.5f) * SERVO_MAG_BIN_WIDTH;
+    stop = 0;
+    startStop(sm, millis());
+}
+
+/**
+ * @name update
+ * @brief update: one step of the sweep, call it every loop; the servo tick drives the servo meanwhile
+ * @param [in] ServoManager sm: servo to sweep
+ * @param [in] const float mag: new calibrated magnetometer sample, without the servo model; NULL if none
+ * @param [in] float hullRate: deg/s, turn rate of the hull from the gyro
+ * @retval bool true while the sweep is running
+ */
+bool ServoMagSweep::update(ServoManager &sm, const float *mag, float hullRate)
+{
+    if(not isRunning())
+    {
+        return false;
+    }
+
+    const unsigned long now = millis();
+    const float angle = sm.getNeedleAngle();
+    if(state == mag_sweep_state_t::MOVE)
+    {
+        // the dead band may keep the needle off the stop: still near it is enough, the bin is the needle angle
+        if(fabs(wrap180(angle - stopAngle)) > SWEEP_BAND or fabs(wrap180(angle - lastAngle)) > SWEEP_STILL)
+        {
+            lastOutsideMs = now;
+        }
+        lastAngle = angle;
+        if(now - phaseStartMs > SWEEP_MOVE_TIMEOUT_MS)
+        {
+            // stop not reached: servo not moving or feedback missing
+            finish(sm, false);
+        }
+        else if(now - lastOutsideMs >= SWEEP_SETTLE_MS)
+        {
+            phaseStartMs = now;
+            state = mag_sweep_state_t::SAMPLE;
+        }
+        return isRunning();
+    }
+
+    // ----- SAMPLE: the difference between the stops must come from the servo only
+    if(fabs(hullRate) > SWEEP_MAX_HULL_RATE)
+    {
+        finish(sm, false);
+        return false;
+    }
+    if(mag != NULL)
+    {
+        model.addSample(angle, mag);
+    }
+    if(now - phaseStartMs < SWEEP_SAMPLE_MS)
+    {
+        return true;
+    }
+
+    stop++;
+    if(stop <= SWEEP_STOPS)
+    {
+        startStop(sm, now);
+    }
+    else
+    {
+        finish(sm, model.fit());
+    }
+    return isRunning();
+}
+
+bool ServoMagSweep::isRunning()
+{
+    return state == mag_sweep_state_t::MOVE or state == mag_sweep_state_t::SAMPLE;
+}
+
+mag_sweep_state_t ServoMagSweep::getState()
+{
+    return state;
+}
+
+const ServoMagModel &ServoMagSweep::getModel()
+{
+    return model;
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name startStop
+ * @brief startStop: send the needle to the current stop: out half a turn, back a whole turn, out half a turn
+ * @param [in] ServoManager sm: servo to sweep
+ * @param [in] unsigned long now: ms
+ * @retval None
+ */
+void ServoMagSweep::startStop(ServoManager &sm, unsigned long now)
+{
+    int bins;
+    if(stop <= SWEEP_HALF_TURN)
+    {
+        bins = stop;
+    }
+    else if(stop <= 3 * SWEEP_HALF_TURN)
+    {
+        bins = 2 * SWEEP_HALF_TURN - stop;
+    }
+    else
+    {
+        bins = stop - 4 * SWEEP_HALF_TURN;
+    }
+    // one bin per stop: the PID always takes the way of the sweep
+    stopAngle = fmod(center + bins * SERVO_MAG_BIN_WIDTH + 360.0f, 360.0f);
+    sm.rotateDirect(stopAngle);
+
+    phaseStartMs = now;
+    lastOutsideMs = now;
+    lastAngle = sm.getNeedleAngle();
+    state = mag_sweep_state_t::MOVE;
+}
+
+/**
+ * @name finish
+ * @brief finish: end of the sweep, back to the profile setpoint
+ * @param [in] ServoManager sm: servo swept
+ * @param [in] bool success: model fitted
+ * @retval None
+ */
+void ServoMagSweep::finish(ServoManager &sm, bool success)
+{
+    state = success ? mag_sweep_state_t::DONE : mag_sweep_state_t::FAIL;
+    sm.holdPosition();
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,141 @@
+/**
+ * @file ServoMagSweep.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief This class is for learning the magnetometer bias caused by the servo, by a sweep of the needle
+ *
+ * The sweep runs in the loop, one update() per iteration, with the hull still: the needle goes half a turn
+ * one way from where it is, a whole turn back and half a turn again to the start, stopping every
+ * SERVO_MAG_BIN_WIDTH degrees, so every bin of the ServoMagModel is visited twice and the wiring is never
+ * wound more than half a turn. At each stop:
+ *      - MOVE: the PID takes the needle to the stop, bypassing the motion profile; after SWEEP_SETTLE_MS
+ *        still near the stop the motor current and the field have settled
+ *      - SAMPLE: the calibrated magnetometer samples of SWEEP_SAMPLE_MS go to the bin of the needle angle
+ * A hull turning during the samples, or a stop not reached, fails the sweep; the model is fitted at the
+ * end and the table in use is left as it is on failure.
+ *
+ */
+
+#ifndef SERVO_MAG_SWEEP_H
+#define SERVO_MAG_SWEEP_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "ServoManager.h"
+#include <ServoMagModel.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+enum class mag_sweep_state_t
+{
+    IDLE,
+    MOVE,           // going to the next stop
+    SAMPLE,         // collecting samples at the stop
+    DONE,           // model fitted
+    FAIL            // model not changed
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+class ServoMagSweep
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name ServoMagSweep
+     * @brief ServoMagSweep: constructor, idle
+     */
+    ServoMagSweep();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name start
+     * @brief start: start the sweep from the current needle angle; the servo must not be streaming a move
+     * @param [in] ServoManager sm: servo to sweep
+     * @retval None
+     */
+    void start(ServoManager &sm);
+
+    /**
+     * @name update
+     * @brief update: one step of the sweep, call it every loop; the servo tick drives the servo meanwhile
+     * @param [in] ServoManager sm: servo to sweep
+     * @param [in] const float mag: new calibrated magnetometer sample, without the servo model; NULL if none
+     * @param [in] float hullRate: deg/s, turn rate of the hull from the gyro
+     * @retval bool true while the sweep is running
+     */
+    bool update(ServoManager &sm, const float *mag, float hullRate);
+
+    /**
+     * @name isRunning
+     * @brief isRunning: sweep in progress
+     * @retval bool
+     */
+    bool isRunning();
+
+    /**
+     * @name getState
+     * @brief getState: state of the sweep
+     * @retval mag_sweep_state_t
+     */
+    mag_sweep_state_t getState();
+
+    /**
+     * @name getModel
+     * @brief getModel: model learned, valid in DONE
+     * @retval const ServoMagModel &
+     */
+    const ServoMagModel &getModel();
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void startStop(ServoManager &sm, unsigned long now);
+    void finish(ServoManager &sm, bool success);
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    mag_sweep_state_t state;
+    ServoMagModel model;
+
+    float center;                   // servo frame deg, start of the sweep
+    int stop;                       // index of the stop, 0 to 2 SERVO_MAG_BINS
+    float stopAngle;                // servo frame deg
+    unsigned long phaseStartMs;
+    unsigned long lastOutsideMs;    // last time the needle was moving or off the stop
+    float lastAngle;                // servo frame deg, needle angle of the previous update
+
+};
+
+
+#endif /* SERVO_MAG_SWEEP_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -21,6 +21,17 @@
 
 #define FEEDBACK_PIN 12 // NodeMCU D6
 #define SERVO_PIN 14 //NodeMCU D5
+
+/**
+ * @name wrap180
+ * @brief wrap180: angle to -180, 180 deg
+ */
+static float wrap180(float angle)
+{
+    angle = fmod(angle + 180.0f, 360.0f);
+    if(angle < 0.0f) angle += 360.0f;
+    return angle - 180.0f;
+}
 /*******************
  * CONSTRUCTOR & DESTRUCTOR METHODS
 *******************/
@@ -30,31 +41,70 @@
  * @param [in] int desiredDirection: set desired heading deg [0-360]
  * @param [in] int offsetServoCompass: set offset between zero compass and zero motor [0-360]
 */
-ServoManager::ServoManager()
+ServoManager::ServoManager() : profile(SERVO_MAX_VELOCITY, SERVO_MAX_ACCELERATION, SERVO_MAX_JERK)
 {
     // servo = new FeedbackServo(FEEDBACK_PIN, 2.0, 0.1, 0.0, 0.0, -200, 200, 20.0);
     init = false;
     
-    servo = new FeedbackServo(FEEDBACK_PIN, 5.0, 0.1, 0.0, 0.0, -200, 200, 20.0);
-    servo->setServoControl(SERVO_PIN);
+    gains.kp = SERVO_DEFAULT_KP;
+    gains.ki = SERVO_DEFAULT_KI;
+    gains.kd = SERVO_DEFAULT_KD;
+    servo = NULL;
+    buildServo(SERVO_OUTPUT_LIMIT);
 
     this->previousHeading = 0;
     this->deltaForDesiredDirection = 0;
     this->offsetServoCompass = 0;
+    this->targetRaw = deltaForDesiredDirection;
+    this->profileTargetRaw = deltaForDesiredDirection;
+    this->direct = false;
+    this->resync = false;
+    this->directSetpoint = 0;
+    this->wrapLimitRaw = (int32_t)(SERVO_WRAP_LIMIT * BAM16_PER_DEGREE);
+    this->lastMoveMs = millis();
+    // neutral is the servo zero plus the offset: at boot the needle is within half a turn of it
+    this->lastFeedback = servo->Angle();
+    this->winding = wrap180(lastFeedback - offsetServoCompass);
+    // the first tick plans the move from the needle, no step handed to the PID
+    profile.reset(winding);
     this->n_turns = 0;
-    servo->rotate_PID(deltaForDesiredDirection + offsetServoCompass, 1);
+    this->feedForwardRate = 0;
+    this->feedForwardLatencyUs = 0;
+    this->feedForward = 0;
+    this->lastMotionMs = millis();
+    resetTickStats();
     init = true;
 }
 ServoManager::ServoManager(int desiredDirection, int offsetServoCompass)
+    : profile(SERVO_MAX_VELOCITY, SERVO_MAX_ACCELERATION, SERVO_MAX_JERK)
 {
-    servo = new FeedbackServo(FEEDBACK_PIN, 2.0, 0.1, 0.0, 0.0, -200, 200, 20.0);
-    servo->setServoControl(SERVO_PIN);
+    gains.kp = SERVO_DEFAULT_KP;
+    gains.ki = SERVO_DEFAULT_KI;
+    gains.kd = SERVO_DEFAULT_KD;
+    servo = NULL;
+    buildServo(SERVO_OUTPUT_LIMIT);
 
     this->previousHeading = 0;
-    this->deltaForDesiredDirection = desiredDirection;
+    this->deltaForDesiredDirection = Bam16::fromDegrees(desiredDirection).signedRaw();
     this->offsetServoCompass = offsetServoCompass;
+    this->targetRaw = deltaForDesiredDirection;
+    this->profileTargetRaw = deltaForDesiredDirection;
+    this->direct = false;
+    this->resync = false;
+    this->directSetpoint = 0;
+    this->wrapLimitRaw = (int32_t)(SERVO_WRAP_LIMIT * BAM16_PER_DEGREE);
+    this->lastMoveMs = millis();
+    // neutral is the servo zero plus the offset: at boot the needle is within half a turn of it
+    this->lastFeedback = servo->Angle();
+    this->winding = wrap180(lastFeedback - offsetServoCompass);
+    // the first tick plans the move from the needle, no step handed to the PID
+    profile.reset(winding);
     this->n_turns = 0;
-    servo->rotate_PID(deltaForDesiredDirection + offsetServoCompass, 1);
+    this->feedForwardRate = 0;
+    this->feedForwardLatencyUs = 0;
+    this->feedForward = 0;
+    this->lastMotionMs = millis();
+    resetTickStats();
     init = true;
 
 }
@@ -74,7 +124,7 @@ void ServoManager::setFollowHeading(int heading)
 {
     //TODO: check old position
     desiredDirection = heading;
-    deltaForDesiredDirection += desiredDirection;
+    deltaForDesiredDirection += Bam16::fromDegrees(desiredDirection).raw();
 }
 
 /**
@@ -92,37 +142,22 @@ void ServoManager::setOffsetServoCompass(int offset)
 /**
  * @name updateServoPosition
  * @brief updateServoPosition: update the pointing position passing actual heading taked with compass
- * @param [in] int actualHeading: actual heading deg [0-360]
+ * @param [in] Bam16 actualHeading: actual heading
  * @retval None
  */
-void ServoManager::updateServoPosition(int actualHeading)
+void ServoManager::updateServoPosition(Bam16 actualHeading)
 {
-    int delta = actualHeading - (this->previousHeading%360);
+    // Shortest rotation, also when the compass goes through zero (359 -> 0 or 0 -> 359)
+    int16_t delta = (actualHeading - Bam16::fromRaw((uint16_t)this->previousHeading)).signedRaw();
 
-    if(delta > 180)
-    {
-        //ANTICLOCKWISE MOVEMENT PASSING ZERO HEADING ANGLE
-        //avoiding servo turn around of the servo near zero when compass goes from 0 to 359
-        // Serial.println("Anticlockwise zero");
-        deltaForDesiredDirection += 360 - delta;
-    }
-    else if(delta < -180)
-    {
-        //CLOCKWISE MOVEMENT PASSING ZERO HEADING ANGLE
-        //avoiding servo turn around of the servo near zero when compass goes from 359 to 0
-        // Serial.println("Clockwise zero");
-        deltaForDesiredDirection += 360 + delta;
-    }
-    else
-    {
-        deltaForDesiredDirection += delta;
-    }
+    // kept within a turn, the turns are counted by the target
+    deltaForDesiredDirection = Bam16::fromRaw((uint16_t)(deltaForDesiredDirection + delta)).signedRaw();
     if(delta != 0)
     {
-        //Move servo only if delta is positive or negative
-        servo->rotate_PID((-deltaForDesiredDirection) + offsetServoCompass, 0);
+        //Move servo only if delta is positive or negative, the tick plans the move
+        moveBy(-delta);
     }
-    this->previousHeading = actualHeading;
+    this->previousHeading = actualHeading.raw();
 }
 
 
@@ -130,47 +165,322 @@ void ServoManager::updateServoPosition(int actualHeading)
  * @name setServoPosition
  * @brief setServoPosition: set servo position checking at zero position if it is a clockwise or anticlockwise rotation to
  * avoid turn around of the needle
- * @param [in] int actualHeading: actual heading deg [0-360]
+ * @param [in] Bam16 position: servo position
  * @retval None
  */
-void ServoManager::setServoPosition(int position)
+void ServoManager::setServoPosition(Bam16 position)
 {
     // FOR CONTINUOUS ROTATION
     //i'm in 240 deg -> previous heading = 240  == actual position
     // go to 40 deg -> position = 40   == desired position
-    // alpha is  desired - actual --> 40 - 240 = -200
-    //then delta is 360 + alpha --> 360 - 200 = 160 --> this is the value to be add to the actual position to obtain a short turn to 40 degrees
-    // init = false;
+    // the difference 40 - 240 = -200 wraps to +160 --> this is the value to be add to the actual position to obtain a short turn to 40 degrees
+    int16_t delta = (position - Bam16::fromRaw((uint16_t)this->previousHeading)).signedRaw();
 
-    int alpha = position - (this->previousHeading%360);
-    int delta = 0;
-    int servo_position = 0;
+    int32_t servo_position = (previousHeading + delta) % BAM16_TURN;
+
+    // the target is unwrapped: the move goes on from where the needle is, also through zero
+    moveBy(delta);
+    this->previousHeading = servo_position;
+    init = true;
+}
 
-    if((alpha <-180) and init)
+/**
+ * @name setFeedForward
+ * @brief setFeedForward: rate of the needle from the gyro and age of the heading behind the target; call it
+ *                        every loop, before setServoPosition
+ * @param [in] float rate: deg/s of the needle, minus the heading rate
+ * @param [in] unsigned long latencyUs: from the heading sample to now, smoothing included
+ * @retval None
+ */
+void ServoManager::setFeedForward(float rate, unsigned long latencyUs)
+{
+    feedForwardLatencyUs = latencyUs;
+    feedForwardRate = (fabs(rate) < SERVO_FEED_FORWARD_MIN_RATE) ? 0.0f : rate;
+}
+
+/**
+ * @name setWrapLimit
+ * @brief setWrapLimit: how far from neutral a move may wind the needle, the next moves keep within it
+ * @param [in] float limit: deg, at least 180 (one of the two ways round always fits)
+ * @retval None
+ */
+void ServoManager::setWrapLimit(float limit)
+{
+    if(limit < 180.0f) limit = 180.0f;
+    wrapLimitRaw = (int32_t)(limit * BAM16_PER_DEGREE);
+}
+
+/**
+ * @name unwind
+ * @brief unwind: when the needle has been still for SERVO_UNWIND_IDLE_MS wound more than SERVO_UNWIND_WINDING,
+ *                turn it back by whole turns within half a turn of neutral, same pointing; call it every loop
+ * @retval None
+ */
+void ServoManager::unwind()
+{
+    const unsigned long now = millis();
+    if(direct or isMoving())
+    {
+        lastMoveMs = now;
+        return;
+    }
+    if(now - lastMoveMs < SERVO_UNWIND_IDLE_MS)
     {
-        // i need to sum the alpha value
-        delta = (360 + alpha);
+        return;
     }
-    else if((alpha > 180) and init)
+
+    // wound as the feedback counts it: the target keeps its pointing, within half a turn of neutral
+    if(fabs(winding) > SERVO_UNWIND_WINDING)
     {
-        delta = (alpha - 360);
+        targetRaw = Bam16::fromRaw((uint16_t)targetRaw).signedRaw();
+        lastMoveMs = now;
+    }
+}
+
+/**
+ * @name getWinding
+ * @brief getWinding: needle angle from neutral across the turns, from the feedback
+ * @retval float deg, positive toward increasing servo angles
+ */
+float ServoManager::getWinding()
+{
+    return winding;
+}
+
+/**
+ * @name getNeedleAngle
+ * @brief getNeedleAngle: feedback angle read by the last tick, servo frame (offset included), no feedback read
+ * @retval float deg [0-360]
+ */
+float ServoManager::getNeedleAngle()
+{
+    return lastFeedback;
+}
+
+/**
+ * @name getMagWeight
+ * @brief getMagWeight: how much the magnetometer can be trusted with the servo, 0 while the needle moves,
+ *                      rising to 1 over SERVO_MAG_SETTLE_MS once it stopped
+ * @retval float 0 to 1
+ */
+float ServoManager::getMagWeight()
+{
+    const unsigned long still = millis() - lastMotionMs;
+    if(still >= SERVO_MAG_SETTLE_MS)
+    {
+        return 1.0f;
+    }
+    return (float)still / SERVO_MAG_SETTLE_MS;
+}
+
+/**
+ * @name getTurns
+ * @brief getTurns: whole turns of the needle from neutral, from the feedback
+ * @retval int turns, toward zero
+ */
+int ServoManager::getTurns()
+{
+    return n_turns;
+}
+
+/**
+ * @name setMotionLimits
+ * @brief setMotionLimits: limits of the servo moves, also in the middle of a move
+ * @param [in] float maxVelocity: deg/s
+ * @param [in] float maxAcceleration: deg/s^2
+ * @param [in] float maxJerk: deg/s^3, 0 for a trapezoidal profile
+ * @retval None
+ */
+void ServoManager::setMotionLimits(float maxVelocity, float maxAcceleration, float maxJerk)
+{
+    profile.setLimits(maxVelocity, maxAcceleration, maxJerk);
+}
+
+/**
+ * @name step
+ * @brief step: one tick of the servo control, the next setpoint of the move and one PID output;
+ *              non-blocking, call it every SERVO_SETPOINT_PERIOD_MS from a Ticker
+ * @retval None
+ */
+void ServoManager::step()
+{
+    const unsigned long start = micros();
+    // the profile runs on the measured period: a late tick moves the setpoint as far as the time gone
+    const unsigned long period = (stats.ticks > 0) ? start - lastTickUs : SERVO_SETPOINT_PERIOD_MS * 1000;
+    lastTickUs = start;
+
+    // ----- Turns: the feedback moves much less than half a turn in a tick
+    const float feedback = servo->Angle();
+    const float moved = wrap180(feedback - lastFeedback);
+    const float turned = winding + moved;
+    lastFeedback = feedback;
+    winding = turned;
+    n_turns = (int)(turned / 360.0f);
+
+    // ----- Back from rotateDirect: the profile starts from the needle, holdPosition() took the target to its turn
+    if(resync and not direct)
+    {
+        profile.reset(turned);
+        resync = false;
+    }
+
+    // ----- Target: the last one of the loop, moved on by the feed-forward
+    const int32_t target = targetRaw;
+    const float rate = feedForwardRate;
+    if(target != profileTargetRaw)
+    {
+        // the new target is as old as the heading it comes from
+        profileTargetRaw = target;
+        feedForward = rate * feedForwardLatencyUs * 1e-6f;
     }
     else
     {
-        delta = alpha;
+        feedForward += rate * period * 1e-6f;
     }
+    if(feedForward > SERVO_FEED_FORWARD_LIMIT) feedForward = SERVO_FEED_FORWARD_LIMIT;
+    if(feedForward < -SERVO_FEED_FORWARD_LIMIT) feedForward = -SERVO_FEED_FORWARD_LIMIT;
+    profile.setTarget(bamToDegrees(target) + feedForward);
 
-    servo_position = (previousHeading  + delta) % 360;
+    if(direct)
+    {
+        servo->rotate_PID(directSetpoint, 0);
+    }
+    else
+    {
+        // the PID goes the short way to the wrapped setpoint: more than half a turn behind it (a stall, or a
+        // profile with no limits) it would turn the needle the wrong way, a turn off the count. The setpoint is
+        // sent at most SERVO_MAX_LEAD ahead of the needle, which is still pushed the way the profile goes
+        float setpoint = profile.update(period * 1e-6f);
+        if(setpoint - turned > SERVO_MAX_LEAD) setpoint = turned + SERVO_MAX_LEAD;
+        if(setpoint - turned < -SERVO_MAX_LEAD) setpoint = turned - SERVO_MAX_LEAD;
+        // also when settled: the PID holds the needle only while it runs
+        sendSetpoint(setpoint);
+    }
 
-    // Serial.println(String("SP: ") + String(servo_position) + 
-    //                 String("\nalpha: ") + String(alpha) +
-    //                 String("\nDt: ") + String(delta) +
-    //                 String(" \nSum: ") + String(servo_position + offsetServoCompass)
-    // );
+    // ----- Magnetometer: a streamed move or a turning needle draws current and moves the magnet
+    if(fabs(moved) > SERVO_MAG_STILL_STEP or (not direct and not profile.isSettled()))
+    {
+        lastMotionMs = millis();
+    }
 
-    servo->rotate_PID(servo_position + offsetServoCompass, 0);
-    this->previousHeading = servo_position;
-    init = true;
+    // ----- Timing
+    const unsigned long busy = micros() - start;
+    if(stats.ticks > 0)
+    {
+        if(period > stats.maxPeriodUs) stats.maxPeriodUs = period;
+        if(period > SERVO_TICK_LATE_US) stats.late++;
+    }
+    if(busy > stats.maxStepUs) stats.maxStepUs = busy;
+    stats.ticks++;
+}
+
+/**
+ * @name getTickStats
+ * @brief getTickStats: timing of the ticks since the last resetTickStats
+ * @retval servo_tick_stats_t
+ */
+servo_tick_stats_t ServoManager::getTickStats()
+{
+    return stats;
+}
+
+/**
+ * @name resetTickStats
+ * @brief resetTickStats: restart the timing of the ticks
+ * @retval None
+ */
+void ServoManager::resetTickStats()
+{
+    stats.ticks = 0;
+    stats.late = 0;
+    stats.maxPeriodUs = 0;
+    stats.maxStepUs = 0;
+}
+
+/**
+ * @name isMoving
+ * @brief isMoving: a move is still being streamed
+ * @retval bool
+ */
+bool ServoManager::isMoving()
+{
+    return targetRaw != profileTargetRaw or not profile.isSettled();
+}
+
+/**
+ * @name setGains
+ * @brief setGains: rebuild the servo PID with new gains and output limit, the setpoint is kept
+ * @param [in] servo_gains_t gains: PID gains
+ * @param [in] int outputLimit: PID output limit, us from the stop pulse
+ * @retval None
+ */
+void ServoManager::setGains(const servo_gains_t &gains, int outputLimit)
+{
+    this->gains = gains;
+    buildServo(outputLimit);
+}
+
+/**
+ * @name getGains
+ * @brief getGains: PID gains in use
+ * @retval servo_gains_t
+ */
+servo_gains_t ServoManager::getGains()
+{
+    return gains;
+}
+
+/**
+ * @name getFeedbackAngle
+ * @brief getFeedbackAngle: angle read by the servo feedback, servo frame (offset included)
+ * @retval float deg [0-360]
+ */
+float ServoManager::getFeedbackAngle()
+{
+    return servo->Angle();
+}
+
+/**
+ * @name rotateDirect
+ * @brief rotateDirect: setpoint of the PID from the next tick, bypassing the motion profile (tuning only);
+ *                      holdPosition() goes back to the profile
+ * @param [in] float angle: servo frame deg (offset included)
+ * @retval None
+ */
+void ServoManager::rotateDirect(float angle)
+{
+    directSetpoint = angle;
+    direct = true;
+}
+
+/**
+ * @name holdPosition
+ * @brief holdPosition: back to the motion profile after rotateDirect, from where the needle is; the target keeps
+ *                      its pointing, on the turn of the needle within the wrap limit
+ * @retval None
+ */
+void ServoManager::holdPosition()
+{
+    if(not direct)
+    {
+        return;
+    }
+    // rotateDirect may have left the needle whole turns from the target (the PID takes the short way to its
+    // setpoint): the target keeps its pointing on the turn of the needle, the wrap limit counted from there
+    const int32_t needle = (int32_t)(winding * BAM16_PER_DEGREE);
+    int32_t target = needle + Bam16::fromRaw((uint16_t)(targetRaw - needle)).signedRaw();
+    if(target > wrapLimitRaw)
+    {
+        target -= BAM16_TURN;
+    }
+    else if(target < -wrapLimitRaw)
+    {
+        target += BAM16_TURN;
+    }
+    targetRaw = target;
+    lastMoveMs = millis();
+    resync = true;
+    direct = false;
 }
 
 bool ServoManager::getStatus()
@@ -188,3 +498,50 @@ bool ServoManager::getStatus()
 /*******************
  * PRIVATE METHODS
 *******************/
+/**
+ * @name moveBy
+ * @brief moveBy: move the target by the shortest rotation, or the other way round if the target would be wound
+ *                past the wrap limit; one 32 bit store, the tick never reads half of it
+ * @param [in] int32_t delta: BAM16 LSB, within half a turn
+ * @retval None
+ */
+void ServoManager::moveBy(int32_t delta)
+{
+    int32_t target = targetRaw + delta;
+    if(target > wrapLimitRaw)
+    {
+        target -= BAM16_TURN;
+    }
+    else if(target < -wrapLimitRaw)
+    {
+        target += BAM16_TURN;
+    }
+    targetRaw = target;
+    lastMoveMs = millis();
+}
+
+/**
+ * @name sendSetpoint
+ * @brief sendSetpoint: hand a setpoint of the profile to the PID, wrapped to one turn as the PID wants it
+ * @param [in] float setpoint: deg, unwrapped, offset excluded
+ * @retval None
+ */
+void ServoManager::sendSetpoint(float setpoint)
+{
+    const int32_t wrapped = Bam16::fromDegrees(setpoint).raw();
+    servo->rotate_PID(bamToDegrees(wrapped) + offsetServoCompass, 0);
+}
+
+/**
+ * @name buildServo
+ * @brief buildServo: (re)build the FeedbackServo with the current gains
+ * @param [in] int outputLimit: PID output limit, us from the stop pulse
+ * @retval None
+ */
+void ServoManager::buildServo(int outputLimit)
+{
+    // FeedbackServo takes its gains only in the constructor
+    delete servo;
+    servo = new FeedbackServo(FEEDBACK_PIN, gains.kp, gains.ki, gains.kd, 0.0, -outputLimit, outputLimit, SERVO_CONTROL_PERIOD_MS);
+    servo->setServoControl(SERVO_PIN);
+}
@@ -11,6 +11,31 @@
  *       Actually the PID library for 360 degrees servo control is developed only for NodeMCU but it is not impossible the translation for ESP32 and AVR family
  * 
  * @dependecies: Feedback_Control_Servo https://github.com/belyeng93/Feedback_Control_Servo
+ *
+ * The servo is driven by step(), at the fixed rate SERVO_SETPOINT_PERIOD_MS from a Ticker of the sketch:
+ * every tick hands one setpoint to the PID and the PID computes one output, also when the needle is still,
+ * so the control does not depend on how long the loop took. The loop only publishes the target
+ * (setServoPosition, updateServoPosition) in one 32 bit word, read by the tick.
+ * On the ESP8266 the Ticker runs between slices of loop(), in the system context with the network stack;
+ * timer1 is not free, it generates the servo pulses.
+ *
+ * Multi-turn: the needle is wired, so the turns count. The tick follows the feedback across the turns
+ * (getWinding, from the neutral angle: the servo zero plus the offset, at boot within half a turn of it).
+ * A move takes the shortest rotation unless its target would be wound past the wrap limit, then it goes
+ * the other way round; unwind(), called every loop, takes the needle back within half a turn of neutral
+ * once it has been still for SERVO_UNWIND_IDLE_MS wound past SERVO_UNWIND_WINDING. The target stays on the
+ * turn of the needle: after rotateDirect holdPosition() moves it there. The setpoint is sent at most
+ * SERVO_MAX_LEAD ahead of the needle: the PID goes the short way, a needle stalled or left behind by a profile
+ * with no limits is still pushed the way the profile goes and does not end a turn off the target.
+ *
+ * Feed-forward: the target comes from the smoothed heading, late by the sample, the smoothing and the loop,
+ * and the sketch only moves it past a few degrees. With setFeedForward the tick moves the target with the
+ * needle rate from the gyro: at a new target by rate * latency (its age), then by the rate integrated tick
+ * by tick until the next one, within SERVO_FEED_FORWARD_LIMIT.
+ *
+ * Magnetometer: the motor current and the turning magnet of the servo disturb the field, getMagWeight()
+ * is 0 while the needle moves and back to 1 SERVO_MAG_SETTLE_MS after it stopped; the bias left with the
+ * needle still depends on its angle (getNeedleAngle, see ServoMagModel).
  *   
  */
 
@@ -21,11 +46,32 @@
 /*-----------------------------------*
  * INCLUDE FILES
  *-----------------------------------*/
+#include <Arduino.h>
 #include <FeedbackServo.h>
+#include <BinaryAngle.h>
+#include <MotionProfile.h>
 
 /*-----------------------------------*
  * PUBLIC DEFINES
  *-----------------------------------*/
+const float SERVO_MAX_VELOCITY              = 360.0f;      // deg/s, Parallax 360 is ~720 deg/s unloaded
+const float SERVO_MAX_ACCELERATION          = 1440.0f;     // deg/s^2
+const float SERVO_MAX_JERK                  = 14400.0f;    // deg/s^3, 0 for a trapezoidal profile
+const unsigned long SERVO_SETPOINT_PERIOD_MS = 20;          // step() period: setpoint and PID at 50 Hz
+const float SERVO_CONTROL_PERIOD_MS         = 20.0f;       // PID period of FeedbackServo, one output per step()
+const unsigned long SERVO_TICK_LATE_US      = 30000;       // a tick later than this is counted late
+const float SERVO_WRAP_LIMIT                = 540.0f;      // deg from neutral, default wrap limit, at least 180
+const float SERVO_UNWIND_WINDING            = 360.0f;      // deg from neutral, still needle unwound beyond it
+const unsigned long SERVO_UNWIND_IDLE_MS    = 10000;       // still for this long before unwinding
+const float SERVO_FEED_FORWARD_LIMIT        = 15.0f;       // deg, largest correction of the target
+const float SERVO_MAX_LEAD                  = 150.0f;      // deg, farthest setpoint ahead of the needle, under half a turn
+const float SERVO_FEED_FORWARD_MIN_RATE     = 1.0f;        // deg/s, below it the gyro bias would drift the needle
+const float SERVO_MAG_STILL_STEP            = 0.5f;        // deg of feedback in a tick, above it the needle is moving
+const unsigned long SERVO_MAG_SETTLE_MS     = 300;         // magnetometer weight back to 1 after the needle stopped
+const int SERVO_OUTPUT_LIMIT                = 200;         // PID output limit, us from the 1500 us stop pulse
+const float SERVO_DEFAULT_KP                = 14.0f;       // PID gains until an autotune is saved, chosen with the
+const float SERVO_DEFAULT_KI                = 0.15f;       // profile above on the Parallax 360 model of servo_bench:
+const float SERVO_DEFAULT_KD                = 25.0f;       // the profile plans the setpoints, the damping is the PID's
 
 /*-----------------------------------*
  * PUBLIC MACROS
@@ -36,7 +82,20 @@ template <typename T> int sign(T val) {
 /*-----------------------------------*
  * PUBLIC TYPEDEFS
  *-----------------------------------*/
-/* None */
+struct servo_gains_t
+{
+    float kp;
+    float ki;           // per control period
+    float kd;           // per control period
+};
+
+struct servo_tick_stats_t
+{
+    unsigned long ticks;
+    unsigned long late;             // ticks with a period above SERVO_TICK_LATE_US
+    unsigned long maxPeriodUs;      // longest time between two ticks
+    unsigned long maxStepUs;        // longest step(), PID and feedback read included
+};
 
 /*-----------------------------------*
  * PUBLIC VARIABLE DECLARATIONS
@@ -86,18 +145,153 @@ public:
     /**
      * @name updateServoPosition
      * @brief updateServoPosition: update the pointing position passing actual heading taked with compass
-     * @param [in] int actualHeading: actual heading deg [0-360]
+     * @param [in] Bam16 actualHeading: actual heading
      * @retval None
      */
-    void updateServoPosition(int actualHeading);
+    void updateServoPosition(Bam16 actualHeading);
 
     /**
      * @name setServoPosition
-     * @brief setServoPosition: set servo position
-     * @param [in] int position: deg [0-360]
+     * @brief setServoPosition: set servo position, along the shortest rotation within the wrap limit; the move is
+     *                          planned by the motion profile and streamed by the tick
+     * @param [in] Bam16 position: servo position
+     * @retval None
+     */
+    void setServoPosition(Bam16 position);
+
+    /**
+     * @name setFeedForward
+     * @brief setFeedForward: rate of the needle from the gyro and age of the heading behind the target; call it
+     *                        every loop, before setServoPosition
+     * @param [in] float rate: deg/s of the needle, minus the heading rate
+     * @param [in] unsigned long latencyUs: from the heading sample to now, smoothing included
+     * @retval None
+     */
+    void setFeedForward(float rate, unsigned long latencyUs);
+
+    /**
+     * @name setWrapLimit
+     * @brief setWrapLimit: how far from neutral a move may wind the needle, the next moves keep within it
+     * @param [in] float limit: deg, at least 180 (one of the two ways round always fits)
+     * @retval None
+     */
+    void setWrapLimit(float limit);
+
+    /**
+     * @name unwind
+     * @brief unwind: when the needle has been still for SERVO_UNWIND_IDLE_MS wound more than SERVO_UNWIND_WINDING,
+     *                turn it back by whole turns within half a turn of neutral, same pointing; call it every loop
+     * @retval None
+     */
+    void unwind();
+
+    /**
+     * @name getWinding
+     * @brief getWinding: needle angle from neutral across the turns, from the feedback
+     * @retval float deg, positive toward increasing servo angles
+     */
+    float getWinding();
+
+    /**
+     * @name getNeedleAngle
+     * @brief getNeedleAngle: feedback angle read by the last tick, servo frame (offset included), no feedback read
+     * @retval float deg [0-360]
+     */
+    float getNeedleAngle();
+
+    /**
+     * @name getMagWeight
+     * @brief getMagWeight: how much the magnetometer can be trusted with the servo, 0 while the needle moves,
+     *                      rising to 1 over SERVO_MAG_SETTLE_MS once it stopped
+     * @retval float 0 to 1
+     */
+    float getMagWeight();
+
+    /**
+     * @name getTurns
+     * @brief getTurns: whole turns of the needle from neutral, from the feedback
+     * @retval int turns, toward zero
+     */
+    int getTurns();
+
+    /**
+     * @name setMotionLimits
+     * @brief setMotionLimits: limits of the servo moves, also in the middle of a move
+     * @param [in] float maxVelocity: deg/s
+     * @param [in] float maxAcceleration: deg/s^2
+     * @param [in] float maxJerk: deg/s^3, 0 for a trapezoidal profile
+     * @retval None
+     */
+    void setMotionLimits(float maxVelocity, float maxAcceleration, float maxJerk);
+
+    /**
+     * @name step
+     * @brief step: one tick of the servo control, the next setpoint of the move and one PID output;
+     *              non-blocking, call it every SERVO_SETPOINT_PERIOD_MS from a Ticker
+     * @retval None
+     */
+    void step();
+
+    /**
+     * @name getTickStats
+     * @brief getTickStats: timing of the ticks since the last resetTickStats
+     * @retval servo_tick_stats_t
+     */
+    servo_tick_stats_t getTickStats();
+
+    /**
+     * @name resetTickStats
+     * @brief resetTickStats: restart the timing of the ticks
+     * @retval None
+     */
+    void resetTickStats();
+
+    /**
+     * @name isMoving
+     * @brief isMoving: a move is still being streamed
+     * @retval bool
+     */
+    bool isMoving();
+
+    /**
+     * @name setGains
+     * @brief setGains: rebuild the servo PID with new gains and output limit, the setpoint is kept
+     * @param [in] servo_gains_t gains: PID gains
+     * @param [in] int outputLimit: PID output limit, us from the stop pulse
+     * @retval None
+     */
+    void setGains(const servo_gains_t &gains, int outputLimit = SERVO_OUTPUT_LIMIT);
+
+    /**
+     * @name getGains
+     * @brief getGains: PID gains in use
+     * @retval servo_gains_t
+     */
+    servo_gains_t getGains();
+
+    /**
+     * @name getFeedbackAngle
+     * @brief getFeedbackAngle: angle read by the servo feedback, servo frame (offset included)
+     * @retval float deg [0-360]
+     */
+    float getFeedbackAngle();
+
+    /**
+     * @name rotateDirect
+     * @brief rotateDirect: setpoint of the PID from the next tick, bypassing the motion profile (tuning only);
+     *                      holdPosition() goes back to the profile
+     * @param [in] float angle: servo frame deg (offset included)
      * @retval None
      */
-    void setServoPosition(int position);
+    void rotateDirect(float angle);
+
+    /**
+     * @name holdPosition
+     * @brief holdPosition: back to the motion profile after rotateDirect, from where the needle is; the target keeps
+     *                      its pointing, on the turn of the needle within the wrap limit
+     * @retval None
+     */
+    void holdPosition();
 
     /**
      * @name getStatus
@@ -122,23 +316,45 @@ private:
     /*******************
      * PRIVATE METHODS
     *******************/
-
+    void sendSetpoint(float setpoint);
+    void moveBy(int32_t delta);
+    void buildServo(int outputLimit);
 
     /*******************
      * PRIVATE VARIABLES
     *******************/
     FeedbackServo *servo;
+    servo_gains_t gains;
+    MotionProfile profile;              // deg, servo angle unwrapped over the turns, offset excluded
+
+    // ----- Shared by the loop and the tick: single words
+    volatile int32_t targetRaw;         // BAM16 LSB, unwrapped, target of the profile, written by the loop
+    volatile bool direct;               // rotateDirect in use
+    volatile bool resync;               // holdPosition: the tick restarts the profile from the needle
+    volatile float directSetpoint;      // deg, servo frame
+    volatile float winding;             // deg from neutral, from the feedback, written by the tick
+    volatile int n_turns;               // whole turns of winding, written by the tick
+    volatile float feedForwardRate;     // deg/s of the needle
+    volatile unsigned long feedForwardLatencyUs;
+    volatile float lastFeedback;        // deg, servo frame, feedback of the last tick
+    volatile unsigned long lastMotionMs;    // last tick the needle was moving
+
+    // ----- Tick only
+    int32_t profileTargetRaw;           // BAM16 LSB, target handed to the profile
+    float feedForward;                  // deg, correction of the target
+    unsigned long lastTickUs;
+    servo_tick_stats_t stats;
 
     int offsetServoCompass;
     int desiredDirection;   
 
 
-    int previousHeading;
-    int deltaForDesiredDirection;
+    int32_t previousHeading;            // BAM16 LSB, last servo position, within one turn of zero
+    int32_t deltaForDesiredDirection;   // BAM16 LSB, within half a turn of zero
+    int32_t wrapLimitRaw;               // BAM16 LSB
+    unsigned long lastMoveMs;           // last time the needle was moving or given a target
     bool init;
 
-    int n_turns; // numebers of rotated turns
-
 };
 
 
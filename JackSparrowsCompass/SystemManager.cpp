@@ -5,6 +5,7 @@ SystemManager::SystemManager(/* args */)
     gps_status      = gps_status_t::OFFLINE;
     servo_status    = servo_status_t::OFFLINE;
     system_status   = system_status_t::OFFLINE;
+    mag_disturbed   = false;
     
     gps_offline_counter = 0;
     gps_offline_th = GPS_OFFLINE_TH_DEFAULT;
@@ -44,6 +45,10 @@ void SystemManager::update_servo_status(servo_status_t ss)
 {
     this->servo_status = ss;
 }
+void SystemManager::update_mag_disturbance(bool disturbed)
+{
+    this->mag_disturbed = disturbed;
+}
 system_status_t SystemManager::get_system_status()
 {
     if( compass_status == compass_status_t::OK && 
@@ -86,6 +91,10 @@ servo_status_t SystemManager::get_servo_status()
 {
     return servo_status;
 }
+bool SystemManager::is_mag_disturbed()
+{
+    return mag_disturbed;
+}
 void SystemManager::get_status(system_status_t & sysS, compass_status_t & cs, gps_status_t &gs, servo_status_t &ss)
 {
     sysS    = this->system_status;
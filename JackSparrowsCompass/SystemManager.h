@@ -39,6 +39,7 @@ private:
     gps_status_t        gps_status;
     servo_status_t      servo_status;
     system_status_t     system_status;
+    bool                mag_disturbed;      // field disturbed, the heading coasts on the gyro
 
     uint gps_offline_counter;
     uint gps_offline_th;
@@ -55,6 +56,7 @@ public:
     void update_compass_status(compass_status_t cs);
     void update_gps_status(gps_status_t gs);
     void update_servo_status(servo_status_t ss);
+    void update_mag_disturbance(bool disturbed);
 
     void set_gps_offline_th(uint th);
 
@@ -64,6 +66,7 @@ public:
     compass_status_t    get_compass_status();
     gps_status_t        get_gps_status();
     servo_status_t      get_servo_status();
+    bool                is_mag_disturbed();
 
     void get_status(system_status_t & sysS, compass_status_t & cs, gps_status_t &gs, servo_status_t &ss);
 
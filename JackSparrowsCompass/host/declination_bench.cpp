@@ -0,0 +1,163 @@
+/**
+ * @file declination_bench.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host benchmark of the World Magnetic Model: accuracy, time per evaluation and the cell cache
+ *
+ * Prints:
+ *      - declination, inclination and intensity at a test point of the WMM2025 report, against the value of
+ *        the report, and at the test points of the WMM2020 report: WMM2025 taken back to 2020.0 is off
+ *        them by the forecast error of WMM2020, within BENCH_WMM2020_TOLERANCE
+ *      - a date past the life of the model: update() takes the field at its end and flags it
+ *      - the declination at Torgiano, to compare with the 3.633 deg of the sketches
+ *      - the time of one evaluate() and of one cached update()
+ *      - a voyage Ancona - Split at 6 kn with a fix every second: evaluations of the model, and the largest
+ *        difference between the cached declination and the one at the fix
+ *
+ * Usage:
+ *      declination_bench [year]
+ *
+ * Build (host):
+ *      g++ -std=c++11 -O2 -I../../libraries/CompassCore declination_bench.cpp \
+ *          ../../libraries/CompassCore/MagneticModel.cpp -o declination_bench
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <MagneticModel.h>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const int    BENCH_ROUNDS       = 20000;
+const double VOYAGE_FROM[2]     = {43.62, 13.51};   // Ancona
+const double VOYAGE_TO[2]       = {43.50, 16.44};   // Split
+const double VOYAGE_SPEED       = 3.09;             // m/s, 6 kn
+const double METERS_PER_DEG     = 111195.0;
+const float  TORGIANO[2]        = {43.025986f, 12.433926f};
+const float  BENCH_WMM2025_TOLERANCE = 0.05f;       // deg, rounding of the report
+const float  BENCH_WMM2020_TOLERANCE = 0.25f;       // deg, forecast error of WMM2020 over five years
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+// test values of the reports at 0 km
+struct TestPoint
+{
+    float year;
+    float latitude;
+    float longitude;
+    float declination;
+    float inclination;
+    float intensity;
+};
+
+const TestPoint TEST_POINTS_2025[] =
+{
+    {2025.0f,  80.0f,   0.0f,   1.28f,  83.21f, 55178.4f},
+};
+
+const TestPoint TEST_POINTS_2020[] =
+{
+    {2020.0f,  80.0f,   0.0f,  -1.28f,  83.14f, 55000.1f},
+    {2020.0f,   0.0f, 120.0f,   0.16f, -15.42f, 41104.9f},
+    {2020.0f, -80.0f, 240.0f,  69.36f, -72.20f, 55120.6f},
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+/**
+ * @name compare
+ * @brief compare: the model at the test points, against the values of a report
+ * @retval float: deg, largest difference of declination or inclination
+ */
+template <size_t N> static float compare(const TestPoint (&points)[N])
+{
+    float worst = 0.0f;
+    for (const TestPoint &point : points)
+    {
+        float declination, inclination, intensity;
+        MagneticModel::evaluate(point.latitude, point.longitude, 0.0f, point.year, declination, inclination, intensity);
+        printf("%.1f %6.1f %6.1f: D %7.2f (%7.2f) I %7.2f (%7.2f) F %8.1f (%8.1f)\n", point.year, point.latitude,
+               point.longitude, declination, point.declination, inclination, point.inclination, intensity, point.intensity);
+        worst = fmaxf(worst, fmaxf(fabsf(declination - point.declination), fabsf(inclination - point.inclination)));
+    }
+    return worst;
+}
+
+int main(int argc, char **argv)
+{
+    const float year = (argc > 1) ? (float)atof(argv[1]) : 2026.5f;
+
+    // ----- Accuracy against the reports
+    const float worst = compare(TEST_POINTS_2025);
+    printf("largest angle difference from the WMM2025 report %.3f deg\n", worst);
+    const float worst2020 = compare(TEST_POINTS_2020);
+    printf("largest angle difference from the WMM2020 report %.3f deg\n", worst2020);
+
+    // ----- Past the life of the model: the field at its end, flagged
+    float declination, inclination, intensity;
+    MagneticModel expired;
+    expired.update(TORGIANO[0], TORGIANO[1], MAGNETIC_MODEL_EPOCH + MAGNETIC_MODEL_LIFE + 3.0f);
+    MagneticModel::evaluate(TORGIANO[0], TORGIANO[1], 0.0f, MAGNETIC_MODEL_EPOCH + MAGNETIC_MODEL_LIFE,
+                            declination, inclination, intensity);
+    const bool clamped = !expired.isCurrent() && fabsf(expired.getDeclination() - declination) < 0.05f;
+    printf("Torgiano %.1f: D %.3f, %s\n", MAGNETIC_MODEL_EPOCH + MAGNETIC_MODEL_LIFE + 3.0f, expired.getDeclination(),
+           clamped ? "flagged, field of the end of the model" : "not flagged (wrong)");
+
+    MagneticModel::evaluate(TORGIANO[0], TORGIANO[1], 0.0f, year, declination, inclination, intensity);
+    printf("Torgiano %.1f: D %.3f I %.2f F %.0f\n", year, declination, inclination, intensity);
+
+    // ----- Time
+    volatile float sink = 0.0f;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_ROUNDS; ++i)
+    {
+        MagneticModel::evaluate(TORGIANO[0] + i * 1e-5f, TORGIANO[1], 0.0f, year, declination, inclination, intensity);
+        sink = sink + declination;
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    printf("evaluate %8.1f ns\n", std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_ROUNDS);
+
+    MagneticModel cached;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_ROUNDS; ++i)
+    {
+        cached.update(TORGIANO[0] + i * 1e-8, TORGIANO[1], year);
+        sink = sink + cached.getDeclination();
+    }
+    t1 = std::chrono::steady_clock::now();
+    printf("update   %8.1f ns cached, %u evaluations\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_ROUNDS, (unsigned int)cached.getEvaluations());
+
+    // ----- Voyage, one fix per second
+    MagneticModel model;
+    const double north = (VOYAGE_TO[0] - VOYAGE_FROM[0]) * METERS_PER_DEG;
+    const double east = (VOYAGE_TO[1] - VOYAGE_FROM[1]) * METERS_PER_DEG * cos(VOYAGE_FROM[0] * M_PI / 180.0);
+    const double length = sqrt(north * north + east * east);
+    const int fixes = (int)(length / VOYAGE_SPEED);
+    float largest = 0.0f;
+    for (int i = 0; i <= fixes; ++i)
+    {
+        const double f = (double)i / fixes;
+        const double latitude = VOYAGE_FROM[0] + f * (VOYAGE_TO[0] - VOYAGE_FROM[0]);
+        const double longitude = VOYAGE_FROM[1] + f * (VOYAGE_TO[1] - VOYAGE_FROM[1]);
+        const float date = year + i / (365.25f * 86400.0f);
+        model.update(latitude, longitude, date);
+        MagneticModel::evaluate((float)latitude, (float)longitude, 0.0f, date, declination, inclination, intensity);
+        largest = fmaxf(largest, fabsf(model.getDeclination() - declination));
+    }
+    printf("voyage %.0f km, %d fixes: %u evaluations, cached declination within %.3f deg\n",
+           length / 1000.0, fixes + 1, (unsigned int)model.getEvaluations(), largest);
+    return (worst < BENCH_WMM2025_TOLERANCE && worst2020 < BENCH_WMM2020_TOLERANCE && clamped && largest < 0.1f) ? 0 : 1;
+}
+
+/****************************************************************************
+ ****************************************************************************/
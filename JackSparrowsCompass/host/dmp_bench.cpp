@@ -0,0 +1,420 @@
+/**
+ * @file dmp_bench.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host benchmark of the DMP mode: Dmp and DmpYawFusion against a register-level stand-in of the MPU9250
+ *
+ * SimulatedMpu answers the registers Dmp uses as the chip does: BANK_SEL / MEM_START_ADDR / MEM_R_W on a 4 kB
+ * DMP memory with auto increment, the program start, USER_CTRL with the DMP and FIFO enable and reset bits,
+ * FIFO_COUNT and FIFO_R_W on a 512 byte FIFO that overwrites its oldest bytes when full. Once enabled with the
+ * 6-axis quaternion key written, the stand-in pushes a q30 quaternion packet every FIFO period: the true
+ * attitude of a rolling and yawing hull, with the yaw of the DMP starting at 0 and drifting (SIM_DMP_DRIFT).
+ * A magnetometer sample comes every 1 / mag_hz s, in the frame of the Mahony filter.
+ * The loop of the sketch (LOOP_MS) reads the FIFO and fuses the yaw as the quaternion compass library does in
+ * DMP mode, and the bench prints:
+ *      - the load: bytes, bus transfers, refusal without an image
+ *      - the heading error against the truth after SETTLE_S, rms and max, and the yaw offset
+ *      - quaternions read, FIFO resets, bus bytes per second, and the MCU time per fused quaternion
+ * -g adds a stray byte to the FIFO at 20 s and stalls the loop for 3 s at 30 s: both must end in a FIFO reset
+ * and the heading must come back.
+ *
+ * Usage:
+ *      dmp_bench [-r fifo_hz] [-m mag_hz] [-g]
+ *
+ * Build (host):
+ *      g++ -std=c++11 -O2 -I../../libraries/CompassCore dmp_bench.cpp ../../libraries/CompassCore/Dmp.cpp \
+ *          ../../libraries/CompassCore/DmpYawFusion.cpp -o dmp_bench
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <deque>
+#include <chrono>
+#include <random>
+#include <Dmp.h>
+#include <DmpYawFusion.h>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const uint16_t IMAGE_SIZE       = 3062;     // bytes, as the MotionDriver image
+const unsigned long LOOP_MS     = 10;       // loop period of the sketch
+const float RUN_S               = 60.0f;
+const float SETTLE_S            = 5.0f;     // error counted after this
+const float SIM_DMP_DRIFT       = 0.05f;    // deg/s, yaw drift of the 6-axis quaternion
+const float SIM_YAW_AMPLITUDE   = 30.0f;    // deg
+const float SIM_YAW_PERIOD      = 8.0f;     // s
+const float SIM_ROLL_AMPLITUDE  = 10.0f;    // deg
+const float SIM_PITCH_AMPLITUDE = 5.0f;     // deg
+const float SIM_HEADING         = 40.0f;    // deg, mean heading
+const float SIM_FIELD[3]        = {230.0f, 0.0f, -400.0f};  // mG, world frame of the filter, north along +x
+const float SIM_MAG_NOISE       = 2.0f;     // mG, sigma
+const float DEG                 = 0.017453292519943f;
+
+// ----- Registers of the stand-in
+const uint8_t REG_SMPLRT_DIV    = 0x19;
+const uint8_t REG_USER_CTRL     = 0x6A;
+const uint8_t REG_BANK_SEL      = 0x6D;
+const uint8_t REG_MEM_START     = 0x6E;
+const uint8_t REG_MEM_R_W       = 0x6F;
+const uint8_t REG_PRGM_START_H  = 0x70;
+const uint8_t REG_PRGM_START_L  = 0x71;
+const uint8_t REG_FIFO_COUNTH   = 0x72;
+const uint8_t REG_FIFO_COUNTL   = 0x73;
+const uint8_t REG_FIFO_R_W      = 0x74;
+const uint16_t KEY_D_0_22       = 22 + 512;
+const uint16_t KEY_CFG_8        = 2718;
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+/**
+ * @name multiply
+ * @brief multiply: r = a * b, quaternions w, x, y, z
+ */
+static void multiply(const float a[4], const float b[4], float r[4])
+{
+    const float w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    const float x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    const float y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    const float z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+    r[0] = w; r[1] = x; r[2] = y; r[3] = z;
+}
+
+/**
+ * @name axisAngle
+ * @brief axisAngle: rotation of angle deg about axis 0 (x), 1 (y) or 2 (z)
+ */
+static void axisAngle(int axis, float angle, float q[4])
+{
+    q[0] = cosf(0.5f * angle * DEG);
+    q[1] = q[2] = q[3] = 0.0f;
+    q[1 + axis] = sinf(0.5f * angle * DEG);
+}
+
+/**
+ * @name yaw
+ * @brief yaw: deg, direction of the body x axis in the world, from +x towards +y
+ */
+static float yaw(const float q[4])
+{
+    const float r00 = 1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3]);
+    const float r10 = 2.0f * (q[1] * q[2] + q[0] * q[3]);
+    return atan2f(r10, r00) / DEG;
+}
+
+/**
+ * @name angleDifference
+ * @brief angleDifference: signed difference a - b, wrapped to +-180 deg
+ */
+static float angleDifference(float a, float b)
+{
+    float d = fmodf(a - b + 540.0f, 360.0f);
+    if (d < 0.0f) d += 360.0f;
+    return d - 180.0f;
+}
+
+/**
+ * @name mirror
+ * @brief mirror: chip frame to the frame of the Mahony filter (y of accelerometer and gyro flipped), and back
+ */
+static void mirror(const float q[4], float r[4])
+{
+    r[0] = q[0];
+    r[1] = -q[1];
+    r[2] = q[2];
+    r[3] = -q[3];
+}
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/**
+ * Register-level stand-in of the MPU9250 for Dmp
+ */
+class SimulatedMpu : public ImuBus
+{
+public:
+    SimulatedMpu() : userCtrl(0), bank(0), memStart(0), programStart(0), sampleDivider(0), samples(0), transfers(0), bytes(0)
+    {
+        memset(memory, 0, sizeof(memory));
+        q[0] = 1.0f;
+        q[1] = q[2] = q[3] = 0.0f;
+    }
+
+    bool writeRegisters(uint8_t reg, const uint8_t *data, uint8_t count)
+    {
+        transfers++;
+        bytes += count + 1;
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            // MEM_R_W and FIFO_R_W are not auto incremented: the DMP memory pointer is
+            const uint8_t target = (reg == REG_MEM_R_W) ? reg : (uint8_t)(reg + i);
+            write(target, data[i]);
+        }
+        return true;
+    }
+
+    bool readRegisters(uint8_t reg, uint8_t *data, uint8_t count)
+    {
+        transfers++;
+        bytes += count + 1;
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            const uint8_t target = (reg == REG_MEM_R_W || reg == REG_FIFO_R_W) ? reg : (uint8_t)(reg + i);
+            data[i] = read(target);
+        }
+        return true;
+    }
+
+    void wait(uint16_t ms)
+    {
+        (void)ms;
+    }
+
+    /* One sample of the chip, 1 kHz / (1 + SMPLRT_DIV): a packet into the FIFO every FIFO period */
+    void sample(const float attitude[4])
+    {
+        if (!(userCtrl & 0x80) || !(userCtrl & 0x40) || programStart != DMP_START_ADDRESS)
+        {
+            return;
+        }
+        if (memory[KEY_CFG_8] != 0x20)
+        {
+            return;
+        }
+        const uint16_t divider = ((uint16_t)memory[KEY_D_0_22] << 8) | memory[KEY_D_0_22 + 1];
+        if (samples++ % (divider + 1) != 0)
+        {
+            return;
+        }
+        float chip[4];
+        mirror(attitude, chip);
+        for (int i = 0; i < 4; ++i)
+        {
+            const int32_t raw = (int32_t)lrintf(chip[i] * 1073741824.0f * 0.999999f);
+            push((uint8_t)(raw >> 24));
+            push((uint8_t)(raw >> 16));
+            push((uint8_t)(raw >> 8));
+            push((uint8_t)raw);
+        }
+    }
+
+    /* Byte out of step in the FIFO */
+    void push(uint8_t value)
+    {
+        if (fifo.size() >= DMP_FIFO_SIZE) fifo.pop_front();
+        fifo.push_back(value);
+    }
+
+    /* Sample rate of the chip, Hz */
+    float sampleRate() const { return 1000.0f / (1 + sampleDivider); }
+
+    uint8_t memory[4096];
+    uint8_t userCtrl;
+    uint8_t bank, memStart;
+    uint16_t programStart;
+    uint8_t sampleDivider;
+    unsigned long samples;
+    unsigned long transfers;
+    unsigned long bytes;
+    std::deque<uint8_t> fifo;
+    float q[4];
+
+private:
+    void write(uint8_t reg, uint8_t value)
+    {
+        switch (reg)
+        {
+        case REG_SMPLRT_DIV: sampleDivider = value; break;
+        case REG_BANK_SEL: bank = value & 0x0F; break;
+        case REG_MEM_START: memStart = value; break;
+        case REG_MEM_R_W: memory[bank * 256 + memStart++] = value; break;
+        case REG_PRGM_START_H: programStart = (programStart & 0x00FF) | ((uint16_t)value << 8); break;
+        case REG_PRGM_START_L: programStart = (programStart & 0xFF00) | value; break;
+        case REG_USER_CTRL:
+            if (value & 0x04) fifo.clear();
+            if (value & 0x08) samples = 0;
+            userCtrl = value & 0xF3;        // reset bits clear themselves
+            break;
+        default: break;
+        }
+    }
+
+    uint8_t read(uint8_t reg)
+    {
+        switch (reg)
+        {
+        case REG_MEM_R_W: return memory[bank * 256 + memStart++];
+        case REG_FIFO_COUNTH: return (uint8_t)(fifo.size() >> 8);
+        case REG_FIFO_COUNTL: return (uint8_t)(fifo.size() & 0xFF);
+        case REG_FIFO_R_W:
+        {
+            if (fifo.empty()) return 0;
+            const uint8_t value = fifo.front();
+            fifo.pop_front();
+            return value;
+        }
+        default: return 0;
+        }
+    }
+};
+
+/**
+ * @name truth
+ * @brief truth: attitude of the hull at t, in the frame of the Mahony filter; heading in deg
+ */
+static void truth(float t, float attitude[4], float &heading)
+{
+    heading = SIM_HEADING + SIM_YAW_AMPLITUDE * sinf(2.0f * (float)M_PI * t / SIM_YAW_PERIOD);
+    const float roll = SIM_ROLL_AMPLITUDE * sinf(2.0f * (float)M_PI * t / 5.0f);
+    const float pitch = SIM_PITCH_AMPLITUDE * sinf(2.0f * (float)M_PI * t / 7.0f);
+    float qz[4], qy[4], qx[4], t1[4];
+    axisAngle(2, heading, qz);
+    axisAngle(1, pitch, qy);
+    axisAngle(0, roll, qx);
+    multiply(qz, qy, t1);
+    multiply(t1, qx, attitude);
+}
+
+/**
+ * @name main
+ * @brief main: load, start, run the hull, print errors and costs
+ */
+int main(int argc, char **argv)
+{
+    uint16_t fifoRate = 100;
+    float magRate = 8.0f;
+    bool glitches = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) fifoRate = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc) magRate = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "-g")) glitches = true;
+        else
+        {
+            fprintf(stderr, "usage: dmp_bench [-r fifo_hz] [-m mag_hz] [-g]\n");
+            return 2;
+        }
+    }
+
+    SimulatedMpu mpu;
+    Dmp dmp;
+
+    // ----- Load
+    printf("load without image: %s\n", dmp.load(mpu, NULL, 0) ? "accepted (wrong)" : "refused");
+    std::mt19937 rng(1);
+    uint8_t image[IMAGE_SIZE];
+    for (uint16_t k = 0; k < IMAGE_SIZE; ++k) image[k] = (uint8_t)rng();
+    const unsigned long transfers0 = mpu.transfers;
+    const bool loaded = dmp.load(mpu, image, IMAGE_SIZE);
+    const bool same = memcmp(mpu.memory, image, IMAGE_SIZE) == 0;
+    printf("load %u bytes: %s, memory %s, %lu bus transfers, program start 0x%04X\n", IMAGE_SIZE,
+           loaded ? "ok" : "FAIL", same ? "matches" : "DIFFERS", mpu.transfers - transfers0, mpu.programStart);
+    if (!loaded || !dmp.start(mpu, fifoRate))
+    {
+        printf("start FAIL\n");
+        return 1;
+    }
+    printf("started: FIFO %u Hz, chip %.0f Hz, magnetometer %.0f Hz\n", fifoRate, mpu.sampleRate(), magRate);
+
+    // ----- Run
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    DmpYawFusion fusion;
+    const float samplePeriod = 1.0f / mpu.sampleRate();
+    float simTime = 0.0f, nextMag = 0.0f, lastMagTime = 0.0f;
+    bool magPending = false;
+    float magSample[3] = {0.0f, 0.0f, 0.0f};
+    double sum2 = 0.0, maxError = 0.0, fuseNs = 0.0;
+    unsigned long counted = 0, quaternions = 0, fused = 0;
+    const unsigned long bytes0 = mpu.bytes;
+    bool glitched = false;
+
+    for (unsigned long ms = 0; ms < (unsigned long)(RUN_S * 1000.0f); ms += LOOP_MS)
+    {
+        const float now = ms * 1e-3f;
+
+        // ----- Chip and magnetometer up to now
+        float attitude[4], heading;
+        for (; simTime < now; simTime += samplePeriod)
+        {
+            truth(simTime, attitude, heading);
+            float drift[4], dmpAttitude[4];
+            axisAngle(2, -SIM_HEADING + SIM_DMP_DRIFT * simTime, drift);
+            multiply(drift, attitude, dmpAttitude);
+            mpu.sample(dmpAttitude);
+            if (simTime >= nextMag)
+            {
+                // world to body: R(q) transposed
+                const float w = attitude[0], x = attitude[1], y = attitude[2], z = attitude[3];
+                const float R[3][3] =
+                {
+                    {1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y)},
+                    {2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x)},
+                    {2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y)}
+                };
+                for (int i = 0; i < 3; ++i)
+                {
+                    magSample[i] = R[0][i] * SIM_FIELD[0] + R[1][i] * SIM_FIELD[1] + R[2][i] * SIM_FIELD[2] + SIM_MAG_NOISE * gauss(rng);
+                }
+                magPending = true;
+                nextMag += 1.0f / magRate;
+            }
+        }
+        if (glitches && !glitched && now >= 20.0f)
+        {
+            mpu.push(0x5A);
+            glitched = true;
+        }
+        if (glitches && now >= 30.0f && now < 33.0f)
+        {
+            continue;       // loop stalled, the FIFO fills
+        }
+
+        // ----- Loop of the sketch in DMP mode
+        float q[4], q6[4];
+        if (dmp.read(mpu, q) != 1)
+        {
+            continue;
+        }
+        quaternions++;
+        mirror(q, q6);
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        fusion.update(q6, magPending ? magSample : NULL, now - lastMagTime);
+        fuseNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        fused++;
+        if (magPending)
+        {
+            lastMagTime = now;
+            magPending = false;
+        }
+
+        // ----- Error against the attitude of the newest packet
+        float fusedQ[4];
+        fusion.getQuaternion(fusedQ);
+        truth(simTime - samplePeriod, attitude, heading);
+        const float error = fabsf(angleDifference(yaw(fusedQ), heading));
+        if (now >= SETTLE_S && !(glitches && now >= 30.0f && now < 35.0f))
+        {
+            sum2 += (double)error * error;
+            if (error > maxError) maxError = error;
+            counted++;
+        }
+    }
+
+    printf("heading error after %.0f s: rms %.3f deg, max %.3f deg over %lu quaternions\n", SETTLE_S,
+           counted ? sqrt(sum2 / counted) : 0.0, maxError, counted);
+    printf("yaw offset %.2f deg (DMP drift %.2f deg over the run)\n", fusion.getOffset(), SIM_DMP_DRIFT * RUN_S);
+    printf("quaternions read %lu, FIFO resets %lu, bus %.0f bytes/s, fusion %.0f ns per quaternion\n", quaternions,
+           (unsigned long)dmp.getResets(), (mpu.bytes - bytes0) / RUN_S, fused ? fuseNs / fused : 0.0);
+    return (glitches && dmp.getResets() < 2) ? 1 : 0;
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,270 @@
+/**
+ * @file heading_bench.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host benchmark of the tilt compensated heading: Euler formula against cross products
+ *
+ * Replays LSM303 readings through headingFromEuler and headingFromVectors (HeadingMath, the two
+ * methods of CompassManager) and prints time per sample, cycles per sample on x86, and how far
+ * the two headings are apart.
+ * Without a capture the readings are synthesized from random attitudes in the Torgiano field
+ * (inclination 59.5 deg) with LSM303DLHC gains and noise; then the error against the true heading
+ * is printed too, split between moderate tilt and pitch near +-90 deg.
+ *
+ * Usage:
+ *      heading_bench [capture.csv]
+ *
+ * Capture: one reading per line, "ax,ay,az,mx,my,mz", calibrated LSM303 values (any unit)
+ *
+ * Build (host):
+ *      g++ -std=c++11 -O2 -I../../libraries/CompassCore heading_bench.cpp \
+ *          ../../libraries/CompassCore/HeadingMath.cpp -o heading_bench
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <HeadingMath.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#endif
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const int   SYNTHETIC_SAMPLES   = 20000;
+const int   BENCH_ROUNDS        = 200;
+const float FIELD_INCLINATION   = 59.5f;    // deg, Torgiano
+const float ACC_LSB_PER_G       = 1000.0f;  // LSM303DLHC +-2 g, 12 bit
+const float MAG_LSB_PER_GAUSS   = 1100.0f;  // LSM303DLHC +-1.3 gauss, xy
+const float FIELD_GAUSS         = 0.47f;
+const float ACC_NOISE_LSB       = 4.0f;
+const float MAG_NOISE_LSB       = 2.0f;
+const float STEEP_PITCH         = 85.0f;    // deg, readings steeper than this are reported apart
+const float DEG                 = 0.017453292519943f;
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+struct Reading
+{
+    float acc[3];
+    float mag[3];
+    float trueHeading;                      // deg, NaN for replayed readings
+    float pitch;                            // deg
+};
+
+typedef float (*heading_fn_t)(const float acc[3], const float mag[3]);
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+/**
+ * @name angleDifference
+ * @brief angleDifference: absolute difference of two headings, wrapped to 0-180 deg
+ */
+static float angleDifference(float a, float b)
+{
+    float d = fmodf(fabsf(a - b), 360.0f);
+    return d > 180.0f ? 360.0f - d : d;
+}
+
+/**
+ * @name normalize
+ * @brief normalize: scale a vector to unit length, as CompassManager does before the filter
+ */
+static void normalize(float v[3])
+{
+    const float n = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    for (int i = 0; i < 3; ++i) v[i] /= n;
+}
+
+/**
+ * @name synthesize
+ * @brief synthesize: random attitudes, world frame north-west-up, sensor x forward, y left, z up
+ */
+static void synthesize(std::vector<Reading> &readings)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+
+    const float fieldWorld[3] =
+    {
+        FIELD_GAUSS * cosf(FIELD_INCLINATION * DEG),
+        0.0f,
+        -FIELD_GAUSS * sinf(FIELD_INCLINATION * DEG)
+    };
+
+    for (int k = 0; k < SYNTHETIC_SAMPLES; ++k)
+    {
+        Reading r;
+        const float heading = 360.0f * uniform(rng);
+        // one reading out of ten close to vertical, the others within +-60 deg
+        const float pitch = (k % 10 == 0) ? (uniform(rng) < 0.5f ? -1.0f : 1.0f) * (86.0f + 3.9f * uniform(rng))
+                                          : 120.0f * uniform(rng) - 60.0f;
+        const float roll = 120.0f * uniform(rng) - 60.0f;
+
+        // body to world: yaw (clockwise heading, i.e. -heading about up), pitch (nose up about y left), roll about x
+        const float cy = cosf(-heading * DEG), sy = sinf(-heading * DEG);
+        const float cp = cosf(-pitch * DEG), sp = sinf(-pitch * DEG);
+        const float cr = cosf(roll * DEG), sr = sinf(roll * DEG);
+        const float R[3][3] =
+        {
+            {cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr},
+            {sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr},
+            {-sp,     cp * sr,                cp * cr}
+        };
+
+        // world to body is R transposed; gravity reaction is up
+        for (int i = 0; i < 3; ++i)
+        {
+            r.acc[i] = R[2][i] * ACC_LSB_PER_G + ACC_NOISE_LSB * gauss(rng);
+            r.mag[i] = (R[0][i] * fieldWorld[0] + R[1][i] * fieldWorld[1] + R[2][i] * fieldWorld[2]) * MAG_LSB_PER_GAUSS
+                       + MAG_NOISE_LSB * gauss(rng);
+        }
+        r.trueHeading = heading;
+        r.pitch = pitch;
+        readings.push_back(r);
+    }
+}
+
+/**
+ * @name replay
+ * @brief replay: load "ax,ay,az,mx,my,mz" lines
+ */
+static bool replay(const char *path, std::vector<Reading> &readings)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        Reading r;
+        if (sscanf(line, "%f,%f,%f,%f,%f,%f", &r.acc[0], &r.acc[1], &r.acc[2],
+                   &r.mag[0], &r.mag[1], &r.mag[2]) != 6) continue;
+        r.trueHeading = NAN;
+        r.pitch = asinf(r.acc[0] / sqrtf(r.acc[0] * r.acc[0] + r.acc[1] * r.acc[1] + r.acc[2] * r.acc[2])) / DEG;
+        readings.push_back(r);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * @name bench
+ * @brief bench: time one heading function over every reading, BENCH_ROUNDS times
+ */
+static void bench(const char *name, heading_fn_t fn, const std::vector<Reading> &readings)
+{
+    volatile float sink = 0.0f;
+    const double calls = (double)readings.size() * BENCH_ROUNDS;
+
+#ifdef BENCH_HAS_TSC
+    const unsigned long long tsc0 = __rdtsc();
+#endif
+    const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        float acc = 0.0f;
+        for (size_t k = 0; k < readings.size(); ++k) acc += fn(readings[k].acc, readings[k].mag);
+        sink = sink + acc;
+    }
+    const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+
+#ifdef BENCH_HAS_TSC
+    const double cycles = (double)(__rdtsc() - tsc0) / calls;
+    printf("%-8s %8.1f ns/sample %8.1f TSC cycles/sample\n", name, ns, cycles);
+#else
+    printf("%-8s %8.1f ns/sample\n", name, ns);
+#endif
+    (void)sink;
+}
+
+/**
+ * @name main
+ * @brief main: replay or synthesize, check agreement, time both methods
+ */
+int main(int argc, char **argv)
+{
+    std::vector<Reading> readings;
+    if (argc > 1)
+    {
+        if (!replay(argv[1], readings) || readings.empty())
+        {
+            fprintf(stderr, "cannot read %s\n", argv[1]);
+            return 1;
+        }
+        printf("%u readings from %s\n", (unsigned int)readings.size(), argv[1]);
+    }
+    else
+    {
+        synthesize(readings);
+        printf("%u synthetic readings, inclination %.1f deg\n", (unsigned int)readings.size(), FIELD_INCLINATION);
+    }
+
+    // CompassManager feeds both methods with normalized vectors
+    for (size_t k = 0; k < readings.size(); ++k)
+    {
+        normalize(readings[k].acc);
+        normalize(readings[k].mag);
+    }
+
+    // ----- Agreement and accuracy
+    double sumDiff = 0.0, maxDiff = 0.0;
+    unsigned int compared = 0, eulerNan = 0, vectorNan = 0;
+    double errEuler[2] = {0.0, 0.0}, errVector[2] = {0.0, 0.0};
+    unsigned int counted[2] = {0, 0};
+    for (size_t k = 0; k < readings.size(); ++k)
+    {
+        const Reading &r = readings[k];
+        const float e = headingFromEuler(r.acc, r.mag);
+        const float v = headingFromVectors(r.acc, r.mag);
+        if (isnan(e)) eulerNan++;
+        if (isnan(v)) vectorNan++;
+
+        const int steep = fabsf(r.pitch) > STEEP_PITCH ? 1 : 0;
+        if (!steep && !isnan(e) && !isnan(v))
+        {
+            const double d = angleDifference(e, v);
+            sumDiff += d;
+            if (d > maxDiff) maxDiff = d;
+            compared++;
+        }
+        if (!isnan(r.trueHeading))
+        {
+            errEuler[steep] += isnan(e) ? 180.0 : angleDifference(e, r.trueHeading);
+            errVector[steep] += angleDifference(v, r.trueHeading);
+            counted[steep]++;
+        }
+    }
+
+    printf("pitch within +-%.0f deg: Euler vs vector mean %.4f deg, max %.4f deg over %u readings\n",
+           STEEP_PITCH, compared ? sumDiff / compared : 0.0, maxDiff, compared);
+    printf("undefined headings: Euler %u, vector %u\n", eulerNan, vectorNan);
+    for (int steep = 0; steep < 2; ++steep)
+    {
+        if (counted[steep] == 0) continue;
+        printf("mean error vs truth, %s: Euler %.3f deg, vector %.3f deg (%u readings, NaN counted as 180)\n",
+               steep ? "steep pitch" : "moderate tilt", errEuler[steep] / counted[steep],
+               errVector[steep] / counted[steep], counted[steep]);
+    }
+
+    // ----- Timing
+    bench("Euler", headingFromEuler, readings);
+    bench("vector", headingFromVectors, readings);
+    return 0;
+}
+
+/****************************************************************************
+ ****************************************************************************/
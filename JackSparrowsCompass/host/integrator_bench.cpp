@@ -0,0 +1,164 @@
+/**
+ * @file integrator_bench.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host benchmark of the quaternion integrator: heading lost on the gyro against the fusion rate
+ *
+ * The hull rolls SIM_ROLL over SIM_ROLL_PERIOD and pitches SIM_PITCH over SIM_PITCH_PERIOD, a quarter of a
+ * period apart, as on a quartering sea, while it turns at SIM_TURN with a yaw of SIM_YAW over SIM_YAW_PERIOD.
+ * The attitude is known in closed form, the gyro reads its body rate with no noise and no bias: all the error
+ * is of the integration. Every method of QuaternionIntegrator integrates the gyro alone, sampled at each rate
+ * of SIM_RATES, over a MAG_COAST_LIMIT coast, the longest the filter goes with no magnetometer; the heading
+ * is compared with the truth every sample.
+ * Prints for every method and rate the largest and the final heading error, and the time of an integrate()
+ * call on the host. Fails unless CONING at 50 Hz is at least as good as EULER at 200 Hz.
+ *
+ * Usage:
+ *      integrator_bench [seconds]
+ *
+ * Build (host):
+ *      g++ -std=c++11 -O2 -I../../libraries/CompassCore integrator_bench.cpp \
+ *          ../../libraries/CompassCore/QuaternionIntegrator.cpp -o integrator_bench
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <QuaternionIntegrator.h>
+#include <MagDisturbanceDetector.h>     // MAG_COAST_LIMIT
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const double SIM_ROLL           = 20.0;     // deg
+const double SIM_ROLL_PERIOD    = 5.0;      // s
+const double SIM_PITCH          = 8.0;      // deg
+const double SIM_PITCH_PERIOD   = 5.0;      // s
+const double SIM_YAW            = 10.0;     // deg
+const double SIM_YAW_PERIOD     = 10.0;     // s
+const double SIM_TURN           = 6.0;      // deg/s
+const int SIM_RATES[]           = {25, 50, 100, 200};   // Hz
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+static void multiply(const double a[4], const double b[4], double out[4])
+{
+    out[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    out[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    out[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    out[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+}
+
+// body to world, yaw about z, then pitch about y, then roll about x
+static void truth(double t, double q[4])
+{
+    const double d = M_PI / 180.0;
+    const double roll = SIM_ROLL * d * sin(2.0 * M_PI * t / SIM_ROLL_PERIOD);
+    const double pitch = SIM_PITCH * d * cos(2.0 * M_PI * t / SIM_PITCH_PERIOD);
+    const double yaw = SIM_TURN * d * t + SIM_YAW * d * sin(2.0 * M_PI * t / SIM_YAW_PERIOD);
+    const double qz[4] = {cos(0.5 * yaw), 0.0, 0.0, sin(0.5 * yaw)};
+    const double qy[4] = {cos(0.5 * pitch), 0.0, sin(0.5 * pitch), 0.0};
+    const double qx[4] = {cos(0.5 * roll), sin(0.5 * roll), 0.0, 0.0};
+    double qzy[4];
+    multiply(qz, qy, qzy);
+    multiply(qzy, qx, q);
+}
+
+// body rate of the truth, w = 2 * conj(q) * dq/dt
+static void bodyRate(double t, float rate[3])
+{
+    const double h = 1e-5;
+    double q[4], before[4], after[4], dq[4], w[4];
+    truth(t, q);
+    truth(t - h, before);
+    truth(t + h, after);
+    for (int i = 0; i < 4; ++i) dq[i] = (after[i] - before[i]) / (2.0 * h);
+    const double conj[4] = {q[0], -q[1], -q[2], -q[3]};
+    multiply(conj, dq, w);
+    for (int i = 0; i < 3; ++i) rate[i] = (float)(2.0 * w[i + 1]);
+}
+
+static double yawOf(double w, double x, double y, double z)
+{
+    return atan2(2.0 * (w * z + x * y), 1.0 - 2.0 * (y * y + z * z)) * 180.0 / M_PI;
+}
+
+static double wrap180(double angle)
+{
+    while (angle > 180.0) angle -= 360.0;
+    while (angle < -180.0) angle += 360.0;
+    return angle;
+}
+
+static const char *methodName(quaternion_integrator_t method)
+{
+    switch (method)
+    {
+    case quaternion_integrator_t::EULER:        return "EULER";
+    case quaternion_integrator_t::EXPONENTIAL:  return "EXPONENTIAL";
+    default:                                    return "CONING";
+    }
+}
+
+/*******************
+ * MAIN
+*******************/
+int main(int argc, char **argv)
+{
+    const double seconds = (argc > 1) ? atof(argv[1]) : MAG_COAST_LIMIT;
+    const quaternion_integrator_t methods[] =
+    {
+        quaternion_integrator_t::EULER, quaternion_integrator_t::EXPONENTIAL, quaternion_integrator_t::CONING
+    };
+    const int rateCount = sizeof(SIM_RATES) / sizeof(SIM_RATES[0]);
+    double worst[3][rateCount];
+
+    printf("%.0f s on the gyro alone, roll %.0f deg, pitch %.0f deg, turn %.0f deg/s\n",
+           seconds, SIM_ROLL, SIM_PITCH, SIM_TURN);
+    for (int m = 0; m < 3; ++m)
+    {
+        for (int r = 0; r < rateCount; ++r)
+        {
+            const double dt = 1.0 / SIM_RATES[r];
+            const long samples = (long)(seconds * SIM_RATES[r] + 0.5);
+            QuaternionIntegrator integrator(methods[m]);
+            double start[4];
+            truth(0.0, start);
+            float q[4] = {(float)start[0], (float)start[1], (float)start[2], (float)start[3]};
+
+            // the integrator sees the previous sample first, as the filter does after its first read
+            float rate[3];
+            bodyRate(0.0, rate);
+            integrator.integrate(q, rate, 0.0f);
+
+            double largest = 0.0, error = 0.0, spent = 0.0;
+            for (long i = 1; i <= samples; ++i)
+            {
+                bodyRate(i * dt, rate);
+                const auto before = std::chrono::steady_clock::now();
+                integrator.integrate(q, rate, (float)dt);
+                spent += std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count();
+
+                double t[4];
+                truth(i * dt, t);
+                error = wrap180(yawOf(q[0], q[1], q[2], q[3]) - yawOf(t[0], t[1], t[2], t[3]));
+                if (fabs(error) > largest) largest = fabs(error);
+            }
+            worst[m][r] = largest;
+            printf("%-11s %3d Hz: heading error %7.3f deg max, %7.3f deg at the end, %5.1f ns a sample\n",
+                   methodName(methods[m]), SIM_RATES[r], largest, error, 1e9 * spent / samples);
+        }
+    }
+
+    // CONING at 50 Hz against EULER at 200 Hz
+    return (worst[2][1] <= worst[0][3]) ? 0 : 1;
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,668 @@
+/**
+ * @file servo_bench.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host benchmark of the needle pointing: ServoManager on a simulated feedback servo
+ *
+ * ServoManager is built as on the board, with FeedbackServo and Arduino replaced by the host
+ * shims (host/shims): a simulated Parallax 360 with inertia, friction, dead band and a quantized
+ * feedback encoder, driven by the same PID gains. A script of servo headings is played with the
+ * loop of the sketch (setServoPosition on a change, delay 10 ms) and ServoManager::step on a Ticker
+ * at SERVO_SETPOINT_PERIOD_MS, in three modes:
+ *      - step: the old behaviour, the final angle handed to the PID at once
+ *      - trapezoidal and S-curve: the motion profile of ServoManager
+ * For each move it prints settle time (needle within SETTLE_BAND and staying there), overshoot past
+ * the target, travel against the shortest rotation, and peak PID pulse (proxy of the peak current).
+ * With -a the gains are found first by ServoAutotune on the simulated servo, as /autotune does on the
+ * unit. With -c, the exit code is 1 if a profiled move does not settle within the given time, so it
+ * can gate a change of gains or limits in CI.
+ * The load of the loop: -b adds work to every iteration that yields (waiting on the network or the GPS),
+ * -B work that does not (the ticks wait for it, as on the board); -L calls step() from the loop, at most
+ * every SERVO_SETPOINT_PERIOD_MS, as the servo was driven before the Ticker. The timing of the ticks is
+ * printed for each mode.
+ * The winding of the needle is printed too: the largest one during the script, the winding left after the
+ * idle unwind, and the error of the winding tracked by ServoManager against the simulated needle then.
+ * -W plays a script that keeps turning the same way, -w sets the wrap limit.
+ * -Y yaws the hull instead (YAW_AMPLITUDE, YAW_PERIOD) with the target bearing still: the heading goes
+ * through the HeadingSmoother and the 5 deg gate of the sketch, and the pointing error of the needle is
+ * printed without and with the gyro feed-forward.
+ * -M simulates the magnetometer next to the servo: a field turning with the needle (SIM_SERVO_FIELD) and one
+ * with the motor current (SIM_CURRENT_FIELD, per us of PID pulse). ServoMagSweep learns the first with the
+ * hull still, then the hull yaws as with -Y, the heading coming from the simulated magnetometer as in the
+ * sketch, and heading and pointing errors are printed with no correction, with the learned model, and with
+ * the model and the magnetometer weight of ServoManager.
+ *
+ * Usage:
+ *      servo_bench [-g kp,ki,kd | -a] [-f script.csv | -W | -Y | -M] [-w wrap_deg] [-c max_settle_ms] [-b ms] [-B ms] [-L]
+ *
+ * Script: one move per line, "ms,heading", time from the start and servo heading deg
+ *
+ * Build (host):
+ *      g++ -std=c++11 -O2 -Ishims -I.. -I../../libraries/CompassCore servo_bench.cpp shims/host_shims.cpp \
+ *          ../ServoManager.cpp ../ServoAutotune.cpp ../ServoMagSweep.cpp ../../libraries/CompassCore/MotionProfile.cpp \
+ *          ../../libraries/CompassCore/HeadingSmoother.cpp ../../libraries/CompassCore/ServoMagModel.cpp -o servo_bench
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "ServoManager.h"
+#include "ServoAutotune.h"
+#include "ServoMagSweep.h"
+#include "Ticker.h"
+#include <HeadingSmoother.h>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const int   SERVO_OFFSET    = 270;      // deg, as the sketch
+const float SETTLE_BAND     = 2.0f;     // deg
+const unsigned long LOOP_MS = 10;       // loop period of the sketch
+const unsigned long TAIL_MS = 2000;     // time after the last move
+const float YAW_AMPLITUDE   = 30.0f;    // deg, -Y
+const float YAW_PERIOD      = 8.0f;     // s, -Y: 24 deg/s at the peak
+const unsigned long YAW_MS  = 24000;    // -Y, three periods
+const float GATE            = 5.0f;     // deg, target change handed to the servo by the sketch
+const float SIM_HORIZONTAL_FIELD = 230.0f;  // mG, -M, earth field
+const float SIM_VERTICAL_FIELD   = 400.0f;  // mG
+const float SIM_SERVO_FIELD      = 40.0f;   // mG, magnet of the servo, turns with the needle
+const float SIM_CURRENT_FIELD    = 0.15f;   // mG per us of PID pulse, motor current
+const float SIM_MAG_NOISE        = 1.0f;    // mG, peak
+const float SIM_GYRO_BIAS        = 0.2f;    // deg/s
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+struct Move
+{
+    unsigned long ms;
+    float heading;
+};
+
+struct Mode
+{
+    const char *name;
+    float maxVelocity;
+    float maxAcceleration;
+    float maxJerk;
+    bool checked;               // subject to -c
+};
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+// quarter turn, retarget in the middle of a move, through zero both ways, small step, near half turn
+static const Move DEFAULT_SCRIPT[] =
+{
+    {500, 90.0f}, {2500, 45.0f}, {2650, 135.0f}, {4500, 350.0f}, {6500, 10.0f},
+    {8500, 340.0f}, {10500, 200.0f}, {12500, 206.0f}, {14500, 25.0f}
+};
+
+static const Mode MODES[] =
+{
+    {"step",        1.0e6f,             1.0e9f,                 0.0f,           false},
+    {"trapezoid",   SERVO_MAX_VELOCITY, SERVO_MAX_ACCELERATION, 0.0f,           true},
+    {"s-curve",     SERVO_MAX_VELOCITY, SERVO_MAX_ACCELERATION, SERVO_MAX_JERK, true}
+};
+
+static unsigned long maxSettleMs = 0;   // -c, 0 = no check
+static float wrapLimit = SERVO_WRAP_LIMIT;  // -w
+static unsigned long yieldingMs = 0;    // -b, work per loop that yields
+static unsigned long blockingMs = 0;    // -B, work per loop that does not yield
+static bool loopDriven = false;         // -L, step() from the loop
+static unsigned long lastStepMs = 0;
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+/**
+ * @name wrap180
+ * @brief wrap180: angle to -180, 180 deg
+ */
+static float wrap180(float angle)
+{
+    angle = fmodf(angle + 180.0f, 360.0f);
+    if (angle < 0.0f) angle += 360.0f;
+    return angle - 180.0f;
+}
+
+/**
+ * @name load
+ * @brief load: read "ms,heading" lines
+ */
+static bool load(const char *path, std::vector<Move> &script)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return false;
+
+    char line[128];
+    while (fgets(line, sizeof(line), file))
+    {
+        Move move;
+        if (sscanf(line, "%lu,%f", &move.ms, &move.heading) == 2) script.push_back(move);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * @name loopIteration
+ * @brief loopIteration: one iteration of the loop of the sketch besides setServoPosition
+ */
+static void loopIteration(ServoManager &sm)
+{
+    if (yieldingMs > 0) delay(yieldingMs);
+    if (blockingMs > 0) hostBusyMicros(blockingMs * 1000ul);
+    if (loopDriven && millis() - lastStepMs >= SERVO_SETPOINT_PERIOD_MS)
+    {
+        lastStepMs = millis();
+        sm.step();
+    }
+    sm.unwind();
+    delay(LOOP_MS);
+}
+
+/**
+ * @name run
+ * @brief run: play the script in one mode, print one line per move
+ * @retval bool every move passed the -c check
+ */
+static bool run(const Mode &mode, const std::vector<Move> &script)
+{
+    ServoManager sm(0, SERVO_OFFSET);
+    sm.setMotionLimits(mode.maxVelocity, mode.maxAcceleration, mode.maxJerk);
+    sm.setWrapLimit(wrapLimit);
+    FeedbackServo *servo = FeedbackServo::instance();
+    Ticker ticker;
+    if (!loopDriven) ticker.attach_ms(SERVO_SETPOINT_PERIOD_MS, [&sm]() { sm.step(); });
+
+    // let the needle settle on the start position
+    for (unsigned long t = 0; t < 1000; t += LOOP_MS)
+    {
+        loopIteration(sm);
+    }
+    sm.resetTickStats();
+    // the simulated needle starts on a whole turn of its own: winding of the needle = angle - neutral
+    const float neutral = servo->plant.angle - SERVO_OFFSET - sm.getWinding();
+    float maxWinding = 0.0f;
+
+    printf("\n%s\n", mode.name);
+    printf("  move               settle ms  overshoot deg  travel deg  shortest deg  peak pulse us\n");
+
+    bool passed = true;
+    unsigned int settled = 0;
+    float sumSettle = 0.0f, sumOvershoot = 0.0f, sumTravel = 0.0f, sumShortest = 0.0f, sumPeak = 0.0f;
+    float from = 0.0f;
+    const unsigned long start = millis();
+    for (size_t k = 0; k < script.size(); ++k)
+    {
+        const Move &move = script[k];
+        const unsigned long end = (k + 1 < script.size()) ? script[k + 1].ms : move.ms + TAIL_MS;
+        while (millis() - start < move.ms)
+        {
+            loopIteration(sm);
+        }
+
+        const float needle = servo->plant.angle - SERVO_OFFSET;
+        const float shortest = wrap180(move.heading - needle);
+        const float travel0 = servo->plant.travel;
+        servo->plant.peakPulse = 0.0f;
+
+        sm.setServoPosition(Bam16::fromDegrees(move.heading));
+
+        const unsigned long moveStart = millis();
+        unsigned long lastOutside = moveStart;
+        bool outside = true;
+        std::vector<float> track;
+        while (millis() - start < end)
+        {
+            loopIteration(sm);
+
+            const float error = wrap180(servo->plant.angle - SERVO_OFFSET - move.heading);
+            outside = fabsf(error) > SETTLE_BAND;
+            if (outside) lastOutside = millis();
+            track.push_back(servo->plant.angle - SERVO_OFFSET);
+
+            const float winding = servo->plant.angle - SERVO_OFFSET - neutral;
+            if (fabsf(winding) > maxWinding) maxWinding = fabsf(winding);
+        }
+
+        // a half turn can go either way: the target is the one on the side the needle went
+        const float last = track.back();
+        const float goal = last + wrap180(move.heading - last);
+        const float direction = goal >= needle ? 1.0f : -1.0f;
+        float overshoot = 0.0f;
+        for (size_t i = 0; i < track.size(); ++i)
+        {
+            if ((track[i] - goal) * direction > overshoot) overshoot = (track[i] - goal) * direction;
+        }
+
+        const float travel = servo->plant.travel - travel0;
+        char label[32];
+        snprintf(label, sizeof(label), "%.0f -> %.0f", from, move.heading);
+        // a move cut short by the next one (a retarget) is not checked
+        const bool checked = mode.checked && maxSettleMs > 0 && end - move.ms > maxSettleMs;
+        if (outside)
+        {
+            printf("  %-16s   %9s  %13.2f  %10.1f  %12.1f  %13.0f\n", label, end - move.ms > 1000 ? "never" : "cut",
+                   overshoot, travel, fabsf(shortest), servo->plant.peakPulse);
+            if (checked) passed = false;
+        }
+        else
+        {
+            printf("  %-16s   %9lu  %13.2f  %10.1f  %12.1f  %13.0f\n", label, lastOutside - moveStart, overshoot,
+                   travel, fabsf(shortest), servo->plant.peakPulse);
+            sumSettle += lastOutside - moveStart;
+            settled++;
+            if (checked && lastOutside - moveStart > maxSettleMs) passed = false;
+        }
+        sumOvershoot += overshoot;
+        sumTravel += travel;
+        sumShortest += fabsf(shortest);
+        sumPeak += servo->plant.peakPulse;
+        from = move.heading;
+    }
+
+    const float n = (float)script.size();
+    printf("  %-16s   %9.0f  %13.2f  %10.1f  %12.1f  %13.0f\n", "mean", settled ? sumSettle / settled : 0.0f,
+           sumOvershoot / n, sumTravel / n, sumShortest / n, sumPeak / n);
+    printf("  settled %u of %u moves (settle mean over the settled ones)\n", settled, (unsigned int)script.size());
+
+    // still needle: unwound after SERVO_UNWIND_IDLE_MS
+    const float windingLeft = servo->plant.angle - SERVO_OFFSET - neutral;
+    for (unsigned long t = 0; t < SERVO_UNWIND_IDLE_MS + 15000; t += LOOP_MS)
+    {
+        loopIteration(sm);
+    }
+    const float windingIdle = servo->plant.angle - SERVO_OFFSET - neutral;
+    printf("  winding: max %.0f deg, %.0f deg at the end, %.0f deg (%d turns) after the idle, tracked within %.2f deg\n",
+           maxWinding, windingLeft, windingIdle, sm.getTurns(), fabsf(windingIdle - sm.getWinding()));
+
+    const servo_tick_stats_t stats = sm.getTickStats();
+    printf("  ticks %lu, late %lu, max period %lu us, max step %lu us\n", stats.ticks, stats.late, stats.maxPeriodUs,
+           stats.maxStepUs);
+    return passed;
+}
+
+/**
+ * @name yaw
+ * @brief yaw: the hull yaws, the target bearing is still; pointing error of the needle
+ * @param [in] bool feedForward: gyro feed-forward on
+ */
+static void yaw(const Mode &mode, bool feedForward)
+{
+    ServoManager sm(0, SERVO_OFFSET);
+    sm.setMotionLimits(mode.maxVelocity, mode.maxAcceleration, mode.maxJerk);
+    FeedbackServo *servo = FeedbackServo::instance();
+    Ticker ticker;
+    if (!loopDriven) ticker.attach_ms(SERVO_SETPOINT_PERIOD_MS, [&sm]() { sm.step(); });
+    for (unsigned long t = 0; t < 1000; t += LOOP_MS)
+    {
+        loopIteration(sm);
+    }
+
+    HeadingSmoother smoother;
+    Bam16 previousTarget;
+    float sumSquares = 0.0f, maxError = 0.0f;
+    unsigned int samples = 0;
+    unsigned long lastSampleMs = millis();
+    const unsigned long start = millis();
+    while (millis() - start < YAW_MS)
+    {
+        // one heading sample per loop, as the compass of the sketch
+        const float t = (millis() - start) * 0.001f;
+        const float hull = YAW_AMPLITUDE * sinf(2.0f * (float)PI * t / YAW_PERIOD);
+        const float hullRate = YAW_AMPLITUDE * 2.0f * (float)PI / YAW_PERIOD * cosf(2.0f * (float)PI * t / YAW_PERIOD);
+        smoother.update(hull);
+        const unsigned long periodUs = (millis() - lastSampleMs) * 1000ul;
+        lastSampleMs = millis();
+
+        if (feedForward) sm.setFeedForward(-hullRate, (unsigned long)(smoother.getLag() * periodUs));
+
+        const Bam16 target = Bam16::fromDegrees(-smoother.getHeading());
+        if (fabsf((target - previousTarget).toSignedDegrees()) >= GATE)
+        {
+            sm.setServoPosition(target);
+            previousTarget = target;
+        }
+        loopIteration(sm);
+
+        // needle on the hull plus the hull: toward the bearing, 0
+        const float error = wrap180(servo->plant.angle - SERVO_OFFSET + hull);
+        if (millis() - start >= (unsigned long)(YAW_PERIOD * 1000.0f))
+        {
+            sumSquares += error * error;
+            if (fabsf(error) > maxError) maxError = fabsf(error);
+            samples++;
+        }
+    }
+    printf("  feed-forward %-3s  pointing error rms %5.2f deg, max %5.2f deg\n", feedForward ? "on" : "off",
+           sqrtf(sumSquares / (samples ? samples : 1)), maxError);
+}
+
+/**
+ * @name servoField
+ * @brief servoField: field of the servo magnet at a servo angle, as the sensor sees it
+ */
+static void servoField(float servoAngle, float field[3])
+{
+    const float a = servoAngle * (float)PI / 180.0f;
+    field[0] = SIM_SERVO_FIELD * cosf(a);
+    field[1] = SIM_SERVO_FIELD * sinf(a + 0.5f);
+    field[2] = 0.5f * SIM_SERVO_FIELD * cosf(a);
+}
+
+/**
+ * @name simulatedMag
+ * @brief simulatedMag: calibrated magnetometer sample, earth field of the hull heading plus the servo
+ */
+static void simulatedMag(float hull, const ServoPlant &plant, float mag[3])
+{
+    const float h = hull * (float)PI / 180.0f;
+    float field[3];
+    servoField(plant.angle, field);
+    mag[0] = SIM_HORIZONTAL_FIELD * cosf(h) + field[0] + SIM_CURRENT_FIELD * plant.pulse;
+    mag[1] = -SIM_HORIZONTAL_FIELD * sinf(h) + field[1] + 0.5f * SIM_CURRENT_FIELD * plant.pulse;
+    mag[2] = SIM_VERTICAL_FIELD + field[2];
+    for (int i = 0; i < 3; ++i) mag[i] += SIM_MAG_NOISE * (2.0f * rand() / RAND_MAX - 1.0f);
+}
+
+/**
+ * @name sweep
+ * @brief sweep: learn the servo field with ServoMagSweep, hull still; error of the table against the simulated field
+ * @retval bool model learned
+ */
+static bool sweep(ServoMagModel &model)
+{
+    ServoManager sm(0, SERVO_OFFSET);
+    FeedbackServo *servo = FeedbackServo::instance();
+    Ticker ticker;
+    ticker.attach_ms(SERVO_SETPOINT_PERIOD_MS, [&sm]() { sm.step(); });
+    delay(1000);
+
+    ServoMagSweep magSweep;
+    const unsigned long start = millis();
+    magSweep.start(sm);
+    float mag[3];
+    do
+    {
+        simulatedMag(0.0f, servo->plant, mag);
+        delay(LOOP_MS);
+    }
+    while (magSweep.update(sm, mag, SIM_GYRO_BIAS));
+
+    if (magSweep.getState() != mag_sweep_state_t::DONE)
+    {
+        printf("sweep: failed after %lu ms\n", millis() - start);
+        return false;
+    }
+    model = magSweep.getModel();
+
+    // the table keeps the part of the field that turns with the needle
+    float mean[3] = {0.0f, 0.0f, 0.0f}, field[3], bias[3];
+    for (int a = 0; a < 360; ++a)
+    {
+        servoField((float)a, field);
+        for (int i = 0; i < 3; ++i) mean[i] += field[i] / 360.0f;
+    }
+    float sumSquares = 0.0f, maxError = 0.0f;
+    for (int a = 0; a < 360; ++a)
+    {
+        servoField((float)a, field);
+        model.getBias((float)a, bias);
+        for (int i = 0; i < 3; ++i)
+        {
+            const float error = bias[i] - (field[i] - mean[i]);
+            sumSquares += error * error;
+            if (fabsf(error) > maxError) maxError = fabsf(error);
+        }
+    }
+    printf("sweep: %lu ms, largest bias %.1f mG, table error rms %.2f mG, max %.2f mG\n", millis() - start,
+           model.getMaxBias(), sqrtf(sumSquares / 1080.0f), maxError);
+    return true;
+}
+
+/**
+ * @name magYaw
+ * @brief magYaw: the hull yaws, the target bearing is still, the heading comes from the simulated magnetometer
+ * @param [in] const ServoMagModel model: servo model, NULL for none
+ * @param [in] bool weighted: magnetometer weight of ServoManager, the gyro carries the heading meanwhile
+ */
+static void magYaw(const Mode &mode, const ServoMagModel *model, bool weighted)
+{
+    ServoManager sm(0, SERVO_OFFSET);
+    sm.setMotionLimits(mode.maxVelocity, mode.maxAcceleration, mode.maxJerk);
+    FeedbackServo *servo = FeedbackServo::instance();
+    Ticker ticker;
+    ticker.attach_ms(SERVO_SETPOINT_PERIOD_MS, [&sm]() { sm.step(); });
+    for (unsigned long t = 0; t < 1000; t += LOOP_MS)
+    {
+        loopIteration(sm);
+    }
+
+    HeadingSmoother smoother;
+    Bam16 previousTarget;
+    float compassHeading = 0.0f;
+    float sumHeading = 0.0f, maxHeading = 0.0f, sumPointing = 0.0f, maxPointing = 0.0f;
+    unsigned int samples = 0;
+    unsigned long lastSampleMs = millis();
+    const unsigned long start = millis();
+    while (millis() - start < YAW_MS)
+    {
+        const float t = (millis() - start) * 0.001f;
+        const float hull = YAW_AMPLITUDE * sinf(2.0f * (float)PI * t / YAW_PERIOD);
+        const float hullRate = YAW_AMPLITUDE * 2.0f * (float)PI / YAW_PERIOD * cosf(2.0f * (float)PI * t / YAW_PERIOD);
+        const float dt = (millis() - lastSampleMs) * 0.001f;
+        lastSampleMs = millis();
+
+        // the heading of the sketch: magnetometer corrected at the needle angle, blended on the gyro by the weight
+        float mag[3];
+        simulatedMag(hull, servo->plant, mag);
+        if (model != NULL) model->apply(sm.getNeedleAngle(), mag);
+        const float magHeading = atan2f(-mag[1], mag[0]) * 180.0f / (float)PI;
+        const float weight = weighted ? sm.getMagWeight() : 1.0f;
+        compassHeading += (hullRate + SIM_GYRO_BIAS) * dt;
+        compassHeading += weight * wrap180(magHeading - compassHeading);
+        compassHeading = wrap180(compassHeading);
+        smoother.update(compassHeading);
+
+        sm.setFeedForward(-(hullRate + SIM_GYRO_BIAS), (unsigned long)(smoother.getLag() * dt * 1e6f));
+        const Bam16 target = Bam16::fromDegrees(-smoother.getHeading());
+        if (fabsf((target - previousTarget).toSignedDegrees()) >= GATE)
+        {
+            sm.setServoPosition(target);
+            previousTarget = target;
+        }
+        loopIteration(sm);
+
+        const float headingError = wrap180(compassHeading - hull);
+        const float pointingError = wrap180(servo->plant.angle - SERVO_OFFSET + hull);
+        if (millis() - start >= (unsigned long)(YAW_PERIOD * 1000.0f))
+        {
+            sumHeading += headingError * headingError;
+            sumPointing += pointingError * pointingError;
+            if (fabsf(headingError) > maxHeading) maxHeading = fabsf(headingError);
+            if (fabsf(pointingError) > maxPointing) maxPointing = fabsf(pointingError);
+            samples++;
+        }
+    }
+    const float n = samples ? (float)samples : 1.0f;
+    printf("  %-14s  heading error rms %5.2f deg, max %5.2f deg; pointing error rms %5.2f deg, max %5.2f deg\n",
+           model == NULL ? "none" : (weighted ? "model + weight" : "model"), sqrtf(sumHeading / n), maxHeading,
+           sqrtf(sumPointing / n), maxPointing);
+}
+
+/**
+ * @name autotune
+ * @brief autotune: run ServoAutotune with the loop of the sketch, the gains found are used by the next servos
+ * @retval bool gains found
+ */
+static bool autotune()
+{
+    ServoManager sm(0, SERVO_OFFSET);
+    Ticker ticker;
+    ticker.attach_ms(SERVO_SETPOINT_PERIOD_MS, [&sm]() { sm.step(); });
+    delay(1000);
+
+    ServoAutotune tuner;
+    const unsigned long start = millis();
+    tuner.start(sm);
+    while (tuner.update(sm))
+    {
+        delay(LOOP_MS);
+    }
+
+    const servo_gains_t gains = tuner.getGains();
+    printf("autotune: Ku %.2f us/deg, Tu %.3f s, %lu ms\n", tuner.getUltimateGain(), tuner.getUltimatePeriod(),
+           millis() - start);
+    if (tuner.getState() != autotune_state_t::DONE)
+    {
+        printf("autotune: no candidate passed\n");
+        return false;
+    }
+    printf("gains kp %.3f ki %.4f kd %.3f\n", gains.kp, gains.ki, gains.kd);
+    FeedbackServo::overrideGains(gains.kp, gains.ki, gains.kd);
+    return true;
+}
+
+/**
+ * @name main
+ * @brief main: play the script in every mode
+ */
+int main(int argc, char **argv)
+{
+    std::vector<Move> script;
+    bool tune = false;
+    bool yawTest = false;
+    bool magTest = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        float kp, ki, kd;
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%f,%f,%f", &kp, &ki, &kd) == 3)
+        {
+            FeedbackServo::overrideGains(kp, ki, kd);
+            printf("gains kp %.3f ki %.3f kd %.3f\n", kp, ki, kd);
+            ++i;
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            if (!load(argv[i + 1], script) || script.empty())
+            {
+                fprintf(stderr, "cannot read %s\n", argv[i + 1]);
+                return 1;
+            }
+            ++i;
+        }
+        else if (strcmp(argv[i], "-W") == 0)
+        {
+            // a quarter turn and more, always the same way: 2400 deg
+            for (int k = 1; k <= 24; ++k)
+            {
+                Move move = {500ul + 1500ul * (k - 1), fmodf(100.0f * k, 360.0f)};
+                script.push_back(move);
+            }
+        }
+        else if (strcmp(argv[i], "-Y") == 0)
+        {
+            yawTest = true;
+        }
+        else if (strcmp(argv[i], "-M") == 0)
+        {
+            magTest = true;
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            wrapLimit = (float)atof(argv[i + 1]);
+            ++i;
+        }
+        else if (strcmp(argv[i], "-a") == 0)
+        {
+            tune = true;
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            maxSettleMs = strtoul(argv[i + 1], NULL, 10);
+            ++i;
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            yieldingMs = strtoul(argv[i + 1], NULL, 10);
+            ++i;
+        }
+        else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc)
+        {
+            blockingMs = strtoul(argv[i + 1], NULL, 10);
+            ++i;
+        }
+        else if (strcmp(argv[i], "-L") == 0)
+        {
+            loopDriven = true;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-g kp,ki,kd | -a] [-f script.csv | -W | -Y | -M] [-w wrap_deg] [-c max_settle_ms] [-b ms] "
+                    "[-B ms] [-L]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (script.empty())
+    {
+        script.assign(DEFAULT_SCRIPT, DEFAULT_SCRIPT + sizeof(DEFAULT_SCRIPT) / sizeof(DEFAULT_SCRIPT[0]));
+    }
+
+    const ServoPlant &plant = FeedbackServo::defaultPlant;
+    printf("plant: %.0f deg/s, time constant %.3f s, friction %.0f deg/s^2, dead band %.0f us, encoder %.2f deg\n",
+           plant.maxSpeed, plant.timeConstant, plant.friction, plant.deadband, plant.encoderResolution);
+    if (tune && !autotune())
+    {
+        return 1;
+    }
+
+    if (yawTest)
+    {
+        printf("hull yaw +-%.0f deg every %.0f s, target bearing still, first period skipped\n", YAW_AMPLITUDE, YAW_PERIOD);
+        for (size_t m = 1; m < sizeof(MODES) / sizeof(MODES[0]); ++m)
+        {
+            printf("\n%s\n", MODES[m].name);
+            yaw(MODES[m], false);
+            yaw(MODES[m], true);
+        }
+        return 0;
+    }
+
+    if (magTest)
+    {
+        printf("servo field %.0f mG, motor %.2f mG/us, earth field %.0f mG horizontal\n", SIM_SERVO_FIELD,
+               SIM_CURRENT_FIELD, SIM_HORIZONTAL_FIELD);
+        ServoMagModel model;
+        if (!sweep(model))
+        {
+            return 1;
+        }
+        printf("hull yaw +-%.0f deg every %.0f s, target bearing still, first period skipped\n", YAW_AMPLITUDE, YAW_PERIOD);
+        for (size_t m = 1; m < sizeof(MODES) / sizeof(MODES[0]); ++m)
+        {
+            printf("\n%s\n", MODES[m].name);
+            magYaw(MODES[m], NULL, false);
+            magYaw(MODES[m], &model, false);
+            magYaw(MODES[m], &model, true);
+        }
+        return 0;
+    }
+
+    bool ok = true;
+    for (size_t m = 0; m < sizeof(MODES) / sizeof(MODES[0]); ++m)
+    {
+        ok = run(MODES[m], script) && ok;
+    }
+    if (!ok) printf("\nFAIL: a profiled move did not settle within %lu ms\n", maxSettleMs);
+    return ok ? 0 : 1;
+}
+
+/****************************************************************************
+ ****************************************************************************/
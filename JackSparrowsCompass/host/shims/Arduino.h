@@ -0,0 +1,81 @@
+/**
+ * @file Arduino.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host shim of the Arduino core used by the firmware modules built on the host
+ *
+ * Only what ServoManager needs: the time functions run on a simulated clock, and delay()
+ * advances it while the simulated servos (FeedbackServo shim) move and the tickers (Ticker shim) fire.
+ *
+ * @note Host only, never on the include path of the sketch
+ *
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+unsigned long millis();
+unsigned long micros();
+
+/**
+ * @name delay
+ * @brief delay: advance the simulated clock, the simulated servos move meanwhile
+ * @param [in] unsigned long ms: time ms
+ * @retval None
+ */
+void delay(unsigned long ms);
+
+/**
+ * @name hostAdvanceMicros
+ * @brief hostAdvanceMicros: advance the simulated clock, the simulated servos move and the tickers fire meanwhile
+ * @param [in] unsigned long us: time us
+ * @retval None
+ */
+void hostAdvanceMicros(unsigned long us);
+
+/**
+ * @name hostBusyMicros
+ * @brief hostBusyMicros: advance the simulated clock as code that does not yield, the tickers wait
+ * @param [in] unsigned long us: time us
+ * @retval None
+ */
+void hostBusyMicros(unsigned long us);
+
+
+#endif /* HOST_ARDUINO_H */
+
+/****************************************************************************
+ ****************************************************************************/
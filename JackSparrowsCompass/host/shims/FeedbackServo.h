@@ -0,0 +1,150 @@
+/**
+ * @file FeedbackServo.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host shim of Feedback_Control_Servo: PID on a simulated Parallax 360 feedback servo
+ *
+ * Same interface as the library used by ServoManager, the servo is a ServoPlant:
+ *      - drive: pulse offset from the 1500 us stop pulse, dead inside +-deadband, then linear up
+ *        to maxSpeed at PULSE_FULL_SPEED us
+ *      - mechanics: first order speed response (timeConstant, inertia of servo and needle) plus
+ *        Coulomb friction, the needle sticks when the drive cannot beat it
+ *      - feedback: absolute angle within one turn, quantized to encoderResolution
+ * The plant belongs to the feedback pin, not to the object: a FeedbackServo built again on the same
+ * pin (new gains) takes over the same needle, as attaching the pin again does on the board.
+ * As the library, rotate_PID computes one PID output on the shortest angle error and the servo keeps
+ * that pulse until the next call: the gains apply per call, meant to be every controlPeriod (the
+ * integral sums the error of each call, the derivative is the difference of two calls).
+ * Positive pulses turn toward increasing angles.
+ *
+ * @note Host only, never on the include path of the sketch
+ *
+ */
+
+#ifndef HOST_FEEDBACK_SERVO_H
+#define HOST_FEEDBACK_SERVO_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "Arduino.h"
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const float PULSE_FULL_SPEED = 220.0f;     // us from 1500, Parallax 360: 1280 and 1720 us
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+struct ServoPlant
+{
+    float maxSpeed;             // deg/s at full pulse
+    float timeConstant;         // s, speed response (inertia)
+    float friction;             // deg/s^2, Coulomb
+    float deadband;             // us around the stop pulse
+    float encoderResolution;    // deg per feedback step
+
+    float angle;                // deg, unwrapped
+    float speed;                // deg/s
+    float pulse;                // us from 1500, last PID output
+    float travel;               // deg, |angle| travelled
+    float peakPulse;            // us, largest |pulse|
+};
+
+class FeedbackServo
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name FeedbackServo
+     * @brief FeedbackServo: constructor, takes over the plant of the feedback pin
+     * @param [in] int feedbackPin: feedback pin, one plant per pin
+     * @param [in] float kp, ki, kd: PID gains, per control period
+     * @param [in] float kf: feed forward gain, unused by ServoManager
+     * @param [in] int minOutput, maxOutput: PID output limits, us from 1500
+     * @param [in] float controlPeriod: PID period ms, unused: one output per rotate_PID
+     */
+    FeedbackServo(int feedbackPin, float kp, float ki, float kd, float kf, int minOutput, int maxOutput, float controlPeriod);
+    ~FeedbackServo();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    void setServoControl(int servoPin) { (void)servoPin; }
+
+    /**
+     * @name rotate_PID
+     * @brief rotate_PID: new setpoint and one PID output, held until the next call
+     * @param [in] float angle: deg, any range
+     * @param [in] int threshold: deg, the PID stops the servo inside it
+     * @retval None
+     */
+    void rotate_PID(float angle, int threshold);
+
+    /**
+     * @name Angle
+     * @brief Angle: feedback angle
+     * @retval float 0 to 360 deg, quantized
+     */
+    float Angle();
+
+    /**
+     * @name advance
+     * @brief advance: simulate one step of the plant
+     * @param [in] float dt: s
+     * @retval None
+     */
+    void advance(float dt);
+
+    ServoPlant &plant;
+
+    /**
+     * @name defaultPlant / overrideGains
+     * @brief plant model of the pins used for the first time, gains of the servos built afterwards
+     *        (ServoManager builds its own)
+     */
+    static ServoPlant defaultPlant;
+    static void overrideGains(float kp, float ki, float kd);
+
+    /**
+     * @name instance
+     * @brief instance: the last servo built, NULL if none
+     */
+    static FeedbackServo *instance();
+
+
+private:
+    int feedbackPin;
+    float kp, ki, kd;
+    float minOutput, maxOutput;
+    float setpoint;
+    float threshold;
+    float integral;
+    float previousError;
+
+}; /* FeedbackServo */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* HOST_FEEDBACK_SERVO_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,98 @@
+/**
+ * @file Ticker.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host shim of the ESP8266 Ticker: periodic callbacks on the simulated clock
+ *
+ * The callbacks run inside delay() / hostAdvanceMicros, as on the board they run when the loop yields.
+ *
+ * @note Host only, never on the include path of the sketch
+ *
+ */
+
+#ifndef HOST_TICKER_H
+#define HOST_TICKER_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "Arduino.h"
+#include <functional>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class Ticker
+{
+public:
+    typedef std::function<void(void)> callback_function_t;
+
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    Ticker();
+    ~Ticker();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name attach_ms
+     * @brief attach_ms: call callback every milliseconds of simulated time, the first time after one period
+     * @param [in] uint32_t milliseconds: period ms
+     * @param [in] callback_function_t callback: function called
+     * @retval None
+     */
+    void attach_ms(uint32_t milliseconds, callback_function_t callback);
+
+    /**
+     * @name detach
+     * @brief detach: stop the callbacks
+     * @retval None
+     */
+    void detach();
+
+    bool active();
+
+    /**
+     * @name fire
+     * @brief fire: call the callback if due at the simulated time (host clock only)
+     * @param [in] uint64_t nowUs: simulated time us
+     * @retval None
+     */
+    void fire(uint64_t nowUs);
+
+
+private:
+    callback_function_t callback;
+    uint64_t periodUs;
+    uint64_t nextUs;
+
+}; /* Ticker */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* HOST_TICKER_H */
+
+/****************************************************************************
+ ****************************************************************************/
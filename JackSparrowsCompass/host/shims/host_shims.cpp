@@ -0,0 +1,267 @@
+/**
+ * @file host_shims.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host shims: simulated clock, tickers and simulated feedback servos
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "Arduino.h"
+#include "FeedbackServo.h"
+#include "Ticker.h"
+#include <map>
+#include <set>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const unsigned long PLANT_STEP_US = 250;    // plant integration step
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+static uint64_t clockMicros = 0;
+static std::map<int, ServoPlant> plants;            // feedback pin -> needle
+static std::map<int, FeedbackServo *> drivers;      // feedback pin -> servo driving it, the last built
+static FeedbackServo *lastBuilt = NULL;
+static std::set<Ticker *> tickers;                 // attached
+static bool busy = false;                           // hostBusyMicros: no ticks
+
+static bool gainsOverridden = false;
+static float overrideKp, overrideKi, overrideKd;
+
+ServoPlant FeedbackServo::defaultPlant =
+{
+    720.0f,     // maxSpeed, Parallax 360 high speed, loaded
+    0.04f,      // timeConstant
+    300.0f,     // friction
+    20.0f,      // deadband, 1480 to 1520 us
+    0.35f,      // encoderResolution, 1 us of the 910 Hz duty cycle
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+/**
+ * @name plantOn
+ * @brief plantOn: needle of a feedback pin, from defaultPlant the first time
+ */
+static ServoPlant &plantOn(int feedbackPin)
+{
+    if (plants.find(feedbackPin) == plants.end()) plants[feedbackPin] = FeedbackServo::defaultPlant;
+    return plants[feedbackPin];
+}
+
+/**
+ * @name wrap180
+ * @brief wrap180: angle to -180, 180 deg
+ */
+static float wrap180(float angle)
+{
+    angle = fmodf(angle + 180.0f, 360.0f);
+    if (angle < 0.0f) angle += 360.0f;
+    return angle - 180.0f;
+}
+
+/*******************
+ * ARDUINO CORE
+*******************/
+unsigned long millis()
+{
+    return (unsigned long)(clockMicros / 1000u);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)clockMicros;
+}
+
+void delay(unsigned long ms)
+{
+    hostAdvanceMicros(ms * 1000ul);
+}
+
+void hostAdvanceMicros(unsigned long us)
+{
+    while (us > 0)
+    {
+        const unsigned long h = us > PLANT_STEP_US ? PLANT_STEP_US : us;
+        for (std::map<int, FeedbackServo *>::iterator it = drivers.begin(); it != drivers.end(); ++it)
+        {
+            it->second->advance(h * 1e-6f);
+        }
+        clockMicros += h;
+        us -= h;
+
+        if (busy) continue;
+        // a callback may detach a ticker: iterate on a copy
+        const std::set<Ticker *> due = tickers;
+        for (std::set<Ticker *>::const_iterator it = due.begin(); it != due.end(); ++it)
+        {
+            if (tickers.count(*it)) (*it)->fire(clockMicros);
+        }
+    }
+}
+
+void hostBusyMicros(unsigned long us)
+{
+    busy = true;
+    hostAdvanceMicros(us);
+    busy = false;
+}
+
+/*******************
+ * TICKER
+*******************/
+Ticker::Ticker()
+{
+    periodUs = 0;
+    nextUs = 0;
+}
+
+Ticker::~Ticker()
+{
+    detach();
+}
+
+void Ticker::attach_ms(uint32_t milliseconds, callback_function_t callback)
+{
+    this->callback = callback;
+    periodUs = milliseconds * 1000ull;
+    nextUs = clockMicros + periodUs;
+    tickers.insert(this);
+}
+
+void Ticker::detach()
+{
+    tickers.erase(this);
+}
+
+bool Ticker::active()
+{
+    return tickers.count(this) > 0;
+}
+
+void Ticker::fire(uint64_t nowUs)
+{
+    if (nowUs < nextUs) return;
+    // late ticks are not made up, as the os timer of the ESP8266
+    while (nextUs <= nowUs) nextUs += periodUs;
+    callback();
+}
+
+/*******************
+ * FEEDBACK SERVO
+*******************/
+FeedbackServo::FeedbackServo(int feedbackPin, float kp, float ki, float kd, float kf, int minOutput, int maxOutput, float controlPeriod)
+    : plant(plantOn(feedbackPin))
+{
+    (void)kf;
+    (void)controlPeriod;
+    this->feedbackPin = feedbackPin;
+    this->kp        = gainsOverridden ? overrideKp : kp;
+    this->ki        = gainsOverridden ? overrideKi : ki;
+    this->kd        = gainsOverridden ? overrideKd : kd;
+    this->minOutput = minOutput;
+    this->maxOutput = maxOutput;
+    setpoint        = plant.angle;
+    threshold       = 0.0f;
+    integral        = 0.0f;
+    previousError   = 0.0f;
+    plant.pulse     = 0.0f;
+    drivers[feedbackPin] = this;
+    lastBuilt = this;
+}
+
+FeedbackServo::~FeedbackServo()
+{
+    if (drivers[feedbackPin] == this)
+    {
+        drivers.erase(feedbackPin);
+        plant.pulse = 0.0f;
+    }
+    if (lastBuilt == this) lastBuilt = NULL;
+}
+
+void FeedbackServo::overrideGains(float kp, float ki, float kd)
+{
+    gainsOverridden = true;
+    overrideKp = kp;
+    overrideKi = ki;
+    overrideKd = kd;
+}
+
+FeedbackServo *FeedbackServo::instance()
+{
+    return lastBuilt;
+}
+
+void FeedbackServo::rotate_PID(float angle, int threshold)
+{
+    setpoint = angle;
+    this->threshold = (float)threshold;
+
+    const float error = wrap180(setpoint - Angle());
+    float output = 0.0f;
+    if (fabsf(error) > this->threshold)
+    {
+        integral += error;
+        // anti wind-up: the integral alone cannot go past the output limits
+        if (ki > 0.0f)
+        {
+            if (ki * integral > maxOutput) integral = maxOutput / ki;
+            if (ki * integral < minOutput) integral = minOutput / ki;
+        }
+        output = kp * error + ki * integral + kd * (error - previousError);
+    }
+    else
+    {
+        integral = 0.0f;
+    }
+    previousError = error;
+
+    if (output > maxOutput) output = maxOutput;
+    if (output < minOutput) output = minOutput;
+    plant.pulse = output;
+    if (fabsf(output) > plant.peakPulse) plant.peakPulse = fabsf(output);
+}
+
+float FeedbackServo::Angle()
+{
+    float angle = fmodf(plant.angle, 360.0f);
+    if (angle < 0.0f) angle += 360.0f;
+    return floorf(angle / plant.encoderResolution) * plant.encoderResolution;
+}
+
+void FeedbackServo::advance(float dt)
+{
+    // ----- Drive: dead band, then linear up to full speed
+    float command = 0.0f;
+    const float magnitude = fabsf(plant.pulse);
+    if (magnitude > plant.deadband)
+    {
+        command = plant.maxSpeed * (magnitude - plant.deadband) / (PULSE_FULL_SPEED - plant.deadband);
+        if (command > plant.maxSpeed) command = plant.maxSpeed;
+        if (plant.pulse < 0.0f) command = -command;
+    }
+
+    // ----- Mechanics: first order speed response against Coulomb friction
+    const float drive = (command - plant.speed) / plant.timeConstant;
+    if (plant.speed == 0.0f && fabsf(drive) <= plant.friction)
+    {
+        return;                                             // sticks
+    }
+    const float direction = plant.speed != 0.0f ? (plant.speed > 0.0f ? 1.0f : -1.0f) : (drive > 0.0f ? 1.0f : -1.0f);
+    const float newSpeed = plant.speed + (drive - direction * plant.friction) * dt;
+    // friction stops the needle, it does not push it backward
+    plant.speed = (plant.speed != 0.0f && newSpeed * plant.speed < 0.0f) ? 0.0f : newSpeed;
+    plant.angle += plant.speed * dt;
+    plant.travel += fabsf(plant.speed) * dt;
+}
+
+/****************************************************************************
+ ****************************************************************************/
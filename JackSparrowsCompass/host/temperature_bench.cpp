@@ -0,0 +1,169 @@
+/**
+ * @file temperature_bench.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Host benchmark of the temperature bias table: gyro bias left over an afternoon in the sun
+ *
+ * The die warms from SIM_T_START by SIM_T_RISE over SIM_HOURS and cools back, the gyro bias follows it on a
+ * curve with a quadratic term. The hull is moored the first SIM_STILL_S of every hour, at sea the rest of it.
+ * The gyro goes as in the quaternion compass library: the table bias away, then the motion detector, whose
+ * zero-velocity bias is taken away too; the boot calibration zeroes the gyro at SIM_T_START every day.
+ * Prints for every day, while at sea, the mean and largest gyro bias left:
+ *      - with the zero-velocity bias only, held from the last time moored
+ *      - with the table as well, learned since the first day
+ * and the heading lost over a MAG_COAST_LIMIT coast on the gyro with the largest of each. The largest comes
+ * as the hull leaves, before the motion detector sees the waves, the same with or without the table.
+ * Then the magnetometer: the field of a hull that turns between the moorings, with a bias of the temperature,
+ * each mooring one learnChange() window; the change of the table from SIM_T_START against the truth.
+ * The moorings come SIM_DAY_SHIFT later every day, the afternoons cover the temperatures in a few days.
+ *
+ * Usage:
+ *      temperature_bench [days]
+ *
+ * Build (host):
+ *      g++ -std=c++11 -O2 -I../../libraries/CompassCore temperature_bench.cpp \
+ *          ../../libraries/CompassCore/TemperatureBiasTable.cpp ../../libraries/CompassCore/MotionDetector.cpp \
+ *          -o temperature_bench
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+#include <TemperatureBiasTable.h>
+#include <MotionDetector.h>
+#include <MagDisturbanceDetector.h>     // MAG_COAST_LIMIT
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const float SIM_DT          = 0.01f;    // s, 100 Hz
+const float SIM_HOURS       = 6.0f;
+const float SIM_T_START     = 25.0f;    // degC
+const float SIM_T_RISE      = 30.0f;    // degC at the middle of the afternoon
+const float SIM_STILL_S     = 900.0f;   // s moored every hour
+const float SIM_DAY_SHIFT   = 1200.0f;  // s later every day
+const float SIM_NOISE       = 0.1f;     // deg/s rms
+const float SIM_WAVE        = 6.0f;     // deg/s, roll of the waves at sea
+const float SIM_WAVE_RAMP   = 30.0f;    // s, the waves grow as the hull leaves the mooring
+const float SIM_MAG_DT      = 0.125f;   // s, 8 Hz
+const float SIM_MAG_SLOPE   = 0.5f;     // mG/degC
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+static float gyroBias(float temperature)
+{
+    const float t = temperature - SIM_T_START;
+    return 0.01f * t + 0.0003f * t * t;
+}
+
+static float dieTemperature(float seconds)
+{
+    return SIM_T_START + SIM_T_RISE * sinf((float)M_PI * seconds / (SIM_HOURS * 3600.0f));
+}
+
+// s into the hour of the schedule: moored below SIM_STILL_S
+static float scheduleTime(int day, float seconds)
+{
+    return fmodf(seconds + day * SIM_DAY_SHIFT, 3600.0f);
+}
+
+int main(int argc, char **argv)
+{
+    const int days = (argc > 1) ? atoi(argv[1]) : 3;
+    std::mt19937 random(7);
+    std::normal_distribution<float> noise(0.0f, SIM_NOISE);
+
+    // ----- Gyro, z axis only, the others alike
+    TemperatureBiasTable table;
+    double lastMean = 0.0;
+    for (int day = 0; day < days; ++day)
+    {
+        table.rebase(SIM_T_START);
+        MotionDetector motionOnly;
+        MotionDetector motionTable;
+        double sumOnly = 0.0, sumTable = 0.0;
+        float maxOnly = 0.0f, maxTable = 0.0f;
+        long atSea = 0;
+        for (float t = 0.0f; t < SIM_HOURS * 3600.0f; t += SIM_DT)
+        {
+            const float temperature = dieTemperature(t);
+            const bool moored = scheduleTime(day, t) < SIM_STILL_S;
+            const float bias = gyroBias(temperature) - gyroBias(SIM_T_START);
+            const float waves = fminf(1.0f, (scheduleTime(day, t) - SIM_STILL_S) / SIM_WAVE_RAMP);
+            const float rate = moored ? 0.0f : SIM_WAVE * waves * sinf(2.0f * (float)M_PI * t / 6.0f);
+            const float raw = rate + bias + noise(random);
+
+            // zero-velocity bias only
+            const float gyroOnly[3] = {0.0f, 0.0f, raw};
+            motionOnly.update(gyroOnly, SIM_DT);
+
+            // table, then zero-velocity bias of what is left
+            float tableBias[3];
+            if (motionTable.isStationary()) table.learn(temperature, gyroOnly, SIM_DT);
+            table.getBias(temperature, tableBias);
+            const float gyroTable[3] = {0.0f, 0.0f, raw - tableBias[2]};
+            motionTable.update(gyroTable, SIM_DT);
+
+            if (!moored)
+            {
+                float zuptOnly[3], zuptTable[3];
+                motionOnly.getGyroBias(zuptOnly);
+                motionTable.getGyroBias(zuptTable);
+                const float errorOnly = fabsf(bias - zuptOnly[2]);
+                const float errorTable = fabsf(bias - tableBias[2] - zuptTable[2]);
+                sumOnly += errorOnly;
+                sumTable += errorTable;
+                maxOnly = fmaxf(maxOnly, errorOnly);
+                maxTable = fmaxf(maxTable, errorTable);
+                ++atSea;
+            }
+        }
+        printf("day %d at sea: bias left %.3f / %.3f deg/s zero-velocity only, %.3f / %.3f with the table (mean / max)\n",
+               day + 1, sumOnly / atSea, maxOnly, sumTable / atSea, maxTable);
+        printf("       %.0f s coast on the gyro: %.1f deg lost zero-velocity only, %.1f with the table\n",
+               MAG_COAST_LIMIT, maxOnly * MAG_COAST_LIMIT, maxTable * MAG_COAST_LIMIT);
+        lastMean = sumTable / atSea;
+    }
+
+    // ----- Magnetometer, x axis: the field moves with the heading of each mooring, the bias with the temperature
+    TemperatureBiasTable magTable;
+    std::normal_distribution<float> magNoise(0.0f, 1.0f);
+    for (int day = 0; day < days; ++day)
+    {
+        for (float t = 0.0f; t < SIM_HOURS * 3600.0f; t += SIM_MAG_DT)
+        {
+            const float mooring = floorf((t + day * SIM_DAY_SHIFT) / 3600.0f) + day * 7.0f;
+            if (scheduleTime(day, t) >= SIM_STILL_S)
+            {
+                magTable.restartChange();
+                continue;
+            }
+            const float temperature = dieTemperature(t);
+            const float field = 200.0f * cosf(mooring * 2.1f);
+            const float value[3] = {field + SIM_MAG_SLOPE * (temperature - SIM_T_START) + magNoise(random), 0.0f, 0.0f};
+            magTable.learnChange(temperature, value, SIM_MAG_DT);
+        }
+    }
+    float worstMag = 0.0f;
+    float first[3];
+    magTable.getBias(SIM_T_START, first);
+    for (float temperature = SIM_T_START; temperature <= SIM_T_START + SIM_T_RISE; temperature += 5.0f)
+    {
+        float bias[3];
+        magTable.getBias(temperature, bias);
+        const float change = bias[0] - first[0];
+        printf("magnetometer %4.1f C: change of the bias %5.2f mG, true %5.2f\n", temperature, change,
+               SIM_MAG_SLOPE * (temperature - SIM_T_START));
+        worstMag = fmaxf(worstMag, fabsf(change - SIM_MAG_SLOPE * (temperature - SIM_T_START)));
+    }
+    return (lastMean < 0.03 && worstMag < 1.0f) ? 0 : 1;
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -140,7 +140,22 @@ R"rawliteral(
         </div>
     </div>
 
-    
+    <hr>
+    <h1 style="margin-top: 0;">Taratura Servo</h1>
+    <div style="text-align: center;">
+        <p>La lancetta ruota per alcuni secondi</p>
+        <input class="button" type="button" value="Avvia" onclick="startAutotune()">
+        <div id="autotune_status"></div>
+    </div>
+
+    <hr>
+    <h1 style="margin-top: 0;">Disturbo Servo</h1>
+    <div style="text-align: center;">
+        <p>Bussola ferma: la lancetta fa un giro avanti e indietro, circa un minuto</p>
+        <input class="button" type="button" value="Avvia" onclick="startMagSweep()">
+        <div id="mag_sweep_status"></div>
+    </div>
+
     <div class="footer">
         Developed by: <b>EmSolutions</b>
     </div>
@@ -153,6 +168,8 @@ R"rawliteral(
             getSysStatus();
             target();
             actualpose();
+            getAutotuneStatus();
+            getMagSweepStatus();
         }, 500); 
         
         function getCompassStatus() 
@@ -175,6 +192,11 @@ R"rawliteral(
                             document.getElementById("comp_status").innerHTML = "Ok";
 
                         }
+                        else if(this.responseText == "disturbed")
+                        {
+                            document.getElementById("compass").style.backgroundColor = "#e9b200";
+                            document.getElementById("comp_status").innerHTML = "Disturbed";
+                        }
                         else
                         {
                             if(this.responseText == "err")
@@ -324,6 +346,92 @@ R"rawliteral(
             xhttp.send();
         }
 
+        function startAutotune() 
+        {
+            var xhttp = new XMLHttpRequest();
+            xhttp.open("GET", "autotune", true);
+            xhttp.send();
+        }
+
+        function getAutotuneStatus() 
+        {
+            var xhttp = new XMLHttpRequest();
+            xhttp.onreadystatechange = function() 
+            {
+                if (this.readyState == 4 && this.status == 200) 
+                {
+                    var res = this.responseText.split(";");
+                    if(res[0] == "ok")
+                    {
+                        document.getElementById("autotune_status").innerHTML = "Ok: kp " + res[1] + " ki " + res[2] + " kd " + res[3];
+                    }
+                    else
+                    {
+                        if(res[0] == "fail")
+                        {
+                            document.getElementById("autotune_status").innerHTML = "Errore, guadagni precedenti";
+                        }
+                        else
+                        {
+                            if(res[0] == "idle")
+                            {
+                                document.getElementById("autotune_status").innerHTML = "";
+                            }
+                            else
+                            {
+                                document.getElementById("autotune_status").innerHTML = "In corso...";
+                            }
+                        }
+                    }
+                }
+            };
+            xhttp.open("GET", "autotune_status", true);
+            xhttp.send();
+        }
+
+        function startMagSweep()
+        {
+            var xhttp = new XMLHttpRequest();
+            xhttp.open("GET", "mag_sweep", true);
+            xhttp.send();
+        }
+
+        function getMagSweepStatus()
+        {
+            var xhttp = new XMLHttpRequest();
+            xhttp.onreadystatechange = function()
+            {
+                if (this.readyState == 4 && this.status == 200)
+                {
+                    var res = this.responseText.split(";");
+                    if(res[0] == "ok")
+                    {
+                        document.getElementById("mag_sweep_status").innerHTML = "Ok: disturbo massimo " + res[1] + " mG";
+                    }
+                    else
+                    {
+                        if(res[0] == "fail")
+                        {
+                            document.getElementById("mag_sweep_status").innerHTML = "Errore, tabella precedente";
+                        }
+                        else
+                        {
+                            if(res[0] == "idle")
+                            {
+                                document.getElementById("mag_sweep_status").innerHTML = "";
+                            }
+                            else
+                            {
+                                document.getElementById("mag_sweep_status").innerHTML = "In corso...";
+                            }
+                        }
+                    }
+                }
+            };
+            xhttp.open("GET", "mag_sweep_status", true);
+            xhttp.send();
+        }
+
     </script>
 
 </body>
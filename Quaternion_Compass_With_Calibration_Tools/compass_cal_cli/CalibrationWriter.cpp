@@ -0,0 +1,107 @@
+/**
+ * @file CalibrationWriter.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Output of compass_cal_cli: binary blob and C header ready to build
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "CalibrationWriter.h"
+#include "MagFit.h"
+#include <stdio.h>
+#include <ctype.h>
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name writeCalibrationBlob
+ * @brief writeCalibrationBlob: write the calibration as MagCalibrationBlob binary file
+ * @param [in] const std::string &path: output file
+ * @param [in] const MagCalibrationBlob &calibration: calibration
+ * @retval bool: true if the file was written
+ */
+bool writeCalibrationBlob(const std::string &path, const MagCalibrationBlob &calibration)
+{
+    uint8_t buffer[MAG_CALIBRATION_BLOB_SIZE];
+    serializeMagCalibration(calibration, buffer);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        return false;
+    }
+    bool ok = fwrite(buffer, 1, sizeof(buffer), file) == sizeof(buffer);
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+/**
+ * @name writeCalibrationHeader
+ * @brief writeCalibrationHeader: write the calibration as C header
+ * @param [in] const std::string &path: output file
+ * @param [in] const std::string &unitName: unit name, used for the include guard
+ * @param [in] const std::string &source: capture the calibration comes from
+ * @param [in] const MagCalibrationBlob &calibration: calibration
+ * @retval bool: true if the file was written
+ */
+bool writeCalibrationHeader(const std::string &path, const std::string &unitName, const std::string &source,
+                            const MagCalibrationBlob &calibration)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string guard = "MAG_CALIBRATION_";
+    for (size_t i = 0; i < unitName.size(); ++i)
+    {
+        guard += isalnum((unsigned char)unitName[i]) ? (char)toupper((unsigned char)unitName[i]) : '_';
+    }
+    guard += "_H";
+
+    const float (*m)[3] = calibration.softIron;
+
+    fprintf(file, "/**\n");
+    fprintf(file, " * @file %s\n", path.substr(path.find_last_of("/\\") + 1).c_str());
+    fprintf(file, " * @brief Magnetometer calibration of unit \"%s\" generated by compass_cal_cli\n", unitName.c_str());
+    fprintf(file, " *\n");
+    fprintf(file, " * Capture: %s\n", source.c_str());
+    fprintf(file, " * Method: %s, samples: %u, residual: %.4f%%%s\n", fitMethodName(calibration.method),
+            (unsigned int)calibration.samples, calibration.residual * 100.0f,
+            (calibration.flags & MAG_CALIBRATION_FLAG_REJECTED) ? " (REJECTED)" : "");
+    fprintf(file, " *\n");
+    fprintf(file, " * calibrated = Mag_soft_iron * (raw - Mag_offset)\n");
+    fprintf(file, " * MPU9250::setMagCalibration(Mag_offset, Mag_soft_iron) loads the full matrix,\n");
+    fprintf(file, " * Mag_*_scale is its diagonal, for sketches with per axis scale-factors only\n");
+    fprintf(file, " */\n\n");
+    fprintf(file, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+
+    fprintf(file, "const float\n");
+    fprintf(file, "Mag_x_offset = %.6g,\n", calibration.offset[0]);
+    fprintf(file, "Mag_y_offset = %.6g,\n", calibration.offset[1]);
+    fprintf(file, "Mag_z_offset = %.6g,\n", calibration.offset[2]);
+    fprintf(file, "Mag_x_scale = %.8g,\n", m[0][0]);
+    fprintf(file, "Mag_y_scale = %.8g,\n", m[1][1]);
+    fprintf(file, "Mag_z_scale = %.8g;\n\n", m[2][2]);
+
+    fprintf(file, "float const Mag_offset[3] =\n{\n    %.6g, %.6g, %.6g\n};\n\n",
+            calibration.offset[0], calibration.offset[1], calibration.offset[2]);
+    fprintf(file, "float const Mag_soft_iron[3][3] =\n{\n");
+    for (int r = 0; r < 3; ++r)
+    {
+        fprintf(file, "    {%.8g, %.8g, %.8g}%s\n", m[r][0], m[r][1], m[r][2], r < 2 ? "," : "");
+    }
+    fprintf(file, "};\n\n");
+    fprintf(file, "float const Mag_field_radius = %.6g;\n\n", calibration.fieldRadius);
+    fprintf(file, "#endif /* %s */\n", guard.c_str());
+
+    return fclose(file) == 0;
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,51 @@
+/**
+ * @file CalibrationWriter.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Output of compass_cal_cli: binary blob and C header ready to build
+ *
+ * The header replaces the copy&paste block printed by compass_cal.pde: it carries the
+ * Mag_*_offset / Mag_*_scale values used by JackSparrowsCompass.ino and the full
+ * soft-iron matrix in the layout of CompassManager (calibrated = matrix * (raw - bias)).
+ *
+ */
+
+#ifndef CALIBRATION_WRITER_H
+#define CALIBRATION_WRITER_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <string>
+#include <MagCalibrationBlob.h>
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/**
+ * @name writeCalibrationBlob
+ * @brief writeCalibrationBlob: write the calibration as MagCalibrationBlob binary file
+ * @param [in] const std::string &path: output file
+ * @param [in] const MagCalibrationBlob &calibration: calibration
+ * @retval bool: true if the file was written
+ */
+bool writeCalibrationBlob(const std::string &path, const MagCalibrationBlob &calibration);
+
+/**
+ * @name writeCalibrationHeader
+ * @brief writeCalibrationHeader: write the calibration as C header
+ * @param [in] const std::string &path: output file
+ * @param [in] const std::string &unitName: unit name, used for the include guard
+ * @param [in] const std::string &source: capture the calibration comes from
+ * @param [in] const MagCalibrationBlob &calibration: calibration
+ * @retval bool: true if the file was written
+ */
+bool writeCalibrationHeader(const std::string &path, const std::string &unitName, const std::string &source,
+                            const MagCalibrationBlob &calibration);
+
+
+#endif /* CALIBRATION_WRITER_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,291 @@
+/**
+ * @file CaptureReader.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetometer capture readers for compass_cal_cli
+ *
+ * Sample validation is the one of compass_cal.pde: a row moving more than jumpLimit counts
+ * on any axis from the previous row is dropped, and so are "0,0,0" rows.
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "CaptureReader.h"
+#include <CoverageTracker.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/select.h>
+#endif
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const int SERIAL_TIMEOUT_MS = 2000;   // no answer from the MCU after this time is an error
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+class SampleValidator
+{
+public:
+    explicit SampleValidator(const CaptureFilter &filter) : filter(filter), previous(), hasPrevious(false) {}
+
+    bool accept(const MagSample &sample)
+    {
+        bool valid = true;
+        if (filter.rejectZeros && (int)sample.x == 0 && (int)sample.y == 0 && (int)sample.z == 0)
+        {
+            valid = false;
+        }
+        if (filter.jumpLimit > 0 && hasPrevious)
+        {
+            if (fabs(sample.x - previous.x) > filter.jumpLimit ||
+                fabs(sample.y - previous.y) > filter.jumpLimit ||
+                fabs(sample.z - previous.z) > filter.jumpLimit)
+            {
+                valid = false;
+            }
+        }
+        previous = sample;
+        hasPrevious = true;
+        return valid;
+    }
+
+private:
+    CaptureFilter filter;
+    MagSample previous;
+    bool hasPrevious;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+static bool parseCsvLine(const char *line, MagSample &sample);
+static bool hasSuffix(const std::string &value, const char *suffix);
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name readCapture
+ * @brief readCapture: load a capture file, the format is chosen from the extension (.bin binary, CSV otherwise)
+ * @param [in] const std::string &path: capture file
+ * @param [in] const CaptureFilter &filter: sample validation
+ * @param [out] std::vector<MagSample> &samples: accepted samples
+ * @param [out] std::string &error: error message if the read failed
+ * @retval bool: true if the file was read
+ */
+bool readCapture(const std::string &path, const CaptureFilter &filter, std::vector<MagSample> &samples, std::string &error)
+{
+    bool binary = hasSuffix(path, ".bin");
+    FILE *file = fopen(path.c_str(), binary ? "rb" : "r");
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    SampleValidator validator(filter);
+    samples.clear();
+
+    if (binary)
+    {
+        uint8_t record[12];
+        while (fread(record, 1, sizeof(record), file) == sizeof(record))
+        {
+            float values[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                uint32_t bits = (uint32_t)record[4 * i] | ((uint32_t)record[4 * i + 1] << 8) |
+                                ((uint32_t)record[4 * i + 2] << 16) | ((uint32_t)record[4 * i + 3] << 24);
+                memcpy(&values[i], &bits, sizeof(float));
+            }
+            MagSample sample = {values[0], values[1], values[2]};
+            if (validator.accept(sample)) samples.push_back(sample);
+        }
+    }
+    else
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), file))
+        {
+            MagSample sample;
+            if (parseCsvLine(line, sample) && validator.accept(sample))
+            {
+                samples.push_back(sample);
+            }
+        }
+    }
+
+    fclose(file);
+    if (samples.empty())
+    {
+        error = "no valid samples in " + path;
+        return false;
+    }
+    return true;
+}
+
+#ifndef _WIN32
+/**
+ * @name readSerialCapture
+ * @brief readSerialCapture: capture samples from a serial port using the compass_cal protocol
+ * @param [in] const std::string &device: serial device, e.g. /dev/ttyUSB0
+ * @param [in] unsigned int sampleCount: number of samples to capture, upper bound if filter.stopOnCoverage
+ * @param [in] const CaptureFilter &filter: sample validation
+ * @param [out] std::vector<MagSample> &samples: accepted samples
+ * @param [out] std::string &error: error message if the capture failed
+ * @retval bool: true if the capture completed
+ */
+bool readSerialCapture(const std::string &device, unsigned int sampleCount, const CaptureFilter &filter,
+                       std::vector<MagSample> &samples, std::string &error)
+{
+    int fd = open(device.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+        error = "cannot open " + device;
+        return false;
+    }
+
+    struct termios tty;
+    tcgetattr(fd, &tty);
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B115200);
+    cfsetospeed(&tty, B115200);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tcsetattr(fd, TCSANOW, &tty);
+    tcflush(fd, TCIOFLUSH);
+
+    SampleValidator validator(filter);
+    CoverageTracker coverage;
+    samples.clear();
+
+    std::string line;
+    bool connected = false;
+    while (samples.size() < sampleCount)
+    {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(fd, &readSet);
+        struct timeval timeout = {SERIAL_TIMEOUT_MS / 1000, (SERIAL_TIMEOUT_MS % 1000) * 1000};
+        if (select(fd + 1, &readSet, NULL, NULL, &timeout) <= 0)
+        {
+            error = "timeout waiting for " + device;
+            close(fd);
+            return false;
+        }
+
+        char c;
+        if (read(fd, &c, 1) != 1)
+        {
+            continue;
+        }
+        if (c != '\n')
+        {
+            if (c != '\r') line += c;
+            continue;
+        }
+
+        if (line == "S")
+        {
+            // ----- MCU is waiting for the link
+            connected = true;
+        }
+        else if (connected)
+        {
+            MagSample sample;
+            if (parseCsvLine(line.c_str(), sample) && validator.accept(sample))
+            {
+                samples.push_back(sample);
+                coverage.addSample(sample.x, sample.y, sample.z);
+                if (samples.size() % 100 == 0)
+                {
+                    fprintf(stderr, "%s: %u/%u samples, coverage %.0f%%, residual %.1f%%\n", device.c_str(),
+                            (unsigned int)samples.size(), sampleCount, coverage.coverage() * 100.0f,
+                            coverage.residual() * 100.0f);
+                }
+                if (filter.stopOnCoverage && coverage.isComplete())
+                {
+                    fprintf(stderr, "%s: coverage reached after %u samples\n", device.c_str(), (unsigned int)samples.size());
+                    break;
+                }
+            }
+        }
+        line.clear();
+
+        if (connected)
+        {
+            // ----- request next sample
+            tcflush(fd, TCIFLUSH);
+            if (write(fd, "S", 1) != 1)
+            {
+                error = "write error on " + device;
+                close(fd);
+                return false;
+            }
+        }
+    }
+
+    close(fd);
+    return true;
+}
+#else
+bool readSerialCapture(const std::string &device, unsigned int sampleCount, const CaptureFilter &filter,
+                       std::vector<MagSample> &samples, std::string &error)
+{
+    error = "serial capture is not supported on this platform";
+    return false;
+}
+#endif
+
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+static bool parseCsvLine(const char *line, MagSample &sample)
+{
+    char *end;
+    float values[3];
+    const char *p = line;
+    for (int i = 0; i < 3; ++i)
+    {
+        values[i] = strtof(p, &end);
+        if (end == p)
+        {
+            return false;   // header or garbage
+        }
+        p = end;
+        while (*p == ' ' || *p == '\t') p++;
+        if (i < 2)
+        {
+            if (*p != ',' && *p != ';')
+            {
+                return false;
+            }
+            p++;
+        }
+    }
+    sample.x = values[0];
+    sample.y = values[1];
+    sample.z = values[2];
+    return true;
+}
+
+static bool hasSuffix(const std::string &value, const char *suffix)
+{
+    size_t length = strlen(suffix);
+    return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+}
+
+/****************************************************************************
+ ****************************************************************************/
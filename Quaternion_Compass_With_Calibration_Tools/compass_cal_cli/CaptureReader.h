@@ -0,0 +1,73 @@
+/**
+ * @file CaptureReader.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetometer capture readers for compass_cal_cli
+ *
+ * Supported sources:
+ *      - CSV files "x,y,z" one sample per line, as written by compass_cal.pde (rotateXYZ.csv, ...)
+ *      - binary files (.bin) of little-endian float32 x, y, z records
+ *      - a serial port talking the compass_cal protocol of quaternion_compass.ino (TASK 2):
+ *        the MCU prints 'S' until the link is up, then answers every 'S' with one "x,y,z" line
+ *
+ */
+
+#ifndef CAPTURE_READER_H
+#define CAPTURE_READER_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <string>
+#include <vector>
+#include "MagFit.h"
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const unsigned int DEFAULT_SERIAL_SAMPLES = 6000;    // same arrayLength of compass_cal.pde
+const float        DEFAULT_JUMP_LIMIT     = 10.0f;   // same xyzLimit of compass_cal.pde
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+struct CaptureFilter
+{
+    float jumpLimit;        // reject samples moving more than this from the previous one, 0 disables
+    bool  rejectZeros;      // reject "0,0,0" rows (sensor not ready)
+    bool  stopOnCoverage;   // serial only: stop before sampleCount once the CoverageTracker is complete
+};
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/**
+ * @name readCapture
+ * @brief readCapture: load a capture file, the format is chosen from the extension (.bin binary, CSV otherwise)
+ * @param [in] const std::string &path: capture file
+ * @param [in] const CaptureFilter &filter: sample validation
+ * @param [out] std::vector<MagSample> &samples: accepted samples
+ * @param [out] std::string &error: error message if the read failed
+ * @retval bool: true if the file was read
+ */
+bool readCapture(const std::string &path, const CaptureFilter &filter, std::vector<MagSample> &samples, std::string &error);
+
+/**
+ * @name readSerialCapture
+ * @brief readSerialCapture: capture samples from a serial port using the compass_cal protocol
+ * @param [in] const std::string &device: serial device, e.g. /dev/ttyUSB0
+ * @param [in] unsigned int sampleCount: number of samples to capture, upper bound if filter.stopOnCoverage
+ * @param [in] const CaptureFilter &filter: sample validation
+ * @param [out] std::vector<MagSample> &samples: accepted samples
+ * @param [out] std::string &error: error message if the capture failed
+ * @retval bool: true if the capture completed
+ */
+bool readSerialCapture(const std::string &device, unsigned int sampleCount, const CaptureFilter &filter,
+                       std::vector<MagSample> &samples, std::string &error);
+
+
+#endif /* CAPTURE_READER_H */
+
+/****************************************************************************
+ ****************************************************************************/
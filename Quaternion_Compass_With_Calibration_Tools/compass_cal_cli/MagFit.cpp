@@ -0,0 +1,700 @@
+/**
+ * @file MagFit.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetometer hard-iron and soft-iron fitting used by compass_cal_cli
+ *
+ * The ellipsoid is fitted as the quadric
+ *      A x^2 + B y^2 + C z^2 + 2D xy + 2E xz + 2F yz + 2G x + 2H y + 2I z = 1
+ * on samples centred and scaled to unit RMS, to keep the 9x9 normal equations well conditioned.
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "MagFit.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <functional>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const int    FIT_PARAMETERS     = 9;
+const int    JACOBI_MAX_SWEEPS  = 50;
+const double ROBUST_CONVERGENCE = 1e-5;   // relative offset change to stop reweighting
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+struct RansacWorker
+{
+    uint32_t seed;              // each worker has its own generator, no shared state while drawing
+    size_t inliers;             // consensus size of the best hypothesis of this worker
+    MagCalibrationBlob model;   // best hypothesis of this worker
+
+    RansacWorker() : seed(0), inliers(0), model() {}
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+static bool solveLinearSystem(double a[FIT_PARAMETERS][FIT_PARAMETERS], double b[FIT_PARAMETERS], double x[FIT_PARAMETERS]);
+static bool invert3x3(const double m[3][3], double inv[3][3]);
+static void jacobiEigen(const double m[3][3], double eigenValues[3], double eigenVectors[3][3]);
+static double median(std::vector<double> values);
+static void ransacWorker(const std::vector<MagSample> &samples, RansacWorker &worker,
+                         std::atomic<unsigned int> &drawn, std::atomic<size_t> &bestInliers);
+static unsigned int ransacRequiredHypotheses(size_t inliers, size_t total);
+static size_t countInliers(const std::vector<MagSample> &samples, const MagCalibrationBlob &calibration);
+static inline double sq(double value) { return value * value; }
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name fitMinMax
+ * @brief fitMinMax: hard-iron offset and diagonal soft-iron scale from axis extremes (compass_cal.pde method)
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [out] MagCalibrationBlob &result: calibration
+ * @retval bool: true if the fit succeeded
+ */
+bool fitMinMax(const std::vector<MagSample> &samples, MagCalibrationBlob &result)
+{
+    if (samples.empty())
+    {
+        return false;
+    }
+
+    float maxValues[3] = {-32768.0f, -32768.0f, -32768.0f};
+    float minValues[3] = { 32767.0f,  32767.0f,  32767.0f};
+
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        const float values[3] = {samples[i].x, samples[i].y, samples[i].z};
+        for (int j = 0; j < 3; ++j)
+        {
+            if (values[j] > maxValues[j]) maxValues[j] = values[j];
+            if (values[j] < minValues[j]) minValues[j] = values[j];
+        }
+    }
+
+    float chord[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        result.offset[j] = (maxValues[j] + minValues[j]) / 2.0f;
+        chord[j] = (maxValues[j] - minValues[j]) / 2.0f;
+        if (chord[j] <= 0.0f)
+        {
+            return false;
+        }
+    }
+    float avgChord = (chord[0] + chord[1] + chord[2]) / 3.0f;
+
+    memset(result.softIron, 0, sizeof(result.softIron));
+    for (int j = 0; j < 3; ++j)
+    {
+        result.softIron[j][j] = avgChord / chord[j];
+    }
+
+    result.method = mag_fit_method_t::MIN_MAX;
+    result.flags = 0;
+    result.fieldRadius = avgChord;
+    result.samples = samples.size();
+
+    std::vector<double> residuals;
+    result.residual = fieldNormResiduals(samples, result, residuals);
+    return true;
+}
+
+/**
+ * @name fitEllipsoid
+ * @brief fitEllipsoid: least squares ellipsoid fit, optionally weighted
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [in] const std::vector<double> *weights: per sample weight, NULL for unweighted
+ * @param [out] MagCalibrationBlob &result: calibration
+ * @retval bool: true if the fit succeeded and the quadric is an ellipsoid
+ */
+bool fitEllipsoid(const std::vector<MagSample> &samples, const std::vector<double> *weights, MagCalibrationBlob &result)
+{
+    if (samples.size() < (size_t)FIT_PARAMETERS)
+    {
+        return false;
+    }
+
+    // ----- Normalize samples: zero mean and unit RMS distance
+    double mean[3] = {0, 0, 0};
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        mean[0] += samples[i].x;
+        mean[1] += samples[i].y;
+        mean[2] += samples[i].z;
+    }
+    for (int j = 0; j < 3; ++j) mean[j] /= samples.size();
+
+    double scale = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        scale += sq(samples[i].x - mean[0]) + sq(samples[i].y - mean[1]) + sq(samples[i].z - mean[2]);
+    }
+    scale = sqrt(scale / samples.size());
+    if (scale <= 0)
+    {
+        return false;
+    }
+
+    // ----- Accumulate normal equations
+    double ata[FIT_PARAMETERS][FIT_PARAMETERS];
+    double atb[FIT_PARAMETERS];
+    memset(ata, 0, sizeof(ata));
+    memset(atb, 0, sizeof(atb));
+
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        double w = weights ? (*weights)[i] : 1.0;
+        if (w <= 0)
+        {
+            continue;
+        }
+        double x = (samples[i].x - mean[0]) / scale;
+        double y = (samples[i].y - mean[1]) / scale;
+        double z = (samples[i].z - mean[2]) / scale;
+        double d[FIT_PARAMETERS] = {x * x, y * y, z * z, 2 * x * y, 2 * x * z, 2 * y * z, 2 * x, 2 * y, 2 * z};
+
+        for (int r = 0; r < FIT_PARAMETERS; ++r)
+        {
+            for (int c = r; c < FIT_PARAMETERS; ++c)
+            {
+                ata[r][c] += w * d[r] * d[c];
+            }
+            atb[r] += w * d[r];
+        }
+    }
+    for (int r = 0; r < FIT_PARAMETERS; ++r)
+    {
+        for (int c = 0; c < r; ++c) ata[r][c] = ata[c][r];
+    }
+
+    double p[FIT_PARAMETERS];
+    if (!solveLinearSystem(ata, atb, p))
+    {
+        return false;
+    }
+
+    // ----- Centre of the ellipsoid: c = -M^-1 v
+    double m[3][3] =
+    {
+        {p[0], p[3], p[4]},
+        {p[3], p[1], p[5]},
+        {p[4], p[5], p[2]}
+    };
+    double v[3] = {p[6], p[7], p[8]};
+    double mInv[3][3];
+    if (!invert3x3(m, mInv))
+    {
+        return false;
+    }
+
+    double centre[3];
+    for (int r = 0; r < 3; ++r)
+    {
+        centre[r] = -(mInv[r][0] * v[0] + mInv[r][1] * v[1] + mInv[r][2] * v[2]);
+    }
+
+    // ----- (x - c)' M (x - c) = 1 + c' M c
+    double k = 1.0;
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c) k += centre[r] * m[r][c] * centre[c];
+    }
+    if (k <= 0)
+    {
+        return false;
+    }
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c) m[r][c] /= k * scale * scale;  // back to raw units
+    }
+
+    // ----- Soft-iron matrix is the square root of M, scaled to determinant 1
+    double eigenValues[3];
+    double eigenVectors[3][3];
+    jacobiEigen(m, eigenValues, eigenVectors);
+    if (eigenValues[0] <= 0 || eigenValues[1] <= 0 || eigenValues[2] <= 0)
+    {
+        return false;   // hyperboloid: samples do not cover enough of the sphere
+    }
+
+    double radius = pow(eigenValues[0] * eigenValues[1] * eigenValues[2], -1.0 / 6.0);
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            double value = 0;
+            for (int e = 0; e < 3; ++e)
+            {
+                value += eigenVectors[r][e] * sqrt(eigenValues[e]) * eigenVectors[c][e];
+            }
+            result.softIron[r][c] = value * radius;
+        }
+        result.offset[r] = mean[r] + centre[r] * scale;
+    }
+
+    result.method = mag_fit_method_t::ELLIPSOID;
+    result.flags = 0;
+    result.fieldRadius = radius;
+    result.samples = samples.size();
+
+    std::vector<double> residuals;
+    result.residual = fieldNormResiduals(samples, result, residuals);
+    return true;
+}
+
+/**
+ * @name fitRobust
+ * @brief fitRobust: RANSAC ellipsoid consensus, refined by Huber reweighted fits on the inliers
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [in] const RobustFitOptions &options: worker threads and seed
+ * @param [out] MagCalibrationBlob &result: calibration, samples is the number of inliers
+ * @retval bool: true if the fit succeeded
+ */
+bool fitRobust(const std::vector<MagSample> &samples, const RobustFitOptions &options, MagCalibrationBlob &result)
+{
+    if (samples.size() < (size_t)RANSAC_SUBSET_SIZE)
+    {
+        return false;
+    }
+
+    // ----- RANSAC: every worker draws hypotheses until the shared adaptive count is reached
+    unsigned int threads = options.threads ? options.threads : 1;
+    std::vector<RansacWorker> workers(threads);
+    std::atomic<unsigned int> drawn(0);
+    std::atomic<size_t> bestInliers(0);
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 0; t < threads; ++t)
+    {
+        workers[t].seed = options.seed + t;
+        pool.push_back(std::thread(ransacWorker, std::cref(samples), std::ref(workers[t]), std::ref(drawn), std::ref(bestInliers)));
+    }
+    for (size_t t = 0; t < pool.size(); ++t) pool[t].join();
+
+    const RansacWorker *best = NULL;
+    for (size_t t = 0; t < workers.size(); ++t)
+    {
+        if (workers[t].inliers > 0 && (!best || workers[t].inliers > best->inliers)) best = &workers[t];
+    }
+    if (!best)
+    {
+        return false;
+    }
+    result = best->model;
+
+    // ----- Refinement: Huber IRLS on the consensus set, outliers keep weight 0
+    std::vector<double> residuals;
+    std::vector<double> weights(samples.size());
+    std::vector<double> inlierResiduals;
+
+    for (int iteration = 0; iteration < ROBUST_FIT_MAX_ITERATIONS; ++iteration)
+    {
+        fieldNormResiduals(samples, result, residuals);
+
+        inlierResiduals.clear();
+        for (size_t i = 0; i < residuals.size(); ++i)
+        {
+            if (fabs(residuals[i]) <= RANSAC_INLIER_THRESHOLD) inlierResiduals.push_back(residuals[i]);
+        }
+        if (inlierResiduals.size() < (size_t)FIT_PARAMETERS)
+        {
+            break;
+        }
+
+        // ----- Robust sigma from the median absolute deviation of the inliers
+        double centre = median(inlierResiduals);
+        for (size_t i = 0; i < inlierResiduals.size(); ++i) inlierResiduals[i] = fabs(inlierResiduals[i] - centre);
+        double sigma = 1.4826 * median(inlierResiduals);
+        if (sigma <= 0)
+        {
+            break;
+        }
+
+        double threshold = HUBER_K * sigma;
+        for (size_t i = 0; i < residuals.size(); ++i)
+        {
+            double r = fabs(residuals[i]);
+            if (r > RANSAC_INLIER_THRESHOLD) weights[i] = 0.0;
+            else weights[i] = (r <= threshold) ? 1.0 : threshold / r;
+        }
+
+        MagCalibrationBlob next;
+        if (!fitEllipsoid(samples, &weights, next))
+        {
+            break;
+        }
+
+        double shift = sqrt(sq(next.offset[0] - result.offset[0]) +
+                            sq(next.offset[1] - result.offset[1]) +
+                            sq(next.offset[2] - result.offset[2]));
+        result = next;
+        if (shift < ROBUST_CONVERGENCE * result.fieldRadius)
+        {
+            break;
+        }
+    }
+
+    fieldNormResiduals(samples, result, residuals);
+    double sum = 0;
+    uint32_t inliers = 0;
+    for (size_t i = 0; i < residuals.size(); ++i)
+    {
+        if (fabs(residuals[i]) <= RANSAC_INLIER_THRESHOLD)
+        {
+            sum += residuals[i] * residuals[i];
+            inliers++;
+        }
+    }
+    if (inliers == 0)
+    {
+        return false;
+    }
+
+    result.method = mag_fit_method_t::ROBUST;
+    result.samples = inliers;
+    result.residual = sqrt(sum / inliers);
+    return true;
+}
+
+/**
+ * @name evaluateFit
+ * @brief evaluateFit: grade a calibration and flag it as rejected if the capture is not good enough
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [in] const MagFitLimits &limits: acceptance limits
+ * @param [in,out] MagCalibrationBlob &calibration: calibration, MAG_CALIBRATION_FLAG_REJECTED is updated
+ * @param [out] MagFitQuality &quality: quality figures
+ * @retval bool: true if the calibration is accepted
+ */
+bool evaluateFit(const std::vector<MagSample> &samples, const MagFitLimits &limits, MagCalibrationBlob &calibration,
+                 MagFitQuality &quality)
+{
+    std::vector<double> residuals;
+    fieldNormResiduals(samples, calibration, residuals);
+
+    double sum = 0;
+    double sumSquares = 0;
+    size_t inliers = 0;
+    quality.normMin = 0;
+    quality.normMax = 0;
+    for (size_t i = 0; i < residuals.size(); ++i)
+    {
+        double r = residuals[i];
+        if (fabs(r) > RANSAC_INLIER_THRESHOLD)
+        {
+            continue;
+        }
+        if (inliers == 0 || r < quality.normMin) quality.normMin = r;
+        if (inliers == 0 || r > quality.normMax) quality.normMax = r;
+        sum += r;
+        sumSquares += r * r;
+        inliers++;
+    }
+
+    quality.inlierRatio = samples.empty() ? 0.0 : (double)inliers / samples.size();
+    quality.normSpread = 0;
+    if (inliers > 1)
+    {
+        double mean = sum / inliers;
+        quality.normSpread = sqrt(std::max(0.0, sumSquares / inliers - mean * mean));
+    }
+
+    double softIron[3][3];
+    double eigenValues[3];
+    double eigenVectors[3][3];
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c) softIron[r][c] = calibration.softIron[r][c];
+    }
+    jacobiEigen(softIron, eigenValues, eigenVectors);
+    double smallest = std::min(eigenValues[0], std::min(eigenValues[1], eigenValues[2]));
+    double largest = std::max(eigenValues[0], std::max(eigenValues[1], eigenValues[2]));
+    quality.anisotropy = smallest > 0 ? largest / smallest : HUGE_VAL;
+
+    bool accepted = inliers > 0 &&
+                    quality.inlierRatio >= limits.minInlierRatio &&
+                    quality.normSpread <= limits.maxNormSpread &&
+                    quality.anisotropy <= limits.maxAnisotropy;
+    if (accepted) calibration.flags &= ~MAG_CALIBRATION_FLAG_REJECTED;
+    else calibration.flags |= MAG_CALIBRATION_FLAG_REJECTED;
+    return accepted;
+}
+
+/**
+ * @name fieldNormResiduals
+ * @brief fieldNormResiduals: relative residual (|calibrated| - radius) / radius of every sample
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [in] const MagCalibrationBlob &calibration: calibration to evaluate
+ * @param [out] std::vector<double> &residuals: one residual per sample
+ * @retval double: RMS of the residuals
+ */
+double fieldNormResiduals(const std::vector<MagSample> &samples, const MagCalibrationBlob &calibration, std::vector<double> &residuals)
+{
+    residuals.resize(samples.size());
+    if (samples.empty() || calibration.fieldRadius <= 0)
+    {
+        return 0;
+    }
+
+    double sum = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        double raw[3] =
+        {
+            samples[i].x - calibration.offset[0],
+            samples[i].y - calibration.offset[1],
+            samples[i].z - calibration.offset[2]
+        };
+        double norm = 0;
+        for (int r = 0; r < 3; ++r)
+        {
+            double value = calibration.softIron[r][0] * raw[0] + calibration.softIron[r][1] * raw[1] + calibration.softIron[r][2] * raw[2];
+            norm += value * value;
+        }
+        residuals[i] = (sqrt(norm) - calibration.fieldRadius) / calibration.fieldRadius;
+        sum += residuals[i] * residuals[i];
+    }
+    return sqrt(sum / samples.size());
+}
+
+/**
+ * @name fitMethodName
+ * @brief fitMethodName: printable name of a fit method
+ * @param [in] mag_fit_method_t method: fit method
+ * @retval const char* name
+ */
+const char *fitMethodName(mag_fit_method_t method)
+{
+    switch (method)
+    {
+        case mag_fit_method_t::MIN_MAX:
+            return "minmax";
+        case mag_fit_method_t::ELLIPSOID:
+            return "ellipsoid";
+        case mag_fit_method_t::ROBUST:
+            return "robust";
+        default:
+            return "unknown";
+    }
+}
+
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name solveLinearSystem
+ * @brief solveLinearSystem: Gaussian elimination with partial pivoting, a and b are destroyed
+ */
+static bool solveLinearSystem(double a[FIT_PARAMETERS][FIT_PARAMETERS], double b[FIT_PARAMETERS], double x[FIT_PARAMETERS])
+{
+    for (int col = 0; col < FIT_PARAMETERS; ++col)
+    {
+        int pivot = col;
+        for (int r = col + 1; r < FIT_PARAMETERS; ++r)
+        {
+            if (fabs(a[r][col]) > fabs(a[pivot][col])) pivot = r;
+        }
+        if (fabs(a[pivot][col]) < 1e-12)
+        {
+            return false;
+        }
+        if (pivot != col)
+        {
+            for (int c = 0; c < FIT_PARAMETERS; ++c) std::swap(a[col][c], a[pivot][c]);
+            std::swap(b[col], b[pivot]);
+        }
+        for (int r = col + 1; r < FIT_PARAMETERS; ++r)
+        {
+            double factor = a[r][col] / a[col][col];
+            for (int c = col; c < FIT_PARAMETERS; ++c) a[r][c] -= factor * a[col][c];
+            b[r] -= factor * b[col];
+        }
+    }
+    for (int r = FIT_PARAMETERS - 1; r >= 0; --r)
+    {
+        double value = b[r];
+        for (int c = r + 1; c < FIT_PARAMETERS; ++c) value -= a[r][c] * x[c];
+        x[r] = value / a[r][r];
+    }
+    return true;
+}
+
+static bool invert3x3(const double m[3][3], double inv[3][3])
+{
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+               - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+               + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    if (fabs(det) < 1e-300)
+    {
+        return false;
+    }
+    inv[0][0] =  (m[1][1] * m[2][2] - m[1][2] * m[2][1]) / det;
+    inv[0][1] = -(m[0][1] * m[2][2] - m[0][2] * m[2][1]) / det;
+    inv[0][2] =  (m[0][1] * m[1][2] - m[0][2] * m[1][1]) / det;
+    inv[1][0] = -(m[1][0] * m[2][2] - m[1][2] * m[2][0]) / det;
+    inv[1][1] =  (m[0][0] * m[2][2] - m[0][2] * m[2][0]) / det;
+    inv[1][2] = -(m[0][0] * m[1][2] - m[0][2] * m[1][0]) / det;
+    inv[2][0] =  (m[1][0] * m[2][1] - m[1][1] * m[2][0]) / det;
+    inv[2][1] = -(m[0][0] * m[2][1] - m[0][1] * m[2][0]) / det;
+    inv[2][2] =  (m[0][0] * m[1][1] - m[0][1] * m[1][0]) / det;
+    return true;
+}
+
+/**
+ * @name jacobiEigen
+ * @brief jacobiEigen: eigen decomposition of a symmetric 3x3 matrix, eigenvectors are the columns
+ */
+static void jacobiEigen(const double m[3][3], double eigenValues[3], double eigenVectors[3][3])
+{
+    double a[3][3];
+    memcpy(a, m, sizeof(a));
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c) eigenVectors[r][c] = (r == c) ? 1.0 : 0.0;
+    }
+
+    for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; ++sweep)
+    {
+        double offDiagonal = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+        if (offDiagonal < 1e-30)
+        {
+            break;
+        }
+        for (int p = 0; p < 2; ++p)
+        {
+            for (int q = p + 1; q < 3; ++q)
+            {
+                if (a[p][q] == 0.0)
+                {
+                    continue;
+                }
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    double akp = a[k][p];
+                    double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; ++k)
+                {
+                    double apk = a[p][k];
+                    double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; ++k)
+                {
+                    double vkp = eigenVectors[k][p];
+                    double vkq = eigenVectors[k][q];
+                    eigenVectors[k][p] = c * vkp - s * vkq;
+                    eigenVectors[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for (int e = 0; e < 3; ++e) eigenValues[e] = a[e][e];
+}
+
+static double median(std::vector<double> values)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    return values[middle];
+}
+
+/**
+ * @name ransacWorker
+ * @brief ransacWorker: draw random subsets, fit them and keep the one with the largest consensus
+ */
+static void ransacWorker(const std::vector<MagSample> &samples, RansacWorker &worker,
+                         std::atomic<unsigned int> &drawn, std::atomic<size_t> &bestInliers)
+{
+    std::mt19937 generator(worker.seed);
+    std::uniform_int_distribution<size_t> pick(0, samples.size() - 1);
+    std::vector<MagSample> subset(RANSAC_SUBSET_SIZE);
+
+    while (drawn++ < ransacRequiredHypotheses(bestInliers.load(), samples.size()))
+    {
+        for (unsigned int i = 0; i < RANSAC_SUBSET_SIZE; ++i) subset[i] = samples[pick(generator)];
+
+        MagCalibrationBlob hypothesis;
+        if (!fitEllipsoid(subset, NULL, hypothesis))
+        {
+            continue;   // degenerate subset or hyperboloid
+        }
+
+        size_t inliers = countInliers(samples, hypothesis);
+        if (inliers > worker.inliers)
+        {
+            worker.inliers = inliers;
+            worker.model = hypothesis;
+
+            size_t best = bestInliers.load();
+            while (inliers > best && !bestInliers.compare_exchange_weak(best, inliers)) {}
+        }
+    }
+}
+
+/**
+ * @name ransacRequiredHypotheses
+ * @brief ransacRequiredHypotheses: hypotheses needed to hit an outlier-free subset with RANSAC_CONFIDENCE
+ */
+static unsigned int ransacRequiredHypotheses(size_t inliers, size_t total)
+{
+    if (inliers == 0 || total == 0)
+    {
+        return RANSAC_MAX_HYPOTHESES;
+    }
+    double clean = pow((double)inliers / total, (double)RANSAC_SUBSET_SIZE);
+    if (clean >= 1.0)
+    {
+        return 1;
+    }
+    double required = log(1.0 - RANSAC_CONFIDENCE) / log(1.0 - clean);
+    return required < RANSAC_MAX_HYPOTHESES ? (unsigned int)ceil(required) : RANSAC_MAX_HYPOTHESES;
+}
+
+static size_t countInliers(const std::vector<MagSample> &samples, const MagCalibrationBlob &calibration)
+{
+    const float (*m)[3] = calibration.softIron;
+    double low = sq(calibration.fieldRadius * (1.0 - RANSAC_INLIER_THRESHOLD));
+    double high = sq(calibration.fieldRadius * (1.0 + RANSAC_INLIER_THRESHOLD));
+
+    size_t inliers = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        double x = samples[i].x - calibration.offset[0];
+        double y = samples[i].y - calibration.offset[1];
+        double z = samples[i].z - calibration.offset[2];
+        double norm = sq(m[0][0] * x + m[0][1] * y + m[0][2] * z) +
+                      sq(m[1][0] * x + m[1][1] * y + m[1][2] * z) +
+                      sq(m[2][0] * x + m[2][1] * y + m[2][2] * z);
+        if (norm >= low && norm <= high) inliers++;
+    }
+    return inliers;
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,146 @@
+/**
+ * @file MagFit.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetometer hard-iron and soft-iron fitting used by compass_cal_cli
+ *
+ * Three fits are available:
+ *      - min/max: the same circle-method of compass_cal.pde (offset and diagonal scale)
+ *      - ellipsoid: least squares fit of a general ellipsoid, gives offset and full soft-iron matrix
+ *      - robust: RANSAC consensus of ellipsoids fitted on random subsets, then refined by an ellipsoid
+ *        fit iteratively reweighted with Huber weights on the consensus set; glitches such as the
+ *        "585.3,0.0,0.0" rows of rotateXYZ.csv are outliers and do not move it
+ *
+ * Every fit can be graded with evaluateFit(): the inlier ratio and the spread of the calibrated
+ * field norm tell a good capture from a bad one, bad ones get MAG_CALIBRATION_FLAG_REJECTED.
+ *
+ * Every fit returns the calibration as softIron * (raw - offset), the soft-iron matrix keeps
+ * the average field norm (determinant 1) so the calibrated values stay in the raw unit.
+ *
+ */
+
+#ifndef MAG_FIT_H
+#define MAG_FIT_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <vector>
+#include <MagCalibrationBlob.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const int    ROBUST_FIT_MAX_ITERATIONS = 20;
+const double HUBER_K                   = 1.345;   // Huber threshold in units of robust sigma
+
+const unsigned int RANSAC_MAX_HYPOTHESES = 4000;  // upper bound, the adaptive count usually stops far earlier
+const unsigned int RANSAC_SUBSET_SIZE    = 12;    // 9 is the minimum, a few more avoid degenerate exact fits
+const double RANSAC_CONFIDENCE           = 0.999; // probability of drawing at least one outlier-free subset
+const double RANSAC_INLIER_THRESHOLD     = 0.05;  // |field norm residual| of an inlier, relative to the radius
+
+const double DEFAULT_MIN_INLIER_RATIO    = 0.90;  // below this the capture is rejected
+const double DEFAULT_MAX_NORM_SPREAD     = 0.03;  // std of the inlier field norm residual above this is rejected
+const double DEFAULT_MAX_ANISOTROPY      = 1.5;   // largest over smallest soft-iron eigenvalue; partial captures
+                                                  // (a single rotation plane) fit a flattened ellipsoid
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+struct MagSample
+{
+    float x;
+    float y;
+    float z;
+};
+
+struct RobustFitOptions
+{
+    unsigned int threads;   // worker threads drawing RANSAC hypotheses, at least 1
+    uint32_t     seed;      // base seed, thread i uses seed + i
+};
+
+struct MagFitLimits
+{
+    double minInlierRatio;
+    double maxNormSpread;
+    double maxAnisotropy;
+};
+
+struct MagFitQuality
+{
+    double inlierRatio;     // samples within RANSAC_INLIER_THRESHOLD over all samples
+    double normSpread;      // standard deviation of the inlier field norm residuals
+    double normMin;         // smallest inlier field norm residual
+    double normMax;         // largest inlier field norm residual
+    double anisotropy;      // largest over smallest eigenvalue of the soft-iron matrix
+};
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/**
+ * @name fitMinMax
+ * @brief fitMinMax: hard-iron offset and diagonal soft-iron scale from axis extremes (compass_cal.pde method)
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [out] MagCalibrationBlob &result: calibration
+ * @retval bool: true if the fit succeeded
+ */
+bool fitMinMax(const std::vector<MagSample> &samples, MagCalibrationBlob &result);
+
+/**
+ * @name fitEllipsoid
+ * @brief fitEllipsoid: least squares ellipsoid fit, optionally weighted
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [in] const std::vector<double> *weights: per sample weight, NULL for unweighted
+ * @param [out] MagCalibrationBlob &result: calibration
+ * @retval bool: true if the fit succeeded and the quadric is an ellipsoid
+ */
+bool fitEllipsoid(const std::vector<MagSample> &samples, const std::vector<double> *weights, MagCalibrationBlob &result);
+
+/**
+ * @name fitRobust
+ * @brief fitRobust: RANSAC ellipsoid consensus, refined by Huber reweighted fits on the inliers
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [in] const RobustFitOptions &options: worker threads and seed
+ * @param [out] MagCalibrationBlob &result: calibration, samples is the number of inliers
+ * @retval bool: true if the fit succeeded
+ */
+bool fitRobust(const std::vector<MagSample> &samples, const RobustFitOptions &options, MagCalibrationBlob &result);
+
+/**
+ * @name evaluateFit
+ * @brief evaluateFit: grade a calibration and flag it as rejected if the capture is not good enough
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [in] const MagFitLimits &limits: acceptance limits
+ * @param [in,out] MagCalibrationBlob &calibration: calibration, MAG_CALIBRATION_FLAG_REJECTED is updated
+ * @param [out] MagFitQuality &quality: quality figures
+ * @retval bool: true if the calibration is accepted
+ */
+bool evaluateFit(const std::vector<MagSample> &samples, const MagFitLimits &limits, MagCalibrationBlob &calibration,
+                 MagFitQuality &quality);
+
+/**
+ * @name fieldNormResiduals
+ * @brief fieldNormResiduals: relative residual (|calibrated| - radius) / radius of every sample
+ * @param [in] const std::vector<MagSample> &samples: raw samples
+ * @param [in] const MagCalibrationBlob &calibration: calibration to evaluate
+ * @param [out] std::vector<double> &residuals: one residual per sample
+ * @retval double: RMS of the residuals
+ */
+double fieldNormResiduals(const std::vector<MagSample> &samples, const MagCalibrationBlob &calibration, std::vector<double> &residuals);
+
+/**
+ * @name fitMethodName
+ * @brief fitMethodName: printable name of a fit method
+ * @param [in] mag_fit_method_t method: fit method
+ * @retval const char* name
+ */
+const char *fitMethodName(mag_fit_method_t method);
+
+
+#endif /* MAG_FIT_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,423 @@
+/**
+ * @file compass_cal_cli.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Headless magnetometer calibration, replacement of the Processing sketch compass_cal.pde
+ *
+ * Every capture given on the command line is a dataset (one unit): the datasets are fitted in
+ * parallel, one worker thread per core, and for each one the tool writes
+ *      <out-dir>/<name>.magcal                 binary MagCalibrationBlob
+ *      <out-dir>/<name>_mag_calibration.h      header to include in the sketch instead of copy&paste
+ * The name is the file name of the capture; captures with the same file name in different directories, e.g.
+ * unitA/capture.csv and unitB/capture.csv, are named after their directory too (unitA_capture, unitB_capture),
+ * the tool refuses to run if the names still clash. The output directory is created if missing.
+ *
+ * Every fit is graded by inlier ratio, field norm spread and soft-iron anisotropy: a capture failing the limits is
+ * written to the .magcal with MAG_CALIBRATION_FLAG_REJECTED, no header is generated for it and
+ * the exit code is non-zero, so a bad calibration cannot silently reach a boat.
+ * Cores left free by the datasets are given to the RANSAC workers of the robust fit.
+ *
+ * Usage:
+ *      compass_cal_cli [options] <capture.csv|capture.bin>...
+ *      compass_cal_cli [options] --serial /dev/ttyUSB0
+ *
+ * Options:
+ *      -m, --method minmax|ellipsoid|robust    fit method (default robust)
+ *      -o, --out-dir DIR                       output directory (default .)
+ *      -j, --jobs N                            worker threads (default: number of cores)
+ *      -n, --name NAME                         unit name, only with a single dataset
+ *      --serial DEVICE                         capture from the MCU running quaternion_compass.ino TASK 2
+ *      --samples N                             most samples to capture from serial (default 6000)
+ *      --full                                  serial: always capture N samples, do not stop at full coverage
+ *      --jump-limit X                          drop samples jumping more than X counts (default 0 files, 10 serial)
+ *      --min-inliers R                         smallest accepted inlier ratio (default 0.90)
+ *      --max-spread S                          largest accepted field norm spread, relative (default 0.03)
+ *      --max-anisotropy A                      largest accepted soft-iron eigenvalue ratio (default 1.5)
+ *      --seed N                                RANSAC seed (default 1)
+ *
+ * Build (host):
+ *      g++ -std=c++11 -O2 -pthread -I../../libraries/CompassCore *.cpp \
+ *          ../../libraries/CompassCore/MagCalibrationBlob.cpp ../../libraries/CompassCore/CoverageTracker.cpp -o compass_cal_cli
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <errno.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+#include "MagFit.h"
+#include "CaptureReader.h"
+#include "CalibrationWriter.h"
+#include <CoverageTracker.h>
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+struct Options
+{
+    mag_fit_method_t method;
+    std::string outDir;
+    unsigned int jobs;
+    std::string name;
+    std::string serialDevice;
+    unsigned int serialSamples;
+    bool fullCapture;
+    float jumpLimit;        // < 0 means default of the source
+    MagFitLimits limits;
+    RobustFitOptions robust;
+};
+
+struct Dataset
+{
+    std::string source;     // file path or serial device
+    bool serial;
+    std::string name;
+
+    // ----- results
+    bool ok;
+    bool rejected;          // fitted, but the quality checks failed
+    std::string error;
+    MagCalibrationBlob calibration;
+    MagFitQuality quality;
+    float coverage;         // fraction of the icosphere faces hit by the capture
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+static void printUsage();
+static bool parseOptions(int argc, char **argv, Options &options, std::vector<Dataset> &datasets);
+static void processDataset(const Options &options, Dataset &dataset);
+static std::string baseName(const std::string &path);
+static std::string parentName(const std::string &path);
+static bool uniqueNames(std::vector<Dataset> &datasets);
+static bool makeDirectory(const std::string &path);
+
+/*******************
+ * MAIN
+*******************/
+int main(int argc, char **argv)
+{
+    Options options;
+    std::vector<Dataset> datasets;
+    if (!parseOptions(argc, argv, options, datasets))
+    {
+        printUsage();
+        return 2;
+    }
+    if (!makeDirectory(options.outDir))
+    {
+        fprintf(stderr, "cannot create the output directory %s: %s\n", options.outDir.c_str(), strerror(errno));
+        return 2;
+    }
+
+    // ----- Fit every dataset, workers take the next dataset until none is left
+    unsigned int workers = options.jobs;
+    if (workers == 0) workers = std::thread::hardware_concurrency();
+    if (workers == 0) workers = 1;
+    if (workers > datasets.size()) workers = datasets.size();
+    unsigned int cores = options.jobs ? options.jobs : std::thread::hardware_concurrency();
+    options.robust.threads = (cores > workers) ? cores / workers : 1;
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < workers; ++i)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            size_t index;
+            while ((index = next++) < datasets.size())
+            {
+                processDataset(options, datasets[index]);
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+    // ----- Summary, in command line order
+    int failures = 0;
+    printf("%-24s %-10s %8s %10s %10s %10s %10s %8s %8s %6s %6s\n", "unit", "method", "samples", "offset_x", "offset_y",
+           "offset_z", "residual", "inliers", "spread", "aniso", "cover");
+    for (size_t i = 0; i < datasets.size(); ++i)
+    {
+        const Dataset &d = datasets[i];
+        if (!d.ok && !d.rejected)
+        {
+            printf("%-24s FAILED: %s\n", d.name.c_str(), d.error.c_str());
+            failures++;
+            continue;
+        }
+        printf("%-24s %-10s %8u %10.3f %10.3f %10.3f %9.3f%% %7.2f%% %7.3f%% %6.3f %5.0f%%%s\n", d.name.c_str(),
+               fitMethodName(d.calibration.method), (unsigned int)d.calibration.samples, d.calibration.offset[0],
+               d.calibration.offset[1], d.calibration.offset[2], d.calibration.residual * 100.0f,
+               d.quality.inlierRatio * 100.0, d.quality.normSpread * 100.0, d.quality.anisotropy,
+               d.coverage * 100.0f, d.rejected ? "  REJECTED" : "");
+        if (!d.ok) failures++;
+    }
+
+    return failures ? 1 : 0;
+}
+
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+static void printUsage()
+{
+    fprintf(stderr,
+            "usage: compass_cal_cli [options] <capture.csv|capture.bin>...\n"
+            "       compass_cal_cli [options] --serial /dev/ttyUSB0\n"
+            "  -m, --method minmax|ellipsoid|robust  fit method (default robust)\n"
+            "  -o, --out-dir DIR                     output directory (default .)\n"
+            "  -j, --jobs N                          worker threads (default: number of cores)\n"
+            "  -n, --name NAME                       unit name, only with a single dataset\n"
+            "  --serial DEVICE                       capture from the MCU (quaternion_compass.ino TASK 2)\n"
+            "  --samples N                           most samples to capture from serial (default %u)\n"
+            "  --full                                serial: do not stop at full coverage\n"
+            "  --jump-limit X                        drop samples jumping more than X counts\n"
+            "  --min-inliers R                       smallest accepted inlier ratio (default %.2f)\n"
+            "  --max-spread S                        largest accepted field norm spread (default %.2f)\n"
+            "  --max-anisotropy A                    largest accepted soft-iron eigenvalue ratio (default %.1f)\n"
+            "  --seed N                              RANSAC seed (default 1)\n",
+            DEFAULT_SERIAL_SAMPLES, DEFAULT_MIN_INLIER_RATIO, DEFAULT_MAX_NORM_SPREAD, DEFAULT_MAX_ANISOTROPY);
+}
+
+static bool parseOptions(int argc, char **argv, Options &options, std::vector<Dataset> &datasets)
+{
+    options.method = mag_fit_method_t::ROBUST;
+    options.outDir = ".";
+    options.jobs = 0;
+    options.serialSamples = DEFAULT_SERIAL_SAMPLES;
+    options.fullCapture = false;
+    options.jumpLimit = -1.0f;
+    options.limits.minInlierRatio = DEFAULT_MIN_INLIER_RATIO;
+    options.limits.maxNormSpread = DEFAULT_MAX_NORM_SPREAD;
+    options.limits.maxAnisotropy = DEFAULT_MAX_ANISOTROPY;
+    options.robust.threads = 1;
+    options.robust.seed = 1;
+
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if ((arg == "-m" || arg == "--method") && hasValue)
+        {
+            std::string method = argv[++i];
+            if (method == "minmax") options.method = mag_fit_method_t::MIN_MAX;
+            else if (method == "ellipsoid") options.method = mag_fit_method_t::ELLIPSOID;
+            else if (method == "robust") options.method = mag_fit_method_t::ROBUST;
+            else return false;
+        }
+        else if ((arg == "-o" || arg == "--out-dir") && hasValue) options.outDir = argv[++i];
+        else if ((arg == "-j" || arg == "--jobs") && hasValue) options.jobs = atoi(argv[++i]);
+        else if ((arg == "-n" || arg == "--name") && hasValue) options.name = argv[++i];
+        else if (arg == "--serial" && hasValue) options.serialDevice = argv[++i];
+        else if (arg == "--samples" && hasValue) options.serialSamples = atoi(argv[++i]);
+        else if (arg == "--full") options.fullCapture = true;
+        else if (arg == "--jump-limit" && hasValue) options.jumpLimit = atof(argv[++i]);
+        else if (arg == "--min-inliers" && hasValue) options.limits.minInlierRatio = atof(argv[++i]);
+        else if (arg == "--max-spread" && hasValue) options.limits.maxNormSpread = atof(argv[++i]);
+        else if (arg == "--max-anisotropy" && hasValue) options.limits.maxAnisotropy = atof(argv[++i]);
+        else if (arg == "--seed" && hasValue) options.robust.seed = strtoul(argv[++i], NULL, 0);
+        else if (arg == "-h" || arg == "--help") return false;
+        else if (!arg.empty() && arg[0] == '-') return false;
+        else files.push_back(arg);
+    }
+
+    if (!options.serialDevice.empty())
+    {
+        Dataset dataset;
+        dataset.source = options.serialDevice;
+        dataset.serial = true;
+        dataset.name = baseName(options.serialDevice);
+        datasets.push_back(dataset);
+    }
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        Dataset dataset;
+        dataset.source = files[i];
+        dataset.serial = false;
+        dataset.name = baseName(files[i]);
+        datasets.push_back(dataset);
+    }
+
+    if (datasets.empty())
+    {
+        return false;
+    }
+    if (!uniqueNames(datasets))
+    {
+        return false;
+    }
+    if (!options.name.empty())
+    {
+        if (datasets.size() != 1)
+        {
+            fprintf(stderr, "--name needs a single dataset\n");
+            return false;
+        }
+        datasets[0].name = options.name;
+    }
+    return true;
+}
+
+static void processDataset(const Options &options, Dataset &dataset)
+{
+    dataset.ok = false;
+    dataset.rejected = false;
+    dataset.coverage = 0.0f;
+
+    CaptureFilter filter;
+    filter.rejectZeros = true;
+    filter.stopOnCoverage = !options.fullCapture;
+    filter.jumpLimit = options.jumpLimit >= 0 ? options.jumpLimit : (dataset.serial ? DEFAULT_JUMP_LIMIT : 0.0f);
+
+    std::vector<MagSample> samples;
+    bool read = dataset.serial
+                ? readSerialCapture(dataset.source, options.serialSamples, filter, samples, dataset.error)
+                : readCapture(dataset.source, filter, samples, dataset.error);
+    if (!read)
+    {
+        return;
+    }
+
+    bool fitted = false;
+    switch (options.method)
+    {
+        case mag_fit_method_t::MIN_MAX:
+            fitted = fitMinMax(samples, dataset.calibration);
+            break;
+        case mag_fit_method_t::ELLIPSOID:
+            fitted = fitEllipsoid(samples, NULL, dataset.calibration);
+            break;
+        case mag_fit_method_t::ROBUST:
+            fitted = fitRobust(samples, options.robust, dataset.calibration);
+            break;
+    }
+    if (!fitted)
+    {
+        dataset.error = "fit failed, the capture does not cover the sphere";
+        return;
+    }
+
+    // ----- Coverage of the capture around the fitted offset
+    CoverageTracker coverage;
+    coverage.setCentre(dataset.calibration.offset);
+    for (size_t i = 0; i < samples.size(); ++i) coverage.addSample(samples[i].x, samples[i].y, samples[i].z);
+    dataset.coverage = coverage.coverage();
+
+    bool accepted = evaluateFit(samples, options.limits, dataset.calibration, dataset.quality);
+
+    // ----- Rejected captures only get the flagged blob, for inspection
+    std::string prefix = options.outDir + "/" + dataset.name;
+    if (!writeCalibrationBlob(prefix + ".magcal", dataset.calibration) ||
+        (accepted && !writeCalibrationHeader(prefix + "_mag_calibration.h", dataset.name, dataset.source, dataset.calibration)))
+    {
+        dataset.error = "cannot write output in " + options.outDir;
+        return;
+    }
+    if (!accepted)
+    {
+        remove((prefix + "_mag_calibration.h").c_str());  // never leave the header of a previous run behind
+    }
+    dataset.rejected = !accepted;
+    dataset.ok = accepted;
+}
+
+static std::string baseName(const std::string &path)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static std::string parentName(const std::string &path)
+{
+    size_t end = path.find_last_of("/\\");
+    while (end != std::string::npos && end > 0 && (path[end - 1] == '/' || path[end - 1] == '\\')) --end;
+    if (end == std::string::npos || end == 0)
+    {
+        return "";
+    }
+    std::string directory = path.substr(0, end);
+    return directory.substr(directory.find_last_of("/\\") + 1);
+}
+
+/*
+Two datasets with the same name would write the same files from two workers, one unit lost without a word:
+the clashing ones are named after their directory as well, and if they still clash the tool does not run.
+*/
+static bool uniqueNames(std::vector<Dataset> &datasets)
+{
+    for (size_t i = 0; i < datasets.size(); ++i)
+    {
+        bool clash = false;
+        for (size_t j = 0; j < datasets.size(); ++j)
+        {
+            if (j != i && baseName(datasets[j].source) == baseName(datasets[i].source)) clash = true;
+        }
+        std::string parent = parentName(datasets[i].source);
+        if (clash && !datasets[i].serial && !parent.empty() && parent != "." && parent != "..")
+        {
+            datasets[i].name = parent + "_" + datasets[i].name;
+        }
+    }
+    for (size_t i = 0; i < datasets.size(); ++i)
+    {
+        for (size_t j = i + 1; j < datasets.size(); ++j)
+        {
+            if (datasets[i].name == datasets[j].name)
+            {
+                fprintf(stderr, "%s and %s would both be written as %s, rename one of them\n",
+                        datasets[i].source.c_str(), datasets[j].source.c_str(), datasets[i].name.c_str());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// mkdir -p
+static bool makeDirectory(const std::string &path)
+{
+    for (size_t end = 1; end <= path.size(); ++end)
+    {
+        if (end != path.size() && path[end] != '/' && path[end] != '\\')
+        {
+            continue;
+        }
+        std::string part = path.substr(0, end);
+        struct stat info;
+        if (stat(part.c_str(), &info) == 0)
+        {
+            if (!(info.st_mode & S_IFDIR))
+            {
+                errno = ENOTDIR;
+                return false;
+            }
+            continue;
+        }
+#if defined(_WIN32)
+        if (_mkdir(part.c_str()) != 0 && errno != EEXIST) return false;
+#else
+        if (mkdir(part.c_str(), 0777) != 0 && errno != EEXIST) return false;
+#endif
+    }
+    return true;
+}
+
+/****************************************************************************
+ ****************************************************************************/
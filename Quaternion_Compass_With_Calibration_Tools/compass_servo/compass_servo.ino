@@ -1,5 +1,22 @@
+/**
+ * Compass swing on a turntable
+ *
+ * The compass board sits on a turntable driven by the feedback servo: the sketch turns it one full turn
+ * forward and one back in RIG_STEP_DEG steps, and at each stop records the heading error (compass heading
+ * minus the angle of the table) once the servo and the filter have settled. The errors are fitted with the
+ * five coefficient deviation curve, printed and saved in SPIFFS (/deviation.txt), where JackSparrowsCompass
+ * loads it at start and corrects its heading with it.
+ *
+ * The magnetometer calibration is the one of JackSparrowsCompass, compass_mag_calibration.h of CompassCore:
+ * the curve is what is left after it. With RIG_ALIGNED the table zero is aimed at RIG_ZERO_HEADING and the fit keeps the constant
+ * term A (misalignment of the board); otherwise the first stop is taken as true and A is dropped.
+ */
 #include "MPU9250.h"
 #include <FeedbackServo.h>
+#include <FS.h>
+#include <HeadingSmoother.h>
+#include <BinaryAngle.h>
+#include <DeviationCurve.h>
 
 #define FEEDBACK_PIN 12 // NodeMCU D6
 #define SERVO_PIN 14 //NodeMCU D5
@@ -16,25 +33,57 @@ MPU9250 mpu;
 // const float Mag_y_scale = 0.97450244;
 // const float Mag_z_scale = 1.0081002;
 
-const float
-Mag_x_offset = 296.175,
-Mag_y_offset = 7.029999,
-Mag_z_offset = -428.03,
-Mag_x_scale = 1.0535749,
-Mag_y_scale = 1.0375158,
-Mag_z_scale = 0.919955;
+// const float
+// Mag_x_offset = 296.175,
+// Mag_y_offset = 7.029999,
+// Mag_z_offset = -428.03,
+// Mag_x_scale = 1.0535749,
+// Mag_y_scale = 1.0375158,
+// Mag_z_scale = 0.919955;
 
+// same calibration as JackSparrowsCompass
+#include <compass_mag_calibration.h>
+
+
+// Swing
+const float RIG_STEP_DEG            = 5.0;      // between two stops
+const int   RIG_STOPS               = 72;       // stops in a turn, 360 / RIG_STEP_DEG
+const unsigned long RIG_PID_MS      = 20;       // period of the servo PID
+const unsigned long RIG_SETTLE_MS   = 2000;     // after the move, servo still and filter converged
+const unsigned long RIG_SAMPLE_MS   = 1000;     // headings averaged at a stop
+const bool  RIG_ALIGNED             = false;    // table zero aimed at RIG_ZERO_HEADING
+const float RIG_ZERO_HEADING        = 0.0;      // deg, magnetic heading of the table zero when aligned
+
+enum class rig_state_t
+{
+    SETTLE,         // servo going to the stop
+    SAMPLE,         // averaging the headings
+    DONE            // curve fitted, corrected heading printed
+};
+
+rig_state_t state = rig_state_t::SETTLE;
+DeviationCurve deviation;
+HeadingSmoother headingSmoother(HEADING_SMOOTHER_MAX_WINDOW);
+
+int stop = 0;                   // 0 to 2 RIG_STOPS, a turn forward and one back
+float startAngle = 0;           // servo deg, table zero
+float lastAngle = 0;            // servo deg, last feedback
+float turned = 0;               // deg, table turned from the zero, counted through the turns
+float trueStart = 0;            // deg, true heading at the table zero
+float direction = 1;            // +1 if the heading grows with the servo angle
+unsigned long phaseStartMs = 0;
+unsigned long lastPidMs = 0;
 
 int32_t timestamp = 0;
 
-const int delta = 10;
-int angle = 0;
+bool save_deviation(const DeviationCurve &curve);
+
 void setup()
 {
     Serial.begin(115200);
     Wire.begin();
 	// Wire.setClock(400000);
-    
+
     delay(500);
 
     servo = new FeedbackServo(FEEDBACK_PIN, 2.0, 0.1, 0.0, 0.0, -200, 200, 20.0);
@@ -71,23 +120,135 @@ void setup()
     else
     {
         Serial.println("ERROR ON COMPASS SETUP");
+        while(true) delay(1000);
     }
 
-
-
+    startAngle = servo->Angle();
+    lastAngle = startAngle;
+    phaseStartMs = millis();
+    Serial.println("Swing started, keep metal away from the table");
 }
 
 void loop()
 {
-    int heading;
+    unsigned long now = millis();
+
     if(mpu.update(micros()-timestamp))
     {
-        heading = (int) mpu.getHeading();
-        Serial.println("Angle: " + String(heading));
+        headingSmoother.update(mpu.getHeading());
     }
-    // servo->rotate_PID(angle, 0);
-    angle += delta;
-    delay(100);
     timestamp = micros(); // is for integration handling on quaternion compensation compass
 
-}
\ No newline at end of file
+    // ----- Table: the feedback moves much less than half a turn between two loops
+    float angle = servo->Angle();
+    turned += Bam16::fromDegrees(angle - lastAngle).toSignedDegrees();
+    lastAngle = angle;
+
+    if(now - lastPidMs >= RIG_PID_MS)
+    {
+        lastPidMs = now;
+        int k = (stop <= RIG_STOPS) ? stop : 2 * RIG_STOPS - stop;
+        servo->rotate_PID(Bam16::fromDegrees(startAngle + k * RIG_STEP_DEG).toDegrees(), 0);
+    }
+
+    if(state == rig_state_t::SETTLE)
+    {
+        if(now - phaseStartMs >= RIG_SETTLE_MS)
+        {
+            headingSmoother.reset();
+            state = rig_state_t::SAMPLE;
+            phaseStartMs = now;
+        }
+    }
+    else if(state == rig_state_t::SAMPLE)
+    {
+        if(now - phaseStartMs >= RIG_SAMPLE_MS)
+        {
+            float heading = headingSmoother.getHeading();
+            if(stop == 0)
+            {
+                trueStart = RIG_ALIGNED ? RIG_ZERO_HEADING : heading;
+            }
+            else if(stop == 1)
+            {
+                // the heading follows the table one way or the other, depending on how the board is mounted
+                float moved = Bam16::fromDegrees(heading - trueStart).toSignedDegrees();
+                direction = (moved * turned >= 0) ? 1 : -1;
+            }
+            if(stop > 0 or RIG_ALIGNED)
+            {
+                float trueHeading = trueStart + direction * turned;
+                deviation.addSample(heading, heading - trueHeading);
+                Serial.println("Stop: " + String(stop) + " heading " + String(heading, 2) + " true " + String(Bam16::fromDegrees(trueHeading).toDegrees(), 2));
+            }
+
+            stop++;
+            if(stop <= 2 * RIG_STOPS)
+            {
+                state = rig_state_t::SETTLE;
+            }
+            else
+            {
+                if(deviation.fit())
+                {
+                    float coefficients[DEVIATION_COEFFICIENTS];
+                    deviation.getCoefficients(coefficients);
+                    if(not RIG_ALIGNED)
+                    {
+                        // A is the heading error of the first stop, not a misalignment of the board
+                        coefficients[0] = 0;
+                        deviation.setCoefficients(coefficients);
+                    }
+                    Serial.println("Deviation A " + String(coefficients[0], 3) + " B " + String(coefficients[1], 3) + " C " + String(coefficients[2], 3) +
+                                   " D " + String(coefficients[3], 3) + " E " + String(coefficients[4], 3));
+                    Serial.println("Residual " + String(deviation.residual(), 2) + " deg, max deviation " + String(deviation.getMaxDeviation(), 2) + " deg");
+                    Serial.println(save_deviation(deviation) ? "Saved in /deviation.txt" : "ERROR SAVING /deviation.txt");
+                }
+                else
+                {
+                    Serial.println("ERROR: deviation not fitted");
+                }
+                state = rig_state_t::DONE;
+            }
+            phaseStartMs = now;
+        }
+    }
+    else
+    {
+        if(now - phaseStartMs >= 500)
+        {
+            phaseStartMs = now;
+            float heading = headingSmoother.getHeading();
+            Serial.println("Angle: " + String(heading, 1) + " corrected " + String(deviation.correct(heading), 1));
+        }
+    }
+}
+
+/**
+ * @name save_deviation
+ * @brief save_deviation: coefficients of the curve in /deviation.txt, one line per value, read by load_deviation of JackSparrowsCompass
+ * @param [in] DeviationCurve curve: curve to save
+ * @retval bool saved
+ */
+bool save_deviation(const DeviationCurve &curve)
+{
+    if(not SPIFFS.begin())
+    {
+        return false;
+    }
+    File deviationFile = SPIFFS.open("/deviation.txt", "w");
+    bool saved = false;
+    if(deviationFile)
+    {
+        float coefficients[DEVIATION_COEFFICIENTS];
+        curve.getCoefficients(coefficients);
+        for(int i = 0; i < DEVIATION_COEFFICIENTS; ++i)
+        {
+            deviationFile.println(coefficients[i], 4);
+        }
+        deviationFile.close();
+        saved = true;
+    }
+    SPIFFS.end();
+    return saved;
+}
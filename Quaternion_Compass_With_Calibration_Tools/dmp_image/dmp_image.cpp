@@ -0,0 +1,230 @@
+/**
+ * @file dmp_image.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Build step of the DMP mode: the firmware image of the Digital Motion Processor to a header of the
+ *        quaternion compass library
+ *
+ * The image is the dmp_memory[] array of the InvenSense MotionDriver 6.12 (inv_mpu_dmp_motion_driver.c of the
+ * eMD package of InvenSense). It is InvenSense code and it is not distributed with this repository: the tool
+ * reads the array out of that source file, checks its size against DMP_IMAGE_SIZE and writes it as a PROGMEM
+ * array, which dmp_firmware.h includes when it is there. Without it the library is built without
+ * MPU9250::enableDmp().
+ *
+ * Usage:
+ *      dmp_image <inv_mpu_dmp_motion_driver.c> [output header]
+ *
+ * The output defaults to ../quaternion_compass_lib/dmp_firmware_image.h, next to dmp_firmware.h.
+ *
+ * Build (host):
+ *      g++ -std=c++11 -O2 dmp_image.cpp -o dmp_image
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const size_t DMP_IMAGE_SIZE         = 3062;     // bytes of the MotionDriver 6.12 image, DMP_CODE_SIZE
+const char   DMP_IMAGE_ARRAY[]      = "dmp_memory";
+const char   DEFAULT_OUTPUT[]       = "../quaternion_compass_lib/dmp_firmware_image.h";
+
+/*-----------------------------------*
+ * PRIVATE FUNCTIONS
+ *-----------------------------------*/
+/**
+ * @name readFile
+ * @brief readFile: whole file to a string
+ * @param [in] const char *path: file
+ * @param [out] std::string &text: content
+ * @retval bool: false if it cannot be read
+ */
+static bool readFile(const char *path, std::string &text)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        text.append(buffer, count);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+/**
+ * @name stripComments
+ * @brief stripComments: C and C++ comments to a space, the bytes of the array are often commented by address
+ * @param [in] const std::string &text: source
+ * @retval std::string: source without comments
+ */
+static std::string stripComments(const std::string &text)
+{
+    std::string out;
+    size_t i = 0;
+    while (i < text.size())
+    {
+        if (text.compare(i, 2, "/*") == 0)
+        {
+            size_t end = text.find("*/", i + 2);
+            i = (end == std::string::npos) ? text.size() : end + 2;
+            out += ' ';
+        }
+        else if (text.compare(i, 2, "//") == 0)
+        {
+            size_t end = text.find('\n', i);
+            i = (end == std::string::npos) ? text.size() : end;
+            out += ' ';
+        }
+        else
+        {
+            out += text[i++];
+        }
+    }
+    return out;
+}
+
+/**
+ * @name parseImage
+ * @brief parseImage: the initializer of the array named DMP_IMAGE_ARRAY, byte by byte
+ * @param [in] const std::string &source: source without comments
+ * @param [out] std::vector<unsigned char> &image: bytes
+ * @retval bool: false if the array is missing or a value is not a byte
+ */
+static bool parseImage(const std::string &source, std::vector<unsigned char> &image)
+{
+    // the definition, not a use: the name followed by its size and the initializer
+    size_t name = source.find(DMP_IMAGE_ARRAY);
+    size_t open = std::string::npos;
+    while (name != std::string::npos)
+    {
+        size_t brace = source.find('{', name);
+        size_t semicolon = source.find(';', name);
+        if (brace != std::string::npos && brace < semicolon)
+        {
+            open = brace;
+            break;
+        }
+        name = source.find(DMP_IMAGE_ARRAY, name + 1);
+    }
+    if (open == std::string::npos)
+    {
+        return false;
+    }
+    size_t close = source.find('}', open);
+    if (close == std::string::npos)
+    {
+        return false;
+    }
+
+    const char *p = source.c_str() + open + 1;
+    const char *end = source.c_str() + close;
+    while (p < end)
+    {
+        if (isspace((unsigned char)*p) || *p == ',')
+        {
+            ++p;
+            continue;
+        }
+        char *next;
+        unsigned long value = strtoul(p, &next, 0);
+        if (next == p || value > 0xFF)
+        {
+            return false;
+        }
+        image.push_back((unsigned char)value);
+        p = next;
+    }
+    return true;
+}
+
+/**
+ * @name writeHeader
+ * @brief writeHeader: the image as PROGMEM array, 16 bytes per line
+ * @param [in] const char *path: output file
+ * @param [in] const char *source: file the image comes from
+ * @param [in] const std::vector<unsigned char> &image: bytes
+ * @retval bool: true if the file was written
+ */
+static bool writeHeader(const char *path, const char *source, const std::vector<unsigned char> &image)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+    std::string name(path);
+    fprintf(file, "/**\n");
+    fprintf(file, " * @file %s\n", name.substr(name.find_last_of("/\\") + 1).c_str());
+    fprintf(file, " * @brief DMP firmware image generated by dmp_image, InvenSense code: do not commit\n");
+    fprintf(file, " *\n");
+    fprintf(file, " * Source: %s\n", source);
+    fprintf(file, " */\n\n");
+    fprintf(file, "#ifndef DMP_FIRMWARE_IMAGE_H\n#define DMP_FIRMWARE_IMAGE_H\n\n");
+    fprintf(file, "const uint16_t DMP_FIRMWARE_SIZE = %u;\n", (unsigned int)image.size());
+    fprintf(file, "const uint8_t DMP_FIRMWARE[DMP_FIRMWARE_SIZE] PROGMEM =\n{\n");
+    for (size_t i = 0; i < image.size(); ++i)
+    {
+        fprintf(file, "%s0x%02X%s", (i % 16 == 0) ? "    " : "", image[i],
+                (i + 1 == image.size()) ? "\n" : ((i % 16 == 15) ? ",\n" : ", "));
+    }
+    fprintf(file, "};\n\n");
+    fprintf(file, "#endif /* DMP_FIRMWARE_IMAGE_H */\n");
+    return fclose(file) == 0;
+}
+
+/*******************
+ * MAIN
+*******************/
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "usage: dmp_image <inv_mpu_dmp_motion_driver.c> [output header]\n");
+        return 2;
+    }
+    const char *output = (argc == 3) ? argv[2] : DEFAULT_OUTPUT;
+
+    std::string text;
+    if (!readFile(argv[1], text))
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<unsigned char> image;
+    if (!parseImage(stripComments(text), image))
+    {
+        fprintf(stderr, "no %s[] array of bytes in %s\n", DMP_IMAGE_ARRAY, argv[1]);
+        return 1;
+    }
+    // another release of the image has other memory keys, Dmp would configure it wrong
+    if (image.size() != DMP_IMAGE_SIZE)
+    {
+        fprintf(stderr, "%s[] is %u bytes, the MotionDriver 6.12 image is %u\n", DMP_IMAGE_ARRAY,
+                (unsigned int)image.size(), (unsigned int)DMP_IMAGE_SIZE);
+        return 1;
+    }
+    if (!writeHeader(output, argv[1], image))
+    {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 1;
+    }
+    printf("%s: %u bytes\n", output, (unsigned int)image.size());
+    return 0;
+}
+
+/****************************************************************************
+ ****************************************************************************/
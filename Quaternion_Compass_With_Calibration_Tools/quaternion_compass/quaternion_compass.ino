@@ -67,6 +67,8 @@
 
 #include <SPI.h>
 #include <Wire.h>
+#include <CoverageTracker.h>                                        // CompassCore library: calibration coverage map
+#include <CalibrationTransform.h>                                   // CompassCore library: precomputed affine calibration
 
 #if defined(ARDUINO_SAMD_ZERO) && defined(SERIAL_PORT_USBVIRTUAL)
 #define Serial SERIAL_PORT_USBVIRTUAL                               // Required for Serial on Zero based boards
@@ -122,7 +124,7 @@ const int pin_BL = 10;
   Method 1 :
   ----------
   Set "#define TASK 1". Upload this change to your Arduino.
-  You will be asked to "tumble" your  compass for 30 seconds.
+  You will be asked to "tumble" your  compass until the coverage is reached (30 seconds at most).
   Replace (copy - & -paste) the values below with the offsets and scale - factors that appear on your computer screen.
   Once you have done this select one of  TASKs 3, 4, or 5 and upload these changes to your Arduino
   This method is less accurate than Method 2
@@ -406,6 +408,7 @@ short magCount[3];                                  // Stores the 16-bit signed
 float magCalibration[3] = {0, 0, 0},
                           magBias[3] = {0, 0, 0},
                                        magScale[3] = {0, 0, 0};    // Factory mag calibration, mag offset , mag scale-factor
+CalibrationTransform magTransform;                  // softIron * (raw * mRes * ASA - offset) in one 3x4 transform
 float gyroBias[3] = {0, 0, 0},
                     accelBias[3] = {0, 0, 0};        // Bias corrections for gyro and accelerometer
 short tempCount;                                    // temperature raw count output
@@ -581,6 +584,15 @@ void setup()
       Serial.print(F("ASAY = ")); Serial.println(magCalibration[1], 2);
       Serial.print(F("ASAZ = ")); Serial.println(magCalibration[2], 2);
       Serial.println("");
+
+      // ----- Hard-iron offsets & soft-iron scale-factors (from compass_cal)
+      magBias[0] = Mag_x_offset;
+      magBias[1] = Mag_y_offset;
+      magBias[2] = Mag_z_offset;
+      magScale[0] = Mag_x_scale;
+      magScale[1] = Mag_y_scale;
+      magScale[2] = Mag_z_scale;
+      updateMagTransform();
       delay(1000);
     }
     else
@@ -623,14 +635,15 @@ void setup()
     lcd.setCursor(0, 0);
     lcd.print(F("Tumble compass"));
     lcd.setCursor(0, 1);
-    lcd.print(F("for 30 seconds"));
+    lcd.print(F("until done"));
 #endif
 
     // ----- Calculate magnetometer offsets & scale-factors
     Serial.println(F("Magnetometer calibration ..."));
-    Serial.println(F("Tumble/wave device for 30 seconds in a figure 8"));
+    Serial.println(F("Tumble/wave device in a figure 8 until the coverage is reached (30 seconds at most)"));
     delay(2000);
     magCalMPU9250(magBias, magScale);
+    updateMagTransform();                       // Use the new offsets & scale-factors from now on
 
 #ifdef LCD2
     lcd.clear();
@@ -750,6 +763,22 @@ void getMres() {
   }
 }
 
+// -------------------
+// updateMagTransform()
+// -------------------
+/* Fold resolution, factory ASA, hard-iron offsets and soft-iron scale-factors in magTransform */
+void updateMagTransform()
+{
+  getMres();
+  const float inputScale[3] =
+  {
+    mRes * magCalibration[0],
+    mRes * magCalibration[1],
+    mRes * magCalibration[2]
+  };
+  magTransform.setDiagonal(magScale, magBias, inputScale);
+}
+
 // -------------------
 // getGres()
 // -------------------
@@ -1116,21 +1145,22 @@ void calibrateMPU9250(float * dest1, float * dest2)
 /*
   Function which accumulates magnetometer data after device initialization.
   It calculates the bias and scale in the x, y, and z axes.
+  Sampling stops as soon as the CoverageTracker says the sphere has been covered and the fit
+  explains the samples, 30 seconds at most.
 */
 void magCalMPU9250(float * bias_dest, float * scale_dest)
 {
   unsigned short ii = 0, sample_count = 0;
-  short mag_max[3]  = { -32768, -32768, -32768},
-                      mag_min[3]  = {32767, 32767, 32767},
-                                    mag_temp[3] = {0, 0, 0};
-  long mag_bias[3] = {0, 0, 0};
-  float mag_chord[3] = {0, 0, 0};
-  float avg_chord;
+  short mag_temp[3] = {0, 0, 0};
+  float mag_offset[3] = {0, 0, 0};
+  unsigned long last_report = 0;
+  static CoverageTracker coverage;                // static: keeps the representatives off the stack
 
   // ----- Make sure resolution has been calculated
   getMres();
+  coverage.reset();
 
-  // ----- Tumble compass for 30 seconds
+  // ----- Tumble compass until the sphere is covered, for 30 seconds at most
   /*
     At 8 Hz ODR (output data rate), new mag data is available every 125 ms
     At 100 Hz ODR, new mag data is available every 10 ms
@@ -1142,57 +1172,48 @@ void magCalMPU9250(float * bias_dest, float * scale_dest)
   for (ii = 0; ii < sample_count; ii++)
   {
     readMagData(mag_temp);  // Read the raw mag data
+    coverage.addSample(mag_temp[0], mag_temp[1], mag_temp[2]);
 
-    for (int jj = 0; jj < 3; jj++)
+    // ----- Live coverage report, twice a second
+    if (millis() - last_report >= 500)
     {
-      if (mag_temp[jj] > mag_max[jj]) mag_max[jj] = mag_temp[jj];
-      if (mag_temp[jj] < mag_min[jj]) mag_min[jj] = mag_temp[jj];
+      last_report = millis();
+      Serial.print(F("Coverage "));
+      Serial.print(coverage.coverage() * 100.0f, 0);
+      Serial.print(F(" %, residual "));
+      Serial.print(coverage.residual() * 100.0f, 1);
+      Serial.println(F(" %"));
     }
+    if (coverage.isComplete()) break;
 
     if (Mmode == M_8HZ) delay(135);               // At 8 Hz ODR, new mag data is available every 125 ms
     if (Mmode == M_100HZ) delay(12);              // At 100 Hz ODR, new mag data is available every 10 ms
   }
 
-  // Serial.println("mag x min/max:"); Serial.println(mag_max[0]); Serial.println(mag_min[0]);
-  // Serial.println("mag y min/max:"); Serial.println(mag_max[1]); Serial.println(mag_min[1]);
-  // Serial.println("mag z min/max:"); Serial.println(mag_max[2]); Serial.println(mag_min[2]);
+  if (!coverage.isComplete())
+  {
+    Serial.println(F("Coverage not reached, calibration may be poor"));
+  }
 
   // ----- Get hard iron correction
-  /* long data-type  */
-  mag_bias[0]  = (mag_max[0] + mag_min[0]) / 2;                       // data-type: long
-  mag_bias[1]  = (mag_max[1] + mag_min[1]) / 2;
-  mag_bias[2]  = (mag_max[2] + mag_min[2]) / 2;
+  /* least squares fit of the tracker, min/max if the fit is not solvable */
+  coverage.getOffset(mag_offset);
 
   // ----- Save mag biases in G for main program
   /* float data-type  */
-  bias_dest[0] = (float)mag_bias[0] * magCalibration[0] * mRes;       // rawMagX * ASAX * 0.6
-  bias_dest[1] = (float)mag_bias[1] * magCalibration[1] * mRes;       // rawMagY * ASAY * 0.6
-  bias_dest[2] = (float)mag_bias[2] * magCalibration[2] * mRes;       // rawMagZ * ASAZ * 0.6
+  bias_dest[0] = mag_offset[0] * magCalibration[0] * mRes;            // rawMagX * ASAX * 0.6
+  bias_dest[1] = mag_offset[1] * magCalibration[1] * mRes;            // rawMagY * ASAY * 0.6
+  bias_dest[2] = mag_offset[2] * magCalibration[2] * mRes;            // rawMagZ * ASAZ * 0.6
 
   // ----- Get soft iron correction estimate
-  /* float data-type */
-  mag_chord[0]  = ((float)(mag_max[0] - mag_min[0])) / 2.0;
-  mag_chord[1]  = ((float)(mag_max[1] - mag_min[1])) / 2.0;
-  mag_chord[2]  = ((float)(mag_max[2] - mag_min[2])) / 2.0;
-  avg_chord = (mag_chord[0] + mag_chord[1] + mag_chord[2]) / 3.0;
-
-  // ----- calculate scale-factors
-  /* Destination data-type is float */
-  scale_dest[0] = avg_chord / mag_chord[0];
-  scale_dest[1] = avg_chord / mag_chord[1];
-  scale_dest[2] = avg_chord / mag_chord[2];
+  /* Destination data-type is float, average semi-axis / axis semi-axis */
+  coverage.getScale(scale_dest);
 
   //  Serial.print("bias_dest[0] "); Serial.println(bias_dest[0]);
   //  Serial.print("bias_dest[1] "); Serial.println(bias_dest[1]);
   //  Serial.print("bias_dest[2] "); Serial.println(bias_dest[2]);
   //  Serial.print("");
   //
-  //  Serial.print("mag_chord[0]] "); Serial.println(mag_chord[0]);
-  //  Serial.print("mag_chord[1]] "); Serial.println(mag_chord[1]);
-  //  Serial.print("mag_chord[2]] "); Serial.println(mag_chord[2]);
-  //  Serial.print("avg_chord] "); Serial.println(avg_chord);
-  //  Serial.print("");
-  //
   //  Serial.print("scale_dest[0] "); Serial.println(scale_dest[0]);
   //  Serial.print("scale_dest[1] "); Serial.println(scale_dest[1]);
   //  Serial.print("scale_dest[2] "); Serial.println(scale_dest[2]);
@@ -1551,34 +1572,14 @@ void refresh_data()
 
     // ----- Magnetometer calculations
     readMagData(magCount);                              // Read the magnetometer x|y| registers
-    getMres();                                          // Get magnetometer resolution
-
-    //    // ----- Kris Winer hard-iron offsets
-    //    magBias[0] = +470.;  // User environmental x-axis correction in milliGauss, should be automatically calculated
-    //    magBias[1] = +120.;  // User environmental x-axis correction in milliGauss
-    //    magBias[2] = +125.;  // User environmental x-axis correction in milliGauss
-
-    // ----- Copy hard-iron offsets
-    magBias[0] = Mag_x_offset;                          // Get hard-iron offsets (from compass_cal)
-    magBias[1] = Mag_y_offset;
-    magBias[2] = Mag_z_offset;
-
-    // ----- Copy the soft-iron scalefactors
-    magScale[0] = Mag_x_scale;
-    magScale[1] = Mag_y_scale;
-    magScale[2] = Mag_z_scale;
-
-    //    // ----- Calculate the magnetometer values in milliGauss
-    //    /* Include factory calibration per data sheet and user environmental corrections */
-    //    mx = (float)magCount[0] * mRes * magCalibration[0] - magBias[0];    // get actual magnetometer value, this depends on scale being set
-    //    my = (float)magCount[1] * mRes * magCalibration[1] - magBias[1];
-    //    mz = (float)magCount[2] * mRes * magCalibration[2] - magBias[2];
 
     // ----- Calculate the magnetometer values in milliGauss
-    /* The above formula is not using the soft-iron scale factors */
-    mx = ((float)magCount[0] * mRes * magCalibration[0] - magBias[0]) * magScale[0];    // (rawMagX*ASAX*0.6 - magOffsetX)*scalefactor
-    my = ((float)magCount[1] * mRes * magCalibration[1] - magBias[1]) * magScale[1];    // (rawMagY*ASAY*0.6 - magOffsetY)*scalefactor
-    mz = ((float)magCount[2] * mRes * magCalibration[2] - magBias[2]) * magScale[2];    // (rawMagZ*ASAZ*0.6 - magOffsetZ)*scalefactor
+    /* (rawMag*ASA*0.6 - magOffset)*scalefactor, precomputed by updateMagTransform() */
+    float magCalibrated[3];
+    magTransform.apply(magCount, magCalibrated);
+    mx = magCalibrated[0];
+    my = magCalibrated[1];
+    mz = magCalibrated[2];
   }
 }
 
@@ -0,0 +1,16 @@
+// ----- DMP firmware image
+/*
+The image of the Digital Motion Processor is the dmp_memory[] array of the InvenSense MotionDriver 6.12
+(inv_mpu_dmp_motion_driver.c, 3062 bytes, program start 0x0400). It is InvenSense code and it is not
+distributed with this repository; the build step of the DMP mode generates it next to this file:
+    cd ../dmp_image && g++ -std=c++11 -O2 dmp_image.cpp -o dmp_image
+    ./dmp_image path/to/inv_mpu_dmp_motion_driver.c         writes ../quaternion_compass_lib/dmp_firmware_image.h
+The array is in PROGMEM, Dmp::load copies it to RAM one chunk at a time with memcpy_P: 3 kB do not fit an Uno.
+With the image MPU9250_DMP is defined here, mpu9250_lib.cpp includes the image and MPU9250::enableDmp() is built; without it there is no DMP mode, a
+sketch calling enableDmp() does not compile, and the Mahony filter runs on the MCU.
+*/
+#if defined(__has_include)
+#if __has_include("dmp_firmware_image.h")
+#define MPU9250_DMP
+#endif
+#endif
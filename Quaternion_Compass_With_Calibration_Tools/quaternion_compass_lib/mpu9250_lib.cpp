@@ -12,6 +12,12 @@
 * INCLUDE FILES
 *-----------------------------------*/
 #include "mpu9250_lib.h"
+#include <CoverageTracker.h>
+#include <HeadingMath.h>
+#include <ResumeState.h>
+#ifdef MPU9250_DMP
+#include "dmp_firmware_image.h"
+#endif
 /*-----------------------------------*
 * PUBLIC DEFINES
 *-----------------------------------*/
@@ -49,76 +55,104 @@ MPU9250::MPU9250()
     while (!Serial);// required for Feather M4 Express<
     Serial.begin(115200);
 
-    
-    // ----- Display title
-    Serial.println(F("MPU-9250 Quaternion Compass"));
-    Serial.println("");
-    delay(2000);
+    // ----- State of the filter before a reset, if any: the MPU9250 kept its power and its offset registers,
+    // no calibration and no convergence again
+    ResumeState state;
+    resumed = loadResumeState(state) && (state.flags & RESUME_FLAG_ATTITUDE);
 
-    // ----- Level surface message
-    Serial.println(F("Place the compass on a level surface"));
-    Serial.println("");
-    delay(2000);
+    if (!resumed)
+    {
+        // ----- Display title
+        Serial.println(F("MPU-9250 Quaternion Compass"));
+        Serial.println("");
+        delay(2000);
+
+        // ----- Level surface message
+        Serial.println(F("Place the compass on a level surface"));
+        Serial.println("");
+        delay(2000);
 
 #ifdef LCD2
-    // ----- Start LCD
-    lcd.begin(16, 2);                                 // Configure 16 char x 2 line LCD display
-
-    // ----- Display title
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(F("   Quaternion"));
-    lcd.setCursor(0, 1);
-    lcd.print(F("   Compass V8"));
-    delay(2000);
-
-    // ----- Level surface message
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(F("Place compass on"));
-    lcd.setCursor(0, 1);
-    lcd.print(F("level surface"));
-    delay(2000);
+        // ----- Start LCD
+        lcd.begin(16, 2);                                 // Configure 16 char x 2 line LCD display
+
+        // ----- Display title
+        lcd.clear();
+        lcd.setCursor(0, 0);
+        lcd.print(F("   Quaternion"));
+        lcd.setCursor(0, 1);
+        lcd.print(F("   Compass V8"));
+        delay(2000);
+
+        // ----- Level surface message
+        lcd.clear();
+        lcd.setCursor(0, 0);
+        lcd.print(F("Place compass on"));
+        lcd.setCursor(0, 1);
+        lcd.print(F("level surface"));
+        delay(2000);
 #endif
+    }
+
     // ----- Read the WHO_AM_I register, this is a good test of communication
     byte c = readByte(MPU9250_ADDRESS, WHO_AM_I_MPU9250);  // Read WHO_AM_I register for MPU-9250
-    delay(1000);
+    if (!resumed) delay(1000);
 
     if ((c == 0x71) || (c == 0x73)) // MPU9250=0x68; MPU9255=0x73
     {
         Serial.println(F("MPU9250 is online..."));
         Serial.println("");
 
-        MPU9250SelfTest(SelfTest); // Start by performing self test and reporting values
-        Serial.println(F("Self test (14% acceptable)"));
-        Serial.print(F("x-axis acceleration trim within : ")); Serial.print(SelfTest[0], 1); Serial.println(F("% of factory value"));
-        Serial.print(F("y-axis acceleration trim within : ")); Serial.print(SelfTest[1], 1); Serial.println(F("% of factory value"));
-        Serial.print(F("z-axis acceleration trim within : ")); Serial.print(SelfTest[2], 1); Serial.println(F("% of factory value"));
-        Serial.print(F("x-axis gyration trim within : ")); Serial.print(SelfTest[3], 1); Serial.println(F("% of factory value"));
-        Serial.print(F("y-axis gyration trim within : ")); Serial.print(SelfTest[4], 1); Serial.println(F("% of factory value"));
-        Serial.print(F("z-axis gyration trim within : ")); Serial.print(SelfTest[5], 1); Serial.println(F("% of factory value"));
-        Serial.println("");
+        if (resumed)
+        {
+            // ----- Attitude, integral terms and biases of the filter before the reset; the offset registers of
+            // the MPU9250 still hold the calibration
+            for (int i = 0; i < 4; ++i) q[i] = state.quaternion[i];
+            for (int i = 0; i < 3; ++i)
+            {
+                eInt[i] = state.integral[i];
+                gyroBias[i] = state.gyroOffset[i];
+                accelBias[i] = state.accelOffset[i];
+            }
+            calibrationTemperature = state.calibrationTemperature;
+            motion.setGyroBias(state.gyroBias);
+            Serial.println(F("MPU9250 resumed after a reset, calibration kept"));
+            Serial.println("");
+        }
+        else
+        {
+            MPU9250SelfTest(SelfTest); // Start by performing self test and reporting values
+            Serial.println(F("Self test (14% acceptable)"));
+            Serial.print(F("x-axis acceleration trim within : ")); Serial.print(SelfTest[0], 1); Serial.println(F("% of factory value"));
+            Serial.print(F("y-axis acceleration trim within : ")); Serial.print(SelfTest[1], 1); Serial.println(F("% of factory value"));
+            Serial.print(F("z-axis acceleration trim within : ")); Serial.print(SelfTest[2], 1); Serial.println(F("% of factory value"));
+            Serial.print(F("x-axis gyration trim within : ")); Serial.print(SelfTest[3], 1); Serial.println(F("% of factory value"));
+            Serial.print(F("y-axis gyration trim within : ")); Serial.print(SelfTest[4], 1); Serial.println(F("% of factory value"));
+            Serial.print(F("z-axis gyration trim within : ")); Serial.print(SelfTest[5], 1); Serial.println(F("% of factory value"));
+            Serial.println("");
 
-        calibrateMPU9250(gyroBias, accelBias); // Calibrate gyro and accelerometers, load biases in bias registers
+            calibrateMPU9250(gyroBias, accelBias); // Calibrate gyro and accelerometers, load biases in bias registers
 
-        Serial.println(F("MPU9250 accelerometer bias"));
-        Serial.print(F("x = ")); Serial.println((int)(1000 * accelBias[0]));
-        Serial.print(F("y = ")); Serial.println((int)(1000 * accelBias[1]));
-        Serial.print(F("z = ")); Serial.print((int)(1000 * accelBias[2]));
-        Serial.println(F(" mg"));
-        Serial.println("");
+            Serial.println(F("MPU9250 accelerometer bias"));
+            Serial.print(F("x = ")); Serial.println((int)(1000 * accelBias[0]));
+            Serial.print(F("y = ")); Serial.println((int)(1000 * accelBias[1]));
+            Serial.print(F("z = ")); Serial.print((int)(1000 * accelBias[2]));
+            Serial.println(F(" mg"));
+            Serial.println("");
 
-        Serial.println(F("MPU9250 gyro bias"));
-        Serial.print(F("x = ")); Serial.println(gyroBias[0], 1);
-        Serial.print(F("y = ")); Serial.println(gyroBias[1], 1);
-        Serial.print(F("z = ")); Serial.print(gyroBias[2], 1);
-        Serial.println(F(" o/s"));
-        Serial.println("");
-        delay(1000);
+            Serial.println(F("MPU9250 gyro bias"));
+            Serial.print(F("x = ")); Serial.println(gyroBias[0], 1);
+            Serial.print(F("y = ")); Serial.println(gyroBias[1], 1);
+            Serial.print(F("z = ")); Serial.print(gyroBias[2], 1);
+            Serial.println(F(" o/s"));
+            Serial.println("");
+            delay(1000);
+        }
 
         initMPU9250();
         Serial.println(F("MPU9250 initialized for active data mode....")); // Initialize device for active mode read of acclerometer, gyroscope, and temperature
         Serial.println("");
+        if (!resumed) getTemperature(calibrationTemperature);
 
         // Read the WHO_AM_I register of the magnetometer, this is a good test of communication
         byte d = readByte(AK8963_ADDRESS, AK8963_WHO_AM_I);  // Read WHO_AM_I register for AK8963
@@ -137,7 +171,10 @@ MPU9250::MPU9250()
             Serial.print(F("ASAY = ")); Serial.println(magCalibration[1], 2);
             Serial.print(F("ASAZ = ")); Serial.println(magCalibration[2], 2);
             Serial.println("");
-            delay(1000);
+
+            getMres();
+            updateMagTransform();
+            if (!resumed) delay(1000);
         }
         else
         {
@@ -171,7 +208,7 @@ MPU9250::MPU9250()
     
 
 }
-~MPU9250::MPU9250(){}
+MPU9250::~MPU9250(){}
 
 /*******************
  * PUBLIC METHODS
@@ -248,45 +285,42 @@ void MPU9250::getAres()
 }
 
 /* refresh data and compute QUATERNION*/
-bool MPU9250::update()
+const MPU9250Sample &MPU9250::sample()
 {
-    refresh_data();                              // This must be done each time through the loop
-    calc_quaternion();                           // This must be done each time through the loop
+    // ----- Stationary: the attitude does not change, a low rate saves the bus and the filter
+    if (motion.isStationary() && (millis() - lastFusion) < STATIONARY_FUSION_PERIOD_MS)
+    {
+        newData = false;
+        return lastSample;
+    }
+    lastFusion = millis();
 
-    pitch = asin(2.0f * (q[1] * q[3] - q[0] * q[2]));
-    roll  = -atan2(2.0f * (q[0] * q[1] + q[2] * q[3]), q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]);
-    yaw   = atan2(2.0f * (q[1] * q[2] + q[0] * q[3]), q[0] * q[0] + q[1] * q[1] - q[2] * q[2] - q[3] * q[3]);
+    if (dmp.isRunning())
+    {
+        newData = refresh_dmp();                 // the DMP fuses gyro and accelerometer, the magnetometer yaw is here
+    }
+    else
+    {
+        newData = refresh_data();                // This must be done each time through the loop
+        calc_quaternion();                       // This must be done each time through the loop
+    }
 
-    // ----- convert to degrees
-    //TODO: flag for select if you want radians or degrees
-    pitch *= RAD_TO_DEG;
-    roll *= RAD_TO_DEG;
-    yaw *= RAD_TO_DEG;
+    lastSample = MPU9250Sample(q, (True_North == true) ? getDeclination() : 0.0f, Now);
 
-    // ----- calculate the heading
-    /*
-        The yaw and compass heading (after the next two lines) track each other 100%
-    */
-    this->heading = yaw;
-    if (this->heading < 0) this->heading += 360.0;                        // Yaw goes negative between 180 amd 360 degrees
-    if (True_North == true) this->heading += Declination;           // Calculate True North
-    if (this->heading < 0) this->heading += 360.0;                        // Allow for under|overflow
-    if (this->heading >= 360) this->heading -= 360.0;
-
-    // ----- send the results to the Serial Monitor
-    Serial.print("        Pitch ");
-    print_number((short)pitch);
-    Serial.print("        Roll ");
-    print_number((short)roll);
-    Serial.print("        Heading ");
-    print_number((short)this->heading);
-
-    // ----- Print temperature in degrees Centigrade
-    tempCount = readTempData();                               // Read the temperature registers
-    temperature = ((float) tempCount) / 333.87 + 21.0;        // Temp in degrees C
-    Serial.print("        Temp(C) ");
-    Serial.print(temperature, 1);
+    // ----- Kept in the RTC memory: after a watchdog or a soft reset the filter goes on from here
+    if (attitudeValid && (millis() - lastResumeSave) >= RESUME_SAVE_PERIOD_MS)
+    {
+        saveResume();
+        lastResumeSave = millis();
+    }
+    return lastSample;
+}
 
+/* refresh data and compute, same as sample(); true if the sensors had new data */
+bool MPU9250::update()
+{
+    sample();
+    return newData;
 }
 
 /*
@@ -457,23 +491,22 @@ void MPU9250::calibrateMPU9250(float * dest1, float * dest2)
 /*
 Function which accumulates magnetometer data after device initialization.
 It calculates the bias and scale in the x, y, and z axes.
+Sampling stops as soon as the CoverageTracker says the sphere has been covered and the fit
+explains the samples, 30 seconds at most.
 */
 void MPU9250::magCalMPU9250(float * bias_dest, float * scale_dest)
 {
     unsigned short ii = 0, sample_count = 0;
-    short mag_max[3]  = { -32768, -32768, -32768}:
-    short mag_min[3]  = {32767, 32767, 32767}:
     short mag_temp[3] = {0, 0, 0};
-
-    long mag_bias[3] = {0, 0, 0};
-    float mag_chord[3] = {0, 0, 0};
-
-    float avg_chord;
+    float mag_offset[3] = {0, 0, 0};
+    unsigned long last_report = 0;
+    static CoverageTracker coverage;                // static: keeps the representatives off the stack
 
     // ----- Make sure resolution has been calculated
     getMres();
+    coverage.reset();
 
-    // ----- Tumble compass for 30 seconds
+    // ----- Tumble compass until the sphere is covered, for 30 seconds at most
     /*
         At 8 Hz ODR (output data rate), new mag data is available every 125 ms
         At 100 Hz ODR, new mag data is available every 10 ms
@@ -485,45 +518,245 @@ void MPU9250::magCalMPU9250(float * bias_dest, float * scale_dest)
     for (ii = 0; ii < sample_count; ii++)
     {
         readMagData(mag_temp);  // Read the raw mag data
+        coverage.addSample(mag_temp[0], mag_temp[1], mag_temp[2]);
 
-        for (int jj = 0; jj < 3; jj++)
+        // ----- Live coverage report, twice a second
+        if (millis() - last_report >= 500)
         {
-        if (mag_temp[jj] > mag_max[jj]) mag_max[jj] = mag_temp[jj];
-        if (mag_temp[jj] < mag_min[jj]) mag_min[jj] = mag_temp[jj];
+            last_report = millis();
+            Serial.print(F("Coverage "));
+            Serial.print(coverage.coverage() * 100.0f, 0);
+            Serial.print(F(" %, residual "));
+            Serial.print(coverage.residual() * 100.0f, 1);
+            Serial.println(F(" %"));
         }
+        if (coverage.isComplete()) break;
 
         if (Mmode == M_8HZ) delay(135);               // At 8 Hz ODR, new mag data is available every 125 ms
         if (Mmode == M_100HZ) delay(12);              // At 100 Hz ODR, new mag data is available every 10 ms
     }
 
-    // Serial.println("mag x min/max:"); Serial.println(mag_max[0]); Serial.println(mag_min[0]);
-    // Serial.println("mag y min/max:"); Serial.println(mag_max[1]); Serial.println(mag_min[1]);
-    // Serial.println("mag z min/max:"); Serial.println(mag_max[2]); Serial.println(mag_min[2]);
+    if (!coverage.isComplete())
+    {
+        Serial.println(F("Coverage not reached, calibration may be poor"));
+    }
 
     // ----- Get hard iron correction
-    /* long data-type  */
-    mag_bias[0]  = (mag_max[0] + mag_min[0]) / 2;                       // data-type: long
-    mag_bias[1]  = (mag_max[1] + mag_min[1]) / 2;
-    mag_bias[2]  = (mag_max[2] + mag_min[2]) / 2;
+    /* least squares fit of the tracker, min/max if the fit is not solvable */
+    coverage.getOffset(mag_offset);
 
     // ----- Save mag biases in G for main program
     /* float data-type  */
-    bias_dest[0] = (float)mag_bias[0] * magCalibration[0] * mRes;       // rawMagX * ASAX * 0.6
-    bias_dest[1] = (float)mag_bias[1] * magCalibration[1] * mRes;       // rawMagY * ASAY * 0.6
-    bias_dest[2] = (float)mag_bias[2] * magCalibration[2] * mRes;       // rawMagZ * ASAZ * 0.6
+    bias_dest[0] = mag_offset[0] * magCalibration[0] * mRes;            // rawMagX * ASAX * 0.6
+    bias_dest[1] = mag_offset[1] * magCalibration[1] * mRes;            // rawMagY * ASAY * 0.6
+    bias_dest[2] = mag_offset[2] * magCalibration[2] * mRes;            // rawMagZ * ASAZ * 0.6
 
     // ----- Get soft iron correction estimate
-    /* float data-type */
-    mag_chord[0]  = ((float)(mag_max[0] - mag_min[0])) / 2.0;
-    mag_chord[1]  = ((float)(mag_max[1] - mag_min[1])) / 2.0;
-    mag_chord[2]  = ((float)(mag_max[2] - mag_min[2])) / 2.0;
-    avg_chord = (mag_chord[0] + mag_chord[1] + mag_chord[2]) / 3.0;
-
-    // ----- calculate scale-factors
-    /* Destination data-type is float */
-    scale_dest[0] = avg_chord / mag_chord[0];
-    scale_dest[1] = avg_chord / mag_chord[1];
-    scale_dest[2] = avg_chord / mag_chord[2];
+    /* Destination data-type is float, average semi-axis / axis semi-axis */
+    coverage.getScale(scale_dest);
+}
+
+/**
+ * @name setMagCalibration
+ * @brief setMagCalibration: replace the magnetometer calibration, m = softIron * (raw * mRes * ASA - bias)
+ * @param [in] const float bias[3]: hard-iron offset in milliGauss
+ * @param [in] const float softIron[3][3]: soft-iron matrix, diag(Mag_*_scale) for the min/max calibration
+ * @retval None
+ */
+void MPU9250::setMagCalibration(const float bias[3], const float softIron[3][3])
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        magBias[i] = bias[i];
+        for (int j = 0; j < 3; ++j) magSoftIron[i][j] = softIron[i][j];
+    }
+    updateMagTransform();
+}
+
+/**
+ * @name setServoMagModel
+ * @brief setServoMagModel: bias of a servo near the magnetometer, taken away after the calibration
+ * @param [in] const ServoMagModel *model: model, NULL for none; kept by pointer, it must outlive the sensor
+ * @retval None
+ */
+void MPU9250::setServoMagModel(const ServoMagModel *model)
+{
+    servoMagModel = model;
+}
+
+/**
+ * @name setServoAngle
+ * @brief setServoAngle: servo angle of the next samples, for the servo model
+ * @param [in] float angle: deg, servo frame
+ * @retval None
+ */
+void MPU9250::setServoAngle(float angle)
+{
+    servoAngle = angle;
+}
+
+/**
+ * @name setTemperatureBias
+ * @brief setTemperatureBias: bias of gyro and magnetometer versus the die temperature, taken away from every sample
+ *                            and learned while stationary; the gyro table is taken to zero at the temperature of
+ *                            the calibration at boot, kept across a reset
+ * @param [in] TemperatureBiasTable *gyro: deg/s, NULL for none; kept by pointer, it must outlive the sensor
+ * @param [in] TemperatureBiasTable *mag: milliGauss after the calibration and the servo model, NULL for none
+ * @retval None
+ */
+void MPU9250::setTemperatureBias(TemperatureBiasTable *gyro, TemperatureBiasTable *mag)
+{
+    gyroTemperature = gyro;
+    magTemperature = mag;
+    if (gyroTemperature != NULL) gyroTemperature->rebase(calibrationTemperature);
+    if (magTemperature != NULL) magTemperature->restartChange();
+}
+
+/**
+ * @name setMagWeight
+ * @brief setMagWeight: weight of the magnetometer in the Mahony filter, e.g. down while a servo moves
+ * @param [in] float weight: 0 gyro and accelerometer only, 1 full weight
+ * @retval None
+ */
+void MPU9250::setMagWeight(float weight)
+{
+    magWeight = constrain(weight, 0.0f, 1.0f);
+}
+
+/**
+ * @name setGainSchedule
+ * @brief setGainSchedule: gains of the Mahony filter, Kp scheduled on the residual of the correction, see GainScheduler
+ * @param [in] const gain_schedule_t &schedule: Kp, 1/s; DEFAULT_MAHONY_GAIN_SCHEDULE at start
+ * @param [in] float ki: integral gain, 1/s^2, 0 for none
+ * @retval None
+ */
+void MPU9250::setGainSchedule(const gain_schedule_t &schedule, float ki)
+{
+    kpSchedule.setSchedule(schedule);
+    Ki = (ki > 0.0f) ? ki : 0.0f;
+}
+
+/**
+ * @name setIntegrator
+ * @brief setIntegrator: how the Mahony filter integrates the gyro, see QuaternionIntegrator
+ * @param [in] quaternion_integrator_t method: CONING at start, EULER the original first order step
+ * @retval None
+ */
+void MPU9250::setIntegrator(quaternion_integrator_t method)
+{
+    integrator.setMethod(method);
+}
+
+/**
+ * @name setMagRate
+ * @brief setMagRate: output data rate of the AK8963, the filter corrects the attitude once per magnetometer sample
+ * @param [in] byte mode: M_8HZ or M_100HZ continuous mode
+ * @retval None
+ */
+void MPU9250::setMagRate(byte mode)
+{
+    if (mode != M_8HZ && mode != M_100HZ) return;
+    Mmode = mode;
+    writeByte(AK8963_ADDRESS, AK8963_CNTL, 0x00); // Power down magnetometer before a mode change
+    delay(10);
+    writeByte(AK8963_ADDRESS, AK8963_CNTL, Mscale << 4 | Mmode);
+    delay(10);
+}
+
+/**
+ * @name enableWakeOnMotion
+ * @brief enableWakeOnMotion: wake-on-motion interrupt of the accelerometer, read with the data ready in INT_STATUS;
+ *                            a motion over the threshold takes the compass out of STATIONARY at the next read
+ * @param [in] float thresholdMg: mg between two accelerometer samples, 4 to 1020
+ * @retval None
+ */
+void MPU9250::enableWakeOnMotion(float thresholdMg)
+{
+    // The gyro keeps running for the filter, so the accelerometer stays in normal mode and LP_ACCEL_ODR is not used
+    writeByte(MPU9250_ADDRESS, MOT_DETECT_CTRL, 0xC0);                                     // ACCEL_INTEL_EN, compare with the previous sample
+    writeByte(MPU9250_ADDRESS, WOM_THR, (byte)constrain(thresholdMg / 4.0f, 1.0f, 255.0f)); // LSB = 4 mg
+    writeByte(MPU9250_ADDRESS, INT_ENABLE, 0x41);                                          // wake-on-motion (bit 6) and data ready (bit 0)
+}
+
+/**
+ * @name setLocation
+ * @brief setLocation: position and date for the declination of the World Magnetic Model, e.g. from a GPS;
+ *                     cheap to call at every fix, the model is evaluated again only a few km away; its dip
+ *                     checks the reference field of the disturbance detector
+ * @param [in] double latitude: deg
+ * @param [in] double longitude: deg
+ * @param [in] float year: decimal year, e.g. 2026.5; out of the life of the model its nearest end is taken
+ * @retval None
+ */
+void MPU9250::setLocation(double latitude, double longitude, float year)
+{
+    if (magneticModel.update(latitude, longitude, year))
+    {
+        Serial.print(F("Declination: "));
+        Serial.println(magneticModel.getDeclination(), 2);
+        if (!magneticModel.isCurrent())
+        {
+            Serial.println(F("Date out of the life of the World Magnetic Model, declination of its nearest end"));
+        }
+    }
+    // the dip of the place checks the reference of the disturbance detector, learned blindly at power-on
+    if (magneticModel.isValid())
+    {
+        magDisturbance.setExpectedDip(magneticModel.getInclination());
+    }
+}
+
+#ifdef MPU9250_DMP
+/**
+ * @name enableDmp
+ * @brief enableDmp: DMP mode, the chip fuses gyro and accelerometer into a quaternion at rate, the MCU only
+ *                   turns its yaw to the magnetometer (DmpYawFusion); the gyro goes to 2000 dps, as the DMP wants
+ * @param [in] uint16_t rate: Hz, quaternions from the FIFO, 1 to DMP_SAMPLE_RATE
+ * @retval bool: false if the image does not load, the Mahony filter goes on
+ * @note built only with the image, see dmp_firmware.h
+ */
+bool MPU9250::enableDmp(uint16_t rate)
+{
+    Gscale = GFS_2000DPS;
+    byte c = readByte(MPU9250_ADDRESS, GYRO_CONFIG);
+    c = c & ~0x18;                                  // Clear GFS bits [4:3]
+    writeByte(MPU9250_ADDRESS, GYRO_CONFIG, c | Gscale << 3);
+
+    if (!dmp.load(*this, DMP_FIRMWARE, DMP_FIRMWARE_SIZE) || !dmp.start(*this, rate))
+    {
+        Serial.println(F("DMP not loaded"));
+        return false;
+    }
+    dmpYaw.reset();
+    Serial.println(F("DMP running"));
+    return true;
+}
+#endif
+
+/* ImuBus: write count consecutive registers, MEM_R_W and FIFO_R_W take them all */
+bool MPU9250::writeRegisters(uint8_t reg, const uint8_t *data, uint8_t count)
+{
+    Wire.beginTransmission(MPU9250_ADDRESS);
+    Wire.write(reg);
+    for (uint8_t i = 0; i < count; ++i) Wire.write(data[i]);
+    return Wire.endTransmission() == 0;
+}
+
+/* ImuBus: read count consecutive registers */
+bool MPU9250::readRegisters(uint8_t reg, uint8_t *data, uint8_t count)
+{
+    Wire.beginTransmission(MPU9250_ADDRESS);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom((uint8_t)MPU9250_ADDRESS, count) != count) return false;
+    for (uint8_t i = 0; i < count; ++i) data[i] = Wire.read();
+    return true;
+}
+
+/* ImuBus: wait */
+void MPU9250::wait(uint16_t ms)
+{
+    delay(ms);
 }
 
 /* Accelerometer and gyroscope self test check calibration wrt factory settings */
@@ -746,15 +979,31 @@ void MPU9250::MadgwickQuaternionUpdate(float ax, float ay, float az, float gx, f
 /*
 Similar to Madgwick scheme but uses proportional and integral filtering
 on the error between estimated reference vectors and measured ones.
+Prediction: integrate the gyro rate over dt, every IMU sample.
+The exponential map of integrator is exact for a rate constant over dt and its coning term follows a rate
+that changes within it, so the error does not grow with dt as the first order step did.
+*/
+void MPU9250::MahonyPredict(float gx, float gy, float gz, float dt)
+{
+    const float rate[3] = {gx, gy, gz};
+    integrator.integrate(q, rate, dt);
+}
+
+/*
+Correction: turn q towards the measured gravity and field, once per magnetometer sample.
+dt is the time since the last correction: the Mahony feedback Kp * e would close the error as exp(-Kp * t)
+between two corrections, so the correction closes 1 - exp(-Kp * dt) of it at once; it never overshoots,
+also at 8 Hz where Kp * dt is 5 at the high gain. Kp follows kpSchedule, see setGainSchedule().
 */
-void MPU9250::MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz)
+void MPU9250::MahonyCorrect(float ax, float ay, float az, float mx, float my, float mz, float dt)
 {
     float q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];   // short name local variable for readability
     float norm;
     float hx, hy, bx, bz;
     float vx, vy, vz, wx, wy, wz;
     float ex, ey, ez;
-    float pa, pb, pc;
+
+    if (dt <= 0.0f) return;
 
     // ----- Auxiliary variables to avoid repeated arithmetic
     float q1q1 = q1 * q1;
@@ -798,15 +1047,20 @@ void MPU9250::MahonyQuaternionUpdate(float ax, float ay, float az, float gx, flo
     wy = 2.0f * bx * (q2q3 - q1q4) + 2.0f * bz * (q1q2 + q3q4);
     wz = 2.0f * bx * (q1q3 + q2q4) + 2.0f * bz * (0.5f - q2q2 - q3q3);
 
-    //  ----- Error is cross product between estimated direction and measured direction of gravity
-    ex = (ay * vz - az * vy) + (my * wz - mz * wy);
-    ey = (az * vx - ax * vz) + (mz * wx - mx * wz);
-    ez = (ax * vy - ay * vx) + (mx * wy - my * wx);
+    //  ----- Error is cross product between estimated direction and measured direction of gravity and field
+    const float weight = magWeight * magDisturbance.getWeight();
+    ex = (ay * vz - az * vy) + weight * (my * wz - mz * wy);
+    ey = (az * vx - ax * vz) + weight * (mz * wx - mx * wz);
+    ez = (ax * vy - ay * vx) + weight * (mx * wy - my * wx);
+
+    // ----- Kp high while the filter converges, low once the mean error is small
+    const float residual[3] = {ex, ey, ez};
+    const float Kp = kpSchedule.update(residual, dt);
     if (Ki > 0.0f)
     {
-    eInt[0] += ex;      // accumulate integral error
-    eInt[1] += ey;
-    eInt[2] += ez;
+    eInt[0] += ex * dt; // accumulate integral error
+    eInt[1] += ey * dt;
+    eInt[2] += ez * dt;
     }
     else
     {
@@ -815,27 +1069,10 @@ void MPU9250::MahonyQuaternionUpdate(float ax, float ay, float az, float gx, flo
     eInt[2] = 0.0f;
     }
 
-    // ----- Apply feedback terms
-    gx = gx + Kp * ex + Ki * eInt[0];
-    gy = gy + Kp * ey + Ki * eInt[1];
-    gz = gz + Kp * ez + Ki * eInt[2];
-
-    // ----- Integrate rate of change of quaternion
-    pa = q2;
-    pb = q3;
-    pc = q4;
-    q1 = q1 + (-q2 * gx - q3 * gy - q4 * gz) * (0.5f * deltat);
-    q2 = pa + (q1 * gx + pb * gz - pc * gy) * (0.5f * deltat);
-    q3 = pb + (q1 * gy - pa * gz + pc * gx) * (0.5f * deltat);
-    q4 = pc + (q1 * gz + pa * gy - pb * gx) * (0.5f * deltat);
-
-    // ----- Normalise quaternion
-    norm = sqrtf(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
-    norm = 1.0f / norm;
-    q[0] = q1 * norm;
-    q[1] = q2 * norm;
-    q[2] = q3 * norm;
-    q[3] = q4 * norm;
+    // ----- Apply feedback terms, as a rate over dt; not a gyro sample, kept out of the coning term
+    float gain = (1.0f - expf(-Kp * dt)) / dt;
+    const float feedback[3] = {gain * ex + Ki * eInt[0], gain * ey + Ki * eInt[1], gain * ez + Ki * eInt[2]};
+    integrator.rotate(q, feedback, dt);
 }
 
 
@@ -866,8 +1103,8 @@ void MPU9250::readGyroData(short * destination)
     destination[2] = ((short)rawData[4] << 8) | rawData[5] ;
 
 }
-/* Read magnetometer registers */
-void MPU9250::readMagData(short * destination)
+/* Read magnetometer registers, true if ST1 reported a new sample without overflow */
+bool MPU9250::readMagData(short * destination)
 {
     byte rawData[7];  // x/y/z gyro register data, ST2 register stored here, must read ST2 at end of data acquisition
     if (readByte(AK8963_ADDRESS, AK8963_ST1) & 0x01) { // wait for magnetometer data ready bit to be set
@@ -877,22 +1114,18 @@ void MPU9250::readMagData(short * destination)
         destination[0] = ((short)rawData[1] << 8) | rawData[0] ;  // Turn the MSB and LSB into a signed 16-bit value
         destination[1] = ((short)rawData[3] << 8) | rawData[2] ;  // Data stored as little Endian
         destination[2] = ((short)rawData[5] << 8) | rawData[4] ;
+        return true;
         }
     }
-
+    return false;
 }
 
 /* Read temperature */
 short MPU9250::readTempData()
 {
-    /* Read temperature */
-    short readTempData()
-    {
-        byte rawData[2];  // x/y/z gyro register data stored here
-        readBytes(MPU9250_ADDRESS, TEMP_OUT_H, 2, &rawData[0]);  // Read the two raw data registers sequentially into data array
-        return ((short)rawData[0] << 8) | rawData[1] ;  // Turn the MSB and LSB into a 16-bit value
-    }
-
+    byte rawData[2];  // x/y/z gyro register data stored here
+    readBytes(MPU9250_ADDRESS, TEMP_OUT_H, 2, &rawData[0]);  // Read the two raw data registers sequentially into data array
+    return ((short)rawData[0] << 8) | rawData[1] ;  // Turn the MSB and LSB into a 16-bit value
 }
 
 /* Initialize the AK8963 magnetometer */
@@ -977,12 +1210,19 @@ void MPU9250::initMPU9250()
     delay(100);
 }
 
-/* Get current MPU-9250 register values */
-void MPU9250::refresh_data()
+/* Get current MPU-9250 register values, true if new data was read */
+bool MPU9250::refresh_data()
 {
 
+    // ----- INT_STATUS clears on read: the wake-on-motion bit is taken here with the data ready one
+    byte status = readByte(MPU9250_ADDRESS, INT_STATUS);
+    if (status & 0x40)
+    {
+        motion.wakeOnMotion();
+    }
+
     // ----- If intPin goes high, all data registers have new data
-    if (readByte(MPU9250_ADDRESS, INT_STATUS) & 0x01)
+    if (status & 0x01)
     {
         readAccelData(accelCount);                          // Read the accelerometer registers
         getAres();                                          // Get accelerometer resolution
@@ -1000,46 +1240,238 @@ void MPU9250::refresh_data()
         gx = (float)gyroCount[0] * gRes; // get actual gyro value, this depends on scale being set
         gy = (float)gyroCount[1] * gRes;
         gz = (float)gyroCount[2] * gRes;
+        float gyro[3] = {gx, gy, gz};
+
+        // ----- Magnetometer calculations, only on a new sample: at 8 Hz most IMU samples have none
+        newMag = readMagData(magCount);                     // Read the magnetometer x|y| registers
+        float magCalibrated[3];
+        if (newMag)
+        {
+            // ----- Calculate the magnetometer values in milliGauss
+            /* softIron * (rawMag*ASA*0.6 - magOffset), precomputed by updateMagTransform() */
+            magTransform.apply(magCount, magCalibrated);
+            if (servoMagModel != NULL) servoMagModel->apply(servoAngle, magCalibrated);
+        }
+
+        // ----- Bias of the die temperature, the enclosure warms in the sun
+        compensateTemperature(gyro, newMag ? magCalibrated : NULL);
+        gx = gyro[0];
+        gy = gyro[1];
+        gz = gyro[2];
+        if (newMag)
+        {
+            mx = magCalibrated[0];
+            my = magCalibrated[1];
+            mz = magCalibrated[2];
+        }
+        return true;
+    }
+    newMag = false;
+    return false;
+}
+
+/* DMP mode: newest quaternion of the FIFO and magnetometer yaw, true if a quaternion was read */
+bool MPU9250::refresh_dmp()
+{
+    float chip[4];
+    if (dmp.read(*this, chip) != 1)
+    {
+        newMag = false;
+        return false;
+    }
+    Now = micros();
+
+    // ----- Accelerometer for the dip check of the disturbance detector only, the DMP fuses its own
+    readAccelData(accelCount);
+    getAres();
+    ax = (float)accelCount[0] * aRes;
+    ay = (float)accelCount[1] * aRes;
+    az = (float)accelCount[2] * aRes;
+
+    // ----- Gyro for the motion detector only, the DMP integrates its own
+    readGyroData(gyroCount);
+    getGres();
+    gx = (float)gyroCount[0] * gRes;
+    gy = (float)gyroCount[1] * gRes;
+    gz = (float)gyroCount[2] * gRes;
+    float gyro[3] = {gx, gy, gz};
+
+    // ----- Magnetometer, in the frame of the filter as calc_quaternion() gives it
+    float magFilter[3];
+    float magCalibrated[3];
+    newMag = readMagData(magCount);
+    if (newMag)
+    {
+        magTransform.apply(magCount, magCalibrated);
+        if (servoMagModel != NULL) servoMagModel->apply(servoAngle, magCalibrated);
+    }
+
+    // ----- Bias of the die temperature: the DMP keeps its own gyro bias, the table serves the motion detector here
+    compensateTemperature(gyro, newMag ? magCalibrated : NULL);
+    gx = gyro[0];
+    gy = gyro[1];
+    gz = gyro[2];
+    motion.update(gyro, secondsSince(Now, lastMotionUpdate));
+    lastMotionUpdate = Now;
+
+    if (newMag)
+    {
+        mx = magCalibrated[0];
+        my = magCalibrated[1];
+        mz = magCalibrated[2];
+        magFilter[0] = my;
+        magFilter[1] = -mx;
+        magFilter[2] = -mz;
+    }
+
+    // ----- The filter flips y of accelerometer and gyro: the same reflection on the DMP quaternion
+    const float q6[4] = {chip[0], -chip[1], chip[2], -chip[3]};
+    if (newMag)
+    {
+        float up[3];
+        getVertical(q6, up);
+        magDisturbance.update(magFilter, up, sqrtf(ax * ax + ay * ay + az * az), secondsSince(Now, lastCorrection));
+    }
+    dmpYaw.update(q6, newMag ? magFilter : NULL, secondsSince(Now, lastCorrection), magWeight * magDisturbance.getWeight());
+    if (newMag)
+    {
+        lastCorrection = Now;
+        attitudeValid = true;                   // the yaw is set at once by the first sample, see DmpYawFusion
+    }
+    dmpYaw.getQuaternion(q);
+    return true;
+}
+
+/*
+s from last to now, 0 for the first sample (last still 0): the first one comes long after boot, past the
+prompts and the calibration, and that time would count as one step of the filter and of the detectors
+*/
+float MPU9250::secondsSince(unsigned long now, unsigned long last)
+{
+    return (last == 0) ? 0.0f : (now - last) / 1000000.0f;
+}
+
+/* Vertical, up, of an attitude in the frame of the filter: the gravity the Mahony filter expects */
+void MPU9250::getVertical(const float quaternion[4], float up[3]) const
+{
+    const float w = quaternion[0], x = quaternion[1], y = quaternion[2], z = quaternion[3];
+    up[0] = 2.0f * (x * z - w * y);
+    up[1] = 2.0f * (w * x + y * z);
+    up[2] = w * w - x * x - y * y + z * z;
+}
+
+/* Temperature bias taken away from the gyro, and the magnetometer if mag is not NULL; learned while stationary */
+void MPU9250::compensateTemperature(float gyro[3], float mag[3])
+{
+    if (gyroTemperature == NULL && magTemperature == NULL)
+    {
+        return;
+    }
+    float temperature;
+    getTemperature(temperature);
+    const unsigned long now = micros();
+    const float dt = secondsSince(now, lastGyroTemperature);
+    lastGyroTemperature = now;
+    float bias[3];
+
+    // ----- Gyro: stationary it reads its own bias
+    if (gyroTemperature != NULL)
+    {
+        if (motion.isStationary()) gyroTemperature->learn(temperature, gyro, dt);
+        gyroTemperature->getBias(temperature, bias);
+        for (int i = 0; i < 3; ++i) gyro[i] -= bias[i];
+    }
+
+    // ----- Magnetometer: only its change is seen, over a window while still; a hull swinging slowly at anchor is
+    // still for the motion detector, so the window ends after TEMPERATURE_MAG_TURN_LIMIT on the gyro
+    if (magTemperature != NULL)
+    {
+        float gyroBiasZupt[3];
+        motion.getGyroBias(gyroBiasZupt);
+        for (int i = 0; i < 3; ++i) magTemperatureTurn[i] += (gyro[i] - gyroBiasZupt[i]) * dt;
+        if (mag != NULL)
+        {
+            const float turn = sqrtf(magTemperatureTurn[0] * magTemperatureTurn[0] + magTemperatureTurn[1] * magTemperatureTurn[1] +
+                                     magTemperatureTurn[2] * magTemperatureTurn[2]);
+            if (motion.isStationary() && !magDisturbance.isDisturbed() && turn < TEMPERATURE_MAG_TURN_LIMIT)
+            {
+                magTemperature->learnChange(temperature, mag, secondsSince(now, lastMagTemperature));
+            }
+            else
+            {
+                magTemperature->restartChange();
+                for (int i = 0; i < 3; ++i) magTemperatureTurn[i] = 0.0f;
+            }
+            lastMagTemperature = now;
+            magTemperature->getBias(temperature, bias);
+            for (int i = 0; i < 3; ++i) mag[i] -= bias[i];
+        }
+    }
+}
+
+/* First fresh magnetometer sample: attitude at once from gravity and field (TRIAD), or the resumed one if it agrees */
+void MPU9250::startAttitude()
+{
+    const float acc[3] = {ax, -ay, az};
+    const float mag[3] = {my, -mx, -mz};
+    float triad[4];
+    if (!attitudeFromVectors(acc, mag, triad))
+    {
+        return;
+    }
+    attitudeValid = true;
+
+    // ----- The hull may have turned while the MCU was held in reset: the resumed attitude only if its yaw agrees
+    if (resumed)
+    {
+        const float yawResumed = atan2f(2.0f * (q[1] * q[2] + q[0] * q[3]), q[0] * q[0] + q[1] * q[1] - q[2] * q[2] - q[3] * q[3]);
+        const float yawTriad = atan2f(2.0f * (triad[1] * triad[2] + triad[0] * triad[3]),
+                                      triad[0] * triad[0] + triad[1] * triad[1] - triad[2] * triad[2] - triad[3] * triad[3]);
+        const float difference = (Bam16::fromRadians(yawResumed) - Bam16::fromRadians(yawTriad)).toSignedDegrees();
+        if (fabsf(difference) <= RESUME_HEADING_TOLERANCE)
+        {
+            return;
+        }
+    }
+    for (int i = 0; i < 4; ++i) q[i] = triad[i];
+    for (int i = 0; i < 3; ++i) eInt[i] = 0.0f;
+}
 
-        // ----- Magnetometer calculations
-        readMagData(magCount);                              // Read the magnetometer x|y| registers
-        getMres();                                          // Get magnetometer resolution
-
-        //    // ----- Kris Winer hard-iron offsets
-        //    magBias[0] = +470.;  // User environmental x-axis correction in milliGauss, should be automatically calculated
-        //    magBias[1] = +120.;  // User environmental x-axis correction in milliGauss
-        //    magBias[2] = +125.;  // User environmental x-axis correction in milliGauss
-
-        // ----- Copy hard-iron offsets
-        magBias[0] = Mag_x_offset;                          // Get hard-iron offsets (from compass_cal)
-        magBias[1] = Mag_y_offset;
-        magBias[2] = Mag_z_offset;
-
-        // ----- Copy the soft-iron scalefactors
-        magScale[0] = Mag_x_scale;
-        magScale[1] = Mag_y_scale;
-        magScale[2] = Mag_z_scale;
-
-        //    // ----- Calculate the magnetometer values in milliGauss
-        //    /* Include factory calibration per data sheet and user environmental corrections */
-        //    mx = (float)magCount[0] * mRes * magCalibration[0] - magBias[0];    // get actual magnetometer value, this depends on scale being set
-        //    my = (float)magCount[1] * mRes * magCalibration[1] - magBias[1];
-        //    mz = (float)magCount[2] * mRes * magCalibration[2] - magBias[2];
-
-        // ----- Calculate the magnetometer values in milliGauss
-        /* The above formula is not using the soft-iron scale factors */
-        mx = ((float)magCount[0] * mRes * magCalibration[0] - magBias[0]) * magScale[0];    // (rawMagX*ASAX*0.6 - magOffsetX)*scalefactor
-        my = ((float)magCount[1] * mRes * magCalibration[1] - magBias[1]) * magScale[1];    // (rawMagY*ASAY*0.6 - magOffsetY)*scalefactor
-        mz = ((float)magCount[2] * mRes * magCalibration[2] - magBias[2]) * magScale[2];    // (rawMagZ*ASAZ*0.6 - magOffsetZ)*scalefactor
+/* Filter state to the RTC memory, a reset resumes from it */
+void MPU9250::saveResume()
+{
+    ResumeState state;
+    state.flags = RESUME_FLAG_ATTITUDE;
+    for (int i = 0; i < 4; ++i) state.quaternion[i] = q[i];
+    for (int i = 0; i < 3; ++i)
+    {
+        state.integral[i] = eInt[i];
+        state.gyroOffset[i] = gyroBias[i];
+        state.accelOffset[i] = accelBias[i];
     }
+    motion.getGyroBias(state.gyroBias);
+    state.calibrationTemperature = calibrationTemperature;
+    state.heading = 0.0f;
+    saveResumeState(state);
+}
 
+/* Fold resolution, factory ASA, hard-iron and soft-iron in magTransform */
+void MPU9250::updateMagTransform()
+{
+    const float inputScale[3] =
+    {
+        mRes * magCalibration[0],
+        mRes * magCalibration[1],
+        mRes * magCalibration[2]
+    };
+    magTransform.set(magSoftIron, magBias, inputScale);
 }
 
 /* Send current MPU-9250 register values to Mahony quaternion filter */
 void MPU9250::calc_quaternion()
 {
     Now = micros();
-    deltat = ((Now - lastUpdate) / 1000000.0f); // set integration time by time elapsed since last filter update
+    deltat = secondsSince(Now, lastUpdate);         // set integration time by time elapsed since last filter update
     lastUpdate = Now;
     sum += deltat; // sum for averaging filter update rate
     sumCount++;
@@ -1056,34 +1488,141 @@ void MPU9250::calc_quaternion()
 
     //  MadgwickQuaternionUpdate(ax, ay, az, gx*PI/180.0f, gy*PI/180.0f, gz*PI/180.0f,  my,  mx, mz);
 
+    // ----- Moving or stationary, and the gyro bias learned while stationary (zero-velocity update)
+    float gyroBiasZupt[3];
+    if (newData)
+    {
+        const float gyro[3] = {gx, gy, gz};
+        motion.update(gyro, secondsSince(Now, lastMotionUpdate));
+        lastMotionUpdate = Now;
+    }
+    motion.getGyroBias(gyroBiasZupt);
+
     // ----- Apply NEU (north east up)signs when parsing values
-    MahonyQuaternionUpdate(
-    ax,                -ay,                  az,
-    gx * DEG_TO_RAD,   -gy * DEG_TO_RAD,     gz * DEG_TO_RAD,
-    my,                -mx,                 -mz);
+    MahonyPredict((gx - gyroBiasZupt[0]) * DEG_TO_RAD,   -(gy - gyroBiasZupt[1]) * DEG_TO_RAD,     (gz - gyroBiasZupt[2]) * DEG_TO_RAD, deltat);
+
+    // ----- A stale magnetometer sample would pull q again towards the same field: correct on fresh ones only
+    if (newMag)
+    {
+        // the first one sets the attitude at once, Kp would take seconds from the identity
+        if (!attitudeValid) startAttitude();
+
+        // norm and dip against the vertical of the filter, the waves do not reach it; the dip with 1 g only
+        const float magFilter[3] = {my, -mx, -mz};
+        float up[3];
+        getVertical(q, up);
+        const bool wasDisturbed = magDisturbance.isDisturbed();
+        magDisturbance.update(magFilter, up, sqrtf(ax * ax + ay * ay + az * az), secondsSince(Now, lastCorrection));
+
+        // back from a disturbance the heading coasted on the gyro: high gain to converge on the field again
+        if (wasDisturbed && !magDisturbance.isDisturbed()) kpSchedule.boost();
+
+        MahonyCorrect(
+        ax,                -ay,                  az,
+        my,                -mx,                 -mz,
+        secondsSince(Now, lastCorrection));
+        lastCorrection = Now;
+    }
 
 }
 
-void MPU9250::getQuaternion(float &quaternion[4])
+void MPU9250::getQuaternion(float quaternion[4])
 {
-    memcpy ( quaternion, &q, sizeof(q) );
+    lastSample.getQuaternion(quaternion);
 }
 
 void MPU9250::getYawPitchRoll(float &yaw, float &pitch, float &roll)
 {
-    yaw = this->yaw:
-    pitch = this->pitch:
-    roll = this->roll:
+    lastSample.getYawPitchRoll(yaw, pitch, roll);
 }
 
 void MPU9250::getTemperature(float &temperature)
 {
+    // ----- The die temperature changes slowly, do not read it every sample
+    if (!temperatureValid || (millis() - lastTemperatureRead >= TEMPERATURE_PERIOD_MS))
+    {
+        tempCount = readTempData();                                 // Read the temperature registers
+        this->temperature = ((float) tempCount) / 333.87 + 21.0;    // Temp in degrees C
+        lastTemperatureRead = millis();
+        temperatureValid = true;
+    }
     temperature = this->temperature;
 }
 
 void MPU9250::getHeading(float &heading)
 {
-    heading = this->heading;
+    heading = lastSample.getHeading();
+}
+
+/*******************
+ * MPU9250Sample
+*******************/
+/* Identity attitude */
+MPU9250Sample::MPU9250Sample()
+{
+    q[0] = 1.0f; q[1] = 0.0f; q[2] = 0.0f; q[3] = 0.0f;
+    declination = 0.0f;
+    timestamp = 0;
+    anglesValid = false;
+}
+
+/* Snapshot of the filter quaternion */
+MPU9250Sample::MPU9250Sample(const float quaternion[4], float declination, unsigned long timestamp)
+{
+    memcpy(q, quaternion, sizeof(q));
+    this->declination = declination;
+    this->timestamp = timestamp;
+    anglesValid = false;
+}
+
+/* Quaternion of this sample */
+void MPU9250Sample::getQuaternion(float quaternion[4]) const
+{
+    memcpy(quaternion, q, sizeof(q));
+}
+
+/* Yaw, pitch and roll in degrees, computed on first request */
+void MPU9250Sample::getYawPitchRoll(float &yaw, float &pitch, float &roll) const
+{
+    computeYawPitchRoll();
+    yaw = this->yaw;
+    pitch = this->pitch;
+    roll = this->roll;
+}
+
+/* Heading 0 to 360 degrees, computed on first request */
+float MPU9250Sample::getHeading() const
+{
+    computeYawPitchRoll();
+    return heading;
+}
+
+/* Euler angles and heading of the quaternion, once per sample */
+void MPU9250Sample::computeYawPitchRoll() const
+{
+    if (anglesValid) return;
+
+    pitch = asin(2.0f * (q[1] * q[3] - q[0] * q[2]));
+    roll  = -atan2(2.0f * (q[0] * q[1] + q[2] * q[3]), q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]);
+    yaw   = atan2(2.0f * (q[1] * q[2] + q[0] * q[3]), q[0] * q[0] + q[1] * q[1] - q[2] * q[2] - q[3] * q[3]);
+
+    // ----- convert to degrees
+    //TODO: flag for select if you want radians or degrees
+    pitch *= RAD_TO_DEG;
+    roll *= RAD_TO_DEG;
+    yaw *= RAD_TO_DEG;
+
+    // ----- calculate the heading
+    /*
+        The yaw and compass heading (after the next two lines) track each other 100%
+    */
+    heading = yaw;
+    if (heading < 0) heading += 360.0;                              // Yaw goes negative between 180 amd 360 degrees
+    heading += declination;                                         // Calculate True North
+    if (heading < 0) heading += 360.0;                              // Allow for under|overflow
+    if (heading >= 360) heading -= 360.0;
+
+    anglesValid = true;
 }
 
 /*******************
@@ -15,10 +15,28 @@
  *-----------------------------------*/
 #include <Wire.h>
 #include <Arduino.h>
+#include <CalibrationTransform.h>
+#include <BinaryAngle.h>
+#include <ServoMagModel.h>
+#include <MotionDetector.h>
+#include <Dmp.h>
+#include <DmpYawFusion.h>
+#include <MagneticModel.h>
+#include <MagDisturbanceDetector.h>
+#include <TemperatureBiasTable.h>
+#include <GainScheduler.h>
+#include <QuaternionIntegrator.h>
 #include "mpu9250_defs.h"
+#include "dmp_firmware.h"
 /*-----------------------------------*
  * PUBLIC DEFINES
  *-----------------------------------*/
+const float DEFAULT_WOM_THRESHOLD_MG = 40.0f;           // wake-on-motion threshold of the accelerometer
+const uint16_t DEFAULT_DMP_RATE = 100;                  // Hz, quaternions from the DMP FIFO
+const float RESUME_HEADING_TOLERANCE = 10.0f;           // deg, a resumed attitude off the first TRIAD by more is dropped
+// Kp of the Mahony filter, 1/s: 40 converges in a moment, 5 keeps the needle quiet; residual in sine of the error
+const gain_schedule_t DEFAULT_MAHONY_GAIN_SCHEDULE = {40.0f, 5.0f, 5.0f, 3.0f, 0.05f, 0.2f};
+
 /*-----------------------------------*
  * PUBLIC MACROS
  *-----------------------------------*/
@@ -27,7 +45,59 @@
 /*-----------------------------------*
  * PUBLIC TYPEDEFS
  *-----------------------------------*/
-/* None */
+class MPU9250Sample
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name MPU9250Sample
+     * @brief MPU9250Sample: identity attitude
+     */
+    MPU9250Sample();
+
+    /**
+     * @name MPU9250Sample
+     * @brief MPU9250Sample: snapshot of the filter quaternion
+     * @param [in] const float quaternion[4]: filter quaternion q0..q3
+     * @param [in] float declination: deg added to the heading, 0 for magnetic north
+     * @param [in] unsigned long timestamp: micros() of the sample
+     */
+    MPU9250Sample(const float quaternion[4], float declination, unsigned long timestamp);
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /* Quaternion of this sample */
+    void getQuaternion(float quaternion[4]) const;
+    /* Yaw, pitch and roll in degrees, computed on first request */
+    void getYawPitchRoll(float &yaw, float &pitch, float &roll) const;
+    /* Heading 0 to 360 degrees, computed on first request */
+    float getHeading() const;
+    /* Heading as binary angle, for bearing and servo arithmetic */
+    Bam16 getHeadingAngle() const { return Bam16::fromDegrees(getHeading()); }
+    /* micros() of the sample */
+    unsigned long getTimestamp() const { return timestamp; }
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void computeYawPitchRoll() const;
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    float q[4];
+    float declination;
+    unsigned long timestamp;
+
+    // ----- Derived values, computed on first request
+    mutable bool anglesValid;
+    mutable float yaw, pitch, roll, heading;
+
+}; /* MPU9250Sample */
 
 /*-----------------------------------*
  * PUBLIC VARIABLE DECLARATIONS
@@ -38,7 +108,7 @@
  * PUBLIC FUNCTION PROTOTYPES
  *-----------------------------------*/
 
-class MPU9250
+class MPU9250 : public ImuBus
 {
 public:
     /*******************
@@ -70,15 +140,28 @@ public:
     /* Get accelerometer resolution */
     void getAres();
 
-    void getQuaternion(float &quaternion[4]);
+    /**
+     * @name sample
+     * @brief sample: read the sensors, run the filter and keep a snapshot of the quaternion
+     * @retval const MPU9250Sample &: the new snapshot, valid until the next sample()
+     */
+    const MPU9250Sample &sample();
+
+    /* Snapshot of the last sample(), no bus access */
+    const MPU9250Sample &getLastSample() const { return lastSample; }
+
+    /* Values of the last sample(), derived values are computed once per sample */
+    void getQuaternion(float quaternion[4]);
 
     void getYawPitchRoll(float &yaw, float &pitch, float &roll);
 
-    void getTemperature(float &temperature);
     void getHeading(float &heading);
 
+    /* Die temperature, read from the sensor at most once every TEMPERATURE_PERIOD_MS */
+    void getTemperature(float &temperature);
+
 
-    /* refresh data and compute*/
+    /* refresh data and compute, same as sample(); true if the sensors had new data */
     bool update();
 
     /*
@@ -91,6 +174,135 @@ public:
     It calculates the bias and scale in the x, y, and z axes.
     */
     void magCalMPU9250(float * bias_dest, float * scale_dest);
+
+    /**
+     * @name setMagCalibration
+     * @brief setMagCalibration: replace the magnetometer calibration, m = softIron * (raw * mRes * ASA - bias)
+     * @param [in] const float bias[3]: hard-iron offset in milliGauss
+     * @param [in] const float softIron[3][3]: soft-iron matrix, diag(Mag_*_scale) for the min/max calibration
+     * @retval None
+     */
+    void setMagCalibration(const float bias[3], const float softIron[3][3]);
+
+    /**
+     * @name setServoMagModel
+     * @brief setServoMagModel: bias of a servo near the magnetometer, taken away after the calibration
+     * @param [in] const ServoMagModel *model: model, NULL for none; kept by pointer, it must outlive the sensor
+     * @retval None
+     */
+    void setServoMagModel(const ServoMagModel *model);
+
+    /**
+     * @name setServoAngle
+     * @brief setServoAngle: servo angle of the next samples, for the servo model
+     * @param [in] float angle: deg, servo frame
+     * @retval None
+     */
+    void setServoAngle(float angle);
+
+    /**
+     * @name setTemperatureBias
+     * @brief setTemperatureBias: bias of gyro and magnetometer versus the die temperature, taken away from every sample
+     *                            and learned while stationary; the gyro table is taken to zero at the temperature of
+     *                            the calibration at boot, kept across a reset
+     * @param [in] TemperatureBiasTable *gyro: deg/s, NULL for none; kept by pointer, it must outlive the sensor
+     * @param [in] TemperatureBiasTable *mag: milliGauss after the calibration and the servo model, NULL for none
+     * @retval None
+     */
+    void setTemperatureBias(TemperatureBiasTable *gyro, TemperatureBiasTable *mag);
+
+    /**
+     * @name setMagWeight
+     * @brief setMagWeight: weight of the magnetometer in the Mahony filter, e.g. down while a servo moves
+     * @param [in] float weight: 0 gyro and accelerometer only, 1 full weight
+     * @retval None
+     */
+    void setMagWeight(float weight);
+
+    /**
+     * @name setGainSchedule
+     * @brief setGainSchedule: gains of the Mahony filter, Kp scheduled on the residual of the correction, see GainScheduler
+     * @param [in] const gain_schedule_t &schedule: Kp, 1/s; DEFAULT_MAHONY_GAIN_SCHEDULE at start
+     * @param [in] float ki: integral gain, 1/s^2, 0 for none
+     * @retval None
+     */
+    void setGainSchedule(const gain_schedule_t &schedule, float ki = 0.0f);
+
+    /**
+     * @name getGain
+     * @brief getGain: Kp of the Mahony filter now, 1/s
+     */
+    float getGain() const { return kpSchedule.getGain(); }
+
+    /**
+     * @name setIntegrator
+     * @brief setIntegrator: how the Mahony filter integrates the gyro, see QuaternionIntegrator
+     * @param [in] quaternion_integrator_t method: CONING at start, EULER the original first order step
+     * @retval None
+     */
+    void setIntegrator(quaternion_integrator_t method);
+
+    /**
+     * @name setMagRate
+     * @brief setMagRate: output data rate of the AK8963, the filter corrects the attitude once per magnetometer sample
+     * @param [in] byte mode: M_8HZ or M_100HZ continuous mode
+     * @retval None
+     */
+    void setMagRate(byte mode);
+
+    /**
+     * @name enableWakeOnMotion
+     * @brief enableWakeOnMotion: wake-on-motion interrupt of the accelerometer, read with the data ready in INT_STATUS;
+     *                            a motion over the threshold takes the compass out of STATIONARY at the next read
+     * @param [in] float thresholdMg: mg between two accelerometer samples, 4 to 1020
+     * @retval None
+     */
+    void enableWakeOnMotion(float thresholdMg = DEFAULT_WOM_THRESHOLD_MG);
+
+    /**
+     * @name isStationary
+     * @brief isStationary: compass still, the filter runs every STATIONARY_FUSION_PERIOD_MS and the gyro bias is learned
+     * @retval bool
+     */
+    bool isStationary() const { return motion.isStationary(); }
+
+    /* Field disturbed by a magnet or steel nearby: the filter coasts on the gyro, see MagDisturbanceDetector */
+    bool isMagDisturbed() const { return magDisturbance.isDisturbed(); }
+
+    /**
+     * @name setLocation
+     * @brief setLocation: position and date for the declination of the World Magnetic Model, e.g. from a GPS;
+     *                     cheap to call at every fix, the model is evaluated again only a few km away; its dip
+     *                     checks the reference field of the disturbance detector
+     * @param [in] double latitude: deg
+     * @param [in] double longitude: deg
+     * @param [in] float year: decimal year, e.g. 2026.5; out of the life of the model its nearest end is taken
+     * @retval None
+     */
+    void setLocation(double latitude, double longitude, float year);
+
+    /* Declination added with True_North: of the model once a location is set, else Declination */
+    float getDeclination() const { return magneticModel.isValid() ? magneticModel.getDeclination() : Declination; }
+
+    /**
+     * @name enableDmp
+     * @brief enableDmp: DMP mode, the chip fuses gyro and accelerometer into a quaternion at rate, the MCU only
+     *                   turns its yaw to the magnetometer (DmpYawFusion); the gyro goes to 2000 dps, as the DMP wants
+     * @param [in] uint16_t rate: Hz, quaternions from the FIFO, 1 to DMP_SAMPLE_RATE
+     * @retval bool: false if the image does not load, the Mahony filter goes on
+     * @note built only with the image, see dmp_firmware.h
+     */
+#ifdef MPU9250_DMP
+    bool enableDmp(uint16_t rate = DEFAULT_DMP_RATE);
+#endif
+
+    /* DMP mode on */
+    bool isDmpEnabled() const { return dmp.isRunning(); }
+
+    /* ImuBus: register access of the DMP loader, I2C at MPU9250_ADDRESS */
+    bool writeRegisters(uint8_t reg, const uint8_t *data, uint8_t count);
+    bool readRegisters(uint8_t reg, uint8_t *data, uint8_t count);
+    void wait(uint16_t ms);
     /* Accelerometer and gyroscope self test; check calibration wrt factory settings */
     void MPU9250SelfTest(float * destination); // Should return percent deviation from factory trim values, +/- 14 or less deviation is a pass
   
@@ -113,8 +325,8 @@ private:
     void readAccelData(short * destination);
     /* Read gyro registers */
     void readGyroData(short * destination);
-    /* Read magnetometer registers */
-    void readMagData(short * destination);
+    /* Read magnetometer registers, true if ST1 reported a new sample without overflow */
+    bool readMagData(short * destination);
     /* Read temperature */
     short readTempData();
     /* Initialize the AK8963 magnetometer */
@@ -122,12 +334,33 @@ private:
     /* Initialize the MPU9250|MPU6050 chipset */
     void initMPU9250();
 
-    /* Get current MPU-9250 register values */
-    void refresh_data();
+    /* Get current MPU-9250 register values, true if new data was read; newMag tells a fresh magnetometer sample */
+    bool refresh_data();
 
-    /* Send current MPU-9250 register values to Mahony quaternion filter */
+    /* Gyro prediction every sample, accelerometer and magnetometer correction on a fresh magnetometer sample */
     void calc_quaternion();
 
+    /* DMP mode: newest quaternion of the FIFO and magnetometer yaw, true if a quaternion was read */
+    bool refresh_dmp();
+
+    /* s from last to now, 0 for the first sample */
+    static float secondsSince(unsigned long now, unsigned long last);
+
+    /* Vertical, up, of an attitude in the frame of the filter */
+    void getVertical(const float quaternion[4], float up[3]) const;
+
+    /* Temperature bias taken away from the gyro, and the magnetometer if mag is not NULL; learned while stationary */
+    void compensateTemperature(float gyro[3], float mag[3]);
+
+    /* First fresh magnetometer sample: attitude at once from gravity and field (TRIAD), or the resumed one if it agrees */
+    void startAttitude();
+
+    /* Filter state to the RTC memory, a reset resumes from it */
+    void saveResume();
+
+    /* Fold resolution, factory ASA, hard-iron and soft-iron in magTransform */
+    void updateMagTransform();
+
     void writeByte(byte address, byte subAddress, byte data);
     byte readByte(byte address, byte subAddress);
     void readBytes(byte address, byte subAddress, byte count, byte * dest);
@@ -145,8 +378,12 @@ private:
     /*
     Similar to Madgwick scheme but uses proportional and integral filtering
     on the error between estimated reference vectors and measured ones.
+    The update is split in two: the prediction integrates the gyro rate over deltat at the IMU rate,
+    the correction turns q towards the measured gravity and field over the time since the last correction.
+    Both rotate q through integrator, exact for the angle of a sample: the fusion rate can go down.
     */
-    void MahonyQuaternionUpdate(float ax, float ay, float az, float gx, float gy, float gz, float mx, float my, float mz);
+    void MahonyPredict(float gx, float gy, float gz, float dt);
+    void MahonyCorrect(float ax, float ay, float az, float mx, float my, float mz, float dt);
 
 
 
@@ -160,10 +397,12 @@ private:
     By convention, declination is positive when magnetic north
     is east of true north, and negative when it is to the west.
     Substitute your magnetic declination for the "Declination" shown below.
+    It is used until setLocation() gives a position to the World Magnetic Model.
     */
 
     #define True_North false          // change this to "true" for True North                
     float Declination = +3.633;     // substitute your magnetic declination
+    MagneticModel magneticModel;    // declination at the location, see setLocation()
     
     // Magnetic calibration offset
     float Mag_x_offset = 366.695;
@@ -178,13 +417,39 @@ private:
     short gyroCount[3];                                 // Stores the 16-bit signed gyro sensor output
     short magCount[3];                                  // Stores the 16-bit signed magnetometer sensor output
     float magCalibration[3] = {0, 0, 0},
-                            magBias[3] = {0, 0, 0},
-                                        magScale[3] = {0, 0, 0};    // Factory mag calibration, mag offset , mag scale-factor
+                            magBias[3] = {Mag_x_offset, Mag_y_offset, Mag_z_offset};    // Factory mag calibration, mag offset
+    float magSoftIron[3][3] =
+    {
+        {Mag_x_scale, 0.0f, 0.0f},
+        {0.0f, Mag_y_scale, 0.0f},
+        {0.0f, 0.0f, Mag_z_scale}
+    };                                                  // mag soft-iron matrix, the scale-factors on the diagonal
+    CalibrationTransform magTransform;                  // all of the above in one 3x4 transform, see updateMagTransform()
+    const ServoMagModel *servoMagModel = NULL;          // bias of the servo versus its angle, after magTransform
+    float servoAngle = 0.0f;                            // deg, servo frame
+    float magWeight = 1.0f;                             // weight of the magnetometer error in the Mahony filter
+    MotionDetector motion;                              // moving / stationary, gyro bias learned while stationary
+    unsigned long lastMotionUpdate = 0;                 // micros() of the last gyro sample given to motion
+    unsigned long lastFusion = 0;                       // millis() of the last sample() that read the sensors
+    Dmp dmp;                                            // DMP mode, see enableDmp()
+    DmpYawFusion dmpYaw;                                // magnetometer yaw of the DMP quaternion
+    MagDisturbanceDetector magDisturbance;              // weight of the magnetometer from its norm and dip
+    TemperatureBiasTable *gyroTemperature = NULL;       // gyro bias versus the die temperature, see setTemperatureBias()
+    TemperatureBiasTable *magTemperature = NULL;        // magnetometer bias versus the die temperature
+    unsigned long lastGyroTemperature = 0;              // micros() of the last gyro sample given to gyroTemperature
+    unsigned long lastMagTemperature = 0;               // micros() of the last magnetometer sample given to magTemperature
+    float magTemperatureTurn[3] = {0.0f, 0.0f, 0.0f};   // deg turned on the gyro since the reference of magTemperature
     float gyroBias[3] = {0, 0, 0},
                         accelBias[3] = {0, 0, 0};        // Bias corrections for gyro and accelerometer
     short tempCount;                                    // temperature raw count output
     float temperature;                                  // Stores the real internal chip temperature in degrees Celsius
+    unsigned long lastTemperatureRead = 0;              // millis() of the last temperature read
+    bool temperatureValid = false;                      // temperature has been read at least once
     float SelfTest[6];                                  // holds results of gyro and accelerometer self test
+    float calibrationTemperature = 0.0f;                // degC of the calibration at boot, the zero of gyroTemperature
+    bool attitudeValid = false;                         // q set by TRIAD or by the state before a reset, not the identity
+    bool resumed = false;                               // q, eInt and biases of the state before a reset, see ResumeState
+    unsigned long lastResumeSave = 0;                   // millis() of the last state written to the RTC memory
 
     /*
     There is a tradeoff in the beta parameter between accuracy and response speed.
@@ -205,15 +470,17 @@ private:
     float beta = sqrt(3.0f / 4.0f) * GyroMeasError;     // compute beta
     float zeta = sqrt(3.0f / 4.0f) * GyroMeasDrift;     // compute zeta, the other free parameter in the Madgwick scheme usually set to a small or zero value
 
-    // ----- Mahony free parameters
-    //#define Kp 2.0f * 5.0f                            // original Kp proportional feedback parameter in Mahony filter and fusion scheme
-    #define Kp 40.0f                                    // Kp proportional feedback parameter in Mahony filter and fusion scheme
-    #define Ki 0.0f                                     // Ki integral parameter in Mahony filter and fusion scheme
+    // ----- Mahony free parameters, see setGainSchedule()
+    GainScheduler kpSchedule = GainScheduler(DEFAULT_MAHONY_GAIN_SCHEDULE);    // Kp proportional feedback parameter, high to converge, low in steady state
+    float Ki = 0.0f;                                    // Ki integral parameter in Mahony filter and fusion scheme
+    QuaternionIntegrator integrator;                    // gyro and feedback into q, see setIntegrator()
 
     unsigned long delt_t = 0;                           // used to control display output rate
     unsigned long count = 0, sumCount = 0;              // used to control display output rate
-    float pitch, roll, yaw;
-    float heading;
+    MPU9250Sample lastSample;                           // quaternion of the last sample(), angles computed on request
+    bool newData = false;                               // last sample() read new sensor data
+    bool newMag = false;                                // last sample() read a new magnetometer sample
+    unsigned long lastCorrection = 0;                   // micros() of the last accelerometer and magnetometer correction
 
     float deltat = 0.0f, sum = 0.0f;                    // integration interval for both filter schemes
     unsigned long lastUpdate = 0, firstUpdate = 0;      // used to calculate integration interval
@@ -227,7 +494,7 @@ private:
     byte Gscale = GFS_250DPS;
     byte Ascale = AFS_2G;
     byte Mscale = MFS_14BITS;                           // Choose either 14-bit or 16-bit magnetometer resolution (AK8963=14-bits)
-    byte Mmode = 0x02;                                  // 2 for 8 Hz, 6 for 100 Hz continuous magnetometer data read
+    byte Mmode = M_8HZ;                                 // M_8HZ or M_100HZ continuous magnetometer data read, see setMagRate()
     float aRes, gRes, mRes;                             // scale resolutions per LSB for the sensors
 
 }; /* MPU9250 */
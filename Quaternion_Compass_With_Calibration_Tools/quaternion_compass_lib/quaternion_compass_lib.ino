@@ -6,13 +6,20 @@ unsigned long Timer1 = 500000L;   // 500mS loop ... used when sending data to to
 unsigned long Stop1;              // Timer1 stops when micros() exceeds this value
 
 
-MCU9250::MCU9250 *mpu;
+MPU9250 *mpu;
+TemperatureBiasTable gyroTemperature;       // bias versus die temperature, learned while still; empty at every boot here
+TemperatureBiasTable magTemperature;
 // -----------------
 // setup()
 // -----------------
 void setup()
 {
-  mpu = new MCU9250::MCU9250();
+  mpu = new MPU9250();
+  mpu->enableWakeOnMotion();                 // out of the stationary low rate as soon as the compass is moved
+  mpu->setTemperatureBias(&gyroTemperature, &magTemperature);
+#ifdef MPU9250_DMP
+  mpu->enableDmp();                          // 6-axis fusion on the DMP, built with the image, see dmp_firmware.h
+#endif
  
 }
 
@@ -21,7 +28,7 @@ void setup()
 // ----------
 void loop()
 {
-  mpu->update();
+  mpu->sample();                            // One sensor read, heading & angles computed on request
   // ----- Perform these tasks every 500mS
   delt_t = millis() - count;
   if (delt_t > 500)
@@ -85,8 +92,6 @@ void view_heading_SM()
   print_number((short)heading);
 
   // ----- Print temperature in degrees Centigrade
-  tempCount = readTempData();                               // Read the temperature registers
-  temperature = ((float) tempCount) / 333.87 + 21.0;        // Temp in degrees C
   Serial.print("        Temp(C) ");
   Serial.print(temperature, 1);
   
@@ -0,0 +1,176 @@
+/**
+ * @file BinaryAngle.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief 16 bit binary angle (BAM16) for headings, bearings and servo positions
+ *
+ * The full turn is mapped on the 65536 values of an uint16_t, 1 LSB = 360/65536 = 0.0055 deg:
+ *      - sums and differences wrap around 360 deg by the natural unsigned overflow, no % 360
+ *      - the difference of two angles read as int16_t is the shortest rotation, -180 to +180 deg,
+ *        with no delta > 180 / delta < -180 branches
+ *
+ * @note Header only and no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef BINARY_ANGLE_H
+#define BINARY_ANGLE_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const float BAM16_PER_DEGREE    = 65536.0f / 360.0f;
+const float BAM16_PER_RADIAN    = 65536.0f / 6.283185307179586f;
+const int32_t BAM16_TURN        = 65536;        // LSB in a full turn
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class Bam16
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name Bam16
+     * @brief Bam16: constructor, 0 deg
+     */
+    Bam16() : value(0) {}
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name fromRaw
+     * @brief fromRaw: angle from its binary value
+     * @param [in] uint16_t raw: 0 to 65535, one turn
+     * @retval Bam16
+     */
+    static Bam16 fromRaw(uint16_t raw) { Bam16 angle; angle.value = raw; return angle; }
+
+    /**
+     * @name fromDegrees
+     * @brief fromDegrees: angle from degrees, any range, rounded to the nearest LSB
+     * @param [in] float degrees: angle deg
+     * @retval Bam16
+     */
+    static Bam16 fromDegrees(float degrees) { return fromScaled(degrees * BAM16_PER_DEGREE); }
+
+    /**
+     * @name fromRadians
+     * @brief fromRadians: angle from radians, any range, rounded to the nearest LSB
+     * @param [in] float radians: angle rad
+     * @retval Bam16
+     */
+    static Bam16 fromRadians(float radians) { return fromScaled(radians * BAM16_PER_RADIAN); }
+
+    /**
+     * @name raw
+     * @brief raw: binary value
+     * @retval uint16_t 0 to 65535
+     */
+    uint16_t raw() const { return value; }
+
+    /**
+     * @name signedRaw
+     * @brief signedRaw: binary value as a signed angle, -32768 (-180 deg) to 32767
+     * @retval int16_t
+     */
+    int16_t signedRaw() const { return (int16_t)value; }
+
+    /**
+     * @name toDegrees
+     * @brief toDegrees: angle 0 to 360 deg
+     * @retval float
+     */
+    float toDegrees() const { return value / BAM16_PER_DEGREE; }
+
+    /**
+     * @name toSignedDegrees
+     * @brief toSignedDegrees: angle -180 to 180 deg, e.g. the shortest rotation of a difference
+     * @retval float
+     */
+    float toSignedDegrees() const { return signedRaw() / BAM16_PER_DEGREE; }
+
+    /**
+     * @name toRadians
+     * @brief toRadians: angle 0 to 2 pi rad
+     * @retval float
+     */
+    float toRadians() const { return value / BAM16_PER_RADIAN; }
+
+    /**
+     * @name toSignedRadians
+     * @brief toSignedRadians: angle -pi to pi rad
+     * @retval float
+     */
+    float toSignedRadians() const { return signedRaw() / BAM16_PER_RADIAN; }
+
+    /**
+     * @name toIntDegrees
+     * @brief toIntDegrees: angle rounded to 0 to 359 deg, for the int interfaces (web page, logs)
+     * @retval int
+     */
+    int toIntDegrees() const { return (int)(((uint32_t)value * 360u + 32768u) >> 16) % 360; }
+
+    // ----- Wrapping arithmetic, the difference is the shortest rotation
+    Bam16 operator+(Bam16 other) const { return fromRaw((uint16_t)(value + other.value)); }
+    Bam16 operator-(Bam16 other) const { return fromRaw((uint16_t)(value - other.value)); }
+    Bam16 operator-() const { return fromRaw((uint16_t)(0u - value)); }
+    Bam16 &operator+=(Bam16 other) { value = (uint16_t)(value + other.value); return *this; }
+    Bam16 &operator-=(Bam16 other) { value = (uint16_t)(value - other.value); return *this; }
+    bool operator==(Bam16 other) const { return value == other.value; }
+    bool operator!=(Bam16 other) const { return value != other.value; }
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    static Bam16 fromScaled(float scaled)
+    {
+        // int32 keeps several turns of either sign, the cast to uint16 wraps them
+        const int32_t rounded = (int32_t)(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+        return fromRaw((uint16_t)rounded);
+    }
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    uint16_t value;
+
+}; /* Bam16 */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/**
+ * @name bamToDegrees
+ * @brief bamToDegrees: degrees of an angle accumulated in BAM16 LSB beyond one turn (e.g. a servo position)
+ * @param [in] int32_t lsb: angle in 360/65536 deg units, any number of turns
+ * @retval float deg
+ */
+inline float bamToDegrees(int32_t lsb) { return lsb / BAM16_PER_DEGREE; }
+
+
+#endif /* BINARY_ANGLE_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,74 @@
+/**
+ * @file CalibrationTransform.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Precomputed 3x4 affine calibration of a 3 axis sensor
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "CalibrationTransform.h"
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name CalibrationTransform
+ * @brief CalibrationTransform: constructor, identity transform
+ */
+CalibrationTransform::CalibrationTransform()
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 4; ++j) m[i][j] = (i == j) ? 1.0f : 0.0f;
+    }
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name set
+ * @brief set: fold the calibration chain in the affine transform
+ * @param [in] float const softIron[3][3]: soft-iron (or misalignment and scale) matrix
+ * @param [in] float const bias[3]: bias, in the unit of diag(inputScale) * raw
+ * @param [in] float const inputScale[3]: per axis scale of the raw values (e.g. mRes * ASA), NULL for 1
+ * @retval None
+ */
+void CalibrationTransform::set(float const softIron[3][3], float const bias[3], float const inputScale[3])
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        float translation = 0.0f;
+        for (int j = 0; j < 3; ++j)
+        {
+            m[i][j] = softIron[i][j] * (inputScale ? inputScale[j] : 1.0f);
+            translation -= softIron[i][j] * bias[j];
+        }
+        m[i][3] = translation;
+    }
+}
+
+/**
+ * @name setDiagonal
+ * @brief setDiagonal: fold a calibration with per axis scale only, softIron = diag(scale)
+ * @param [in] float const scale[3]: per axis scale applied after the bias
+ * @param [in] float const bias[3]: bias, in the unit of diag(inputScale) * raw
+ * @param [in] float const inputScale[3]: per axis scale of the raw values, NULL for 1
+ * @retval None
+ */
+void CalibrationTransform::setDiagonal(float const scale[3], float const bias[3], float const inputScale[3])
+{
+    float const softIron[3][3] =
+    {
+        {scale[0], 0.0f, 0.0f},
+        {0.0f, scale[1], 0.0f},
+        {0.0f, 0.0f, scale[2]}
+    };
+    set(softIron, bias, inputScale);
+}
+
+/****************************************************************************
+ ****************************************************************************/
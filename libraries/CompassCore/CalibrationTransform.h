@@ -0,0 +1,127 @@
+/**
+ * @file CalibrationTransform.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Precomputed 3x4 affine calibration of a 3 axis sensor
+ *
+ * The calibration chain
+ *      calibrated = softIron * (diag(inputScale) * raw - bias)
+ * (resolution and factory sensitivity in inputScale, hard-iron in bias, soft-iron matrix) is
+ * folded once, when the calibration changes, into
+ *      calibrated = A * raw + t        with A = softIron * diag(inputScale), t = -softIron * bias
+ * so every sample costs 9 multiplications and 9 additions, and the raw input is never modified.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef CALIBRATION_TRANSFORM_H
+#define CALIBRATION_TRANSFORM_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class CalibrationTransform
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name CalibrationTransform
+     * @brief CalibrationTransform: constructor, identity transform
+     */
+    CalibrationTransform();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name set
+     * @brief set: fold the calibration chain in the affine transform
+     * @param [in] float const softIron[3][3]: soft-iron (or misalignment and scale) matrix
+     * @param [in] float const bias[3]: bias, in the unit of diag(inputScale) * raw
+     * @param [in] float const inputScale[3]: per axis scale of the raw values (e.g. mRes * ASA), NULL for 1
+     * @retval None
+     */
+    void set(float const softIron[3][3], float const bias[3], float const inputScale[3] = NULL);
+
+    /**
+     * @name setDiagonal
+     * @brief setDiagonal: fold a calibration with per axis scale only, softIron = diag(scale)
+     * @param [in] float const scale[3]: per axis scale applied after the bias
+     * @param [in] float const bias[3]: bias, in the unit of diag(inputScale) * raw
+     * @param [in] float const inputScale[3]: per axis scale of the raw values, NULL for 1
+     * @retval None
+     */
+    void setDiagonal(float const scale[3], float const bias[3], float const inputScale[3] = NULL);
+
+    /**
+     * @name apply
+     * @brief apply: calibrate one sample
+     * @param [in] const float raw[3]: raw sample
+     * @param [out] float calibrated[3]: calibrated sample
+     * @retval None
+     */
+    inline void apply(const float raw[3], float calibrated[3]) const
+    {
+        const float x = raw[0], y = raw[1], z = raw[2];
+        calibrated[0] = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+        calibrated[1] = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+        calibrated[2] = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+    }
+
+    /**
+     * @name apply
+     * @brief apply: calibrate one sample of raw register counts
+     * @param [in] const int16_t raw[3]: raw counts
+     * @param [out] float calibrated[3]: calibrated sample
+     * @retval None
+     */
+    inline void apply(const int16_t raw[3], float calibrated[3]) const
+    {
+        const float values[3] = {(float)raw[0], (float)raw[1], (float)raw[2]};
+        apply(values, calibrated);
+    }
+
+
+private:
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    float m[3][4];      // [A | t]
+
+}; /* CalibrationTransform */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* CALIBRATION_TRANSFORM_H */
+
+/****************************************************************************
+ ****************************************************************************/
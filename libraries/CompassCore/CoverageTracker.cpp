@@ -0,0 +1,590 @@
+/**
+ * @file CoverageTracker.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Sphere coverage map of the magnetometer calibration capture
+ *
+ * The face of a direction is found in two steps: the nearest of the 20 icosahedron face
+ * centres, then the nearest of its 4 children, so a sample costs 24 dot products. The centres
+ * are a table in flash, read with pgm_read_float on the MCU.
+ * The fit keeps the x^2 coefficient at 1, so it stays linear whatever the origin of the sums;
+ * its 6x6 normal equations are solved every COVERAGE_FIT_INTERVAL samples.
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "CoverageTracker.h"
+#include <math.h>
+#include <string.h>
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#elif defined(ESP8266)
+#include <pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_float(address) (*(const float *)(address))
+#endif
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const uint8_t COVERAGE_MIN_BINS_FOR_RESIDUAL = 12;
+const uint8_t FIT_PARAMETERS                 = 6;
+
+// face centres of the icosahedron (vertices (+-1, +-phi, 0) and their cyclic permutations), on the unit sphere
+const float ICOSPHERE_BASE_CENTRE[COVERAGE_BASE_FACES][3] PROGMEM =
+{
+    {-0.5773503f,  0.5773503f,  0.5773503f},
+    { 0.0000000f,  0.9341724f,  0.3568221f},
+    { 0.0000000f,  0.9341724f, -0.3568221f},
+    {-0.5773503f,  0.5773503f, -0.5773503f},
+    {-0.9341724f,  0.3568221f,  0.0000000f},
+    { 0.5773503f,  0.5773503f,  0.5773503f},
+    {-0.3568221f,  0.0000000f,  0.9341724f},
+    {-0.9341724f, -0.3568221f,  0.0000000f},
+    {-0.3568221f,  0.0000000f, -0.9341724f},
+    { 0.5773503f,  0.5773503f, -0.5773503f},
+    { 0.5773503f, -0.5773503f,  0.5773503f},
+    { 0.0000000f, -0.9341724f,  0.3568221f},
+    { 0.0000000f, -0.9341724f, -0.3568221f},
+    { 0.5773503f, -0.5773503f, -0.5773503f},
+    { 0.9341724f, -0.3568221f,  0.0000000f},
+    { 0.3568221f,  0.0000000f,  0.9341724f},
+    {-0.5773503f, -0.5773503f,  0.5773503f},
+    {-0.5773503f, -0.5773503f, -0.5773503f},
+    { 0.3568221f,  0.0000000f, -0.9341724f},
+    { 0.9341724f,  0.3568221f,  0.0000000f}
+};
+
+// centres of the 4 faces each base face splits into at its edge midpoints: children of base face f are 4f .. 4f+3
+const float ICOSPHERE_CHILD_CENTRE[COVERAGE_BINS][3] PROGMEM =
+{
+    {-0.5804106f,  0.7625749f,  0.2856625f}, {-0.7625749f,  0.2856625f,  0.5804106f},  // face 0
+    {-0.2856625f,  0.5804106f,  0.7625749f}, {-0.5773503f,  0.5773503f,  0.5773503f},
+    {-0.2947481f,  0.9391240f,  0.1765491f}, { 0.0000000f,  0.7569597f,  0.6534616f},  // face 1
+    { 0.2947481f,  0.9391240f,  0.1765491f}, { 0.0000000f,  0.9341724f,  0.3568221f},
+    {-0.2947481f,  0.9391240f, -0.1765491f}, { 0.2947481f,  0.9391240f, -0.1765491f},  // face 2
+    { 0.0000000f,  0.7569597f, -0.6534616f}, { 0.0000000f,  0.9341724f, -0.3568221f},
+    {-0.5804106f,  0.7625749f, -0.2856625f}, {-0.2856625f,  0.5804106f, -0.7625749f},  // face 3
+    {-0.7625749f,  0.2856625f, -0.5804106f}, {-0.5773503f,  0.5773503f, -0.5773503f},
+    {-0.7569597f,  0.6534616f,  0.0000000f}, {-0.9391240f,  0.1765491f, -0.2947481f},  // face 4
+    {-0.9391240f,  0.1765491f,  0.2947481f}, {-0.9341724f,  0.3568221f,  0.0000000f},
+    { 0.5804106f,  0.7625749f,  0.2856625f}, { 0.2856625f,  0.5804106f,  0.7625749f},  // face 5
+    { 0.7625749f,  0.2856625f,  0.5804106f}, { 0.5773503f,  0.5773503f,  0.5773503f},
+    {-0.1765491f,  0.2947481f,  0.9391240f}, {-0.6534616f,  0.0000000f,  0.7569597f},  // face 6
+    {-0.1765491f, -0.2947481f,  0.9391240f}, {-0.3568221f,  0.0000000f,  0.9341724f},
+    {-0.9391240f, -0.1765491f,  0.2947481f}, {-0.9391240f, -0.1765491f, -0.2947481f},  // face 7
+    {-0.7569597f, -0.6534616f,  0.0000000f}, {-0.9341724f, -0.3568221f,  0.0000000f},
+    {-0.6534616f,  0.0000000f, -0.7569597f}, {-0.1765491f,  0.2947481f, -0.9391240f},  // face 8
+    {-0.1765491f, -0.2947481f, -0.9391240f}, {-0.3568221f,  0.0000000f, -0.9341724f},
+    { 0.2856625f,  0.5804106f, -0.7625749f}, { 0.5804106f,  0.7625749f, -0.2856625f},  // face 9
+    { 0.7625749f,  0.2856625f, -0.5804106f}, { 0.5773503f,  0.5773503f, -0.5773503f},
+    { 0.5804106f, -0.7625749f,  0.2856625f}, { 0.7625749f, -0.2856625f,  0.5804106f},  // face 10
+    { 0.2856625f, -0.5804106f,  0.7625749f}, { 0.5773503f, -0.5773503f,  0.5773503f},
+    { 0.2947481f, -0.9391240f,  0.1765491f}, { 0.0000000f, -0.7569597f,  0.6534616f},  // face 11
+    {-0.2947481f, -0.9391240f,  0.1765491f}, { 0.0000000f, -0.9341724f,  0.3568221f},
+    { 0.2947481f, -0.9391240f, -0.1765491f}, {-0.2947481f, -0.9391240f, -0.1765491f},  // face 12
+    { 0.0000000f, -0.7569597f, -0.6534616f}, { 0.0000000f, -0.9341724f, -0.3568221f},
+    { 0.5804106f, -0.7625749f, -0.2856625f}, { 0.2856625f, -0.5804106f, -0.7625749f},  // face 13
+    { 0.7625749f, -0.2856625f, -0.5804106f}, { 0.5773503f, -0.5773503f, -0.5773503f},
+    { 0.7569597f, -0.6534616f,  0.0000000f}, { 0.9391240f, -0.1765491f, -0.2947481f},  // face 14
+    { 0.9391240f, -0.1765491f,  0.2947481f}, { 0.9341724f, -0.3568221f,  0.0000000f},
+    { 0.1765491f, -0.2947481f,  0.9391240f}, { 0.6534616f,  0.0000000f,  0.7569597f},  // face 15
+    { 0.1765491f,  0.2947481f,  0.9391240f}, { 0.3568221f,  0.0000000f,  0.9341724f},
+    {-0.5804106f, -0.7625749f,  0.2856625f}, {-0.2856625f, -0.5804106f,  0.7625749f},  // face 16
+    {-0.7625749f, -0.2856625f,  0.5804106f}, {-0.5773503f, -0.5773503f,  0.5773503f},
+    {-0.2856625f, -0.5804106f, -0.7625749f}, {-0.5804106f, -0.7625749f, -0.2856625f},  // face 17
+    {-0.7625749f, -0.2856625f, -0.5804106f}, {-0.5773503f, -0.5773503f, -0.5773503f},
+    { 0.6534616f,  0.0000000f, -0.7569597f}, { 0.1765491f, -0.2947481f, -0.9391240f},  // face 18
+    { 0.1765491f,  0.2947481f, -0.9391240f}, { 0.3568221f,  0.0000000f, -0.9341724f},
+    { 0.9391240f,  0.1765491f,  0.2947481f}, { 0.9391240f,  0.1765491f, -0.2947481f},  // face 19
+    { 0.7569597f,  0.6534616f,  0.0000000f}, { 0.9341724f,  0.3568221f,  0.0000000f}
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+static bool solveLinearSystem(double a[FIT_PARAMETERS][FIT_PARAMETERS], double b[FIT_PARAMETERS], double x[FIT_PARAMETERS]);
+static float dotFlash(const float direction[3], const float *centre);
+static int16_t toCount(float value);
+static uint8_t upper(uint8_t r, uint8_t c);
+static inline bool testBit(const uint8_t *bits, uint8_t i) { return (bits[i >> 3] >> (i & 7)) & 1; }
+static inline void setBit(uint8_t *bits, uint8_t i) { bits[i >> 3] |= (uint8_t)(1 << (i & 7)); }
+static inline void clearBit(uint8_t *bits, uint8_t i) { bits[i >> 3] &= (uint8_t)~(1 << (i & 7)); }
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name CoverageTracker
+ * @brief CoverageTracker: constructor
+ * @param [in] float minCoverage: fraction of faces needed to complete the capture
+ * @param [in] float maxResidual: largest RMS field norm residual to complete the capture
+ */
+CoverageTracker::CoverageTracker(float minCoverage, float maxResidual)
+    : minCoverage(minCoverage), maxResidual(maxResidual)
+{
+    reset();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name reset
+ * @brief reset: forget every sample
+ * @retval None
+ */
+void CoverageTracker::reset()
+{
+    samples = 0;
+    occupied = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        minValues[i] = 0.0f;
+        maxValues[i] = 0.0f;
+        binnedCentre[i] = 0.0f;
+        origin[i] = 0.0;
+    }
+    memset(ata, 0, sizeof(ata));
+    memset(atb, 0, sizeof(atb));
+    fitValid = false;
+    centreFixed = false;
+    memset(hasRepresentative, 0, sizeof(hasRepresentative));
+}
+
+/**
+ * @name addSample
+ * @brief addSample: add a raw magnetometer sample
+ * @param [in] float x: raw x
+ * @param [in] float y: raw y
+ * @param [in] float z: raw z
+ * @retval None
+ */
+void CoverageTracker::addSample(float x, float y, float z)
+{
+    const float sample[3] = {x, y, z};
+    for (int i = 0; i < 3; ++i)
+    {
+        if (samples == 0 || sample[i] < minValues[i]) minValues[i] = sample[i];
+        if (samples == 0 || sample[i] > maxValues[i]) maxValues[i] = sample[i];
+        if (samples == 0) origin[i] = sample[i];
+    }
+    samples++;
+
+    // ----- Accumulate the normal equations of the fit
+    double u = x - origin[0];
+    double v = y - origin[1];
+    double w = z - origin[2];
+    const double d[FIT_PARAMETERS] = {v * v, w * w, u, v, w, 1.0};
+    for (uint8_t r = 0; r < FIT_PARAMETERS; ++r)
+    {
+        for (uint8_t c = r; c < FIT_PARAMETERS; ++c) ata[upper(r, c)] += d[r] * d[c];
+        atb[r] -= d[r] * u * u;
+    }
+    if (samples % COVERAGE_FIT_INTERVAL == 0)
+    {
+        solveFit();
+    }
+
+    // ----- The centre moves while the sphere fills up, place the representatives again
+    float chord = averageChord();
+    float centre[3];
+    getOffset(centre);
+    float shift = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        float delta = centre[i] - binnedCentre[i];
+        shift += delta * delta;
+    }
+    if (shift > (COVERAGE_REBIN_DISTANCE * chord) * (COVERAGE_REBIN_DISTANCE * chord))
+    {
+        rebin();
+    }
+
+    placeSample(sample);
+}
+
+/**
+ * @name setCentre
+ * @brief setCentre: use a known hard-iron offset instead of the estimate, e.g. to grade a capture after the fit
+ * @param [in] const float centre[3]: offset, same unit of the samples
+ * @retval None
+ */
+void CoverageTracker::setCentre(const float centre[3])
+{
+    centreFixed = true;
+    memcpy(fitOffset, centre, sizeof(fitOffset));
+    rebin();
+}
+
+/**
+ * @name coverage
+ * @brief coverage: fraction of icosphere faces hit so far
+ * @retval float: 0 to 1
+ */
+float CoverageTracker::coverage() const
+{
+    return (float)occupied / COVERAGE_BINS;
+}
+
+/**
+ * @name residual
+ * @brief residual: RMS of the relative field norm residual of the representatives, calibrated with offset and scale
+ * @retval float: relative residual, 1 if there are not enough samples
+ */
+float CoverageTracker::residual() const
+{
+    if (occupied < COVERAGE_MIN_BINS_FOR_RESIDUAL)
+    {
+        return 1.0f;
+    }
+
+    float offset[3];
+    float scale[3];
+    getOffset(offset);
+    getScale(scale);
+
+    // ----- One running pass (Welford), no array of norms on the stack
+    uint8_t count = 0;
+    float mean = 0.0f;
+    float squares = 0.0f;
+    for (uint8_t b = 0; b < COVERAGE_BINS; ++b)
+    {
+        if (!testBit(hasRepresentative, b))
+        {
+            continue;
+        }
+        float norm = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            float value = (representative[b][i] - offset[i]) * scale[i];
+            norm += value * value;
+        }
+        norm = sqrtf(norm);
+        count++;
+        float delta = norm - mean;
+        mean += delta / count;
+        squares += delta * (norm - mean);
+    }
+    if (mean <= 0.0f)
+    {
+        return 1.0f;
+    }
+    return sqrtf(squares / count) / mean;
+}
+
+/**
+ * @name isComplete
+ * @brief isComplete: true when coverage and residual reached the thresholds
+ * @retval bool
+ */
+bool CoverageTracker::isComplete() const
+{
+    return coverage() >= minCoverage && residual() <= maxResidual;
+}
+
+/**
+ * @name getOffset
+ * @brief getOffset: hard-iron offset of the samples so far
+ * @param [out] float offset[3]: offset, same unit of the samples
+ * @retval None
+ */
+void CoverageTracker::getOffset(float offset[3]) const
+{
+    for (int i = 0; i < 3; ++i) offset[i] = (fitValid || centreFixed) ? fitOffset[i] : (maxValues[i] + minValues[i]) / 2.0f;
+}
+
+/**
+ * @name getScale
+ * @brief getScale: soft-iron per axis scale of the samples so far, the average is 1
+ * @param [out] float scale[3]: per axis scale
+ * @retval None
+ */
+void CoverageTracker::getScale(float scale[3]) const
+{
+    if (fitValid)
+    {
+        memcpy(scale, fitScale, sizeof(fitScale));
+        return;
+    }
+    float average = averageChord();
+    for (int i = 0; i < 3; ++i)
+    {
+        float chord = (maxValues[i] - minValues[i]) / 2.0f;
+        scale[i] = chord > 0.0f ? average / chord : 1.0f;
+    }
+}
+
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+uint8_t CoverageTracker::findBin(const float direction[3]) const
+{
+    uint8_t face = 0;
+    float best = -2.0f;
+    for (uint8_t f = 0; f < COVERAGE_BASE_FACES; ++f)
+    {
+        float d = dotFlash(direction, ICOSPHERE_BASE_CENTRE[f]);
+        if (d > best)
+        {
+            best = d;
+            face = f;
+        }
+    }
+
+    uint8_t bin = 4 * face;
+    best = -2.0f;
+    for (uint8_t c = 4 * face; c < 4 * face + 4; ++c)
+    {
+        float d = dotFlash(direction, ICOSPHERE_CHILD_CENTRE[c]);
+        if (d > best)
+        {
+            best = d;
+            bin = c;
+        }
+    }
+    return bin;
+}
+
+/**
+ * @name placeSample
+ * @brief placeSample: drop a sample in its face, keep it if it is closer to the average radius
+ * @retval bool: true if the sample is now the representative of its face
+ */
+bool CoverageTracker::placeSample(const float sample[3])
+{
+    float norm;
+    uint8_t bin = binOf(sample, norm);
+    if (bin >= COVERAGE_BINS)
+    {
+        return false;
+    }
+    if (testBit(hasRepresentative, bin))
+    {
+        if (!isCloser(bin, norm))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        setBit(hasRepresentative, bin);
+        occupied++;
+    }
+    for (int i = 0; i < 3; ++i) representative[bin][i] = toCount(sample[i]);
+    return true;
+}
+
+/**
+ * @name rebin
+ * @brief rebin: place the representatives again around the current min/max centre, in place: a representative
+ *               moving to a face not yet placed again swaps with the one there, which is placed next
+ */
+void CoverageTracker::rebin()
+{
+    uint8_t pending[COVERAGE_BIN_BYTES];
+    memcpy(pending, hasRepresentative, sizeof(pending));
+
+    getOffset(binnedCentre);
+    memset(hasRepresentative, 0, sizeof(hasRepresentative));
+    occupied = 0;
+
+    for (uint8_t b = 0; b < COVERAGE_BINS; ++b)
+    {
+        if (!testBit(pending, b))
+        {
+            continue;
+        }
+        clearBit(pending, b);
+        int16_t moving[3] = {representative[b][0], representative[b][1], representative[b][2]};
+        while (true)
+        {
+            const float sample[3] = {(float)moving[0], (float)moving[1], (float)moving[2]};
+            float norm;
+            uint8_t bin = binOf(sample, norm);
+            if (bin >= COVERAGE_BINS)
+            {
+                break;
+            }
+            if (testBit(hasRepresentative, bin))
+            {
+                if (isCloser(bin, norm)) memcpy(representative[bin], moving, sizeof(moving));
+                break;
+            }
+            setBit(hasRepresentative, bin);
+            occupied++;
+            if (!testBit(pending, bin))
+            {
+                memcpy(representative[bin], moving, sizeof(moving));
+                break;
+            }
+            // the face still holds a representative of the old centre: it moves on in place of this one
+            clearBit(pending, bin);
+            for (int i = 0; i < 3; ++i)
+            {
+                int16_t evicted = representative[bin][i];
+                representative[bin][i] = moving[i];
+                moving[i] = evicted;
+            }
+        }
+    }
+}
+
+/**
+ * @name binOf
+ * @brief binOf: face of a sample around binnedCentre
+ * @param [out] float &norm: distance of the sample from binnedCentre
+ * @retval uint8_t: face, COVERAGE_BINS if the sample is on the centre
+ */
+uint8_t CoverageTracker::binOf(const float sample[3], float &norm) const
+{
+    float direction[3];
+    norm = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        direction[i] = sample[i] - binnedCentre[i];
+        norm += direction[i] * direction[i];
+    }
+    norm = sqrtf(norm);
+    if (norm <= 0.0f)
+    {
+        return COVERAGE_BINS;
+    }
+    for (int i = 0; i < 3; ++i) direction[i] /= norm;
+    return findBin(direction);
+}
+
+/**
+ * @name isCloser
+ * @brief isCloser: a sample at norm from binnedCentre is closer to the average radius than the representative of bin
+ */
+bool CoverageTracker::isCloser(uint8_t bin, float norm) const
+{
+    float current = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        float d = representative[bin][i] - binnedCentre[i];
+        current += d * d;
+    }
+    float chord = averageChord();
+    return fabsf(sqrtf(current) - chord) > fabsf(norm - chord);
+}
+
+float CoverageTracker::averageChord() const
+{
+    return ((maxValues[0] - minValues[0]) + (maxValues[1] - minValues[1]) + (maxValues[2] - minValues[2])) / 6.0f;
+}
+
+/**
+ * @name solveFit
+ * @brief solveFit: offset and scale from the normal equations, fitValid is false if not an ellipsoid
+ */
+void CoverageTracker::solveFit()
+{
+    double a[FIT_PARAMETERS][FIT_PARAMETERS];
+    double b[FIT_PARAMETERS];
+    double p[FIT_PARAMETERS];
+    for (uint8_t r = 0; r < FIT_PARAMETERS; ++r)
+    {
+        for (uint8_t c = 0; c < FIT_PARAMETERS; ++c) a[r][c] = (c >= r) ? ata[upper(r, c)] : ata[upper(c, r)];
+        b[r] = atb[r];
+    }
+
+    fitValid = false;
+    if (!solveLinearSystem(a, b, p) || p[0] <= 0.0 || p[1] <= 0.0)
+    {
+        return;     // not enough of the sphere yet
+    }
+
+    // ----- u^2 + B v^2 + C w^2 + D u + E v + F w + G = 0
+    double centre[3] = {-p[2] / 2.0, -p[3] / (2.0 * p[0]), -p[4] / (2.0 * p[1])};
+    double k = centre[0] * centre[0] + p[0] * centre[1] * centre[1] + p[1] * centre[2] * centre[2] - p[5];
+    if (k <= 0.0)
+    {
+        return;
+    }
+
+    double axis[3] = {sqrt(k), sqrt(k / p[0]), sqrt(k / p[1])};
+    double average = (axis[0] + axis[1] + axis[2]) / 3.0;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!centreFixed) fitOffset[i] = (float)(origin[i] + centre[i]);
+        fitScale[i] = (float)(average / axis[i]);
+    }
+    fitValid = true;
+}
+
+/**
+ * @name solveLinearSystem
+ * @brief solveLinearSystem: Gaussian elimination with partial pivoting, a and b are destroyed
+ */
+static bool solveLinearSystem(double a[FIT_PARAMETERS][FIT_PARAMETERS], double b[FIT_PARAMETERS], double x[FIT_PARAMETERS])
+{
+    double diagonal[FIT_PARAMETERS];     // the unknowns have very different units, pivots are judged per column
+    for (uint8_t c = 0; c < FIT_PARAMETERS; ++c) diagonal[c] = fabs(a[c][c]);
+
+    for (uint8_t col = 0; col < FIT_PARAMETERS; ++col)
+    {
+        uint8_t pivot = col;
+        for (uint8_t r = col + 1; r < FIT_PARAMETERS; ++r)
+        {
+            if (fabs(a[r][col]) > fabs(a[pivot][col])) pivot = r;
+        }
+        if (fabs(a[pivot][col]) <= 1e-12 * diagonal[col])
+        {
+            return false;
+        }
+        if (pivot != col)
+        {
+            for (uint8_t c = 0; c < FIT_PARAMETERS; ++c)
+            {
+                double t = a[col][c];
+                a[col][c] = a[pivot][c];
+                a[pivot][c] = t;
+            }
+            double t = b[col];
+            b[col] = b[pivot];
+            b[pivot] = t;
+        }
+        for (uint8_t r = col + 1; r < FIT_PARAMETERS; ++r)
+        {
+            double factor = a[r][col] / a[col][col];
+            for (uint8_t c = col; c < FIT_PARAMETERS; ++c) a[r][c] -= factor * a[col][c];
+            b[r] -= factor * b[col];
+        }
+    }
+    for (int r = FIT_PARAMETERS - 1; r >= 0; --r)
+    {
+        double value = b[r];
+        for (uint8_t c = r + 1; c < FIT_PARAMETERS; ++c) value -= a[r][c] * x[c];
+        x[r] = value / a[r][r];
+    }
+    return true;
+}
+
+static float dotFlash(const float direction[3], const float *centre)
+{
+    return direction[0] * pgm_read_float(centre) + direction[1] * pgm_read_float(centre + 1) +
+           direction[2] * pgm_read_float(centre + 2);
+}
+
+// the representatives keep the resolution of the 16 bit registers of the magnetometer
+static int16_t toCount(float value)
+{
+    if (value >= 32767.0f) return 32767;
+    if (value <= -32768.0f) return -32768;
+    return (int16_t)floorf(value + 0.5f);
+}
+
+// index of row r, column c >= r of the upper triangle of the normal matrix, row by row
+static uint8_t upper(uint8_t r, uint8_t c)
+{
+    return r * FIT_PARAMETERS - r * (r - 1) / 2 + (c - r);
+}
+
+/****************************************************************************
+ ****************************************************************************/
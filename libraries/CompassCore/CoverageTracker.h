@@ -0,0 +1,207 @@
+/**
+ * @file CoverageTracker.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Sphere coverage map of the magnetometer calibration capture
+ *
+ * Every sample is centred on the current hard-iron estimate, normalized and dropped in one of
+ * the 80 faces of an icosphere (icosahedron subdivided once, faces of about the same area).
+ * A capture is complete when enough faces are hit and the fit explains the samples: the
+ * capture can stop as soon as the device has been tumbled once, instead of running for a
+ * fixed time.
+ *
+ * The fit is an axis aligned ellipsoid (offset and per axis scale, the model of magCalMPU9250)
+ * solved by least squares over every sample: a single glitch still pulls it, but far less than
+ * min/max, which it moves all the way; min/max is the fallback until the fit is solvable.
+ * Each face keeps one representative sample, the one whose norm is closest to the average
+ * radius, so the residual check costs 80 points whatever the capture length.
+ * The tracker also runs on an Arduino Uno, 2 KB of SRAM: the face centres are a table in flash,
+ * the representatives are kept as the int16_t of the registers, a bit per face says if there is
+ * one, and the residual is one running pass; about 690 B on AVR.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef COVERAGE_TRACKER_H
+#define COVERAGE_TRACKER_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint8_t COVERAGE_BASE_FACES      = 20;
+const uint8_t COVERAGE_BINS            = 80;      // icosahedron faces subdivided once
+const uint8_t COVERAGE_BIN_BYTES       = (COVERAGE_BINS + 7) / 8;
+const float   DEFAULT_MIN_COVERAGE     = 0.80f;   // fraction of faces to hit
+const float   DEFAULT_MAX_RESIDUAL     = 0.05f;   // RMS field norm residual of the representatives
+const float   COVERAGE_REBIN_DISTANCE  = 0.05f;   // centre shift, relative to the radius, that triggers a rebin
+const uint8_t COVERAGE_FIT_INTERVAL    = 16;      // samples between two solutions of the fit
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class CoverageTracker
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name CoverageTracker
+     * @brief CoverageTracker: constructor
+     * @param [in] float minCoverage: fraction of faces needed to complete the capture
+     * @param [in] float maxResidual: largest RMS field norm residual to complete the capture
+     */
+    CoverageTracker(float minCoverage = DEFAULT_MIN_COVERAGE, float maxResidual = DEFAULT_MAX_RESIDUAL);
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name reset
+     * @brief reset: forget every sample
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name addSample
+     * @brief addSample: add a raw magnetometer sample, counts of the registers: it is kept rounded to int16_t
+     * @param [in] float x: raw x
+     * @param [in] float y: raw y
+     * @param [in] float z: raw z
+     * @retval None
+     */
+    void addSample(float x, float y, float z);
+
+    /**
+     * @name setCentre
+     * @brief setCentre: use a known hard-iron offset instead of the estimate, e.g. to grade a capture after the fit
+     * @param [in] const float centre[3]: offset, same unit of the samples
+     * @retval None
+     */
+    void setCentre(const float centre[3]);
+
+    /**
+     * @name coverage
+     * @brief coverage: fraction of icosphere faces hit so far
+     * @retval float: 0 to 1
+     */
+    float coverage() const;
+
+    /**
+     * @name residual
+     * @brief residual: RMS of the relative field norm residual of the representatives, calibrated with offset and scale
+     * @retval float: relative residual, 1 if there are not enough samples
+     */
+    float residual() const;
+
+    /**
+     * @name isComplete
+     * @brief isComplete: true when coverage and residual reached the thresholds
+     * @retval bool
+     */
+    bool isComplete() const;
+
+    /**
+     * @name getOffset
+     * @brief getOffset: hard-iron offset of the samples so far
+     * @param [out] float offset[3]: offset, same unit of the samples
+     * @retval None
+     */
+    void getOffset(float offset[3]) const;
+
+    /**
+     * @name getScale
+     * @brief getScale: soft-iron per axis scale of the samples so far, the average is 1
+     * @param [out] float scale[3]: per axis scale
+     * @retval None
+     */
+    void getScale(float scale[3]) const;
+
+    /**
+     * @name sampleCount
+     * @brief sampleCount: samples added since the last reset
+     * @retval uint32_t
+     */
+    uint32_t sampleCount() const { return samples; }
+
+    /**
+     * @name occupiedBins
+     * @brief occupiedBins: number of faces hit so far
+     * @retval uint8_t
+     */
+    uint8_t occupiedBins() const { return occupied; }
+
+    /**
+     * @name isFitValid
+     * @brief isFitValid: true if offset and scale come from the ellipsoid fit, false if from min/max
+     * @retval bool
+     */
+    bool isFitValid() const { return fitValid; }
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    uint8_t findBin(const float direction[3]) const;
+    uint8_t binOf(const float sample[3], float &norm) const;
+    bool isCloser(uint8_t bin, float norm) const;
+    bool placeSample(const float sample[3]);
+    void rebin();
+    float averageChord() const;
+    void solveFit();
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    float minCoverage;
+    float maxResidual;
+
+    uint32_t samples;
+    float minValues[3];
+    float maxValues[3];
+    float binnedCentre[3];                  // offset used to place the representatives
+
+    // ----- Least squares of u^2 + B v^2 + C w^2 + D u + E v + F w + G = 0, with u = x - origin
+    double origin[3];                       // first sample, keeps the sums well conditioned
+    double ata[6 * 7 / 2];                  // upper triangle of the 6x6 normal matrix, row by row
+    double atb[6];
+    bool fitValid;
+    bool centreFixed;                       // setCentre() was called
+    float fitOffset[3];
+    float fitScale[3];
+
+    uint8_t occupied;
+    uint8_t hasRepresentative[COVERAGE_BIN_BYTES];  // bit per face
+    int16_t representative[COVERAGE_BINS][3];
+
+}; /* CoverageTracker */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* COVERAGE_TRACKER_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,283 @@
+/**
+ * @file DeviationCurve.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Residual deviation of the compass versus heading, fitted from a swing
+ *
+ * The fit accumulates the 5x5 normal equations sample by sample, so a swing of any length costs
+ * the same memory; they are solved once by fit().
+ * The table keeps centidegrees in 16 bits: 720 bytes, deviations up to 327 deg.
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "DeviationCurve.h"
+#include <math.h>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const float DEVIATION_DEG_TO_RAD = 0.017453292519943f;
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+static void basis(float heading, double row[DEVIATION_COEFFICIENTS]);
+static float wrap360(float angle);
+static bool solveLinearSystem(double a[DEVIATION_COEFFICIENTS][DEVIATION_COEFFICIENTS], double b[DEVIATION_COEFFICIENTS],
+                              double x[DEVIATION_COEFFICIENTS]);
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name DeviationCurve
+ * @brief DeviationCurve: constructor, no deviation
+ */
+DeviationCurve::DeviationCurve()
+{
+    valid = false;
+    fitResidual = 0.0f;
+    for (uint8_t i = 0; i < DEVIATION_COEFFICIENTS; ++i) coefficients[i] = 0.0f;
+    buildTable();
+    reset();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name reset
+ * @brief reset: forget the samples of the swing, the curve in use is kept
+ * @retval None
+ */
+void DeviationCurve::reset()
+{
+    samples = 0;
+    sectors = 0;
+    sumSquares = 0.0;
+    for (uint8_t r = 0; r < DEVIATION_COEFFICIENTS; ++r)
+    {
+        atb[r] = 0.0;
+        for (uint8_t c = 0; c < DEVIATION_COEFFICIENTS; ++c) ata[r][c] = 0.0;
+    }
+}
+
+/**
+ * @name addSample
+ * @brief addSample: add one point of the swing
+ * @param [in] float heading: compass heading, deg
+ * @param [in] float error: compass heading minus true heading, deg, any range (wrapped to +-180)
+ * @retval None
+ */
+void DeviationCurve::addSample(float heading, float error)
+{
+    error = wrap360(error + 180.0f) - 180.0f;
+
+    double row[DEVIATION_COEFFICIENTS];
+    basis(heading, row);
+    for (uint8_t r = 0; r < DEVIATION_COEFFICIENTS; ++r)
+    {
+        atb[r] += row[r] * error;
+        for (uint8_t c = 0; c < DEVIATION_COEFFICIENTS; ++c) ata[r][c] += row[r] * row[c];
+    }
+    sumSquares += (double)error * error;
+    if (samples < 0xFFFF) samples++;
+    sectors |= 1 << (uint8_t)(wrap360(heading) / (360.0f / DEVIATION_SECTORS));
+}
+
+/**
+ * @name fit
+ * @brief fit: least squares coefficients of the samples; the curve in use is kept if they do not fix them
+ * @retval bool: true if the curve was fitted
+ */
+bool DeviationCurve::fit()
+{
+    // headings bunched in a sector leave the harmonics undetermined
+    if (samples < DEVIATION_MIN_SAMPLES || sectors != (1 << DEVIATION_SECTORS) - 1)
+    {
+        return false;
+    }
+
+    double a[DEVIATION_COEFFICIENTS][DEVIATION_COEFFICIENTS];
+    double b[DEVIATION_COEFFICIENTS];
+    double x[DEVIATION_COEFFICIENTS];
+    for (uint8_t r = 0; r < DEVIATION_COEFFICIENTS; ++r)
+    {
+        b[r] = atb[r];
+        for (uint8_t c = 0; c < DEVIATION_COEFFICIENTS; ++c) a[r][c] = ata[r][c];
+    }
+    if (!solveLinearSystem(a, b, x))
+    {
+        return false;
+    }
+
+    // ----- Residual: |e - Ax|^2 = e.e - 2 x.Ate + x.AtA x
+    double squares = sumSquares;
+    for (uint8_t r = 0; r < DEVIATION_COEFFICIENTS; ++r)
+    {
+        squares -= 2.0 * x[r] * atb[r];
+        for (uint8_t c = 0; c < DEVIATION_COEFFICIENTS; ++c) squares += x[r] * ata[r][c] * x[c];
+    }
+    fitResidual = (float)sqrt(squares > 0.0 ? squares / samples : 0.0);
+
+    for (uint8_t i = 0; i < DEVIATION_COEFFICIENTS; ++i) coefficients[i] = (float)x[i];
+    buildTable();
+    valid = true;
+    return true;
+}
+
+/**
+ * @name getDeviation
+ * @brief getDeviation: deviation at a compass heading, interpolated in the table
+ * @param [in] float heading: compass heading, deg, any range
+ * @retval float: deg, 0 with no curve
+ */
+float DeviationCurve::getDeviation(float heading) const
+{
+    const float position = wrap360(heading) * (DEVIATION_TABLE_SIZE / 360.0f);
+    uint16_t k = (uint16_t)position;
+    const float fraction = position - k;
+    if (k >= DEVIATION_TABLE_SIZE) k = 0;
+    const uint16_t next = (k + 1 < DEVIATION_TABLE_SIZE) ? k + 1 : 0;
+    return 0.01f * (table[k] + fraction * (table[next] - table[k]));
+}
+
+/**
+ * @name correct
+ * @brief correct: true heading of a compass heading
+ * @param [in] float heading: compass heading, deg, any range
+ * @retval float: deg, 0 to 360
+ */
+float DeviationCurve::correct(float heading) const
+{
+    return wrap360(heading - getDeviation(heading));
+}
+
+/**
+ * @name getMaxDeviation
+ * @brief getMaxDeviation: largest deviation of the curve, A included
+ * @retval float: deg
+ */
+float DeviationCurve::getMaxDeviation() const
+{
+    int16_t largest = 0;
+    for (uint16_t k = 0; k < DEVIATION_TABLE_SIZE; ++k)
+    {
+        const int16_t value = table[k] < 0 ? -table[k] : table[k];
+        if (value > largest) largest = value;
+    }
+    return 0.01f * largest;
+}
+
+void DeviationCurve::getCoefficients(float coefficients[DEVIATION_COEFFICIENTS]) const
+{
+    for (uint8_t i = 0; i < DEVIATION_COEFFICIENTS; ++i) coefficients[i] = this->coefficients[i];
+}
+
+void DeviationCurve::setCoefficients(const float coefficients[DEVIATION_COEFFICIENTS])
+{
+    for (uint8_t i = 0; i < DEVIATION_COEFFICIENTS; ++i) this->coefficients[i] = coefficients[i];
+    buildTable();
+    valid = true;
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name buildTable
+ * @brief buildTable: expand the coefficients, one point per degree
+ * @retval None
+ */
+void DeviationCurve::buildTable()
+{
+    for (uint16_t k = 0; k < DEVIATION_TABLE_SIZE; ++k)
+    {
+        double row[DEVIATION_COEFFICIENTS];
+        basis(k * (360.0f / DEVIATION_TABLE_SIZE), row);
+        double deviation = 0.0;
+        for (uint8_t i = 0; i < DEVIATION_COEFFICIENTS; ++i) deviation += row[i] * coefficients[i];
+
+        deviation *= 100.0;
+        if (deviation > 32767.0) deviation = 32767.0;
+        if (deviation < -32767.0) deviation = -32767.0;
+        table[k] = (int16_t)(deviation < 0.0 ? deviation - 0.5 : deviation + 0.5);
+    }
+}
+
+/*******************
+ * PRIVATE FUNCTIONS
+*******************/
+/**
+ * @name basis
+ * @brief basis: 1, sin h, cos h, sin 2h, cos 2h
+ */
+static void basis(float heading, double row[DEVIATION_COEFFICIENTS])
+{
+    const float h = heading * DEVIATION_DEG_TO_RAD;
+    row[0] = 1.0;
+    row[1] = sinf(h);
+    row[2] = cosf(h);
+    row[3] = sinf(2.0f * h);
+    row[4] = cosf(2.0f * h);
+}
+
+static float wrap360(float angle)
+{
+    angle = fmodf(angle, 360.0f);
+    if (angle < 0.0f) angle += 360.0f;
+    return angle;
+}
+
+/**
+ * @name solveLinearSystem
+ * @brief solveLinearSystem: Gaussian elimination with partial pivoting, a and b are destroyed
+ */
+static bool solveLinearSystem(double a[DEVIATION_COEFFICIENTS][DEVIATION_COEFFICIENTS], double b[DEVIATION_COEFFICIENTS],
+                              double x[DEVIATION_COEFFICIENTS])
+{
+    const double count = a[0][0];           // sum of 1 * 1
+    for (uint8_t col = 0; col < DEVIATION_COEFFICIENTS; ++col)
+    {
+        uint8_t pivot = col;
+        for (uint8_t r = col + 1; r < DEVIATION_COEFFICIENTS; ++r)
+        {
+            if (fabs(a[r][col]) > fabs(a[pivot][col])) pivot = r;
+        }
+        if (fabs(a[pivot][col]) <= 1e-6 * count)
+        {
+            return false;
+        }
+        if (pivot != col)
+        {
+            for (uint8_t c = 0; c < DEVIATION_COEFFICIENTS; ++c)
+            {
+                double t = a[col][c];
+                a[col][c] = a[pivot][c];
+                a[pivot][c] = t;
+            }
+            double t = b[col];
+            b[col] = b[pivot];
+            b[pivot] = t;
+        }
+        for (uint8_t r = col + 1; r < DEVIATION_COEFFICIENTS; ++r)
+        {
+            double factor = a[r][col] / a[col][col];
+            for (uint8_t c = col; c < DEVIATION_COEFFICIENTS; ++c) a[r][c] -= factor * a[col][c];
+            b[r] -= factor * b[col];
+        }
+    }
+    for (int r = DEVIATION_COEFFICIENTS - 1; r >= 0; --r)
+    {
+        double value = b[r];
+        for (uint8_t c = r + 1; c < DEVIATION_COEFFICIENTS; ++c) value -= a[r][c] * x[c];
+        x[r] = value / a[r][r];
+    }
+    return true;
+}
+
+/****************************************************************************
+ ****************************************************************************/
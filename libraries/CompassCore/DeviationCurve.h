@@ -0,0 +1,170 @@
+/**
+ * @file DeviationCurve.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Residual deviation of the compass versus heading, fitted from a swing
+ *
+ * The deviation, compass heading minus true heading, is the classic five coefficient curve
+ *      d(h) = A + B sin h + C cos h + D sin 2h + E cos 2h
+ * with h the compass heading: A is a misalignment, B and C the hard-iron left by the calibration,
+ * D and E the soft-iron left. The coefficients come from the least squares fit of a swing (the heading
+ * error at known angles) or from setCoefficients, and are expanded in a table of DEVIATION_TABLE_SIZE
+ * points, one per degree, so correct() costs one linear interpolation.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef DEVIATION_CURVE_H
+#define DEVIATION_CURVE_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint8_t  DEVIATION_COEFFICIENTS   = 5;        // A, B, C, D, E
+const uint16_t DEVIATION_TABLE_SIZE     = 360;      // one point per degree
+const uint16_t DEVIATION_MIN_SAMPLES    = 8;        // to fit
+const uint8_t  DEVIATION_SECTORS        = 8;        // of 45 deg, each one needs a sample to fit
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class DeviationCurve
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name DeviationCurve
+     * @brief DeviationCurve: constructor, no deviation
+     */
+    DeviationCurve();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name reset
+     * @brief reset: forget the samples of the swing, the curve in use is kept
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name addSample
+     * @brief addSample: add one point of the swing
+     * @param [in] float heading: compass heading, deg
+     * @param [in] float error: compass heading minus true heading, deg, any range (wrapped to +-180)
+     * @retval None
+     */
+    void addSample(float heading, float error);
+
+    /**
+     * @name fit
+     * @brief fit: least squares coefficients of the samples; the curve in use is kept if they do not fix them
+     * @retval bool: true if the curve was fitted
+     */
+    bool fit();
+
+    /**
+     * @name residual
+     * @brief residual: RMS of the samples around the fitted curve, what the five coefficients cannot explain
+     * @retval float: deg, 0 before a fit
+     */
+    float residual() const { return fitResidual; }
+
+    /**
+     * @name sampleCount
+     * @brief sampleCount: samples added since the last reset
+     * @retval uint16_t
+     */
+    uint16_t sampleCount() const { return samples; }
+
+    /**
+     * @name getDeviation
+     * @brief getDeviation: deviation at a compass heading, interpolated in the table
+     * @param [in] float heading: compass heading, deg, any range
+     * @retval float: deg, 0 with no curve
+     */
+    float getDeviation(float heading) const;
+
+    /**
+     * @name correct
+     * @brief correct: true heading of a compass heading
+     * @param [in] float heading: compass heading, deg, any range
+     * @retval float: deg, 0 to 360
+     */
+    float correct(float heading) const;
+
+    /**
+     * @name getMaxDeviation
+     * @brief getMaxDeviation: largest deviation of the curve, A included
+     * @retval float: deg
+     */
+    float getMaxDeviation() const;
+
+    /**
+     * @name getCoefficients / setCoefficients
+     * @brief coefficients A, B, C, D, E in degrees; setCoefficients rebuilds the table and makes the curve valid
+     */
+    void getCoefficients(float coefficients[DEVIATION_COEFFICIENTS]) const;
+    void setCoefficients(const float coefficients[DEVIATION_COEFFICIENTS]);
+
+    /**
+     * @name isValid
+     * @brief isValid: the curve comes from a fit or setCoefficients
+     * @retval bool
+     */
+    bool isValid() const { return valid; }
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void buildTable();
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    bool valid;
+    float coefficients[DEVIATION_COEFFICIENTS];
+    int16_t table[DEVIATION_TABLE_SIZE];                    // deviation, centidegrees
+
+    // ----- Least squares of the swing
+    uint16_t samples;
+    uint8_t sectors;                                        // bit mask of the sectors with a sample
+    double ata[DEVIATION_COEFFICIENTS][DEVIATION_COEFFICIENTS];
+    double atb[DEVIATION_COEFFICIENTS];
+    double sumSquares;                                      // of the errors
+    float fitResidual;
+
+}; /* DeviationCurve */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* DEVIATION_CURVE_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,265 @@
+/**
+ * @file Dmp.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Digital Motion Processor of the MPU9250: firmware loading and 6-axis quaternions from the FIFO
+ *
+ * The DMP memory keys and their values are the ones of the InvenSense MotionDriver 6.12 for the image it
+ * ships (inv_mpu_dmp_motion_driver.c); another image needs its own.
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "Dmp.h"
+#include <string.h>
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#elif defined(ESP8266)
+#include <pgmspace.h>
+#else
+#define memcpy_P memcpy
+#endif
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+// ----- Registers
+const uint8_t REG_SMPLRT_DIV        = 0x19;
+const uint8_t REG_FIFO_EN           = 0x23;
+const uint8_t REG_USER_CTRL         = 0x6A;
+const uint8_t REG_BANK_SEL          = 0x6D;     // MEM_START_ADDR follows, one write sets both
+const uint8_t REG_MEM_R_W           = 0x6F;
+const uint8_t REG_PRGM_START        = 0x70;     // two bytes, big endian
+const uint8_t REG_FIFO_COUNT        = 0x72;     // two bytes, big endian
+const uint8_t REG_FIFO_R_W          = 0x74;
+
+const uint8_t USER_CTRL_DMP_EN      = 0x80;
+const uint8_t USER_CTRL_FIFO_EN     = 0x40;
+const uint8_t USER_CTRL_DMP_RST     = 0x08;
+const uint8_t USER_CTRL_FIFO_RST    = 0x04;
+
+// ----- DMP memory keys of the MotionDriver image
+const uint16_t KEY_D_0_22           = 22 + 512; // FIFO rate divider
+const uint16_t KEY_CFG_LP_QUAT      = 2712;     // 3-axis low power quaternion
+const uint16_t KEY_CFG_8            = 2718;     // 6-axis low power quaternion
+const uint16_t KEY_CFG_15           = 2727;     // raw sensors into the FIFO
+const uint16_t KEY_CFG_27           = 2742;     // tap and orientation gestures
+const uint16_t KEY_CFG_6            = 2753;     // end of the FIFO rate setting
+
+const float    Q30                  = 1073741824.0f;
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name Dmp
+ * @brief Dmp: constructor, not loaded
+ */
+Dmp::Dmp()
+{
+    loaded = false;
+    running = false;
+    resets = 0;
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name load
+ * @brief load: write the firmware image in the DMP memory and set the program start
+ * @param [in] ImuBus bus: chip
+ * @param [in] const uint8_t *image: firmware image, in PROGMEM on the MCU
+ * @param [in] uint16_t size: bytes, 0 if there is no image
+ * @param [in] uint16_t startAddress: program start
+ * @retval bool: false with no image, on a bus error or a chunk read back different
+ */
+bool Dmp::load(ImuBus &bus, const uint8_t *image, uint16_t size, uint16_t startAddress)
+{
+    loaded = false;
+    if (image == 0 || size == 0)
+    {
+        return false;
+    }
+
+    // one chunk at a time out of flash: the image does not fit the RAM of an Uno
+    uint8_t chunk[DMP_LOAD_CHUNK];
+    uint8_t check[DMP_LOAD_CHUNK];
+    for (uint16_t address = 0; address < size; address += DMP_LOAD_CHUNK)
+    {
+        uint8_t count = (size - address < DMP_LOAD_CHUNK) ? (uint8_t)(size - address) : DMP_LOAD_CHUNK;
+        memcpy_P(chunk, image + address, count);
+        if (!writeMemory(bus, address, chunk, count) || !readMemory(bus, address, check, count))
+        {
+            return false;
+        }
+        if (memcmp(check, chunk, count) != 0)
+        {
+            return false;
+        }
+    }
+
+    const uint8_t start[2] = {(uint8_t)(startAddress >> 8), (uint8_t)(startAddress & 0xFF)};
+    loaded = bus.writeRegisters(REG_PRGM_START, start, 2);
+    return loaded;
+}
+
+/**
+ * @name start
+ * @brief start: 6-axis quaternions into the FIFO and DMP on; the sample rate of the chip must be DMP_SAMPLE_RATE
+ * @param [in] ImuBus bus: chip
+ * @param [in] uint16_t rate: Hz, quaternions per second, 1 to DMP_SAMPLE_RATE
+ * @retval bool: false if not loaded or on a bus error
+ */
+bool Dmp::start(ImuBus &bus, uint16_t rate)
+{
+    if (!loaded)
+    {
+        return false;
+    }
+    if (rate < 1) rate = 1;
+    if (rate > DMP_SAMPLE_RATE) rate = DMP_SAMPLE_RATE;
+
+    // ----- Chip at the DMP rate, no raw sensor into the FIFO: only the DMP writes it
+    const uint8_t divider = 1000 / DMP_SAMPLE_RATE - 1;
+    const uint8_t noFifo = 0;
+    bool ok = bus.writeRegisters(REG_SMPLRT_DIV, &divider, 1) && bus.writeRegisters(REG_FIFO_EN, &noFifo, 1);
+
+    // ----- FIFO rate
+    const uint16_t fifoDivider = DMP_SAMPLE_RATE / rate - 1;
+    const uint8_t rateDivider[2] = {(uint8_t)(fifoDivider >> 8), (uint8_t)(fifoDivider & 0xFF)};
+    const uint8_t rateEnd[12] = {0xFE, 0xF2, 0xAB, 0xC4, 0xAA, 0xF1, 0xDF, 0xDF, 0xBB, 0xAF, 0xDF, 0xDF};
+    ok = ok && writeMemory(bus, KEY_D_0_22, rateDivider, 2) && writeMemory(bus, KEY_CFG_6, rateEnd, 12);
+
+    // ----- 6-axis quaternion only: the 3-axis one, raw sensors and gestures off, so every packet is one quaternion
+    const uint8_t lpQuatOff[4] = {0x8B, 0x8B, 0x8B, 0x8B};
+    const uint8_t sixAxisOn[4] = {0x20, 0x28, 0x30, 0x38};
+    const uint8_t rawOff[10] = {0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3};
+    const uint8_t gesturesOff = 0xD8;
+    ok = ok && writeMemory(bus, KEY_CFG_LP_QUAT, lpQuatOff, 4) && writeMemory(bus, KEY_CFG_8, sixAxisOn, 4) &&
+         writeMemory(bus, KEY_CFG_15, rawOff, 10) && writeMemory(bus, KEY_CFG_27, &gesturesOff, 1);
+
+    running = ok && resetFifo(bus);
+    resets = 0;
+    return running;
+}
+
+/**
+ * @name stop
+ * @brief stop: DMP and FIFO off, the image stays loaded
+ * @param [in] ImuBus bus: chip
+ * @retval None
+ */
+void Dmp::stop(ImuBus &bus)
+{
+    const uint8_t off = 0;
+    bus.writeRegisters(REG_USER_CTRL, &off, 1);
+    running = false;
+}
+
+/**
+ * @name read
+ * @brief read: drain the FIFO, newest quaternion
+ * @param [in] ImuBus bus: chip
+ * @param [out] float q[4]: w, x, y, z in the chip frame, unchanged if none
+ * @retval int8_t: 1 new quaternion, 0 none, -1 FIFO reset (overflow, misaligned or bad quaternion)
+ */
+int8_t Dmp::read(ImuBus &bus, float q[4])
+{
+    if (!running)
+    {
+        return 0;
+    }
+
+    uint8_t countBytes[2];
+    if (!bus.readRegisters(REG_FIFO_COUNT, countBytes, 2))
+    {
+        return 0;
+    }
+    uint16_t count = ((uint16_t)(countBytes[0] & 0x1F) << 8) | countBytes[1];
+    if (count < DMP_PACKET_SIZE)
+    {
+        return 0;
+    }
+    // a full FIFO has lost packets and may hold a partial one
+    if (count >= DMP_FIFO_SIZE || (count % DMP_PACKET_SIZE) != 0)
+    {
+        resetFifo(bus);
+        resets++;
+        return -1;
+    }
+
+    uint8_t packet[DMP_PACKET_SIZE];
+    for (; count >= DMP_PACKET_SIZE; count -= DMP_PACKET_SIZE)
+    {
+        if (!bus.readRegisters(REG_FIFO_R_W, packet, DMP_PACKET_SIZE))
+        {
+            return 0;
+        }
+    }
+
+    float value[4];
+    float norm2 = 0.0f;
+    for (uint8_t i = 0; i < 4; ++i)
+    {
+        const uint8_t *p = packet + 4 * i;
+        int32_t raw = (int32_t)(((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]);
+        value[i] = raw / Q30;
+        norm2 += value[i] * value[i];
+    }
+    // the DMP writes unit quaternions: anything else is a packet out of step
+    if (norm2 < 0.9375f || norm2 > 1.0625f)
+    {
+        resetFifo(bus);
+        resets++;
+        return -1;
+    }
+    for (uint8_t i = 0; i < 4; ++i) q[i] = value[i];
+    return 1;
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name writeMemory / readMemory
+ * @brief DMP memory access, bank and start address then the data; count must not cross a 256 byte bank
+ */
+bool Dmp::writeMemory(ImuBus &bus, uint16_t address, const uint8_t *data, uint8_t count)
+{
+    if ((uint16_t)(address & 0xFF) + count > 256)
+    {
+        return false;
+    }
+    const uint8_t pointer[2] = {(uint8_t)(address >> 8), (uint8_t)(address & 0xFF)};
+    return bus.writeRegisters(REG_BANK_SEL, pointer, 2) && bus.writeRegisters(REG_MEM_R_W, data, count);
+}
+
+bool Dmp::readMemory(ImuBus &bus, uint16_t address, uint8_t *data, uint8_t count)
+{
+    if ((uint16_t)(address & 0xFF) + count > 256)
+    {
+        return false;
+    }
+    const uint8_t pointer[2] = {(uint8_t)(address >> 8), (uint8_t)(address & 0xFF)};
+    return bus.writeRegisters(REG_BANK_SEL, pointer, 2) && bus.readRegisters(REG_MEM_R_W, data, count);
+}
+
+/**
+ * @name resetFifo
+ * @brief resetFifo: FIFO and DMP reset, then both enabled
+ */
+bool Dmp::resetFifo(ImuBus &bus)
+{
+    const uint8_t off = 0;
+    const uint8_t reset = USER_CTRL_FIFO_RST | USER_CTRL_DMP_RST;
+    const uint8_t on = USER_CTRL_DMP_EN | USER_CTRL_FIFO_EN;
+    bool ok = bus.writeRegisters(REG_USER_CTRL, &off, 1) && bus.writeRegisters(REG_USER_CTRL, &reset, 1);
+    bus.wait(50);
+    return ok && bus.writeRegisters(REG_USER_CTRL, &on, 1);
+}
+
+/****************************************************************************
+ ****************************************************************************/
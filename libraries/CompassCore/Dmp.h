@@ -0,0 +1,159 @@
+/**
+ * @file Dmp.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Digital Motion Processor of the MPU9250: firmware loading and 6-axis quaternions from the FIFO
+ *
+ * The DMP runs the gyro and accelerometer fusion on the chip and pushes a quaternion into the FIFO at up to
+ * DMP_SAMPLE_RATE; the MCU only has to take the yaw to the magnetometer (DmpYawFusion).
+ *      - load: the firmware image goes from flash (PROGMEM) into the DMP memory in DMP_LOAD_CHUNK byte chunks,
+ *        each one copied with memcpy_P, written, read back and compared, then the program start address is set
+ *      - start: FIFO rate, 6-axis low power quaternion on, raw sensors and gestures off, FIFO and DMP reset
+ *        and enabled
+ *      - read: drains the FIFO and keeps the newest quaternion; a FIFO full, misaligned or with a quaternion
+ *        far from unit length is reset, the DMP goes on
+ * The chip is reached through ImuBus, so the same code runs on the MPU9250 over I2C and on the host against a
+ * register-level stand-in of the chip.
+ * The image is the InvenSense MotionDriver one: it is not part of this repository, dmp_image generates it
+ * (see dmp_firmware.h of the quaternion compass library).
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef DMP_H
+#define DMP_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint16_t DMP_START_ADDRESS    = 0x0400;   // program start of the MotionDriver image
+const uint16_t DMP_SAMPLE_RATE      = 200;      // Hz, rate of the DMP, the FIFO rate divides it
+const uint8_t  DMP_LOAD_CHUNK       = 16;       // bytes per memory write, within one I2C transfer
+const uint8_t  DMP_PACKET_SIZE      = 16;       // 6-axis quaternion, four q30 big endian
+const uint16_t DMP_FIFO_SIZE        = 512;      // bytes
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/**
+ * Register access to the MPU9250, implemented by the sensor driver or by a host stand-in
+ */
+class ImuBus
+{
+public:
+    virtual ~ImuBus() {}
+
+    /* Write count consecutive registers from reg, false on a bus error */
+    virtual bool writeRegisters(uint8_t reg, const uint8_t *data, uint8_t count) = 0;
+
+    /* Read count consecutive registers from reg; FIFO_R_W is read count times */
+    virtual bool readRegisters(uint8_t reg, uint8_t *data, uint8_t count) = 0;
+
+    /* Wait, ms */
+    virtual void wait(uint16_t ms) = 0;
+};
+
+class Dmp
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name Dmp
+     * @brief Dmp: constructor, not loaded
+     */
+    Dmp();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name load
+     * @brief load: write the firmware image in the DMP memory and set the program start
+     * @param [in] ImuBus bus: chip
+     * @param [in] const uint8_t *image: firmware image, in PROGMEM on the MCU
+     * @param [in] uint16_t size: bytes, 0 if there is no image
+     * @param [in] uint16_t startAddress: program start
+     * @retval bool: false with no image, on a bus error or a chunk read back different
+     */
+    bool load(ImuBus &bus, const uint8_t *image, uint16_t size, uint16_t startAddress = DMP_START_ADDRESS);
+
+    /**
+     * @name start
+     * @brief start: 6-axis quaternions into the FIFO and DMP on; the sample rate of the chip must be DMP_SAMPLE_RATE
+     * @param [in] ImuBus bus: chip
+     * @param [in] uint16_t rate: Hz, quaternions per second, 1 to DMP_SAMPLE_RATE
+     * @retval bool: false if not loaded or on a bus error
+     */
+    bool start(ImuBus &bus, uint16_t rate);
+
+    /**
+     * @name stop
+     * @brief stop: DMP and FIFO off, the image stays loaded
+     * @param [in] ImuBus bus: chip
+     * @retval None
+     */
+    void stop(ImuBus &bus);
+
+    /**
+     * @name read
+     * @brief read: drain the FIFO, newest quaternion
+     * @param [in] ImuBus bus: chip
+     * @param [out] float q[4]: w, x, y, z in the chip frame, unchanged if none
+     * @retval int8_t: 1 new quaternion, 0 none, -1 FIFO reset (overflow, misaligned or bad quaternion)
+     */
+    int8_t read(ImuBus &bus, float q[4]);
+
+    /**
+     * @name isRunning / getResets
+     * @brief DMP started; FIFO resets since the start
+     */
+    bool isRunning() const { return running; }
+    uint32_t getResets() const { return resets; }
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    bool writeMemory(ImuBus &bus, uint16_t address, const uint8_t *data, uint8_t count);
+    bool readMemory(ImuBus &bus, uint16_t address, uint8_t *data, uint8_t count);
+    bool resetFifo(ImuBus &bus);
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    bool loaded;
+    bool running;
+    uint32_t resets;
+
+}; /* Dmp */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* DMP_H */
+
+/****************************************************************************
+ ****************************************************************************/
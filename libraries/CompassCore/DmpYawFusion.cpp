@@ -0,0 +1,134 @@
+/**
+ * @file DmpYawFusion.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetometer yaw correction of the 6-axis quaternion of the DMP
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "DmpYawFusion.h"
+#include <math.h>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const float YAW_PI          = 3.14159265358979f;
+const float YAW_RAD_TO_DEG  = 57.295779513082f;
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name DmpYawFusion
+ * @brief DmpYawFusion: constructor, no offset, the next magnetometer sample sets it
+ */
+DmpYawFusion::DmpYawFusion()
+{
+    offset = 0.0f;
+    q[0] = 1.0f;
+    q[1] = q[2] = q[3] = 0.0f;
+    reset();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name reset
+ * @brief reset: the next magnetometer sample sets the offset at once
+ * @retval None
+ */
+void DmpYawFusion::reset()
+{
+    initialized = false;
+}
+
+/**
+ * @name update
+ * @brief update: new 6-axis quaternion, and magnetometer sample if any
+ * @param [in] const float q6[4]: w, x, y, z, 6-axis quaternion in the filter frame
+ * @param [in] const float *mag: calibrated magnetometer in the filter frame, any unit; NULL if no new sample
+ * @param [in] float dt: s since the previous magnetometer sample, ignored without one
+ * @param [in] float weight: weight of the magnetometer, 0 to 1, e.g. down while a servo moves
+ * @retval None
+ */
+void DmpYawFusion::update(const float q6[4], const float *mag, float dt, float weight)
+{
+    compose(q6);
+    if (mag == 0)
+    {
+        return;
+    }
+
+    // ----- Horizontal field in the world frame, R(q) * mag
+    const float w = q[0], x = q[1], y = q[2], z = q[3];
+    const float hx = (1.0f - 2.0f * (y * y + z * z)) * mag[0] + 2.0f * (x * y - w * z) * mag[1] + 2.0f * (x * z + w * y) * mag[2];
+    const float hy = 2.0f * (x * y + w * z) * mag[0] + (1.0f - 2.0f * (x * x + z * z)) * mag[1] + 2.0f * (y * z - w * x) * mag[2];
+    if (hx == 0.0f && hy == 0.0f)
+    {
+        return;
+    }
+    const float angle = atan2f(hy, hx);     // of the field from +x, what the offset has to take away
+
+    if (!initialized)
+    {
+        offset -= angle;
+        initialized = true;
+    }
+    else
+    {
+        if (dt <= 0.0f || weight <= 0.0f)
+        {
+            return;
+        }
+        if (weight > 1.0f) weight = 1.0f;
+        offset -= weight * (1.0f - expf(-dt / DMP_YAW_TIME)) * angle;
+    }
+    if (offset > YAW_PI) offset -= 2.0f * YAW_PI;
+    if (offset < -YAW_PI) offset += 2.0f * YAW_PI;
+    compose(q6);
+}
+
+/**
+ * @name getQuaternion
+ * @brief getQuaternion: fused attitude, w, x, y, z
+ * @param [out] float q[4]
+ * @retval None
+ */
+void DmpYawFusion::getQuaternion(float q[4]) const
+{
+    for (uint8_t i = 0; i < 4; ++i) q[i] = this->q[i];
+}
+
+/**
+ * @name getOffset
+ * @brief getOffset: yaw offset added to the DMP
+ * @retval float: deg
+ */
+float DmpYawFusion::getOffset() const
+{
+    return offset * YAW_RAD_TO_DEG;
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name compose
+ * @brief compose: q = qz(offset) * q6
+ */
+void DmpYawFusion::compose(const float q6[4])
+{
+    const float c = cosf(0.5f * offset);
+    const float s = sinf(0.5f * offset);
+    q[0] = c * q6[0] - s * q6[3];
+    q[1] = c * q6[1] - s * q6[2];
+    q[2] = c * q6[2] + s * q6[1];
+    q[3] = c * q6[3] + s * q6[0];
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,119 @@
+/**
+ * @file DmpYawFusion.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetometer yaw correction of the 6-axis quaternion of the DMP
+ *
+ * The 6-axis quaternion of the DMP has roll and pitch on gravity, but its yaw starts anywhere and drifts
+ * with the gyro. The fused attitude is that quaternion turned about the vertical by a yaw offset:
+ *      q = qz(offset) * q6
+ * At each magnetometer sample the field is taken to the world frame by q, and the offset is moved so that
+ * its horizontal part points along +x, the magnetic north of the Mahony filter: 1 - exp(-dt / DMP_YAW_TIME)
+ * of the angle left, all of it at the first sample. Between samples the gyro of the DMP carries the yaw.
+ * The frames are the ones of the Mahony filter of the quaternion compass library: world z up, field along +x.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef DMP_YAW_FUSION_H
+#define DMP_YAW_FUSION_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const float DMP_YAW_TIME = 1.0f;    // s, time constant of the yaw on the magnetometer
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class DmpYawFusion
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name DmpYawFusion
+     * @brief DmpYawFusion: constructor, no offset, the next magnetometer sample sets it
+     */
+    DmpYawFusion();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name reset
+     * @brief reset: the next magnetometer sample sets the offset at once
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name update
+     * @brief update: new 6-axis quaternion, and magnetometer sample if any
+     * @param [in] const float q6[4]: w, x, y, z, 6-axis quaternion in the filter frame
+     * @param [in] const float *mag: calibrated magnetometer in the filter frame, any unit; NULL if no new sample
+     * @param [in] float dt: s since the previous magnetometer sample, ignored without one
+     * @param [in] float weight: weight of the magnetometer, 0 to 1, e.g. down while a servo moves
+     * @retval None
+     */
+    void update(const float q6[4], const float *mag, float dt, float weight = 1.0f);
+
+    /**
+     * @name getQuaternion
+     * @brief getQuaternion: fused attitude, w, x, y, z
+     * @param [out] float q[4]
+     * @retval None
+     */
+    void getQuaternion(float q[4]) const;
+
+    /**
+     * @name getOffset
+     * @brief getOffset: yaw offset added to the DMP
+     * @retval float: deg
+     */
+    float getOffset() const;
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void compose(const float q6[4]);
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    float offset;                   // rad
+    bool initialized;               // offset set by a magnetometer sample
+    float q[4];                     // fused
+
+}; /* DmpYawFusion */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* DMP_YAW_FUSION_H */
+
+/****************************************************************************
+ ****************************************************************************/
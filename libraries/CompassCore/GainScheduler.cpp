@@ -0,0 +1,105 @@
+/**
+ * @file GainScheduler.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Gain of a fusion filter scheduled on its residual: high to converge, low to keep the needle quiet
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "GainScheduler.h"
+#include <math.h>
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name GainScheduler
+ * @brief GainScheduler: constructor, at the high gain
+ * @param [in] const gain_schedule_t &schedule
+ */
+GainScheduler::GainScheduler(const gain_schedule_t &schedule) : schedule(schedule)
+{
+    reset();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name setSchedule
+ * @brief setSchedule: schedule of the gain; the gain now is kept within the new high and low
+ */
+void GainScheduler::setSchedule(const gain_schedule_t &schedule)
+{
+    this->schedule = schedule;
+    if (gain > schedule.high) gain = schedule.high;
+    if (gain < schedule.low) gain = schedule.low;
+}
+
+/**
+ * @name reset
+ * @brief reset: high gain, mean residual forgotten
+ * @retval None
+ */
+void GainScheduler::reset()
+{
+    gain = schedule.high;
+    primed = false;
+    for (uint8_t i = 0; i < 3; ++i) mean[i] = 0.0f;
+}
+
+/**
+ * @name boost
+ * @brief boost: back to the high gain, the filter has to converge again
+ * @retval None
+ */
+void GainScheduler::boost()
+{
+    gain = schedule.high;
+}
+
+/**
+ * @name update
+ * @brief update: one residual of the filter
+ * @param [in] const float residual[3]: error the filter corrects, e.g. the Mahony cross products
+ * @param [in] float dt: s since the previous residual
+ * @retval float: gain
+ */
+float GainScheduler::update(const float residual[3], float dt)
+{
+    if (dt <= 0.0f)
+    {
+        return gain;
+    }
+
+    // ----- Mean residual, as a vector: the waves average out, a wrong attitude does not
+    const float alpha = primed ? 1.0f - expf(-dt / schedule.residualTime) : 1.0f;
+    for (uint8_t i = 0; i < 3; ++i) mean[i] += alpha * (residual[i] - mean[i]);
+    primed = true;
+    const float norm = getResidual();
+
+    if (norm >= schedule.boostResidual)
+    {
+        gain = schedule.high;
+    }
+    else if (norm < schedule.residualLimit)
+    {
+        gain = schedule.low + (gain - schedule.low) * expf(-dt / schedule.decayTime);
+    }
+    return gain;
+}
+
+/**
+ * @name getResidual
+ * @brief getResidual: norm of the mean residual
+ */
+float GainScheduler::getResidual() const
+{
+    return sqrtf(mean[0] * mean[0] + mean[1] * mean[1] + mean[2] * mean[2]);
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,138 @@
+/**
+ * @file GainScheduler.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Gain of a fusion filter scheduled on its residual: high to converge, low to keep the needle quiet
+ *
+ * A fixed gain is a trade-off: high it converges in a moment but lets the noise of the accelerometer and
+ * of the magnetometer through, low it is quiet but takes long to converge. The scheduler starts at the
+ * high gain and decays to the low one over decayTime while the residual of the filter is small, e.g. the
+ * error vector of the Mahony correction:
+ *      - the residual is averaged over residualTime, as a vector: the waves swing it both ways and average
+ *        out, a wrong attitude keeps it on one side
+ *      - the gain decays only while the mean is under residualLimit, and holds over it
+ *      - over boostResidual the filter has to converge again and the gain goes back to high; boost() does
+ *        the same for the events the caller sees, e.g. the end of a magnetic disturbance
+ * The schedule is a plain struct and can be changed at any time with setSchedule().
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef GAIN_SCHEDULER_H
+#define GAIN_SCHEDULER_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+struct gain_schedule_t
+{
+    float high;                 // gain at the start and after a boost
+    float low;                  // gain of the steady state
+    float decayTime;            // s, time constant from high to low while the residual is small
+    float residualTime;         // s, time constant of the mean residual
+    float residualLimit;        // mean residual under which the gain decays
+    float boostResidual;        // mean residual over which the gain goes back to high
+};
+
+class GainScheduler
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name GainScheduler
+     * @brief GainScheduler: constructor, at the high gain
+     * @param [in] const gain_schedule_t &schedule
+     */
+    GainScheduler(const gain_schedule_t &schedule);
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name setSchedule / getSchedule
+     * @brief schedule of the gain; the gain now is kept within the new high and low
+     */
+    void setSchedule(const gain_schedule_t &schedule);
+    const gain_schedule_t &getSchedule() const { return schedule; }
+
+    /**
+     * @name reset
+     * @brief reset: high gain, mean residual forgotten
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name boost
+     * @brief boost: back to the high gain, the filter has to converge again
+     * @retval None
+     */
+    void boost();
+
+    /**
+     * @name update
+     * @brief update: one residual of the filter
+     * @param [in] const float residual[3]: error the filter corrects, e.g. the Mahony cross products
+     * @param [in] float dt: s since the previous residual
+     * @retval float: gain
+     */
+    float update(const float residual[3], float dt);
+
+    /**
+     * @name getGain
+     * @brief getGain: gain after the last update
+     */
+    float getGain() const { return gain; }
+
+    /**
+     * @name getResidual
+     * @brief getResidual: norm of the mean residual
+     */
+    float getResidual() const;
+
+
+private:
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    gain_schedule_t schedule;
+    float gain;
+    float mean[3];                  // mean residual
+    bool primed;                    // mean started from a residual
+
+}; /* GainScheduler */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* GAIN_SCHEDULER_H */
+
+/****************************************************************************
+ ****************************************************************************/
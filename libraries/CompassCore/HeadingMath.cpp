@@ -0,0 +1,139 @@
+/**
+ * @file HeadingMath.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Tilt compensated heading from an accelerometer and a magnetometer reading
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "HeadingMath.h"
+#include <math.h>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const float HEADING_RAD_TO_DEG = 57.295779513f;
+
+/*-----------------------------------*
+ * PUBLIC FUNCTIONS
+ *-----------------------------------*/
+/**
+ * @name headingFromVectors
+ * @brief headingFromVectors: tilt compensated heading with cross products and a single atan2
+ * @param [in] const float acc[3]: accelerometer, gravity reaction (z up when flat)
+ * @param [in] const float mag[3]: magnetometer, hard and soft iron calibrated
+ * @retval float heading 0 to 360 deg
+ */
+float headingFromVectors(const float acc[3], const float mag[3])
+{
+    // east = m x g
+    const float ex = mag[1] * acc[2] - mag[2] * acc[1];
+    const float ey = mag[2] * acc[0] - mag[0] * acc[2];
+    const float ez = mag[0] * acc[1] - mag[1] * acc[0];
+
+    // north = g x east, only the x component is needed; |north| = |g| * |east|
+    const float nx = acc[1] * ez - acc[2] * ey;
+    const float gNorm = sqrtf(acc[0] * acc[0] + acc[1] * acc[1] + acc[2] * acc[2]);
+
+    float heading = atan2f(ex * gNorm, nx) * HEADING_RAD_TO_DEG;
+    if (heading < 0) heading += 360.0f;
+    return heading;
+}
+
+/**
+ * @name headingFromEuler
+ * @brief headingFromEuler: tilt compensated heading through pitch and roll, the original CompassManager formula
+ * @param [in] const float acc[3]: accelerometer normalized, gravity reaction (z up when flat)
+ * @param [in] const float mag[3]: magnetometer normalized, hard and soft iron calibrated
+ * @retval float heading 0 to 360 deg, NaN when the roll is undefined (pitch near +-90 deg)
+ */
+float headingFromEuler(const float acc[3], const float mag[3])
+{
+    // Calculating pitch and roll angles following Application Note
+    const float pitch = (double) asin((double) - acc[0]);
+    const float roll = (double) asin((double) acc[1] / cos((double) pitch));
+
+    double Xh = mag[0] * cos((double)pitch) + mag[2] * sin((double)pitch);
+    double Yh = mag[0] * sin((double)roll) * sin((double)pitch) + mag[1] * cos((double)roll) - mag[2] * sin((float)roll) * cos((float)pitch);
+
+    float heading = (atan2(Yh, Xh)) * HEADING_RAD_TO_DEG;
+    if (heading < 0) heading += 360.0f;
+    return heading;
+}
+
+/**
+ * @name attitudeFromVectors
+ * @brief attitudeFromVectors: attitude of the sensor from gravity and field (TRIAD), gravity exact, the
+ *                             field only for the heading
+ * @param [in] const float acc[3]: accelerometer, gravity reaction (z up when flat)
+ * @param [in] const float mag[3]: magnetometer, hard and soft iron calibrated
+ * @param [out] float quaternion[4]: w, x, y, z, sensor to earth, earth x magnetic north and z up
+ * @retval bool: false if the vectors are null or parallel, quaternion untouched
+ */
+bool attitudeFromVectors(const float acc[3], const float mag[3], float quaternion[4])
+{
+    // ----- Earth axes in the sensor frame: up = g, west = g x m, north = west x up
+    const float upNorm = sqrtf(acc[0] * acc[0] + acc[1] * acc[1] + acc[2] * acc[2]);
+    float wx = acc[1] * mag[2] - acc[2] * mag[1];
+    float wy = acc[2] * mag[0] - acc[0] * mag[2];
+    float wz = acc[0] * mag[1] - acc[1] * mag[0];
+    const float westNorm = sqrtf(wx * wx + wy * wy + wz * wz);
+    if (upNorm == 0.0f || westNorm == 0.0f)
+    {
+        return false;
+    }
+    const float ux = acc[0] / upNorm, uy = acc[1] / upNorm, uz = acc[2] / upNorm;
+    wx /= westNorm; wy /= westNorm; wz /= westNorm;
+    const float nx = wy * uz - wz * uy;
+    const float ny = wz * ux - wx * uz;
+    const float nz = wx * uy - wy * ux;
+
+    // ----- Rows north, west, up are the rotation sensor to earth; to a quaternion on its largest term
+    const float trace = nx + wy + uz;
+    float w, x, y, z;
+    if (trace > 0.0f)
+    {
+        const float s = 2.0f * sqrtf(1.0f + trace);
+        w = 0.25f * s;
+        x = (uy - wz) / s;
+        y = (nz - ux) / s;
+        z = (wx - ny) / s;
+    }
+    else if (nx > wy && nx > uz)
+    {
+        const float s = 2.0f * sqrtf(1.0f + nx - wy - uz);
+        w = (uy - wz) / s;
+        x = 0.25f * s;
+        y = (ny + wx) / s;
+        z = (nz + ux) / s;
+    }
+    else if (wy > uz)
+    {
+        const float s = 2.0f * sqrtf(1.0f + wy - nx - uz);
+        w = (nz - ux) / s;
+        x = (ny + wx) / s;
+        y = 0.25f * s;
+        z = (wz + uy) / s;
+    }
+    else
+    {
+        const float s = 2.0f * sqrtf(1.0f + uz - nx - wy);
+        w = (wx - ny) / s;
+        x = (nz + ux) / s;
+        y = (wz + uy) / s;
+        z = 0.25f * s;
+    }
+    // same sign as the identity, a filter started from it does not see a jump
+    const float sign = (w < 0.0f) ? -1.0f : 1.0f;
+    quaternion[0] = sign * w;
+    quaternion[1] = sign * x;
+    quaternion[2] = sign * y;
+    quaternion[3] = sign * z;
+    return true;
+}
+
+/****************************************************************************
+ ****************************************************************************/
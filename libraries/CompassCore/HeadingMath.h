@@ -0,0 +1,91 @@
+/**
+ * @file HeadingMath.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Tilt compensated heading from an accelerometer and a magnetometer reading
+ *
+ * Two implementations of the same heading, 0 to 360 deg clockwise from magnetic north of the
+ * sensor x axis, for a sensor frame with z up when flat (LSM303DLHC, GY-511):
+ *      - headingFromEuler: pitch and roll of the ST application note, then the field is rotated
+ *        back to the horizontal plane; asin, atan2 and six sin/cos, undefined near +-90 deg pitch
+ *      - headingFromVectors: east = m x g, north = g x east, heading = atan2(east_x * |g|, north_x);
+ *        one sqrt and one atan2, defined for every attitude except x axis exactly vertical
+ * attitudeFromVectors gives the whole attitude of the same two vectors (TRIAD), a quaternion to start
+ * an attitude filter at once instead of letting it converge from level and north.
+ *
+ * The inputs need not be normalized nor calibrated to the same unit.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef HEADING_MATH_H
+#define HEADING_MATH_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+enum class heading_method_t
+{
+    EULER,      // pitch/roll and rotation to the horizontal plane
+    VECTOR      // cross products of gravity and field
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/**
+ * @name headingFromVectors
+ * @brief headingFromVectors: tilt compensated heading with cross products and a single atan2
+ * @param [in] const float acc[3]: accelerometer, gravity reaction (z up when flat)
+ * @param [in] const float mag[3]: magnetometer, hard and soft iron calibrated
+ * @retval float heading 0 to 360 deg
+ */
+float headingFromVectors(const float acc[3], const float mag[3]);
+
+/**
+ * @name headingFromEuler
+ * @brief headingFromEuler: tilt compensated heading through pitch and roll, the original CompassManager formula
+ * @param [in] const float acc[3]: accelerometer normalized, gravity reaction (z up when flat)
+ * @param [in] const float mag[3]: magnetometer normalized, hard and soft iron calibrated
+ * @retval float heading 0 to 360 deg, NaN when the roll is undefined (pitch near +-90 deg)
+ */
+float headingFromEuler(const float acc[3], const float mag[3]);
+
+/**
+ * @name attitudeFromVectors
+ * @brief attitudeFromVectors: attitude of the sensor from gravity and field (TRIAD), gravity exact, the
+ *                             field only for the heading
+ * @param [in] const float acc[3]: accelerometer, gravity reaction (z up when flat)
+ * @param [in] const float mag[3]: magnetometer, hard and soft iron calibrated
+ * @param [out] float quaternion[4]: w, x, y, z, sensor to earth, earth x magnetic north and z up
+ * @retval bool: false if the vectors are null or parallel, quaternion untouched
+ */
+bool attitudeFromVectors(const float acc[3], const float mag[3], float quaternion[4]);
+
+
+#endif /* HEADING_MATH_H */
+
+/****************************************************************************
+ ****************************************************************************/
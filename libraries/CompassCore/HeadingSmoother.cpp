@@ -0,0 +1,197 @@
+/**
+ * @file HeadingSmoother.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Heading smoothing with circular statistics
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "HeadingSmoother.h"
+#include <math.h>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const float SMOOTHER_DEG_TO_RAD = 0.017453292519943f;
+const float SMOOTHER_RAD_TO_DEG = 57.295779513082f;
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name HeadingSmoother
+ * @brief HeadingSmoother: constructor, window mode
+ * @param [in] uint8_t window: headings averaged, 1 to HEADING_SMOOTHER_MAX_WINDOW
+ */
+HeadingSmoother::HeadingSmoother(uint8_t window)
+{
+    alpha = DEFAULT_SMOOTHER_ALPHA;
+    setWindow(window);
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name setWindow
+ * @brief setWindow: window mode, mean of the last headings; clears the history
+ * @param [in] uint8_t window: headings averaged, 1 to HEADING_SMOOTHER_MAX_WINDOW
+ * @retval None
+ */
+void HeadingSmoother::setWindow(uint8_t window)
+{
+    if (window < 1) window = 1;
+    if (window > HEADING_SMOOTHER_MAX_WINDOW) window = HEADING_SMOOTHER_MAX_WINDOW;
+
+    mode = smoother_mode_t::WINDOW;
+    this->window = window;
+    reset();
+}
+
+/**
+ * @name setExponential
+ * @brief setExponential: exponential mode; clears the history
+ * @param [in] float alpha: weight of the new heading, 0 to 1
+ * @retval None
+ */
+void HeadingSmoother::setExponential(float alpha)
+{
+    if (alpha <= 0.0f || alpha > 1.0f) alpha = DEFAULT_SMOOTHER_ALPHA;
+
+    mode = smoother_mode_t::EXPONENTIAL;
+    this->alpha = alpha;
+    reset();
+}
+
+/**
+ * @name reset
+ * @brief reset: forget every heading
+ * @retval None
+ */
+void HeadingSmoother::reset()
+{
+    count   = 0;
+    next    = 0;
+    sinSum  = 0.0f;
+    cosSum  = 0.0f;
+}
+
+/**
+ * @name update
+ * @brief update: add a heading
+ * @param [in] float heading: deg, any range
+ * @retval float smoothed heading 0 to 360 deg
+ */
+float HeadingSmoother::update(float heading)
+{
+    const float s = sinf(heading * SMOOTHER_DEG_TO_RAD);
+    const float c = cosf(heading * SMOOTHER_DEG_TO_RAD);
+
+    if (mode == smoother_mode_t::EXPONENTIAL)
+    {
+        if (count == 0)
+        {
+            sinSum = s;
+            cosSum = c;
+        }
+        else
+        {
+            sinSum += alpha * (s - sinSum);
+            cosSum += alpha * (c - cosSum);
+        }
+        if (count < 255) count++;
+        return getHeading();
+    }
+
+    // ----- Window: replace the oldest heading once the ring is full
+    if (count == window)
+    {
+        sinSum -= sinRing[next];
+        cosSum -= cosRing[next];
+    }
+    else
+    {
+        count++;
+    }
+    sinRing[next] = s;
+    cosRing[next] = c;
+    sinSum += s;
+    cosSum += c;
+
+    next++;
+    if (next == window)
+    {
+        next = 0;
+        resum();                                    // once per lap, O(1) amortized
+    }
+    return getHeading();
+}
+
+/**
+ * @name getHeading
+ * @brief getHeading: smoothed heading
+ * @retval float 0 to 360 deg, 0 if there is no heading yet
+ */
+float HeadingSmoother::getHeading() const
+{
+    if (count == 0) return 0.0f;
+
+    float heading = atan2f(sinSum, cosSum) * SMOOTHER_RAD_TO_DEG;
+    if (heading < 0.0f) heading += 360.0f;
+    if (heading >= 360.0f) heading -= 360.0f;
+    return heading;
+}
+
+/**
+ * @name getCircularVariance
+ * @brief getCircularVariance: spread of the smoothed headings
+ * @retval float 0 (steady) to 1 (uniform), 1 if there is no heading yet
+ */
+float HeadingSmoother::getCircularVariance() const
+{
+    if (count == 0) return 1.0f;
+
+    float length = sqrtf(sinSum * sinSum + cosSum * cosSum);
+    if (mode == smoother_mode_t::WINDOW) length /= count;
+
+    const float variance = 1.0f - length;
+    return variance < 0.0f ? 0.0f : variance;
+}
+
+/**
+ * @name getLag
+ * @brief getLag: delay of the smoothed heading behind the last heading added, for a heading turning at a
+ *                steady rate: (count - 1) / 2 in window mode, (1 - alpha) / alpha in exponential mode
+ * @retval float samples
+ */
+float HeadingSmoother::getLag() const
+{
+    if (count == 0) return 0.0f;
+    if (mode == smoother_mode_t::WINDOW) return (count - 1) * 0.5f;
+    return (1.0f - alpha) / alpha;
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name resum
+ * @brief resum: rebuild the window sums from the ring, drops the rounding of add and subtract
+ * @retval None
+ */
+void HeadingSmoother::resum()
+{
+    sinSum = 0.0f;
+    cosSum = 0.0f;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        sinSum += sinRing[i];
+        cosSum += cosRing[i];
+    }
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,169 @@
+/**
+ * @file HeadingSmoother.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Heading smoothing with circular statistics
+ *
+ * Headings are averaged as unit vectors (sin, cos), so 359 and 1 deg give 0 and not 180.
+ * Two modes:
+ *      - WINDOW: mean of the last N headings, running sin/cos sums over a ring buffer,
+ *        O(1) per update (the sums are rebuilt once per lap of the ring to drop float drift)
+ *      - EXPONENTIAL: exponential moving average of the unit vectors, no buffer
+ * The circular variance, 1 - length of the mean vector, is 0 for a steady heading and goes
+ * to 1 for headings spread all around: it is the stability metric of the compass.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef HEADING_SMOOTHER_H
+#define HEADING_SMOOTHER_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint8_t HEADING_SMOOTHER_MAX_WINDOW   = 64;
+const uint8_t DEFAULT_SMOOTHER_WINDOW       = 30;
+const float   DEFAULT_SMOOTHER_ALPHA        = 0.1f;
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+enum class smoother_mode_t
+{
+    WINDOW,         // mean of the last N headings
+    EXPONENTIAL     // exponential moving average
+};
+
+class HeadingSmoother
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name HeadingSmoother
+     * @brief HeadingSmoother: constructor, window mode
+     * @param [in] uint8_t window: headings averaged, 1 to HEADING_SMOOTHER_MAX_WINDOW
+     */
+    HeadingSmoother(uint8_t window = DEFAULT_SMOOTHER_WINDOW);
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name setWindow
+     * @brief setWindow: window mode, mean of the last headings; clears the history
+     * @param [in] uint8_t window: headings averaged, 1 to HEADING_SMOOTHER_MAX_WINDOW
+     * @retval None
+     */
+    void setWindow(uint8_t window);
+
+    /**
+     * @name setExponential
+     * @brief setExponential: exponential mode; clears the history
+     * @param [in] float alpha: weight of the new heading, 0 to 1
+     * @retval None
+     */
+    void setExponential(float alpha);
+
+    /**
+     * @name reset
+     * @brief reset: forget every heading
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name update
+     * @brief update: add a heading
+     * @param [in] float heading: deg, any range
+     * @retval float smoothed heading 0 to 360 deg
+     */
+    float update(float heading);
+
+    /**
+     * @name getHeading
+     * @brief getHeading: smoothed heading
+     * @retval float 0 to 360 deg, 0 if there is no heading yet
+     */
+    float getHeading() const;
+
+    /**
+     * @name getCircularVariance
+     * @brief getCircularVariance: spread of the smoothed headings
+     * @retval float 0 (steady) to 1 (uniform), 1 if there is no heading yet
+     */
+    float getCircularVariance() const;
+
+    /**
+     * @name getLag
+     * @brief getLag: delay of the smoothed heading behind the last heading added, for a heading turning at a
+     *                steady rate: (count - 1) / 2 in window mode, (1 - alpha) / alpha in exponential mode
+     * @retval float samples
+     */
+    float getLag() const;
+
+    /**
+     * @name getMode
+     * @brief getMode: current mode
+     * @retval smoother_mode_t
+     */
+    smoother_mode_t getMode() const { return mode; }
+
+    /**
+     * @name getCount
+     * @brief getCount: headings in the window (exponential mode: headings since reset, saturated)
+     * @retval uint8_t
+     */
+    uint8_t getCount() const { return count; }
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void resum();
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    smoother_mode_t mode;
+    uint8_t window;
+    float alpha;
+
+    uint8_t count;
+    uint8_t next;                                   // ring slot of the next heading
+    float sinSum;                                   // window: sums; exponential: averages
+    float cosSum;
+    float sinRing[HEADING_SMOOTHER_MAX_WINDOW];
+    float cosRing[HEADING_SMOOTHER_MAX_WINDOW];
+
+}; /* HeadingSmoother */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* HEADING_SMOOTHER_H */
+
+/****************************************************************************
+ ****************************************************************************/
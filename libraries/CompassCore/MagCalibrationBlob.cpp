@@ -0,0 +1,177 @@
+/**
+ * @file MagCalibrationBlob.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Binary layout of a magnetometer calibration, shared by the host calibration tools and the firmware
+ *
+ * The blob stores the hard-iron offset and the full 3x3 soft-iron matrix so that
+ *      calibrated = softIron * (raw - offset)
+ * Every field is serialized little-endian, one after the other, with a CRC32 on the end.
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "MagCalibrationBlob.h"
+#include <string.h>
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name serializeMagCalibration
+ * @brief serializeMagCalibration: write the calibration in the blob layout
+ * @param [in] const MagCalibrationBlob &calibration: calibration to serialize
+ * @param [out] uint8_t buffer[MAG_CALIBRATION_BLOB_SIZE]: output buffer
+ * @retval None
+ */
+void serializeMagCalibration(const MagCalibrationBlob &calibration, uint8_t *buffer)
+{
+    uint8_t *p = buffer;
+
+    p = putU32(p, MAG_CALIBRATION_BLOB_MAGIC);
+    *p++ = MAG_CALIBRATION_BLOB_VERSION & 0xFF;
+    *p++ = (MAG_CALIBRATION_BLOB_VERSION >> 8) & 0xFF;
+    *p++ = (uint8_t)calibration.method;
+    *p++ = calibration.flags;
+
+    for (int i = 0; i < 3; ++i) p = putFloat(p, calibration.offset[i]);
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j) p = putFloat(p, calibration.softIron[i][j]);
+    }
+    p = putFloat(p, calibration.fieldRadius);
+    p = putFloat(p, calibration.residual);
+    p = putU32(p, calibration.samples);
+
+    putU32(p, crc32Ieee(buffer, p - buffer));
+}
+
+/**
+ * @name deserializeMagCalibration
+ * @brief deserializeMagCalibration: read a calibration checking magic, version and CRC
+ * @param [in] const uint8_t *buffer: blob bytes
+ * @param [in] size_t size: number of bytes in buffer
+ * @param [out] MagCalibrationBlob &calibration: decoded calibration
+ * @retval bool: true if the blob is valid
+ */
+bool deserializeMagCalibration(const uint8_t *buffer, size_t size, MagCalibrationBlob &calibration)
+{
+    if (size < MAG_CALIBRATION_BLOB_SIZE)
+    {
+        return false;
+    }
+
+    uint32_t crc;
+    getU32(buffer + MAG_CALIBRATION_BLOB_SIZE - 4, crc);
+    if (crc != crc32Ieee(buffer, MAG_CALIBRATION_BLOB_SIZE - 4))
+    {
+        return false;
+    }
+
+    uint32_t magic;
+    const uint8_t *p = getU32(buffer, magic);
+    uint16_t version = p[0] | (p[1] << 8);
+    p += 2;
+    if (magic != MAG_CALIBRATION_BLOB_MAGIC || version != MAG_CALIBRATION_BLOB_VERSION)
+    {
+        return false;
+    }
+
+    calibration.method = (mag_fit_method_t)*p++;
+    calibration.flags = *p++;
+    for (int i = 0; i < 3; ++i) p = getFloat(p, calibration.offset[i]);
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j) p = getFloat(p, calibration.softIron[i][j]);
+    }
+    p = getFloat(p, calibration.fieldRadius);
+    p = getFloat(p, calibration.residual);
+    getU32(p, calibration.samples);
+
+    return true;
+}
+
+/**
+ * @name crc32Ieee
+ * @brief crc32Ieee: standard CRC-32 (IEEE 802.3) of a buffer
+ * @param [in] const uint8_t *data: buffer
+ * @param [in] size_t size: number of bytes
+ * @retval uint32_t crc
+ */
+uint32_t crc32Ieee(const uint8_t *data, size_t size)
+{
+    // Bitwise version: the blob is small and a 1 KB table is not worth the RAM on the MCU
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/**
+ * @name putU32
+ * @brief putU32: write a field little-endian
+ * @param [out] uint8_t *p: 4 bytes
+ * @param [in] uint32_t value
+ * @retval uint8_t *: past the field
+ */
+uint8_t *putU32(uint8_t *p, uint32_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+    return p + 4;
+}
+
+/**
+ * @name putFloat
+ * @brief putFloat: write a float little-endian, its IEEE 754 bits
+ * @param [out] uint8_t *p: 4 bytes
+ * @param [in] float value
+ * @retval uint8_t *: past the field
+ */
+uint8_t *putFloat(uint8_t *p, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return putU32(p, bits);
+}
+
+/**
+ * @name getU32
+ * @brief getU32: read a field written by putU32
+ * @param [in] const uint8_t *p: 4 bytes
+ * @param [out] uint32_t &value
+ * @retval const uint8_t *: past the field
+ */
+const uint8_t *getU32(const uint8_t *p, uint32_t &value)
+{
+    value = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    return p + 4;
+}
+
+/**
+ * @name getFloat
+ * @brief getFloat: read a field written by putFloat
+ * @param [in] const uint8_t *p: 4 bytes
+ * @param [out] float &value
+ * @retval const uint8_t *: past the field
+ */
+const uint8_t *getFloat(const uint8_t *p, float &value)
+{
+    uint32_t bits;
+    p = getU32(p, bits);
+    memcpy(&value, &bits, sizeof(value));
+    return p;
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,122 @@
+/**
+ * @file MagCalibrationBlob.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Binary layout of a magnetometer calibration, shared by the host calibration tools and the firmware
+ *
+ * The blob stores the hard-iron offset and the full 3x3 soft-iron matrix so that
+ *      calibrated = softIron * (raw - offset)
+ * Every field is serialized little-endian, one after the other, with a CRC32 on the end; the helpers that do
+ * it are shared with the other blobs, e.g. ResumeState.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef MAG_CALIBRATION_BLOB_H
+#define MAG_CALIBRATION_BLOB_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint32_t MAG_CALIBRATION_BLOB_MAGIC   = 0x434D534A; // "JSMC" little-endian
+const uint16_t MAG_CALIBRATION_BLOB_VERSION = 1;
+const size_t   MAG_CALIBRATION_BLOB_SIZE    = 4 + 2 + 1 + 1 + 3 * 4 + 9 * 4 + 4 + 4 + 4 + 4;
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+enum class mag_fit_method_t : uint8_t
+{
+    MIN_MAX     = 0,
+    ELLIPSOID   = 1,
+    ROBUST      = 2
+};
+
+/* Flags stored in the blob */
+const uint8_t MAG_CALIBRATION_FLAG_REJECTED = 0x01;  // capture did not pass the quality checks
+
+struct MagCalibrationBlob
+{
+    mag_fit_method_t method;
+    uint8_t  flags;
+    float    offset[3];         // hard-iron offset, same unit of the raw samples
+    float    softIron[3][3];    // soft-iron matrix applied after offset removal
+    float    fieldRadius;       // expected norm of the calibrated field
+    float    residual;          // RMS of (|calibrated| - fieldRadius) / fieldRadius
+    uint32_t samples;           // samples used by the fit
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/**
+ * @name serializeMagCalibration
+ * @brief serializeMagCalibration: write the calibration in the blob layout
+ * @param [in] const MagCalibrationBlob &calibration: calibration to serialize
+ * @param [out] uint8_t buffer[MAG_CALIBRATION_BLOB_SIZE]: output buffer
+ * @retval None
+ */
+void serializeMagCalibration(const MagCalibrationBlob &calibration, uint8_t *buffer);
+
+/**
+ * @name deserializeMagCalibration
+ * @brief deserializeMagCalibration: read a calibration checking magic, version and CRC
+ * @param [in] const uint8_t *buffer: blob bytes
+ * @param [in] size_t size: number of bytes in buffer
+ * @param [out] MagCalibrationBlob &calibration: decoded calibration
+ * @retval bool: true if the blob is valid
+ */
+bool deserializeMagCalibration(const uint8_t *buffer, size_t size, MagCalibrationBlob &calibration);
+
+/**
+ * @name crc32Ieee
+ * @brief crc32Ieee: standard CRC-32 (IEEE 802.3) of a buffer
+ * @param [in] const uint8_t *data: buffer
+ * @param [in] size_t size: number of bytes
+ * @retval uint32_t crc
+ */
+uint32_t crc32Ieee(const uint8_t *data, size_t size);
+
+/**
+ * @name putU32 / putFloat
+ * @brief write a field little-endian, as every blob of the firmware
+ * @param [out] uint8_t *p: 4 bytes
+ * @param [in] value
+ * @retval uint8_t *: past the field
+ */
+uint8_t *putU32(uint8_t *p, uint32_t value);
+uint8_t *putFloat(uint8_t *p, float value);
+
+/**
+ * @name getU32 / getFloat
+ * @brief read a field written by putU32 / putFloat
+ * @param [in] const uint8_t *p: 4 bytes
+ * @param [out] value
+ * @retval const uint8_t *: past the field
+ */
+const uint8_t *getU32(const uint8_t *p, uint32_t &value);
+const uint8_t *getFloat(const uint8_t *p, float &value);
+
+
+#endif /* MAG_CALIBRATION_BLOB_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,225 @@
+/**
+ * @file MagDisturbanceDetector.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetic disturbance detection from the norm and the inclination of the calibrated field
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "MagDisturbanceDetector.h"
+#include <math.h>
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const float DISTURBANCE_RAD_TO_DEG = 57.295779513082f;
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name MagDisturbanceDetector
+ * @brief MagDisturbanceDetector: constructor, learning the reference
+ */
+MagDisturbanceDetector::MagDisturbanceDetector()
+{
+    expectedDip = 0.0f;
+    expectedValid = false;
+    expectedOverridden = false;
+    reset();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name reset
+ * @brief reset: reference forgotten, learned again from the next samples
+ * @retval None
+ */
+void MagDisturbanceDetector::reset()
+{
+    state = mag_field_state_t::LEARNING;
+    referenceNorm = 0.0f;
+    referenceDip = 0.0f;
+    dipValid = false;
+    learnTime = 0.0f;
+    clearTime = 0.0f;
+    coastTime = 0.0f;
+    mismatchTime = 0.0f;
+    weight = 1.0f;
+}
+
+/**
+ * @name update
+ * @brief update: one magnetometer sample
+ * @param [in] const float mag[3]: calibrated field, any unit
+ * @param [in] const float up[3]: vertical in the frame of mag, up positive, unit from an attitude filter
+ * @param [in] float accNorm: g, norm of the raw accelerometer of the sample
+ * @param [in] float dt: s since the previous magnetometer sample
+ * @retval float: weight of the sample, 0 to 1
+ */
+float MagDisturbanceDetector::update(const float mag[3], const float up[3], float accNorm, float dt)
+{
+    const float norm = sqrtf(mag[0] * mag[0] + mag[1] * mag[1] + mag[2] * mag[2]);
+    if (norm == 0.0f)
+    {
+        return weight;
+    }
+    if (dt < 0.0f) dt = 0.0f;
+
+    // ----- Dip from the vertical, only while the accelerometer feels about 1 g: the vertical is always unit,
+    //       an acceleration tilts it slowly through the filter
+    const bool quiet = fabsf(accNorm - 1.0f) < MAG_DIP_ACC_TOLERANCE;
+    float dip = 0.0f;
+    if (quiet)
+    {
+        float down = -(mag[0] * up[0] + mag[1] * up[1] + mag[2] * up[2]) / norm;
+        if (down > 1.0f) down = 1.0f;
+        if (down < -1.0f) down = -1.0f;
+        dip = asinf(down) * DISTURBANCE_RAD_TO_DEG;
+    }
+
+    // ----- Reference: mean of the first MAG_REFERENCE_SETTLE
+    if (state == mag_field_state_t::LEARNING)
+    {
+        if (dt > MAG_LEARN_GAP) dt = MAG_LEARN_GAP;
+
+        // the field of the place is known: off it the power-on field is a disturbance, not a reference
+        if (quiet && expectedValid && !expectedOverridden && fabsf(dip - expectedDip) >= MAG_DIP_TOLERANCE)
+        {
+            mismatchTime += dt;
+            if (mismatchTime < MAG_COAST_LIMIT)
+            {
+                learnTime = 0.0f;
+                dipValid = false;
+                weight = 0.0f;
+                return weight;
+            }
+            // off the model that long, as after a long coasting: the field the compass lives in
+            expectedOverridden = true;
+        }
+        mismatchTime = 0.0f;
+
+        const float alpha = (learnTime > 0.0f) ? dt / (learnTime + dt) : 1.0f;
+        referenceNorm += alpha * (norm - referenceNorm);
+        if (quiet)
+        {
+            referenceDip = dipValid ? referenceDip + alpha * (dip - referenceDip) : dip;
+            dipValid = true;
+        }
+        learnTime += dt;
+        if (learnTime >= MAG_REFERENCE_SETTLE) state = mag_field_state_t::CLEAN;
+        weight = 1.0f;
+        return weight;
+    }
+
+    float deviation = fabsf(norm / referenceNorm - 1.0f) / MAG_NORM_TOLERANCE;
+    if (quiet && dipValid)
+    {
+        deviation = fmaxf(deviation, fabsf(dip - referenceDip) / MAG_DIP_TOLERANCE);
+    }
+
+    if (state == mag_field_state_t::CLEAN)
+    {
+        if (deviation >= 1.0f)
+        {
+            state = mag_field_state_t::DISTURBED;
+            clearTime = 0.0f;
+            coastTime = 0.0f;
+            weight = 0.0f;
+            return weight;
+        }
+        weight = 2.0f - 2.0f * deviation;
+        if (weight > 1.0f) weight = 1.0f;
+
+        // the reference follows the slow changes of a clean field: temperature, a new place
+        if (deviation < 0.5f)
+        {
+            const float alpha = 1.0f - expf(-dt / MAG_REFERENCE_TIME);
+            referenceNorm += alpha * (norm - referenceNorm);
+            if (quiet)
+            {
+                referenceDip = dipValid ? referenceDip + alpha * (dip - referenceDip) : dip;
+                dipValid = true;
+            }
+        }
+        return weight;
+    }
+
+    // ----- DISTURBED: gyro only, until the field is back or the coasting is too long
+    // on waves only the norm is checked, and a disturbance can keep the norm: such samples do not clear it
+    coastTime += dt;
+    if (deviation >= 0.5f)
+    {
+        clearTime = 0.0f;
+    }
+    else if (quiet || !dipValid)
+    {
+        clearTime += dt;
+    }
+    weight = 0.0f;
+    if (clearTime >= MAG_CLEAR_TIME)
+    {
+        state = mag_field_state_t::CLEAN;
+        coastTime = 0.0f;
+        weight = 1.0f;
+    }
+    else if (coastTime >= MAG_COAST_LIMIT)
+    {
+        referenceNorm = norm;
+        referenceDip = dip;
+        dipValid = quiet;
+        state = mag_field_state_t::CLEAN;
+        coastTime = 0.0f;
+        weight = 1.0f;
+    }
+    return weight;
+}
+
+/**
+ * @name setExpectedDip
+ * @brief setExpectedDip: inclination of the place, e.g. MagneticModel at the fix; a reference off it is
+ *                        learned again; cheap, call it at every fix
+ * @param [in] float dip: deg, down positive
+ * @retval None
+ */
+void MagDisturbanceDetector::setExpectedDip(float dip)
+{
+    expectedDip = dip;
+    expectedValid = true;
+
+    if (state == mag_field_state_t::LEARNING || !dipValid)
+    {
+        return;
+    }
+    // a reference learned next to an engine: learned again, against the dip of the place this time; not if it
+    // was already taken against the model after MAG_COAST_LIMIT, until the field agrees with the model again
+    if (fabsf(referenceDip - dip) < MAG_DIP_TOLERANCE)
+    {
+        expectedOverridden = false;
+    }
+    else if (!expectedOverridden)
+    {
+        reset();
+    }
+}
+
+/**
+ * @name getReference
+ * @brief getReference: reference of the field
+ * @param [out] float &norm: unit of the samples
+ * @param [out] float &dip: deg, down positive
+ * @retval None
+ */
+void MagDisturbanceDetector::getReference(float &norm, float &dip) const
+{
+    norm = referenceNorm;
+    dip = referenceDip;
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,172 @@
+/**
+ * @file MagDisturbanceDetector.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetic disturbance detection from the norm and the inclination of the calibrated field
+ *
+ * An engine, a speaker or the steel of a hull adds its own field: the norm and the dip angle of the
+ * calibrated magnetometer move away from the ones of the place. The detector keeps a reference of both,
+ * learned while the field is clean (MAG_REFERENCE_TIME, MAG_REFERENCE_SETTLE at the start), and compares
+ * each sample against it:
+ *      deviation = max(|norm / reference - 1| / MAG_NORM_TOLERANCE, |dip - reference| / MAG_DIP_TOLERANCE)
+ * The weight of the magnetometer is 1 up to half the tolerance and goes down to 0 at the tolerance;
+ * over it the field is DISTURBED, weight 0, and the heading coasts on the gyro until the deviation stays
+ * under half the tolerance for MAG_CLEAR_TIME.
+ * The dip needs the vertical of an attitude filter, unit and gyro-stabilised: the gyro averages out the waves.
+ * Its accelerometer still pulls it over seconds, so the dip is checked only while the raw accelerometer norm,
+ * given apart, is within MAG_DIP_ACC_TOLERANCE of 1 g. Without it the norm alone decides, but only a sample
+ * with the dip checked counts to leave DISTURBED.
+ * The coasting is bounded: after MAG_COAST_LIMIT disturbed the field is taken as the new reference, a
+ * disturbance that long is the field the compass lives in, and the gyro would have drifted anyway.
+ * The reference learned at power-on is only as clean as the field then, e.g. next to a running engine.
+ * setExpectedDip() gives the inclination of the place, from the World Magnetic Model at the fix: a reference
+ * dip off it by MAG_DIP_TOLERANCE is learned again, and while learning the samples off it are a disturbance
+ * (weight 0) and restart the learning, also here at most for MAG_COAST_LIMIT, then the field is taken as it is.
+ * A sample interval counts at most MAG_LEARN_GAP while learning, a gap in the samples does not end the
+ * learning on one sample.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef MAG_DISTURBANCE_DETECTOR_H
+#define MAG_DISTURBANCE_DETECTOR_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const float MAG_NORM_TOLERANCE      = 0.08f;    // relative change of the norm that is a disturbance
+const float MAG_DIP_TOLERANCE       = 4.0f;     // deg, change of the inclination that is a disturbance
+const float MAG_DIP_ACC_TOLERANCE   = 0.05f;    // g, accelerometer norm off 1 g over which the dip is not checked
+const float MAG_REFERENCE_SETTLE    = 2.0f;     // s, reference learned at once at the start
+const float MAG_REFERENCE_TIME      = 60.0f;    // s, time constant of the reference while clean
+const float MAG_CLEAR_TIME          = 1.0f;     // s under half the tolerance to leave DISTURBED
+const float MAG_COAST_LIMIT         = 30.0f;    // s, longest coasting on the gyro
+const float MAG_LEARN_GAP           = 0.5f;     // s, longest interval a sample counts for while learning
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+enum class mag_field_state_t
+{
+    LEARNING,
+    CLEAN,
+    DISTURBED
+};
+
+class MagDisturbanceDetector
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name MagDisturbanceDetector
+     * @brief MagDisturbanceDetector: constructor, learning the reference
+     */
+    MagDisturbanceDetector();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name reset
+     * @brief reset: reference forgotten, learned again from the next samples
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name update
+     * @brief update: one magnetometer sample
+     * @param [in] const float mag[3]: calibrated field, any unit
+     * @param [in] const float up[3]: vertical in the frame of mag, up positive, unit from an attitude filter
+     * @param [in] float accNorm: g, norm of the raw accelerometer of the sample
+     * @param [in] float dt: s since the previous magnetometer sample
+     * @retval float: weight of the sample, 0 to 1
+     */
+    float update(const float mag[3], const float up[3], float accNorm, float dt);
+
+    /**
+     * @name setExpectedDip
+     * @brief setExpectedDip: inclination of the place, e.g. MagneticModel at the fix; a reference off it is
+     *                        learned again; cheap, call it at every fix
+     * @param [in] float dip: deg, down positive
+     * @retval None
+     */
+    void setExpectedDip(float dip);
+
+    /**
+     * @name getWeight
+     * @brief getWeight: weight of the magnetometer after the last sample, 0 while disturbed
+     */
+    float getWeight() const { return weight; }
+
+    /**
+     * @name getState / isDisturbed
+     * @brief state of the field; isDisturbed() also while LEARNING a field off the expected dip
+     */
+    mag_field_state_t getState() const { return state; }
+    bool isDisturbed() const { return state == mag_field_state_t::DISTURBED || mismatchTime > 0.0f; }
+
+    /**
+     * @name getCoastTime
+     * @brief getCoastTime: s disturbed so far, 0 if clean
+     */
+    float getCoastTime() const { return coastTime; }
+
+    /**
+     * @name getReference
+     * @brief getReference: reference of the field
+     * @param [out] float &norm: unit of the samples
+     * @param [out] float &dip: deg, down positive
+     * @retval None
+     */
+    void getReference(float &norm, float &dip) const;
+
+
+private:
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    mag_field_state_t state;
+    float referenceNorm;
+    float referenceDip;             // deg
+    bool dipValid;                  // referenceDip learned with a quiet accelerometer
+    float learnTime;                // s of LEARNING
+    float clearTime;                // s under half the tolerance while DISTURBED
+    float coastTime;                // s DISTURBED
+    float weight;
+    float expectedDip;              // deg, of the place
+    bool expectedValid;             // expectedDip given
+    bool expectedOverridden;        // field taken against expectedDip after MAG_COAST_LIMIT
+    float mismatchTime;             // s LEARNING with the dip off expectedDip
+
+}; /* MagDisturbanceDetector */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* MAG_DISTURBANCE_DETECTOR_H */
+
+/****************************************************************************
+ ****************************************************************************/
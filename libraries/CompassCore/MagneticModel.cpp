@@ -0,0 +1,291 @@
+/**
+ * @file MagneticModel.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief World Magnetic Model: declination, inclination and intensity of the field from position and date
+ *
+ * Coefficients: WMM2025 (NOAA NCEI / BGS), WMM.COF of 13 November 2024, nT and nT/year.
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "MagneticModel.h"
+#include <math.h>
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#elif defined(ESP8266)
+#include <pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_float(address) (*(const float *)(address))
+#endif
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+const float WGS84_A             = 6378.137f;            // km, semi-major axis
+const float WGS84_F             = 1.0f / 298.257223563f;
+const float WGS84_E2            = WGS84_F * (2.0f - WGS84_F);
+const float MODEL_RADIUS        = 6371.2f;              // km, reference radius of the harmonics
+const float MODEL_LATITUDE_MAX  = 89.99f;               // deg, the east component is singular at the poles
+const float MODEL_DEG_TO_RAD    = 0.017453292519943f;
+const float MODEL_RAD_TO_DEG    = 57.295779513082f;
+const uint8_t MODEL_TERMS       = (MAGNETIC_MODEL_DEGREE + 1) * (MAGNETIC_MODEL_DEGREE + 2) / 2;
+
+// g, h, dg/dt, dh/dt; n = 1 .. 12, m = 0 .. n
+const float WMM_COEFFICIENTS[MODEL_TERMS - 1][4] PROGMEM =
+{
+    {-29351.8f,     0.0f,  12.0f,   0.0f},  // 1 0
+    { -1410.8f,  4545.4f,   9.7f, -21.5f},  // 1 1
+    { -2556.6f,     0.0f, -11.6f,   0.0f},  // 2 0
+    {  2951.1f, -3133.6f,  -5.2f, -27.7f},
+    {  1649.3f,  -815.1f,  -8.0f, -12.1f},
+    {  1361.0f,     0.0f,  -1.3f,   0.0f},  // 3 0
+    { -2404.1f,   -56.6f,  -4.2f,   4.0f},
+    {  1243.8f,   237.5f,   0.4f,  -0.3f},
+    {   453.6f,  -549.5f, -15.6f,  -4.1f},
+    {   895.0f,     0.0f,  -1.6f,   0.0f},  // 4 0
+    {   799.5f,   278.6f,  -2.4f,  -1.1f},
+    {    55.7f,  -133.9f,  -6.0f,   4.1f},
+    {  -281.1f,   212.0f,   5.6f,   1.6f},
+    {    12.1f,  -375.6f,  -7.0f,  -4.4f},
+    {  -233.2f,     0.0f,   0.6f,   0.0f},  // 5 0
+    {   368.9f,    45.4f,   1.4f,  -0.5f},
+    {   187.2f,   220.2f,   0.0f,   2.2f},
+    {  -138.7f,  -122.9f,   0.6f,   0.4f},
+    {  -142.0f,    43.0f,   2.2f,   1.7f},
+    {    20.9f,   106.1f,   0.9f,   1.9f},
+    {    64.4f,     0.0f,  -0.2f,   0.0f},  // 6 0
+    {    63.8f,   -18.4f,  -0.4f,   0.3f},
+    {    76.9f,    16.8f,   0.9f,  -1.6f},
+    {  -115.7f,    48.8f,   1.2f,  -0.4f},
+    {   -40.9f,   -59.8f,  -0.9f,   0.9f},
+    {    14.9f,    10.9f,   0.3f,   0.7f},
+    {   -60.7f,    72.7f,   0.9f,   0.9f},
+    {    79.5f,     0.0f,  -0.0f,   0.0f},  // 7 0
+    {   -77.0f,   -48.9f,  -0.1f,   0.6f},
+    {    -8.8f,   -14.4f,  -0.1f,   0.5f},
+    {    59.3f,    -1.0f,   0.5f,  -0.8f},
+    {    15.8f,    23.4f,  -0.1f,   0.0f},
+    {     2.5f,    -7.4f,  -0.8f,  -1.0f},
+    {   -11.1f,   -25.1f,  -0.8f,   0.6f},
+    {    14.2f,    -2.3f,   0.8f,  -0.2f},
+    {    23.2f,     0.0f,  -0.1f,   0.0f},  // 8 0
+    {    10.8f,     7.1f,   0.2f,  -0.2f},
+    {   -17.5f,   -12.6f,   0.0f,   0.5f},
+    {     2.0f,    11.4f,   0.5f,  -0.4f},
+    {   -21.7f,    -9.7f,  -0.1f,   0.4f},
+    {    16.9f,    12.7f,   0.3f,  -0.5f},
+    {    15.0f,     0.7f,   0.2f,  -0.6f},
+    {   -16.8f,    -5.2f,  -0.0f,   0.3f},
+    {     0.9f,     3.9f,   0.2f,   0.2f},
+    {     4.6f,     0.0f,  -0.0f,   0.0f},  // 9 0
+    {     7.8f,   -24.8f,  -0.1f,  -0.3f},
+    {     3.0f,    12.2f,   0.1f,   0.3f},
+    {    -0.2f,     8.3f,   0.3f,  -0.3f},
+    {    -2.5f,    -3.3f,  -0.3f,   0.3f},
+    {   -13.1f,    -5.2f,   0.0f,   0.2f},
+    {     2.4f,     7.2f,   0.3f,  -0.1f},
+    {     8.6f,    -0.6f,  -0.1f,  -0.2f},
+    {    -8.7f,     0.8f,   0.1f,   0.4f},
+    {   -12.9f,    10.0f,  -0.1f,   0.1f},
+    {    -1.3f,     0.0f,   0.1f,   0.0f},  // 10 0
+    {    -6.4f,     3.3f,   0.0f,   0.0f},
+    {     0.2f,     0.0f,   0.1f,  -0.0f},
+    {     2.0f,     2.4f,   0.1f,  -0.2f},
+    {    -1.0f,     5.3f,  -0.0f,   0.1f},
+    {    -0.6f,    -9.1f,  -0.3f,  -0.1f},
+    {    -0.9f,     0.4f,   0.0f,   0.1f},
+    {     1.5f,    -4.2f,  -0.1f,   0.0f},
+    {     0.9f,    -3.8f,  -0.1f,  -0.1f},
+    {    -2.7f,     0.9f,  -0.0f,   0.2f},
+    {    -3.9f,    -9.1f,  -0.0f,  -0.0f},
+    {     2.9f,     0.0f,   0.0f,   0.0f},  // 11 0
+    {    -1.5f,     0.0f,  -0.0f,  -0.0f},
+    {    -2.5f,     2.9f,   0.0f,   0.1f},
+    {     2.4f,    -0.6f,   0.0f,  -0.0f},
+    {    -0.6f,     0.2f,   0.0f,   0.1f},
+    {    -0.1f,     0.5f,  -0.1f,  -0.0f},
+    {    -0.6f,    -0.3f,   0.0f,  -0.0f},
+    {    -0.1f,    -1.2f,  -0.0f,   0.1f},
+    {     1.1f,    -1.7f,  -0.1f,  -0.0f},
+    {    -1.0f,    -2.9f,  -0.1f,   0.0f},
+    {    -0.2f,    -1.8f,  -0.1f,   0.0f},
+    {     2.6f,    -2.3f,  -0.1f,   0.0f},
+    {    -2.0f,     0.0f,   0.0f,   0.0f},  // 12 0
+    {    -0.2f,    -1.3f,   0.0f,  -0.0f},
+    {     0.3f,     0.7f,  -0.0f,   0.0f},
+    {     1.2f,     1.0f,  -0.0f,  -0.1f},
+    {    -1.3f,    -1.4f,  -0.0f,   0.1f},
+    {     0.6f,    -0.0f,  -0.0f,  -0.0f},
+    {     0.6f,     0.6f,   0.1f,  -0.0f},
+    {     0.5f,    -0.1f,  -0.0f,  -0.0f},
+    {    -0.1f,     0.8f,   0.0f,   0.0f},
+    {    -0.4f,     0.1f,   0.0f,  -0.0f},
+    {    -0.2f,    -1.0f,  -0.1f,  -0.0f},
+    {    -1.3f,     0.1f,  -0.0f,   0.0f},
+    {    -0.7f,     0.2f,  -0.1f,  -0.1f}
+};
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name MagneticModel
+ * @brief MagneticModel: constructor, no field until the first update()
+ */
+MagneticModel::MagneticModel()
+{
+    valid = false;
+    current = false;
+    cellLatitude = 0;
+    cellLongitude = 0;
+    year = 0.0f;
+    declination = 0.0f;
+    inclination = 0.0f;
+    intensity = 0.0f;
+    evaluations = 0;
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name update
+ * @brief update: field at the position, evaluated again only out of the cached cell or date; a date out of the
+ *                life of the model is taken to its nearest end, see isCurrent()
+ * @param [in] double latitude: deg, geodetic, north positive
+ * @param [in] double longitude: deg, east positive
+ * @param [in] float year: decimal year, e.g. 2026.5
+ * @retval bool: true if the model was evaluated
+ */
+bool MagneticModel::update(double latitude, double longitude, float year)
+{
+    // ----- Life of the model: out of it the secular variation would run on unchecked
+    current = (year >= MAGNETIC_MODEL_EPOCH && year < MAGNETIC_MODEL_EPOCH + MAGNETIC_MODEL_LIFE);
+    if (year < MAGNETIC_MODEL_EPOCH) year = MAGNETIC_MODEL_EPOCH;
+    if (year > MAGNETIC_MODEL_EPOCH + MAGNETIC_MODEL_LIFE) year = MAGNETIC_MODEL_EPOCH + MAGNETIC_MODEL_LIFE;
+
+    // ----- Cell: MAGNETIC_MODEL_CELL of latitude, the same length in longitude at the centre of its row
+    const int32_t cellLat = (int32_t)floor(latitude / MAGNETIC_MODEL_CELL);
+    const float centreLatitude = (cellLat + 0.5f) * MAGNETIC_MODEL_CELL;
+    float rowScale = cosf(centreLatitude * MODEL_DEG_TO_RAD);
+    if (rowScale < 0.1f) rowScale = 0.1f;
+    const float cellWidth = MAGNETIC_MODEL_CELL / rowScale;
+    const int32_t cellLon = (int32_t)floor((longitude + 180.0) / cellWidth);
+
+    if (valid && cellLat == cellLatitude && cellLon == cellLongitude && fabsf(year - this->year) < MAGNETIC_MODEL_YEAR_STEP)
+    {
+        return false;
+    }
+
+    const float centreLongitude = (cellLon + 0.5f) * cellWidth - 180.0f;
+    evaluate(centreLatitude, centreLongitude, 0.0f, year, declination, inclination, intensity);
+    cellLatitude = cellLat;
+    cellLongitude = cellLon;
+    this->year = year;
+    valid = true;
+    evaluations++;
+    return true;
+}
+
+/**
+ * @name evaluate
+ * @brief evaluate: field at a point, no cache and no check of the date
+ * @param [in] float latitude: deg, geodetic
+ * @param [in] float longitude: deg
+ * @param [in] float altitude: km above the WGS84 ellipsoid
+ * @param [in] float year: decimal year
+ * @param [out] float &declination: deg, east positive
+ * @param [out] float &inclination: deg, down positive
+ * @param [out] float &intensity: nT
+ * @retval None
+ */
+void MagneticModel::evaluate(float latitude, float longitude, float altitude, float year,
+                             float &declination, float &inclination, float &intensity)
+{
+    if (latitude > MODEL_LATITUDE_MAX) latitude = MODEL_LATITUDE_MAX;
+    if (latitude < -MODEL_LATITUDE_MAX) latitude = -MODEL_LATITUDE_MAX;
+
+    // ----- Geodetic to geocentric spherical
+    const float sinLat = sinf(latitude * MODEL_DEG_TO_RAD);
+    const float cosLat = cosf(latitude * MODEL_DEG_TO_RAD);
+    const float curvature = WGS84_A / sqrtf(1.0f - WGS84_E2 * sinLat * sinLat);
+    const float p = (curvature + altitude) * cosLat;
+    const float z = (curvature * (1.0f - WGS84_E2) + altitude) * sinLat;
+    const float r = sqrtf(p * p + z * z);
+    const float cosTheta = z / r;               // theta: geocentric colatitude
+    const float sinTheta = p / r;
+
+    float cosLon[MAGNETIC_MODEL_DEGREE + 1], sinLon[MAGNETIC_MODEL_DEGREE + 1];
+    cosLon[0] = 1.0f;
+    sinLon[0] = 0.0f;
+    cosLon[1] = cosf(longitude * MODEL_DEG_TO_RAD);
+    sinLon[1] = sinf(longitude * MODEL_DEG_TO_RAD);
+    for (uint8_t m = 2; m <= MAGNETIC_MODEL_DEGREE; ++m)
+    {
+        cosLon[m] = cosLon[m - 1] * cosLon[1] - sinLon[m - 1] * sinLon[1];
+        sinLon[m] = sinLon[m - 1] * cosLon[1] + cosLon[m - 1] * sinLon[1];
+    }
+
+    // ----- Schmidt semi-normalized Legendre functions and their theta derivative, P[n(n+1)/2 + m]
+    float P[MODEL_TERMS], dP[MODEL_TERMS];
+    P[0] = 1.0f;
+    dP[0] = 0.0f;
+
+    const float t = year - MAGNETIC_MODEL_EPOCH;
+    const float ratio = MODEL_RADIUS / r;
+    float radial = ratio * ratio;
+    float north = 0.0f, east = 0.0f, down = 0.0f;
+    for (uint8_t n = 1; n <= MAGNETIC_MODEL_DEGREE; ++n)
+    {
+        radial *= ratio;                        // (a / r)^(n + 2)
+        const uint8_t row = n * (n + 1) / 2;
+        const uint8_t previous = (n - 1) * n / 2;
+        const uint8_t beforePrevious = (n >= 2) ? (n - 2) * (n - 1) / 2 : 0;
+        for (uint8_t m = 0; m <= n; ++m)
+        {
+            const uint8_t k = row + m;
+            if (m == n)
+            {
+                const float scale = (n == 1) ? 1.0f : sqrtf((2.0f * n - 1.0f) / (2.0f * n));
+                P[k] = scale * sinTheta * P[previous + m - 1];
+                dP[k] = scale * (cosTheta * P[previous + m - 1] + sinTheta * dP[previous + m - 1]);
+            }
+            else
+            {
+                const float a = 2.0f * n - 1.0f;
+                const float b = (m + 2 <= n) ? sqrtf((float)((n - 1) * (n - 1) - m * m)) : 0.0f;
+                const float c = sqrtf((float)(n * n - m * m));
+                const float P2 = (m + 2 <= n) ? P[beforePrevious + m] : 0.0f;
+                const float dP2 = (m + 2 <= n) ? dP[beforePrevious + m] : 0.0f;
+                P[k] = (a * cosTheta * P[previous + m] - b * P2) / c;
+                dP[k] = (a * (cosTheta * dP[previous + m] - sinTheta * P[previous + m]) - b * dP2) / c;
+            }
+
+            const float *coefficient = WMM_COEFFICIENTS[k - 1];
+            const float g = pgm_read_float(coefficient) + t * pgm_read_float(coefficient + 2);
+            const float h = pgm_read_float(coefficient + 1) + t * pgm_read_float(coefficient + 3);
+            const float gh = g * cosLon[m] + h * sinLon[m];
+            north += radial * gh * dP[k];
+            east += radial * m * (g * sinLon[m] - h * cosLon[m]) * P[k];
+            down -= radial * (n + 1) * gh * P[k];
+        }
+    }
+    east /= sinTheta;
+
+    // ----- Back to the geodetic north and down
+    const float psi = asinf(cosTheta) - latitude * MODEL_DEG_TO_RAD;
+    const float x = north * cosf(psi) - down * sinf(psi);
+    const float zDown = north * sinf(psi) + down * cosf(psi);
+    const float horizontal = sqrtf(x * x + east * east);
+
+    declination = atan2f(east, x) * MODEL_RAD_TO_DEG;
+    inclination = atan2f(zDown, horizontal) * MODEL_RAD_TO_DEG;
+    intensity = sqrtf(horizontal * horizontal + zDown * zDown);
+}
+
+/****************************************************************************
+ ****************************************************************************/
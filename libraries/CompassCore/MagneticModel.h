@@ -0,0 +1,149 @@
+/**
+ * @file MagneticModel.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief World Magnetic Model: declination, inclination and intensity of the field from position and date
+ *
+ * The Gauss coefficients of the WMM (degree and order 12, with their secular variation) are a table in
+ * flash; evaluate() sums the spherical harmonics at a geodetic position and decimal year, as in the WMM
+ * technical report: geocentric conversion on WGS84, Schmidt semi-normalized Legendre functions, field
+ * rotated back to the geodetic north, east and down.
+ * One evaluation is some thousand floating point operations, too many for every loop: update() keeps the
+ * field of a grid cell, MAGNETIC_MODEL_CELL wide in latitude and about as wide in km in longitude, taken
+ * at the centre of the cell, and evaluates again only when the fix moves to another cell or the date
+ * moves by MAGNETIC_MODEL_YEAR_STEP.
+ * The secular variation is a straight line, good for the MAGNETIC_MODEL_LIFE years of the model: update()
+ * takes a date out of [MAGNETIC_MODEL_EPOCH, MAGNETIC_MODEL_EPOCH + MAGNETIC_MODEL_LIFE) to the nearest
+ * end and flags it (isCurrent), instead of extrapolating; a new model needs a new coefficient table.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef MAGNETIC_MODEL_H
+#define MAGNETIC_MODEL_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint8_t MAGNETIC_MODEL_DEGREE     = 12;
+const float MAGNETIC_MODEL_EPOCH        = 2025.0f;  // year of the coefficients, WMM2025
+const float MAGNETIC_MODEL_LIFE         = 5.0f;     // years from the epoch the secular variation holds
+const float MAGNETIC_MODEL_CELL         = 0.05f;    // deg of latitude, about 5.5 km
+const float MAGNETIC_MODEL_YEAR_STEP    = 0.1f;     // year, the declination moves some 0.01 deg in it
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class MagneticModel
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name MagneticModel
+     * @brief MagneticModel: constructor, no field until the first update()
+     */
+    MagneticModel();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name update
+     * @brief update: field at the position, evaluated again only out of the cached cell or date; a date out of the
+     *                life of the model is taken to its nearest end, see isCurrent()
+     * @param [in] double latitude: deg, geodetic, north positive
+     * @param [in] double longitude: deg, east positive
+     * @param [in] float year: decimal year, e.g. 2026.5
+     * @retval bool: true if the model was evaluated
+     */
+    bool update(double latitude, double longitude, float year);
+
+    /**
+     * @name isValid
+     * @brief isValid: a field has been evaluated
+     */
+    bool isValid() const { return valid; }
+
+    /**
+     * @name isCurrent
+     * @brief isCurrent: the date of the last update() is within the life of the model; if not, the field is the
+     *                   one of the nearest end of it
+     */
+    bool isCurrent() const { return current; }
+
+    /**
+     * @name getDeclination / getInclination / getIntensity
+     * @brief field of the cached cell: declination deg, east positive; inclination deg, down positive;
+     *        total intensity nT
+     */
+    float getDeclination() const { return declination; }
+    float getInclination() const { return inclination; }
+    float getIntensity() const { return intensity; }
+
+    /**
+     * @name getEvaluations
+     * @brief getEvaluations: evaluations of the model since the constructor
+     */
+    uint32_t getEvaluations() const { return evaluations; }
+
+    /**
+     * @name evaluate
+     * @brief evaluate: field at a point, no cache and no check of the date
+     * @param [in] float latitude: deg, geodetic
+     * @param [in] float longitude: deg
+     * @param [in] float altitude: km above the WGS84 ellipsoid
+     * @param [in] float year: decimal year
+     * @param [out] float &declination: deg, east positive
+     * @param [out] float &inclination: deg, down positive
+     * @param [out] float &intensity: nT
+     * @retval None
+     */
+    static void evaluate(float latitude, float longitude, float altitude, float year,
+                         float &declination, float &inclination, float &intensity);
+
+
+private:
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    bool valid;
+    bool current;                   // date of the last update() within the life of the model
+    int32_t cellLatitude;           // cell of the cached field
+    int32_t cellLongitude;
+    float year;                     // date of the cached field
+    float declination;              // deg
+    float inclination;              // deg
+    float intensity;                // nT
+    uint32_t evaluations;
+
+}; /* MagneticModel */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* MAGNETIC_MODEL_H */
+
+/****************************************************************************
+ ****************************************************************************/
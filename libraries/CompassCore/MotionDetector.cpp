@@ -0,0 +1,152 @@
+/**
+ * @file MotionDetector.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Moving / stationary detection of the compass from the gyro, with the wake-on-motion of the IMU
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "MotionDetector.h"
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name MotionDetector
+ * @brief MotionDetector: constructor, moving with no bias
+ */
+MotionDetector::MotionDetector()
+{
+    for (uint8_t i = 0; i < 3; ++i) bias[i] = 0.0f;
+    reset();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name reset
+ * @brief reset: moving, statistics cleared; the gyro bias is kept
+ * @retval None
+ */
+void MotionDetector::reset()
+{
+    state = motion_state_t::MOVING;
+    stillTime = 0.0f;
+    primed = false;
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        mean[i] = 0.0f;
+        variance[i] = 0.0f;
+    }
+}
+
+/**
+ * @name update
+ * @brief update: one gyro sample
+ * @param [in] const float gyro[3]: deg/s
+ * @param [in] float dt: s since the previous sample
+ * @retval motion_state_t: state after the sample
+ */
+motion_state_t MotionDetector::update(const float gyro[3], float dt)
+{
+    if (dt <= 0.0f)
+    {
+        return state;
+    }
+    if (!primed)
+    {
+        for (uint8_t i = 0; i < 3; ++i) mean[i] = gyro[i];
+        primed = true;
+    }
+
+    // ----- Exponential mean and variance, the weight follows the sample period
+    const float alpha = dt / (MOTION_AVERAGE_TIME + dt);
+    float rate2 = 0.0f;
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        const float delta = gyro[i] - mean[i];
+        mean[i] += alpha * delta;
+        variance[i] = (1.0f - alpha) * (variance[i] + alpha * delta * delta);
+        rate2 += (mean[i] - bias[i]) * (mean[i] - bias[i]);
+    }
+    const float totalVariance = getVariance();
+
+    if (state == motion_state_t::STATIONARY)
+    {
+        if (totalVariance > MOTION_EXIT_FACTOR * MOTION_VARIANCE_LIMIT ||
+            rate2 > (MOTION_EXIT_FACTOR * MOTION_RATE_LIMIT) * (MOTION_EXIT_FACTOR * MOTION_RATE_LIMIT))
+        {
+            state = motion_state_t::MOVING;
+            stillTime = 0.0f;
+        }
+        else
+        {
+            // ----- Zero-velocity update: the hull does not turn, the gyro reads its bias
+            const float beta = dt / (MOTION_BIAS_TIME + dt);
+            for (uint8_t i = 0; i < 3; ++i) bias[i] += beta * (gyro[i] - bias[i]);
+        }
+    }
+    else
+    {
+        if (totalVariance < MOTION_VARIANCE_LIMIT && rate2 < MOTION_RATE_LIMIT * MOTION_RATE_LIMIT)
+        {
+            stillTime += dt;
+            if (stillTime >= MOTION_STILL_TIME) state = motion_state_t::STATIONARY;
+        }
+        else
+        {
+            stillTime = 0.0f;
+        }
+    }
+    return state;
+}
+
+/**
+ * @name wakeOnMotion
+ * @brief wakeOnMotion: the accelerometer saw a motion over its threshold, moving at once
+ * @retval None
+ */
+void MotionDetector::wakeOnMotion()
+{
+    state = motion_state_t::MOVING;
+    stillTime = 0.0f;
+}
+
+/**
+ * @name getGyroBias
+ * @brief getGyroBias: gyro bias learned while stationary
+ * @param [out] float bias[3]: deg/s
+ * @retval None
+ */
+void MotionDetector::getGyroBias(float bias[3]) const
+{
+    for (uint8_t i = 0; i < 3; ++i) bias[i] = this->bias[i];
+}
+
+/**
+ * @name setGyroBias
+ * @brief setGyroBias: gyro bias known from before, e.g. kept across a reset
+ * @param [in] const float bias[3]: deg/s
+ * @retval None
+ */
+void MotionDetector::setGyroBias(const float bias[3])
+{
+    for (uint8_t i = 0; i < 3; ++i) this->bias[i] = bias[i];
+}
+
+/**
+ * @name getVariance
+ * @brief getVariance: gyro variance, sum of the three axes
+ * @retval float: (deg/s)^2
+ */
+float MotionDetector::getVariance() const
+{
+    return variance[0] + variance[1] + variance[2];
+}
+
+/****************************************************************************
+ ****************************************************************************/
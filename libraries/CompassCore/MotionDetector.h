@@ -0,0 +1,149 @@
+/**
+ * @file MotionDetector.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Moving / stationary detection of the compass from the gyro, with the wake-on-motion of the IMU
+ *
+ * The gyro samples feed an exponential mean and variance per axis, over MOTION_AVERAGE_TIME:
+ *      - STATIONARY after MOTION_STILL_TIME with the variance below the limit and the mean rate, bias
+ *        removed, below MOTION_RATE_LIMIT: a steady turn has a low variance but not a low rate
+ *      - MOVING at once when either goes over MOTION_EXIT_FACTOR times its limit, or on wakeOnMotion(),
+ *        the wake-on-motion interrupt of the accelerometer
+ * While stationary the hull does not turn, so the gyro reads its own bias: it is learned over
+ * MOTION_BIAS_TIME (zero-velocity update) and kept as it is while moving.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const float MOTION_AVERAGE_TIME     = 0.5f;     // s, time constant of the gyro mean and variance
+const float MOTION_VARIANCE_LIMIT   = 4.0f;     // (deg/s)^2, sum of the three axes, a hull moored in a harbour
+const float MOTION_RATE_LIMIT       = 1.0f;     // deg/s, mean rate without the bias
+const float MOTION_EXIT_FACTOR      = 2.0f;     // limits times this to leave STATIONARY, hysteresis
+const float MOTION_STILL_TIME       = 3.0f;     // s, below the limits to enter STATIONARY
+const float MOTION_BIAS_TIME        = 20.0f;    // s, time constant of the gyro bias while stationary
+const unsigned long STATIONARY_FUSION_PERIOD_MS = 100;   // filter period while stationary, 10 Hz
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+enum class motion_state_t
+{
+    MOVING,
+    STATIONARY
+};
+
+class MotionDetector
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name MotionDetector
+     * @brief MotionDetector: constructor, moving with no bias
+     */
+    MotionDetector();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name reset
+     * @brief reset: moving, statistics cleared; the gyro bias is kept
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name update
+     * @brief update: one gyro sample
+     * @param [in] const float gyro[3]: deg/s
+     * @param [in] float dt: s since the previous sample
+     * @retval motion_state_t: state after the sample
+     */
+    motion_state_t update(const float gyro[3], float dt);
+
+    /**
+     * @name wakeOnMotion
+     * @brief wakeOnMotion: the accelerometer saw a motion over its threshold, moving at once
+     * @retval None
+     */
+    void wakeOnMotion();
+
+    /**
+     * @name getState / isStationary
+     * @brief state of the compass
+     */
+    motion_state_t getState() const { return state; }
+    bool isStationary() const { return state == motion_state_t::STATIONARY; }
+
+    /**
+     * @name getGyroBias
+     * @brief getGyroBias: gyro bias learned while stationary
+     * @param [out] float bias[3]: deg/s
+     * @retval None
+     */
+    void getGyroBias(float bias[3]) const;
+
+    /**
+     * @name setGyroBias
+     * @brief setGyroBias: gyro bias known from before, e.g. kept across a reset
+     * @param [in] const float bias[3]: deg/s
+     * @retval None
+     */
+    void setGyroBias(const float bias[3]);
+
+    /**
+     * @name getVariance
+     * @brief getVariance: gyro variance, sum of the three axes
+     * @retval float: (deg/s)^2
+     */
+    float getVariance() const;
+
+
+private:
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    motion_state_t state;
+    float mean[3];                  // deg/s
+    float variance[3];              // (deg/s)^2
+    float bias[3];                  // deg/s
+    float stillTime;                // s below the limits
+    bool primed;                    // mean started from a sample
+
+}; /* MotionDetector */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* MOTION_DETECTOR_H */
+
+/****************************************************************************
+ ****************************************************************************/
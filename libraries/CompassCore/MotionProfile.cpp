@@ -0,0 +1,197 @@
+/**
+ * @file MotionProfile.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Online velocity, acceleration and jerk limited setpoint generator
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "MotionProfile.h"
+#include <math.h>
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name MotionProfile
+ * @brief MotionProfile: constructor, at rest in 0
+ * @param [in] float maxVelocity: velocity limit, > 0
+ * @param [in] float maxAcceleration: acceleration limit, > 0
+ * @param [in] float maxJerk: jerk limit, 0 for a trapezoidal profile
+ */
+MotionProfile::MotionProfile(float maxVelocity, float maxAcceleration, float maxJerk)
+{
+    setLimits(maxVelocity, maxAcceleration, maxJerk);
+    reset(0.0f);
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name setLimits
+ * @brief setLimits: change the limits, also in the middle of a move (a new jerk applies from the next move)
+ * @param [in] float maxVelocity: velocity limit, > 0
+ * @param [in] float maxAcceleration: acceleration limit, > 0
+ * @param [in] float maxJerk: jerk limit, 0 for a trapezoidal profile
+ * @retval None
+ */
+void MotionProfile::setLimits(float maxVelocity, float maxAcceleration, float maxJerk)
+{
+    this->maxVelocity       = fabsf(maxVelocity);
+    this->maxAcceleration   = fabsf(maxAcceleration);
+    this->maxJerk           = fabsf(maxJerk);
+
+    // averaging time A / J, in steps; a jerk too low for the ring is raised to the lowest it can do
+    float steps = 1.0f;
+    if (this->maxJerk > 0.0f) steps = this->maxAcceleration / this->maxJerk / PROFILE_STEP + 0.5f;
+    if (steps < 1.0f) steps = 1.0f;
+    if (steps > PROFILE_MAX_TAPS) steps = PROFILE_MAX_TAPS;
+    pendingTaps = (uint8_t)steps;
+}
+
+/**
+ * @name reset
+ * @brief reset: place the setpoint at rest in a position, target included
+ * @param [in] float position: position
+ * @retval None
+ */
+void MotionProfile::reset(float position)
+{
+    target          = position;
+    planPosition    = position;
+    planVelocity    = 0.0f;
+    this->position  = position;
+    velocity        = 0.0f;
+    acceleration    = 0.0f;
+    settled         = true;
+    clearAveraging();
+}
+
+/**
+ * @name setTarget
+ * @brief setTarget: new target, the move is re-planned from the current state
+ * @param [in] float target: position to reach
+ * @retval None
+ */
+void MotionProfile::setTarget(float target)
+{
+    // the plan keeps its position and velocity: the next step starts from where it is
+    this->target = target;
+    if (settled && target != position)
+    {
+        clearAveraging();
+        settled = false;
+    }
+}
+
+/**
+ * @name update
+ * @brief update: advance the setpoint
+ * @param [in] float dt: elapsed time, s
+ * @retval float new setpoint position
+ */
+float MotionProfile::update(float dt)
+{
+    while (dt > 0.0f && !settled)
+    {
+        const float h = dt > PROFILE_STEP ? PROFILE_STEP : dt;
+        step(h);
+        dt -= h;
+    }
+    return position;
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name step
+ * @brief step: one integration step; the trapezoidal velocity follows the highest speed from which
+ *              the plan can still stop on the target, capped by maxVelocity, then its advance is
+ *              averaged over the last taps steps
+ * @param [in] float dt: step, s
+ * @retval None
+ */
+void MotionProfile::step(float dt)
+{
+    const float A = maxAcceleration;
+
+    // ----- Trapezoidal plan
+    const float error       = target - planPosition;
+    const float direction   = error >= 0.0f ? 1.0f : -1.0f;
+    const float distance    = fabsf(error);
+    float advance           = 0.0f;
+
+    if (distance > 0.0f || planVelocity != 0.0f)
+    {
+        // highest speed toward the target from which the discrete braking lands on it
+        float allowed = A * dt * (sqrtf(0.25f + 2.0f * distance / (A * dt * dt)) - 0.5f);
+        if (allowed > maxVelocity) allowed = maxVelocity;
+
+        float speed = planVelocity * direction;             // > 0 toward the target
+        if (speed < allowed - A * dt) speed += A * dt;
+        else if (speed > allowed + A * dt) speed -= A * dt;
+        else speed = allowed;
+
+        advance = speed * dt;
+        if (advance >= distance && speed <= A * dt)
+        {
+            // reaches the target slow enough to stop on it
+            advance = distance;
+            speed = 0.0f;
+        }
+        planVelocity = speed * direction;
+        advance *= direction;
+        planPosition = (advance == error) ? target : planPosition + advance;
+        restSteps = 0;
+    }
+    else if (restSteps < taps)
+    {
+        restSteps++;
+    }
+
+    // ----- Moving average of the advance: S-curve setpoint
+    advanceSum += advance - advanceRing[next];
+    advanceRing[next] = advance;
+    if (++next == taps)
+    {
+        next = 0;
+        advanceSum = 0.0f;                                  // once per lap, drops the float drift
+        for (uint8_t i = 0; i < taps; ++i) advanceSum += advanceRing[i];
+    }
+
+    const float newVelocity = advanceSum / (taps * dt);
+    acceleration = (newVelocity - velocity) / dt;
+    velocity = newVelocity;
+    position += advanceSum / taps;
+
+    if (restSteps >= taps)
+    {
+        // the plan is on the target and the average has drained
+        position        = target;
+        velocity        = 0.0f;
+        acceleration    = 0.0f;
+        settled         = true;
+    }
+}
+
+/**
+ * @name clearAveraging
+ * @brief clearAveraging: empty the averaging ring and apply the taps of the last setLimits
+ * @retval None
+ */
+void MotionProfile::clearAveraging()
+{
+    taps        = pendingTaps;
+    next        = 0;
+    restSteps   = 0;
+    advanceSum  = 0.0f;
+    for (uint8_t i = 0; i < PROFILE_MAX_TAPS; ++i) advanceRing[i] = 0.0f;
+}
+
+/****************************************************************************
+ ****************************************************************************/
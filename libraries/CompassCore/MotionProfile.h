@@ -0,0 +1,155 @@
+/**
+ * @file MotionProfile.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Online velocity, acceleration and jerk limited setpoint generator
+ *
+ * The profile is planned one step at a time from the current position and velocity, so a new
+ * target in the middle of a move is taken without a jump of speed:
+ *      - trapezoidal (maxJerk = 0): accelerate at maxAcceleration up to maxVelocity, brake at the
+ *        last moment with the deceleration that stops exactly on the target, no overshoot
+ *      - S-curve (maxJerk > 0): the trapezoidal steps are averaged over maxAcceleration / maxJerk
+ *        seconds, a moving average of a trapezoidal velocity is the jerk limited S-curve; it ends
+ *        on the same target, later by the averaging time, and still does not overshoot
+ *        (a move too short to cruise goes from +A to -A directly, there the jerk is 2 * maxJerk)
+ * Units are free (deg, deg/s, deg/s^2, deg/s^3 for the servo), time is in seconds.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const float   PROFILE_STEP          = 0.005f;      // s, integration step, longer updates are split
+const uint8_t PROFILE_MAX_TAPS      = 40;          // S-curve averaging, up to 40 steps = 0.2 s
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class MotionProfile
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name MotionProfile
+     * @brief MotionProfile: constructor, at rest in 0
+     * @param [in] float maxVelocity: velocity limit, > 0
+     * @param [in] float maxAcceleration: acceleration limit, > 0
+     * @param [in] float maxJerk: jerk limit, 0 for a trapezoidal profile
+     */
+    MotionProfile(float maxVelocity, float maxAcceleration, float maxJerk = 0.0f);
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name setLimits
+     * @brief setLimits: change the limits, also in the middle of a move (a new jerk applies from the next move)
+     * @param [in] float maxVelocity: velocity limit, > 0
+     * @param [in] float maxAcceleration: acceleration limit, > 0
+     * @param [in] float maxJerk: jerk limit, 0 for a trapezoidal profile
+     * @retval None
+     */
+    void setLimits(float maxVelocity, float maxAcceleration, float maxJerk = 0.0f);
+
+    /**
+     * @name reset
+     * @brief reset: place the setpoint at rest in a position, target included
+     * @param [in] float position: position
+     * @retval None
+     */
+    void reset(float position);
+
+    /**
+     * @name setTarget
+     * @brief setTarget: new target, the move is re-planned from the current state
+     * @param [in] float target: position to reach
+     * @retval None
+     */
+    void setTarget(float target);
+
+    /**
+     * @name update
+     * @brief update: advance the setpoint
+     * @param [in] float dt: elapsed time, s
+     * @retval float new setpoint position
+     */
+    float update(float dt);
+
+    /**
+     * @name isSettled
+     * @brief isSettled: setpoint at rest on the target
+     * @retval bool
+     */
+    bool isSettled() const { return settled; }
+
+    float getPosition() const { return position; }
+    float getVelocity() const { return velocity; }
+    float getAcceleration() const { return acceleration; }
+    float getTarget() const { return target; }
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void step(float dt);
+    void clearAveraging();
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    float maxVelocity;
+    float maxAcceleration;
+    float maxJerk;
+
+    float target;
+    float planPosition;                             // trapezoidal profile
+    float planVelocity;
+
+    float position;                                 // setpoint, averaged profile
+    float velocity;
+    float acceleration;
+    bool settled;
+
+    uint8_t taps;                                   // steps averaged, 1 = trapezoidal
+    uint8_t pendingTaps;                            // taps of the new jerk, applied at rest
+    uint8_t next;
+    uint8_t restSteps;                              // steps since the trapezoidal profile stopped
+    float advanceRing[PROFILE_MAX_TAPS];            // trapezoidal advance of the last steps
+    float advanceSum;
+
+}; /* MotionProfile */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* MOTION_PROFILE_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,168 @@
+/**
+ * @file QuaternionIntegrator.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Integration of a body rate into an attitude quaternion: Euler step, exponential map, coning
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "QuaternionIntegrator.h"
+#include <math.h>
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name QuaternionIntegrator
+ * @brief QuaternionIntegrator: constructor, no previous sample
+ * @param [in] quaternion_integrator_t method
+ */
+QuaternionIntegrator::QuaternionIntegrator(quaternion_integrator_t method) : method(method)
+{
+    reset();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name setMethod
+ * @brief setMethod: integration method; the previous sample is forgotten
+ */
+void QuaternionIntegrator::setMethod(quaternion_integrator_t method)
+{
+    this->method = method;
+    reset();
+}
+
+/**
+ * @name reset
+ * @brief reset: previous sample forgotten, e.g. after a gap in the samples
+ * @retval None
+ */
+void QuaternionIntegrator::reset()
+{
+    primed = false;
+    for (uint8_t i = 0; i < 3; ++i) previous[i] = 0.0f;
+}
+
+/**
+ * @name integrate
+ * @brief integrate: one gyro sample
+ * @param [in,out] float q[4]: w, x, y, z, body to world
+ * @param [in] const float rate[3]: rad/s, body frame, at the end of the sample
+ * @param [in] float dt: s since the previous sample
+ * @retval None
+ */
+void QuaternionIntegrator::integrate(float q[4], const float rate[3], float dt)
+{
+    if (method != quaternion_integrator_t::CONING)
+    {
+        rotate(q, rate, dt);
+        return;
+    }
+    if (!primed)
+    {
+        for (uint8_t i = 0; i < 3; ++i) previous[i] = rate[i];
+        primed = true;
+    }
+
+    // ----- Rate linear from the previous sample: mean times dt, and the coning term
+    const float *w0 = previous;
+    const float coning = dt * dt / 12.0f;
+    const float angle[3] =
+    {
+        0.5f * (w0[0] + rate[0]) * dt + coning * (w0[1] * rate[2] - w0[2] * rate[1]),
+        0.5f * (w0[1] + rate[1]) * dt + coning * (w0[2] * rate[0] - w0[0] * rate[2]),
+        0.5f * (w0[2] + rate[2]) * dt + coning * (w0[0] * rate[1] - w0[1] * rate[0])
+    };
+    for (uint8_t i = 0; i < 3; ++i) previous[i] = rate[i];
+    exponential(q, angle);
+}
+
+/**
+ * @name rotate
+ * @brief rotate: a rate that is not a gyro sample, constant over dt; no coning term
+ * @param [in,out] float q[4]: w, x, y, z, body to world
+ * @param [in] const float rate[3]: rad/s, body frame
+ * @param [in] float dt: s
+ * @retval None
+ */
+void QuaternionIntegrator::rotate(float q[4], const float rate[3], float dt) const
+{
+    if (method == quaternion_integrator_t::EULER)
+    {
+        euler(q, rate, dt);
+        return;
+    }
+    const float angle[3] = {rate[0] * dt, rate[1] * dt, rate[2] * dt};
+    exponential(q, angle);
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name euler
+ * @brief euler: first order step and normalization, as the original Mahony code, q1 updated first
+ */
+void QuaternionIntegrator::euler(float q[4], const float rate[3], float dt)
+{
+    float q1 = q[0], q2 = q[1], q3 = q[2], q4 = q[3];
+    const float pa = q2, pb = q3, pc = q4;
+    const float gx = rate[0], gy = rate[1], gz = rate[2];
+    q1 = q1 + (-q2 * gx - q3 * gy - q4 * gz) * (0.5f * dt);
+    q2 = pa + (q1 * gx + pb * gz - pc * gy) * (0.5f * dt);
+    q3 = pb + (q1 * gy - pa * gz + pc * gx) * (0.5f * dt);
+    q4 = pc + (q1 * gz + pa * gy - pb * gx) * (0.5f * dt);
+
+    const float norm = 1.0f / sqrtf(q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4);
+    q[0] = q1 * norm;
+    q[1] = q2 * norm;
+    q[2] = q3 * norm;
+    q[3] = q4 * norm;
+}
+
+/**
+ * @name exponential
+ * @brief exponential: q times the rotation of a rotation vector, rad, body frame
+ */
+void QuaternionIntegrator::exponential(float q[4], const float angle[3])
+{
+    const float theta2 = angle[0] * angle[0] + angle[1] * angle[1] + angle[2] * angle[2];
+
+    // ----- cos(theta / 2) and sin(theta / 2) / theta; the series is exact in float for the angles of a sample
+    float c, s;
+    if (theta2 < EXPONENTIAL_SERIES_ANGLE * EXPONENTIAL_SERIES_ANGLE)
+    {
+        const float x2 = 0.25f * theta2;
+        c = 1.0f - x2 * (0.5f - x2 * (1.0f / 24.0f - x2 * (1.0f / 720.0f)));
+        s = 0.5f * (1.0f - x2 * (1.0f / 6.0f - x2 * (1.0f / 120.0f - x2 * (1.0f / 5040.0f))));
+    }
+    else
+    {
+        const float theta = sqrtf(theta2);
+        c = cosf(0.5f * theta);
+        s = sinf(0.5f * theta) / theta;
+    }
+    const float dw = c, dx = s * angle[0], dy = s * angle[1], dz = s * angle[2];
+
+    // ----- q * dq, the rotation is in the body frame
+    float w = q[0] * dw - q[1] * dx - q[2] * dy - q[3] * dz;
+    float x = q[0] * dx + q[1] * dw + q[2] * dz - q[3] * dy;
+    float y = q[0] * dy - q[1] * dz + q[2] * dw + q[3] * dx;
+    float z = q[0] * dz + q[1] * dy - q[2] * dx + q[3] * dw;
+
+    // the norm is kept by the rotation, only the rounding is taken away
+    const float norm = 1.0f / sqrtf(w * w + x * x + y * y + z * z);
+    q[0] = w * norm;
+    q[1] = x * norm;
+    q[2] = y * norm;
+    q[3] = z * norm;
+}
+
+/****************************************************************************
+ ****************************************************************************/
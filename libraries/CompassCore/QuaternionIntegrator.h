@@ -0,0 +1,133 @@
+/**
+ * @file QuaternionIntegrator.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Integration of a body rate into an attitude quaternion: Euler step, exponential map, coning
+ *
+ * The quaternion of an attitude filter follows the gyro, q' = 0.5 * q * (0, w). Three ways over a sample:
+ *      - EULER: q += 0.5 * q * (0, w) * dt, then normalized; the original Mahony code, its error grows with
+ *        the angle of a sample and only a high rate keeps it small
+ *      - EXPONENTIAL: q *= exp(0.5 * w * dt), the exact rotation of a rate constant over the sample
+ *      - CONING: the rate taken linear between the previous sample and this one: the rotation vector is the
+ *        mean of the two times dt plus the coning term (w0 x w1) * dt^2 / 12, then the exponential. Rolling
+ *        and pitching out of phase, as a hull on the waves, turn the yaw by a rotation no single rate has
+ * The exponential goes through a series below EXPONENTIAL_SERIES_ANGLE, exact in float for the angles of
+ * a sample and with no sinf / cosf, which the soft float of the ESP8266 pays dearly.
+ * integrate() is for the gyro samples, in order; rotate() for the other rates, e.g. the correction of a
+ * filter, which must not enter the coning term.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef QUATERNION_INTEGRATOR_H
+#define QUATERNION_INTEGRATOR_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const float EXPONENTIAL_SERIES_ANGLE = 0.5f;    // rad of a sample under which the series replaces sin and cos
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+enum class quaternion_integrator_t
+{
+    EULER,          // first order step and normalization
+    EXPONENTIAL,    // exact rotation of a constant rate
+    CONING          // rate linear over the sample, coning term, exponential
+};
+
+class QuaternionIntegrator
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name QuaternionIntegrator
+     * @brief QuaternionIntegrator: constructor, no previous sample
+     * @param [in] quaternion_integrator_t method
+     */
+    QuaternionIntegrator(quaternion_integrator_t method = quaternion_integrator_t::CONING);
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name setMethod / getMethod
+     * @brief integration method; the previous sample is forgotten
+     */
+    void setMethod(quaternion_integrator_t method);
+    quaternion_integrator_t getMethod() const { return method; }
+
+    /**
+     * @name reset
+     * @brief reset: previous sample forgotten, e.g. after a gap in the samples
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name integrate
+     * @brief integrate: one gyro sample
+     * @param [in,out] float q[4]: w, x, y, z, body to world
+     * @param [in] const float rate[3]: rad/s, body frame, at the end of the sample
+     * @param [in] float dt: s since the previous sample
+     * @retval None
+     */
+    void integrate(float q[4], const float rate[3], float dt);
+
+    /**
+     * @name rotate
+     * @brief rotate: a rate that is not a gyro sample, constant over dt; no coning term
+     * @param [in,out] float q[4]: w, x, y, z, body to world
+     * @param [in] const float rate[3]: rad/s, body frame
+     * @param [in] float dt: s
+     * @retval None
+     */
+    void rotate(float q[4], const float rate[3], float dt) const;
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    static void euler(float q[4], const float rate[3], float dt);
+    static void exponential(float q[4], const float angle[3]);
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    quaternion_integrator_t method;
+    float previous[3];              // rad/s, previous gyro sample
+    bool primed;                    // previous holds a sample
+
+}; /* QuaternionIntegrator */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* QUATERNION_INTEGRATOR_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,142 @@
+/**
+ * @file ResumeState.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief State of the heading filter kept across a reset in the RTC memory of the ESP8266
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "ResumeState.h"
+#include "MagCalibrationBlob.h"     // crc32Ieee, putU32 / getU32, putFloat / getFloat
+#if defined(ESP8266)
+extern "C" {
+#include <user_interface.h>
+}
+#endif
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+#if defined(ESP8266)
+const uint8_t RESUME_RTC_USER_START = 64;   // first word of the RTC user memory for the SDK
+#endif
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name serializeResumeState
+ * @brief serializeResumeState: write the state in the blob layout
+ * @param [in] const ResumeState &state: state to serialize
+ * @param [out] uint8_t buffer[RESUME_STATE_SIZE]: output buffer
+ * @retval None
+ */
+void serializeResumeState(const ResumeState &state, uint8_t *buffer)
+{
+    uint8_t *p = buffer;
+
+    p = putU32(p, RESUME_STATE_MAGIC);
+    *p++ = RESUME_STATE_VERSION & 0xFF;
+    *p++ = (RESUME_STATE_VERSION >> 8) & 0xFF;
+    *p++ = state.flags & 0xFF;
+    *p++ = (state.flags >> 8) & 0xFF;
+
+    for (int i = 0; i < 4; ++i) p = putFloat(p, state.quaternion[i]);
+    for (int i = 0; i < 3; ++i) p = putFloat(p, state.integral[i]);
+    for (int i = 0; i < 3; ++i) p = putFloat(p, state.gyroBias[i]);
+    for (int i = 0; i < 3; ++i) p = putFloat(p, state.gyroOffset[i]);
+    for (int i = 0; i < 3; ++i) p = putFloat(p, state.accelOffset[i]);
+    p = putFloat(p, state.calibrationTemperature);
+    p = putFloat(p, state.heading);
+
+    putU32(p, crc32Ieee(buffer, p - buffer));
+}
+
+/**
+ * @name deserializeResumeState
+ * @brief deserializeResumeState: read a state checking magic, version and CRC
+ * @param [in] const uint8_t *buffer: blob bytes
+ * @param [in] size_t size: number of bytes in buffer
+ * @param [out] ResumeState &state: decoded state
+ * @retval bool: true if the blob is valid
+ */
+bool deserializeResumeState(const uint8_t *buffer, size_t size, ResumeState &state)
+{
+    if (size < RESUME_STATE_SIZE)
+    {
+        return false;
+    }
+
+    uint32_t crc;
+    getU32(buffer + RESUME_STATE_SIZE - 4, crc);
+    if (crc != crc32Ieee(buffer, RESUME_STATE_SIZE - 4))
+    {
+        return false;
+    }
+
+    uint32_t magic;
+    const uint8_t *p = getU32(buffer, magic);
+    uint16_t version = p[0] | (p[1] << 8);
+    p += 2;
+    if (magic != RESUME_STATE_MAGIC || version != RESUME_STATE_VERSION)
+    {
+        return false;
+    }
+
+    state.flags = p[0] | (p[1] << 8);
+    p += 2;
+    for (int i = 0; i < 4; ++i) p = getFloat(p, state.quaternion[i]);
+    for (int i = 0; i < 3; ++i) p = getFloat(p, state.integral[i]);
+    for (int i = 0; i < 3; ++i) p = getFloat(p, state.gyroBias[i]);
+    for (int i = 0; i < 3; ++i) p = getFloat(p, state.gyroOffset[i]);
+    for (int i = 0; i < 3; ++i) p = getFloat(p, state.accelOffset[i]);
+    p = getFloat(p, state.calibrationTemperature);
+    getFloat(p, state.heading);
+
+    return true;
+}
+
+/**
+ * @name saveResumeState
+ * @brief saveResumeState: write the state in the RTC user memory
+ * @param [in] const ResumeState &state
+ * @retval None
+ */
+void saveResumeState(const ResumeState &state)
+{
+#if defined(ESP8266)
+    // the SDK copies whole aligned words
+    uint32_t words[RESUME_STATE_SIZE / 4];
+    serializeResumeState(state, (uint8_t *)words);
+    system_rtc_mem_write(RESUME_RTC_USER_START + RESUME_RTC_BLOCK, words, RESUME_STATE_SIZE);
+#else
+    (void)state;
+#endif
+}
+
+/**
+ * @name loadResumeState
+ * @brief loadResumeState: read the state of the RTC user memory, left there before a reset
+ * @param [out] ResumeState &state: state, unchanged if none
+ * @retval bool: true if a valid state was found
+ */
+bool loadResumeState(ResumeState &state)
+{
+#if defined(ESP8266)
+    uint32_t words[RESUME_STATE_SIZE / 4];
+    if (!system_rtc_mem_read(RESUME_RTC_USER_START + RESUME_RTC_BLOCK, words, RESUME_STATE_SIZE))
+    {
+        return false;
+    }
+    return deserializeResumeState((const uint8_t *)words, RESUME_STATE_SIZE, state);
+#else
+    (void)state;
+    return false;
+#endif
+}
+
+/****************************************************************************
+ ****************************************************************************/
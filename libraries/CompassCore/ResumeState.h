@@ -0,0 +1,113 @@
+/**
+ * @file ResumeState.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief State of the heading filter kept across a reset in the RTC memory of the ESP8266
+ *
+ * A watchdog or a soft reset clears the RAM but not the RTC user memory, nor the offset registers of the
+ * MPU9250: the filter can go on from where it was instead of calibrating and converging again. The state
+ * is written every few samples and read at boot; a power cycle leaves garbage in the RTC memory, which
+ * the magic, the version and the CRC32 reject.
+ * Each owner fills what it keeps and says so in the flags: the quaternion compass library its attitude and
+ * integral terms, the firmware its heading; both the zero-velocity bias and the boot offsets of the gyro
+ * and accelerometer, with the temperature they were found at. The fields of a flag not set are unused.
+ * The blob has the layout of MagCalibrationBlob, little-endian with a CRC32 on the end, and a size in
+ * whole words of the RTC memory. It sits past the first RESUME_RTC_BLOCK words, where the core keeps the
+ * boot command of an OTA update.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU;
+ *       on the host loadResumeState() finds nothing and saveResumeState() does nothing
+ *
+ */
+
+#ifndef RESUME_STATE_H
+#define RESUME_STATE_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint32_t RESUME_STATE_MAGIC   = 0x53524A53; // "SJRS" little-endian
+const uint16_t RESUME_STATE_VERSION = 1;
+const size_t   RESUME_STATE_SIZE    = 4 + 2 + 2 + 4 * 4 + 3 * 4 + 3 * 4 + 3 * 4 + 3 * 4 + 4 + 4 + 4;
+const uint8_t  RESUME_RTC_BLOCK     = 32;       // words of the RTC user memory before the state
+const unsigned long RESUME_SAVE_PERIOD_MS = 1000;   // the state is kept in the RTC memory for a reset at this period
+
+/* Flags stored in the state */
+const uint16_t RESUME_FLAG_ATTITUDE = 0x01;     // quaternion and integral
+const uint16_t RESUME_FLAG_HEADING  = 0x02;     // heading
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+struct ResumeState
+{
+    uint16_t flags;
+    float    quaternion[4];     // w, x, y, z, attitude of the filter
+    float    integral[3];       // integral terms of the filter
+    float    gyroBias[3];       // deg/s, zero-velocity bias of MotionDetector
+    float    gyroOffset[3];     // boot calibration of the gyro, in the unit of the owner
+    float    accelOffset[3];    // boot calibration of the accelerometer, in the unit of the owner
+    float    calibrationTemperature;    // degC of the boot calibration, the zero of the gyro temperature table
+    float    heading;           // deg
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/**
+ * @name serializeResumeState
+ * @brief serializeResumeState: write the state in the blob layout
+ * @param [in] const ResumeState &state: state to serialize
+ * @param [out] uint8_t buffer[RESUME_STATE_SIZE]: output buffer
+ * @retval None
+ */
+void serializeResumeState(const ResumeState &state, uint8_t *buffer);
+
+/**
+ * @name deserializeResumeState
+ * @brief deserializeResumeState: read a state checking magic, version and CRC
+ * @param [in] const uint8_t *buffer: blob bytes
+ * @param [in] size_t size: number of bytes in buffer
+ * @param [out] ResumeState &state: decoded state
+ * @retval bool: true if the blob is valid
+ */
+bool deserializeResumeState(const uint8_t *buffer, size_t size, ResumeState &state);
+
+/**
+ * @name saveResumeState
+ * @brief saveResumeState: write the state in the RTC user memory
+ * @param [in] const ResumeState &state
+ * @retval None
+ */
+void saveResumeState(const ResumeState &state);
+
+/**
+ * @name loadResumeState
+ * @brief loadResumeState: read the state of the RTC user memory, left there before a reset
+ * @param [out] ResumeState &state: state, unchanged if none
+ * @retval bool: true if a valid state was found
+ */
+bool loadResumeState(ResumeState &state);
+
+
+#endif /* RESUME_STATE_H */
+
+/****************************************************************************
+ ****************************************************************************/
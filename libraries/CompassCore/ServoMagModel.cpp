@@ -0,0 +1,213 @@
+/**
+ * @file ServoMagModel.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetometer bias caused by the servo, versus the needle angle
+ *
+ * A sample goes to the nearest bin; the table is circular, the bin after the last one is the first.
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "ServoMagModel.h"
+#include <math.h>
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+static float binPosition(float servoAngle);
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name ServoMagModel
+ * @brief ServoMagModel: constructor, empty table: no correction
+ */
+ServoMagModel::ServoMagModel()
+{
+    valid = false;
+    for (int k = 0; k < SERVO_MAG_BINS; ++k)
+    {
+        for (int i = 0; i < 3; ++i) table[k][i] = 0.0f;
+    }
+    reset();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name reset
+ * @brief reset: forget the samples of the sweep, the table in use is kept
+ * @retval None
+ */
+void ServoMagModel::reset()
+{
+    for (int k = 0; k < SERVO_MAG_BINS; ++k)
+    {
+        counts[k] = 0;
+        for (int i = 0; i < 3; ++i) sums[k][i] = 0.0f;
+    }
+}
+
+/**
+ * @name addSample
+ * @brief addSample: add a calibrated magnetometer sample taken with the needle still
+ * @param [in] float servoAngle: deg, servo frame, any range
+ * @param [in] const float mag[3]: calibrated sample, without this model
+ * @retval None
+ */
+void ServoMagModel::addSample(float servoAngle, const float mag[3])
+{
+    int k = (int)floorf(binPosition(servoAngle) + 0.5f);
+    if (k >= SERVO_MAG_BINS) k = 0;
+    if (counts[k] == 0xFFFF) return;
+
+    counts[k]++;
+    for (int i = 0; i < 3; ++i) sums[k][i] += mag[i];
+}
+
+/**
+ * @name coverage
+ * @brief coverage: fraction of bins with SERVO_MAG_MIN_SAMPLES samples
+ * @retval float: 0 to 1
+ */
+float ServoMagModel::coverage() const
+{
+    int filled = 0;
+    for (int k = 0; k < SERVO_MAG_BINS; ++k)
+    {
+        if (counts[k] >= SERVO_MAG_MIN_SAMPLES) filled++;
+    }
+    return (float)filled / SERVO_MAG_BINS;
+}
+
+/**
+ * @name fit
+ * @brief fit: build the table from the samples; the table in use is kept if a bin is short of samples
+ * @retval bool: true if every bin had enough samples
+ */
+bool ServoMagModel::fit()
+{
+    if (coverage() < 1.0f)
+    {
+        return false;
+    }
+
+    // ----- Mean of each bin, then the mean of the bins: the static part belongs to the calibration
+    float means[SERVO_MAG_BINS][3];
+    float overall[3] = {0.0f, 0.0f, 0.0f};
+    for (int k = 0; k < SERVO_MAG_BINS; ++k)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            means[k][i] = sums[k][i] / counts[k];
+            overall[i] += means[k][i] / SERVO_MAG_BINS;
+        }
+    }
+    for (int k = 0; k < SERVO_MAG_BINS; ++k)
+    {
+        for (int i = 0; i < 3; ++i) table[k][i] = means[k][i] - overall[i];
+    }
+    valid = true;
+    return true;
+}
+
+/**
+ * @name getBias
+ * @brief getBias: bias at a servo angle, interpolated between two bins
+ * @param [in] float servoAngle: deg, servo frame, any range
+ * @param [out] float bias[3]: bias, same unit of the samples; zero with an empty table
+ * @retval None
+ */
+void ServoMagModel::getBias(float servoAngle, float bias[3]) const
+{
+    if (!valid)
+    {
+        bias[0] = bias[1] = bias[2] = 0.0f;
+        return;
+    }
+
+    const float position = binPosition(servoAngle);
+    int k = (int)floorf(position);
+    const float fraction = position - k;
+    if (k >= SERVO_MAG_BINS) k = 0;
+    const int next = (k + 1 < SERVO_MAG_BINS) ? k + 1 : 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        bias[i] = table[k][i] + fraction * (table[next][i] - table[k][i]);
+    }
+}
+
+/**
+ * @name apply
+ * @brief apply: take the bias at a servo angle away from a calibrated sample
+ * @param [in] float servoAngle: deg, servo frame, any range
+ * @param [in,out] float mag[3]: calibrated sample
+ * @retval None
+ */
+void ServoMagModel::apply(float servoAngle, float mag[3]) const
+{
+    if (!valid)
+    {
+        return;
+    }
+    float bias[3];
+    getBias(servoAngle, bias);
+    for (int i = 0; i < 3; ++i) mag[i] -= bias[i];
+}
+
+/**
+ * @name getMaxBias
+ * @brief getMaxBias: largest bias norm of the table, how much the servo pulls the field
+ * @retval float: same unit of the samples
+ */
+float ServoMagModel::getMaxBias() const
+{
+    float largest = 0.0f;
+    for (int k = 0; k < SERVO_MAG_BINS; ++k)
+    {
+        const float norm = sqrtf(table[k][0] * table[k][0] + table[k][1] * table[k][1] + table[k][2] * table[k][2]);
+        if (norm > largest) largest = norm;
+    }
+    return largest;
+}
+
+void ServoMagModel::getTable(float table[SERVO_MAG_BINS][3]) const
+{
+    for (int k = 0; k < SERVO_MAG_BINS; ++k)
+    {
+        for (int i = 0; i < 3; ++i) table[k][i] = this->table[k][i];
+    }
+}
+
+void ServoMagModel::setTable(const float table[SERVO_MAG_BINS][3])
+{
+    for (int k = 0; k < SERVO_MAG_BINS; ++k)
+    {
+        for (int i = 0; i < 3; ++i) this->table[k][i] = table[k][i];
+    }
+    valid = true;
+}
+
+/*******************
+ * PRIVATE FUNCTIONS
+*******************/
+/**
+ * @name binPosition
+ * @brief binPosition: servo angle in bins, 0 to SERVO_MAG_BINS
+ * @param [in] float servoAngle: deg, any range
+ * @retval float
+ */
+static float binPosition(float servoAngle)
+{
+    float angle = fmodf(servoAngle, 360.0f);
+    if (angle < 0.0f) angle += 360.0f;
+    return angle / SERVO_MAG_BIN_WIDTH;
+}
+
+/****************************************************************************
+ ****************************************************************************/
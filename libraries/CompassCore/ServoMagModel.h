@@ -0,0 +1,154 @@
+/**
+ * @file ServoMagModel.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Magnetometer bias caused by the servo, versus the needle angle
+ *
+ * The servo sits a few centimetres from the magnetometer and its magnet turns with the needle: the
+ * hard-iron offset depends on the servo angle. The model is a table of SERVO_MAG_BINS biases, one every
+ * SERVO_MAG_BIN_WIDTH degrees of the servo frame, learned from a sweep with the hull still: the samples
+ * of each bin are averaged and the mean of all the bins is taken away, so the table only keeps the part
+ * that turns with the needle and the static calibration keeps the rest.
+ * The bias between two bins is interpolated; apply() takes it away from a calibrated sample.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef SERVO_MAG_MODEL_H
+#define SERVO_MAG_MODEL_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint8_t  SERVO_MAG_BINS        = 36;
+const float    SERVO_MAG_BIN_WIDTH   = 360.0f / SERVO_MAG_BINS;    // deg of the servo frame
+const uint16_t SERVO_MAG_MIN_SAMPLES = 8;                           // per bin, to fit
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class ServoMagModel
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name ServoMagModel
+     * @brief ServoMagModel: constructor, empty table: no correction
+     */
+    ServoMagModel();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name reset
+     * @brief reset: forget the samples of the sweep, the table in use is kept
+     * @retval None
+     */
+    void reset();
+
+    /**
+     * @name addSample
+     * @brief addSample: add a calibrated magnetometer sample taken with the needle still
+     * @param [in] float servoAngle: deg, servo frame, any range
+     * @param [in] const float mag[3]: calibrated sample, without this model
+     * @retval None
+     */
+    void addSample(float servoAngle, const float mag[3]);
+
+    /**
+     * @name coverage
+     * @brief coverage: fraction of bins with SERVO_MAG_MIN_SAMPLES samples
+     * @retval float: 0 to 1
+     */
+    float coverage() const;
+
+    /**
+     * @name fit
+     * @brief fit: build the table from the samples; the table in use is kept if a bin is short of samples
+     * @retval bool: true if every bin had enough samples
+     */
+    bool fit();
+
+    /**
+     * @name getBias
+     * @brief getBias: bias at a servo angle, interpolated between two bins
+     * @param [in] float servoAngle: deg, servo frame, any range
+     * @param [out] float bias[3]: bias, same unit of the samples; zero with an empty table
+     * @retval None
+     */
+    void getBias(float servoAngle, float bias[3]) const;
+
+    /**
+     * @name apply
+     * @brief apply: take the bias at a servo angle away from a calibrated sample
+     * @param [in] float servoAngle: deg, servo frame, any range
+     * @param [in,out] float mag[3]: calibrated sample
+     * @retval None
+     */
+    void apply(float servoAngle, float mag[3]) const;
+
+    /**
+     * @name getMaxBias
+     * @brief getMaxBias: largest bias norm of the table, how much the servo pulls the field
+     * @retval float: same unit of the samples
+     */
+    float getMaxBias() const;
+
+    /**
+     * @name getTable / setTable
+     * @brief table of the bias of each bin, bin k centred at k * SERVO_MAG_BIN_WIDTH; setTable makes it valid
+     */
+    void getTable(float table[SERVO_MAG_BINS][3]) const;
+    void setTable(const float table[SERVO_MAG_BINS][3]);
+
+    /**
+     * @name isValid
+     * @brief isValid: the table comes from a fit or setTable
+     * @retval bool
+     */
+    bool isValid() const { return valid; }
+
+
+private:
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    bool valid;
+    float table[SERVO_MAG_BINS][3];
+
+    // ----- Sweep
+    float sums[SERVO_MAG_BINS][3];
+    uint16_t counts[SERVO_MAG_BINS];
+
+}; /* ServoMagModel */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* SERVO_MAG_MODEL_H */
+
+/****************************************************************************
+ ****************************************************************************/
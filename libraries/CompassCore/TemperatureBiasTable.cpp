@@ -0,0 +1,280 @@
+/**
+ * @file TemperatureBiasTable.cpp
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Sensor bias versus die temperature, piecewise linear, learned while the compass is stationary
+ *
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "TemperatureBiasTable.h"
+#include <math.h>
+
+/*******************
+ * CONSTRUCTOR & DESTRUCTOR METHODS
+*******************/
+/**
+ * @name TemperatureBiasTable
+ * @brief TemperatureBiasTable: constructor, empty table: no correction
+ */
+TemperatureBiasTable::TemperatureBiasTable()
+{
+    clear();
+}
+
+/*******************
+ * PUBLIC METHODS
+*******************/
+/**
+ * @name clear
+ * @brief clear: forget every node
+ * @retval None
+ */
+void TemperatureBiasTable::clear()
+{
+    for (uint8_t k = 0; k < TEMP_BIAS_NODES; ++k)
+    {
+        weight[k] = 0.0f;
+        for (uint8_t i = 0; i < 3; ++i) table[k][i] = 0.0f;
+    }
+    changeTime = 0.0f;
+    restartChange();
+}
+
+/**
+ * @name learn
+ * @brief learn: one sample of the bias, e.g. the gyro while stationary
+ * @param [in] float temperature: degC
+ * @param [in] const float bias[3]: bias at that temperature
+ * @param [in] float dt: s the sample stands for
+ * @retval None
+ */
+void TemperatureBiasTable::learn(float temperature, const float bias[3], float dt)
+{
+    if (dt <= 0.0f)
+    {
+        return;
+    }
+    uint8_t lower;
+    float fraction;
+    locate(temperature, lower, fraction);
+    pull(lower, 1.0f - fraction, bias, dt);
+    pull(lower + 1, fraction, bias, dt);
+}
+
+/**
+ * @name learnChange
+ * @brief learnChange: one sample of a sensor whose bias is only seen by its change, e.g. the magnetometer
+ *                     while stationary; the samples up to restartChange() are one window
+ * @param [in] float temperature: degC
+ * @param [in] const float value[3]: sample, without the correction of this table
+ * @param [in] float dt: s the sample stands for
+ * @retval None
+ */
+void TemperatureBiasTable::learnChange(float temperature, const float value[3], float dt)
+{
+    if (dt <= 0.0f)
+    {
+        return;
+    }
+    if (changeTime == 0.0f)
+    {
+        changeMin = temperature;
+        changeMax = temperature;
+        changeOrigin = temperature;
+        for (uint8_t i = 0; i < 3; ++i) changeValue[i] = value[i];
+    }
+    // sums about the first sample, the floats keep their digits
+    const float t = temperature - changeOrigin;
+    changeTime += dt;
+    changeSumT += dt * t;
+    changeSumTT += dt * t * t;
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        const float v = value[i] - changeValue[i];
+        changeSumV[i] += dt * v;
+        changeSumTV[i] += dt * t * v;
+    }
+    if (temperature < changeMin) changeMin = temperature;
+    if (temperature > changeMax) changeMax = temperature;
+}
+
+/**
+ * @name restartChange
+ * @brief restartChange: end of a learnChange() window, e.g. the hull turned; the slope of the window is
+ *                       learned if the temperature moved by TEMP_BIAS_CHANGE_SPAN
+ * @retval None
+ */
+void TemperatureBiasTable::restartChange()
+{
+    if (changeTime > 0.0f && changeMax - changeMin >= TEMP_BIAS_CHANGE_SPAN)
+    {
+        // ----- Least squares slope of the window, bias per degree
+        const float meanT = changeSumT / changeTime;
+        const float varianceT = changeSumTT / changeTime - meanT * meanT;
+        uint8_t lower;
+        float fraction;
+        locate(changeOrigin + meanT, lower, fraction);
+
+        // ----- The segment of the window takes the slope: the nodes on each side move with its ends, the other
+        // segments keep their slopes and the level of the segment stays where it is
+        const float seen = 0.5f * (weight[lower] + weight[lower + 1]);
+        const float mean = changeTime / (seen + changeTime);
+        const float decay = 1.0f - expf(-changeTime / TEMP_BIAS_TIME);
+        const float gain = (mean > decay) ? mean : decay;
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            const float slope = (changeSumTV[i] / changeTime - meanT * changeSumV[i] / changeTime) / varianceT;
+            const float error = slope * TEMP_BIAS_STEP - (table[lower + 1][i] - table[lower][i]);
+            for (uint8_t k = 0; k < TEMP_BIAS_NODES; ++k)
+            {
+                table[k][i] += (k <= lower) ? -0.5f * gain * error : 0.5f * gain * error;
+            }
+        }
+        weight[lower] += (1.0f - fraction) * changeTime;
+        weight[lower + 1] += fraction * changeTime;
+        if (weight[lower] > TEMP_BIAS_MAX_WEIGHT) weight[lower] = TEMP_BIAS_MAX_WEIGHT;
+        if (weight[lower + 1] > TEMP_BIAS_MAX_WEIGHT) weight[lower + 1] = TEMP_BIAS_MAX_WEIGHT;
+    }
+    changeTime = 0.0f;
+    changeSumT = 0.0f;
+    changeSumTT = 0.0f;
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        changeSumV[i] = 0.0f;
+        changeSumTV[i] = 0.0f;
+    }
+}
+
+/**
+ * @name rebase
+ * @brief rebase: the bias is zero at this temperature, e.g. just after a calibration; the curve shifts
+ * @param [in] float temperature: degC
+ * @retval None
+ */
+void TemperatureBiasTable::rebase(float temperature)
+{
+    float offset[3];
+    getBias(temperature, offset);
+    for (uint8_t k = 0; k < TEMP_BIAS_NODES; ++k)
+    {
+        if (weight[k] <= 0.0f) continue;
+        for (uint8_t i = 0; i < 3; ++i) table[k][i] -= offset[i];
+    }
+    restartChange();
+}
+
+/**
+ * @name getBias
+ * @brief getBias: bias at a temperature, zero with an empty table
+ * @param [in] float temperature: degC
+ * @param [out] float bias[3]
+ * @retval None
+ */
+void TemperatureBiasTable::getBias(float temperature, float bias[3]) const
+{
+    const float x = (temperature - TEMP_BIAS_MIN) / TEMP_BIAS_STEP;
+
+    // ----- Learned nodes around the temperature
+    int8_t lower = -1;
+    int8_t upper = -1;
+    for (uint8_t k = 0; k < TEMP_BIAS_NODES; ++k)
+    {
+        if (weight[k] < TEMP_BIAS_MIN_WEIGHT) continue;
+        if (k <= x) lower = k;
+        else if (upper < 0) upper = k;
+    }
+
+    if (lower < 0 && upper < 0)
+    {
+        for (uint8_t i = 0; i < 3; ++i) bias[i] = 0.0f;
+    }
+    else if (lower < 0 || upper < 0)
+    {
+        // out of the learned range: the nearest node, a slope would run away
+        const uint8_t k = (lower < 0) ? upper : lower;
+        for (uint8_t i = 0; i < 3; ++i) bias[i] = table[k][i];
+    }
+    else
+    {
+        const float fraction = (x - lower) / (upper - lower);
+        for (uint8_t i = 0; i < 3; ++i) bias[i] = table[lower][i] + fraction * (table[upper][i] - table[lower][i]);
+    }
+}
+
+/**
+ * @name isEmpty
+ * @brief isEmpty: no node has TEMP_BIAS_MIN_WEIGHT
+ */
+bool TemperatureBiasTable::isEmpty() const
+{
+    for (uint8_t k = 0; k < TEMP_BIAS_NODES; ++k)
+    {
+        if (weight[k] >= TEMP_BIAS_MIN_WEIGHT) return false;
+    }
+    return true;
+}
+
+/**
+ * @name getTable / setTable
+ * @brief bias and weight (s) of each node, node k at TEMP_BIAS_MIN + k * TEMP_BIAS_STEP
+ */
+void TemperatureBiasTable::getTable(float table[TEMP_BIAS_NODES][3], float weight[TEMP_BIAS_NODES]) const
+{
+    for (uint8_t k = 0; k < TEMP_BIAS_NODES; ++k)
+    {
+        weight[k] = this->weight[k];
+        for (uint8_t i = 0; i < 3; ++i) table[k][i] = this->table[k][i];
+    }
+}
+
+void TemperatureBiasTable::setTable(const float table[TEMP_BIAS_NODES][3], const float weight[TEMP_BIAS_NODES])
+{
+    for (uint8_t k = 0; k < TEMP_BIAS_NODES; ++k)
+    {
+        this->weight[k] = (weight[k] > TEMP_BIAS_MAX_WEIGHT) ? TEMP_BIAS_MAX_WEIGHT : weight[k];
+        for (uint8_t i = 0; i < 3; ++i) this->table[k][i] = table[k][i];
+    }
+    changeTime = 0.0f;
+    restartChange();
+}
+
+/*******************
+ * PRIVATE METHODS
+*******************/
+/**
+ * @name locate
+ * @brief locate: segment of a temperature, clamped to the table; lower node and fraction towards the next one
+ */
+void TemperatureBiasTable::locate(float temperature, uint8_t &lower, float &fraction) const
+{
+    float x = (temperature - TEMP_BIAS_MIN) / TEMP_BIAS_STEP;
+    if (x < 0.0f) x = 0.0f;
+    if (x > TEMP_BIAS_NODES - 1) x = TEMP_BIAS_NODES - 1;
+    lower = (uint8_t)x;
+    if (lower > TEMP_BIAS_NODES - 2) lower = TEMP_BIAS_NODES - 2;
+    fraction = x - lower;
+}
+
+/**
+ * @name pull
+ * @brief pull: node towards a sample by its share; a mean while the node is young, then over TEMP_BIAS_TIME
+ */
+void TemperatureBiasTable::pull(uint8_t node, float share, const float bias[3], float dt)
+{
+    if (share <= 0.0f)
+    {
+        return;
+    }
+    const float mean = share * dt / (weight[node] + share * dt);
+    const float decay = share * (1.0f - expf(-dt / TEMP_BIAS_TIME));
+    const float alpha = (mean > decay) ? mean : decay;
+    for (uint8_t i = 0; i < 3; ++i) table[node][i] += alpha * (bias[i] - table[node][i]);
+    weight[node] += share * dt;
+    if (weight[node] > TEMP_BIAS_MAX_WEIGHT) weight[node] = TEMP_BIAS_MAX_WEIGHT;
+}
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,178 @@
+/**
+ * @file TemperatureBiasTable.h
+ * @author Emanuele Belia
+ * @date 19 October 2026
+ * @brief Sensor bias versus die temperature, piecewise linear, learned while the compass is stationary
+ *
+ * The bias of the gyro, and a little the one of the magnetometer, follow the temperature of the die, and
+ * an enclosure in the sun warms by tens of degrees over an afternoon. The table keeps a 3-axis bias every
+ * TEMP_BIAS_STEP degrees from TEMP_BIAS_MIN; getBias() interpolates between the two learned nodes around
+ * the temperature, and holds the nearest one out of them.
+ * It is learned while the hull does not turn, each sample pulled into the two nodes around its
+ * temperature, by their share, over TEMP_BIAS_TIME: long, the table averages the moorings of many days and
+ * the zero-velocity bias of MotionDetector takes care of what is left:
+ *      - learn(): the gyro, stationary it reads its own bias
+ *      - learnChange(): the magnetometer, whose bias is not seen alone, only its change: while the hull
+ *        does not turn the field moves only by the bias; the least squares slope of such a window, from
+ *        learnChange() to restartChange(), is given to the segment of its mean temperature, whose level
+ *        stays where it is: the level of the table is the one of the calibration, zero. A hull swinging
+ *        slowly turns the field far more than the temperature does: the caller ends the window on the
+ *        smallest turn it can see
+ * The gyro is zeroed by the calibration at boot, so its table is taken back to zero at the boot
+ * temperature by rebase(); the shape of the curve is a property of the chip and stays valid.
+ * getTable() / setTable() move the table to and from flash.
+ *
+ * @note This file has no Arduino dependency, so it can be built on the host as well as on the MCU
+ *
+ */
+
+#ifndef TEMPERATURE_BIAS_TABLE_H
+#define TEMPERATURE_BIAS_TABLE_H
+
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdint.h>
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+const uint8_t TEMP_BIAS_NODES       = 17;
+const float   TEMP_BIAS_MIN         = -10.0f;   // degC, first node
+const float   TEMP_BIAS_STEP        = 5.0f;     // degC between two nodes, the last at 70
+const float   TEMP_BIAS_TIME        = 600.0f;   // s, time constant of a node fully in the samples
+const float   TEMP_BIAS_MIN_WEIGHT  = 10.0f;    // s of samples for a node to be used
+const float   TEMP_BIAS_MAX_WEIGHT  = 3600.0f;  // s, weight kept of a node
+const float   TEMP_BIAS_CHANGE_SPAN = 1.0f;     // degC a learnChange() window must cover to give a slope
+const float   TEMPERATURE_MAG_TURN_LIMIT = 0.5f; // deg turned on the gyro that ends a learnChange() window
+const unsigned long TEMPERATURE_PERIOD_MS = 1000;   // the die temperature, and the bias of the tables, follow at this period
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+class TemperatureBiasTable
+{
+public:
+    /*******************
+     * CONSTRUCTOR & DESTRUCTOR METHODS
+    *******************/
+    /**
+     * @name TemperatureBiasTable
+     * @brief TemperatureBiasTable: constructor, empty table: no correction
+     */
+    TemperatureBiasTable();
+
+    /*******************
+     * PUBLIC METHODS
+    *******************/
+    /**
+     * @name clear
+     * @brief clear: forget every node
+     * @retval None
+     */
+    void clear();
+
+    /**
+     * @name learn
+     * @brief learn: one sample of the bias, e.g. the gyro while stationary
+     * @param [in] float temperature: degC
+     * @param [in] const float bias[3]: bias at that temperature
+     * @param [in] float dt: s the sample stands for
+     * @retval None
+     */
+    void learn(float temperature, const float bias[3], float dt);
+
+    /**
+     * @name learnChange
+     * @brief learnChange: one sample of a sensor whose bias is only seen by its change, e.g. the magnetometer
+     *                     while stationary; the samples up to restartChange() are one window
+     * @param [in] float temperature: degC
+     * @param [in] const float value[3]: sample, without the correction of this table
+     * @param [in] float dt: s the sample stands for
+     * @retval None
+     */
+    void learnChange(float temperature, const float value[3], float dt);
+
+    /**
+     * @name restartChange
+     * @brief restartChange: end of a learnChange() window, e.g. the hull turned; the slope of the window is
+     *                       learned if the temperature moved by TEMP_BIAS_CHANGE_SPAN
+     * @retval None
+     */
+    void restartChange();
+
+    /**
+     * @name rebase
+     * @brief rebase: the bias is zero at this temperature, e.g. just after a calibration; the curve shifts
+     * @param [in] float temperature: degC
+     * @retval None
+     */
+    void rebase(float temperature);
+
+    /**
+     * @name getBias
+     * @brief getBias: bias at a temperature, zero with an empty table
+     * @param [in] float temperature: degC
+     * @param [out] float bias[3]
+     * @retval None
+     */
+    void getBias(float temperature, float bias[3]) const;
+
+    /**
+     * @name isEmpty
+     * @brief isEmpty: no node has TEMP_BIAS_MIN_WEIGHT
+     */
+    bool isEmpty() const;
+
+    /**
+     * @name getTable / setTable
+     * @brief bias and weight (s) of each node, node k at TEMP_BIAS_MIN + k * TEMP_BIAS_STEP
+     */
+    void getTable(float table[TEMP_BIAS_NODES][3], float weight[TEMP_BIAS_NODES]) const;
+    void setTable(const float table[TEMP_BIAS_NODES][3], const float weight[TEMP_BIAS_NODES]);
+
+
+private:
+    /*******************
+     * PRIVATE METHODS
+    *******************/
+    void locate(float temperature, uint8_t &lower, float &fraction) const;
+    void pull(uint8_t node, float share, const float bias[3], float dt);
+
+    /*******************
+     * PRIVATE VARIABLES
+    *******************/
+    float table[TEMP_BIAS_NODES][3];
+    float weight[TEMP_BIAS_NODES];      // s of samples
+
+    // ----- learnChange window, sums weighted by the time of the samples, about the first one
+    float changeTime;                   // s
+    float changeOrigin;                 // degC of the first sample
+    float changeValue[3];               // first sample
+    float changeMin, changeMax;         // degC
+    float changeSumT, changeSumTT;
+    float changeSumV[3], changeSumTV[3];
+
+}; /* TemperatureBiasTable */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+
+#endif /* TEMPERATURE_BIAS_TABLE_H */
+
+/****************************************************************************
+ ****************************************************************************/
@@ -0,0 +1,38 @@
+/**
+ * @file compass_mag_calibration.h
+ * @brief Magnetometer calibration of unit "compass", shared by JackSparrowsCompass and compass_servo
+ *
+ * Capture: calibration of the compass in use, fitted before compass_cal_cli (Processing compass_cal.pde)
+ * Method: minmax, per axis offset and scale only; no field radius
+ *
+ * calibrated = Mag_soft_iron * (raw - Mag_offset)
+ * MPU9250::setMagCalibration(Mag_offset, Mag_soft_iron) loads the full matrix,
+ * Mag_*_scale is its diagonal, for sketches with per axis scale-factors only
+ *
+ * A new calibration of the unit replaces this file with the one of compass_cal_cli --name compass
+ */
+
+#ifndef MAG_CALIBRATION_COMPASS_H
+#define MAG_CALIBRATION_COMPASS_H
+
+const float
+Mag_x_offset = 208.03,
+Mag_y_offset = -108.94,
+Mag_z_offset = -611.47,
+Mag_x_scale = 1.2461473,
+Mag_y_scale = 1.1814733,
+Mag_z_scale = 0.74012357;
+
+float const Mag_offset[3] =
+{
+    208.03, -108.94, -611.47
+};
+
+float const Mag_soft_iron[3][3] =
+{
+    {1.2461473, 0, 0},
+    {0, 1.1814733, 0},
+    {0, 0, 0.74012357}
+};
+
+#endif /* MAG_CALIBRATION_COMPASS_H */